@@ -12,45 +12,11 @@
 AssimpTest::AssimpTest()
     : window::Application(graphics::GraphicsAPI::Type::VULKAN)
 {
-	file::Model bunny;
-	bunny.Load("bunny.obj");
+	const std::shared_ptr<const file::Model> bunny = assetRegistry_->AcquireModel("bunny.obj");
 
 	utility::ShaderCompiler::CompileShaders("shader/", "shader/bin/");
 
-	graphics::Mesh::Layout meshLayout;
-	meshLayout.vertices_ = bunny.meshes_[0].vertices_;
-	meshLayout.indices_ = bunny.meshes_[0].indices_;
-	mesh_ = graphicsAPI_->CreateMesh(meshLayout);
-
-	utility::ByteBuffer::Layout modelViewMatrixLayout;
-	modelViewMatrixLayout.AddAttribute<math::Matrix>();
-	modelViewMatrixLayout.AddAttribute<math::Matrix>();
-	mvBuffer_.SetLayout(modelViewMatrixLayout);
-	mvBuffer_.Add();
-
-	utility::ByteBuffer::Layout projectionMatrixLayout;
-	projectionMatrixLayout.AddAttribute<math::Matrix>();
-	pBuffer_.SetLayout(projectionMatrixLayout);
-	pBuffer_.Add();
-
-	graphics::UniformBuffer::Layout modelViewUBLayout;
-	modelViewUBLayout.size_ = (uint32_t)modelViewMatrixLayout.GetSizeInBytes();
-	modelViewUBLayout.persistentMapping_ = true;
-	modelViewUniformBuffer_ = graphicsAPI_->CreateUniformBuffer(modelViewUBLayout);
-
-	graphics::UniformBuffer::Layout projectionUBLayout;
-	projectionUBLayout.size_ = (uint32_t)projectionMatrixLayout.GetSizeInBytes();
-	projectionUBLayout.persistentMapping_ = true;
-	projectionUniformBuffer_ = graphicsAPI_->CreateUniformBuffer(projectionUBLayout);
-
-	math::Matrix modelMatrix;
-	modelMatrix = math::Matrix::Scale(5.0f);
-	modelMatrix *= math::Matrix::Translation(math::Vector(0.0f, 0.0f, 2.0f, 0.0f));
-	mvBuffer_.At(0).Get<math::Matrix>(0) = modelMatrix;
-	mvBuffer_.At(0).Get<math::Matrix>(1) = math::Matrix::Identity();
-	pBuffer_.At(0).Get<math::Matrix>(0) = math::Matrix::Projection(0.1f, 100.0f, 90.0f, 1.777777f, true);
-	modelViewUniformBuffer_->Update(mvBuffer_.GetRawBufferAddress());
-	projectionUniformBuffer_->Update(pBuffer_.GetRawBufferAddress());
+	mesh_ = assetRegistry_->AcquireMesh(bunny->meshes_[0]);
 
 	graphics::ShaderDescriptor::Output colorOutput{};
 	colorOutput.width_ = 1600;
@@ -63,32 +29,44 @@ AssimpTest::AssimpTest()
 	depthOutput.format_ = graphics::ImageFormat::D32_SFLOAT_U8_UINT;
 	depthOutput.usage_ = graphics::ImageUsage::DEPTH_STENCIL;
 
+	// bindings come from the shaders themselves
 	graphics::Pipeline::Layout pipelineLayout;
 	pipelineLayout.primitiveTopology_ = graphics::PrimitiveTopology::TRIANGLE_LIST;
 	pipelineLayout.vertexShaderPath_ = L"shader/bin/model.vert.spv";
 	pipelineLayout.pixelShaderPath_ = L"shader/bin/model.frag.spv";
-	pipelineLayout.vertexInputLayout_ = bunny.meshes_[0].vertices_.GetLayout().value();
+	pipelineLayout.vertexInputLayout_ = bunny->meshes_[0].vertices_.GetLayout().value();
 	pipelineLayout.depthFunc_ = graphics::ComparisonFunc::LESS_EQUAL;
 	pipelineLayout.shaderDescriptor_.outputs.push_back(colorOutput);
 	pipelineLayout.shaderDescriptor_.outputs.push_back(depthOutput);
+	pipeline_ = graphicsAPI_->CreatePipeline(pipelineLayout);
+
+	const graphics::ShaderReflection& reflection = pipeline_->GetReflection();
+	mvBuffer_.SetLayout(reflection.FindUniformBlock("MVTransform")->CreateLayout());
+	mvBuffer_.Add();
+	pBuffer_.SetLayout(reflection.FindUniformBlock("PTransform")->CreateLayout());
+	pBuffer_.Add();
 
-	graphics::ShaderDescriptor::Binding binding;
-	binding.stage_ = graphics::ShaderStage::VERTEX;
-	binding.type_ = graphics::ShaderBinding::Type::UNIFORM_BUFFER;
-	binding.slot_ = 0;
-	pipelineLayout.shaderDescriptor_.bindings_.push_back(binding);
+	graphics::UniformBuffer::Layout modelViewUBLayout;
+	modelViewUBLayout.size_ = (uint32_t)mvBuffer_.GetElementSize();
+	modelViewUBLayout.persistentMapping_ = true;
+	modelViewUniformBuffer_ = graphicsAPI_->CreateUniformBuffer(modelViewUBLayout);
 
-	binding.slot_ = 1;
-	pipelineLayout.shaderDescriptor_.bindings_.push_back(binding);
+	graphics::UniformBuffer::Layout projectionUBLayout;
+	projectionUBLayout.size_ = (uint32_t)pBuffer_.GetElementSize();
+	projectionUBLayout.persistentMapping_ = true;
+	projectionUniformBuffer_ = graphicsAPI_->CreateUniformBuffer(projectionUBLayout);
 
-	binding.stage_ = graphics::ShaderStage::PIXEL;
-	binding.type_ = graphics::ShaderBinding::Type::TEXTURE_2D;
-	binding.slot_ = 2;
-	pipelineLayout.shaderDescriptor_.bindings_.push_back(binding);
+	math::Matrix modelMatrix;
+	modelMatrix = math::Matrix::Scale(5.0f);
+	modelMatrix *= math::Matrix::Translation(math::Vector(0.0f, 0.0f, 2.0f, 0.0f));
+	mvBuffer_.At(0).Get<math::Matrix>(0) = modelMatrix;
+	mvBuffer_.At(0).Get<math::Matrix>(1) = math::Matrix::Identity();
+	pBuffer_.At(0).Get<math::Matrix>(0) = math::Matrix::Projection(0.1f, 100.0f, 90.0f, 1.777777f, true);
+	modelViewUniformBuffer_->Update(mvBuffer_.GetRawBufferAddress());
+	projectionUniformBuffer_->Update(pBuffer_.GetRawBufferAddress());
 
-	pipeline_ = graphicsAPI_->CreatePipeline(pipelineLayout);
-	pipeline_->BindShaderBinding(modelViewUniformBuffer_, 0);
-	pipeline_->BindShaderBinding(projectionUniformBuffer_, 1);
+	pipeline_->BindShaderBinding(modelViewUniformBuffer_, "MVTransform");
+	pipeline_->BindShaderBinding(projectionUniformBuffer_, "PTransform");
 
 	renderPass_ = graphicsAPI_->CreateRenderPass();
 	renderPass_->SetPipeline(pipeline_, *graphicsAPI_);
@@ -98,9 +76,9 @@ AssimpTest::AssimpTest()
 	textureLayout.initializationType_ = graphics::Texture::InitializationType::BUFFER;
 	defaultTexture_ = graphicsAPI_->CreateTexture(textureLayout);
 
-	defaultMaterial_ = graphicsAPI_->CreateMaterial();
-	defaultMaterial_->SetFixedBinding(graphics::Material::FixedBindingIndex::DIFFUSE_MAP, defaultTexture_);
-	defaultMaterial_->SetFixedBinding(graphics::Material::FixedBindingIndex::NORMAL_MAP, defaultTexture_);
+	// maps the model does not name fall back to the default texture
+	const file::Material& material = bunny->materials_.empty() ? file::Material{} : bunny->materials_[bunny->meshes_[0].materialIndex_];
+	defaultMaterial_ = assetRegistry_->AcquireMaterial(material, graphics::Texture::Layout{}, defaultTexture_);
 
 	graphics::Drawable drawable;
 	drawable.mesh_ = mesh_;
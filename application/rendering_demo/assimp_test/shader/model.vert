@@ -6,13 +6,13 @@ layout(location = 2) in vec3 _tangent;
 layout(location = 3) in vec3 _bitangent;
 layout(location = 4) in vec2 _texCoord;
 
-layout(set = 1, binding = 2) uniform MVTransform
+layout(set = 1, binding = 0) uniform MVTransform
 {
     mat4 model;
     mat4 view;
 } mv;
 
-layout(set = 1, binding = 3) uniform PTransform
+layout(set = 1, binding = 1) uniform PTransform
 {
     mat4 proj;
 } p;
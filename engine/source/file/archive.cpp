@@ -0,0 +1,297 @@
+#include "archive.h"
+#include "binary_file.h"
+#include "io_service.h"
+#include "zlib_api.h"
+#include "utility/log.h"
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+using utility::Log;
+
+namespace file
+{
+	namespace
+	{
+		constexpr uint32_t magic = 'C' | ('P' << 8) | ('A' << 16) | ('K' << 24);
+
+		struct FileHeader
+		{
+			uint32_t magic_ = magic;
+			uint32_t version_ = Archive::version;
+			uint32_t numEntries_ = 0;
+			uint32_t namesSize_ = 0;
+			uint64_t entriesOffset_ = 0;
+			uint64_t namesOffset_ = 0;
+		};
+
+		static_assert(sizeof(FileHeader) == 32);
+		static_assert(sizeof(Archive::Entry) == 40);
+
+		constexpr uint64_t readAheadSize = 32ull << 20; // sources read in one batch unless a single file is larger
+	}
+
+	bool Archive::Open(const std::filesystem::path& _path)
+	{
+		entries_ = nullptr;
+		numEntries_ = 0;
+		names_ = {};
+
+		// lookups jump around the table and entries are read in whatever order assets are requested
+		if (!file_.Open(_path, MappedFile::AccessPattern::RANDOM))
+		{
+			return false;
+		}
+
+		const std::span<const std::byte> bytes = file_.GetBytes();
+		const FileHeader* header = (const FileHeader*)bytes.data();
+		if (bytes.size() < sizeof(FileHeader) || header->magic_ != magic || header->version_ != version)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "not an archive or an outdated one, path : " + _path.string()) << std::endl;
+			file_.Close();
+			return false;
+		}
+
+		const uint64_t entriesSize = (uint64_t)header->numEntries_ * sizeof(Entry);
+		if (header->entriesOffset_ + entriesSize > bytes.size() || header->namesOffset_ + header->namesSize_ > bytes.size() || header->entriesOffset_ % alignof(Entry) != 0)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted archive, path : " + _path.string()) << std::endl;
+			file_.Close();
+			return false;
+		}
+
+		entries_ = (const Entry*)(bytes.data() + header->entriesOffset_);
+		numEntries_ = header->numEntries_;
+		names_ = std::string_view((const char*)bytes.data() + header->namesOffset_, header->namesSize_);
+		return true;
+	}
+
+	bool Archive::IsOpen() const
+	{
+		return file_.IsOpen();
+	}
+
+	uint32_t Archive::GetNumEntries() const
+	{
+		return numEntries_;
+	}
+
+	bool Archive::Contains(std::string_view _name) const
+	{
+		return Find(_name) != nullptr;
+	}
+
+	bool Archive::OpenEntry(std::string_view _name, MappedFile& _outFile) const
+	{
+		const Entry* entry = Find(_name);
+		if (!entry)
+		{
+			return false;
+		}
+
+		const std::span<const std::byte> bytes = file_.GetBytes();
+		if (entry->offset_ + entry->storedSize_ > bytes.size())
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "archive entry out of bounds, name : " + std::string(_name)) << std::endl;
+			return false;
+		}
+
+		const std::span<const std::byte> stored = bytes.subspan((size_t)entry->offset_, (size_t)entry->storedSize_);
+		if (entry->compression_ == (uint16_t)Compression::NONE)
+		{
+			_outFile = MappedFile::FromMemory(shared_from_this(), stored);
+			return true;
+		}
+
+		std::shared_ptr<std::byte[]> inflated(new std::byte[std::max<size_t>(1, (size_t)entry->size_)]);
+		unsigned long inflatedSize = (unsigned long)entry->size_;
+		if (uncompress((unsigned char*)inflated.get(), &inflatedSize, (const unsigned char*)stored.data(), (unsigned long)stored.size()) != zlibOk || inflatedSize != entry->size_)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to inflate archive entry, name : " + std::string(_name)) << std::endl;
+			return false;
+		}
+
+		_outFile = MappedFile::FromMemory(inflated, std::span<const std::byte>(inflated.get(), (size_t)entry->size_));
+		return true;
+	}
+
+	std::string Archive::Normalize(std::string_view _path)
+	{
+		std::string name(_path);
+		std::replace(name.begin(), name.end(), '\\', '/');
+		name = std::filesystem::path(name).lexically_normal().generic_string();
+		std::transform(name.begin(), name.end(), name.begin(), [](char _c) { return (_c >= 'A' && _c <= 'Z') ? (char)(_c - 'A' + 'a') : _c; });
+
+		while (!name.empty() && name.back() == '/')
+		{
+			name.pop_back();
+		}
+		return name;
+	}
+
+	uint64_t Archive::Hash(std::string_view _name)
+	{
+		// 64 bit fnv-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (const char c : _name)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	const Archive::Entry* Archive::Find(std::string_view _name) const
+	{
+		const uint64_t hash = Hash(_name);
+		const Entry* last = entries_ + numEntries_;
+		for (const Entry* entry = std::lower_bound(entries_, last, hash, [](const Entry& _entry, uint64_t _hash) { return _entry.hash_ < _hash; }); entry != last && entry->hash_ == hash; entry++)
+		{
+			if ((uint64_t)entry->nameOffset_ + entry->nameLength_ <= names_.size() && names_.substr(entry->nameOffset_, entry->nameLength_) == _name)
+			{
+				return entry;
+			}
+		}
+		return nullptr;
+	}
+
+	bool Archive::Build(const std::filesystem::path& _root, const std::filesystem::path& _outPath, Compression _compression)
+	{
+		struct Source
+		{
+			std::string name_;
+			std::filesystem::path path_;
+			uint64_t size_ = 0;
+		};
+
+		// the archive may be built into its own root, neither it nor temporary files of earlier builds are packed
+		const std::filesystem::path outPath = std::filesystem::absolute(_outPath).lexically_normal();
+
+		std::error_code error;
+		std::vector<Source> sources;
+		for (const std::filesystem::directory_entry& directoryEntry : std::filesystem::recursive_directory_iterator(_root, error))
+		{
+			const std::filesystem::path path = std::filesystem::absolute(directoryEntry.path()).lexically_normal();
+			if (directoryEntry.is_regular_file() && path != outPath && !IsTemporaryPath(path, outPath))
+			{
+				// only sizes the read ahead, the file is sized again when it is read
+				std::error_code sizeError;
+				const uint64_t size = directoryEntry.file_size(sizeError);
+				sources.push_back({ Normalize(directoryEntry.path().lexically_relative(_root).generic_string()), directoryEntry.path(), sizeError ? 0 : size });
+			}
+		}
+
+		if (error)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to list archive root, path : " + _root.string()) << std::endl;
+			return false;
+		}
+
+		// data follows path order so files of one directory end up next to each other
+		std::sort(sources.begin(), sources.end(), [](const Source& _lhs, const Source& _rhs) { return _lhs.name_ < _rhs.name_; });
+
+		std::vector<Entry> entries(sources.size());
+		std::string names;
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			entries[i].hash_ = Hash(sources[i].name_);
+			entries[i].nameOffset_ = (uint32_t)names.size();
+			entries[i].nameLength_ = (uint16_t)sources[i].name_.size();
+			names += sources[i].name_;
+		}
+
+		FileHeader header{};
+		header.numEntries_ = (uint32_t)entries.size();
+		header.namesSize_ = (uint32_t)names.size();
+		header.entriesOffset_ = sizeof(FileHeader);
+		header.namesOffset_ = header.entriesOffset_ + sizeof(Entry) * entries.size();
+
+		const bool written = WriteAtomically(_outPath, [&](std::ostream& _stream)
+			{
+				// the table is written last once every offset is known
+				const std::vector<char> padding(alignment);
+				const std::vector<char> placeholder(header.namesOffset_);
+				uint64_t offset = header.namesOffset_ + names.size();
+				_stream.write(placeholder.data(), (std::streamsize)placeholder.size());
+				_stream.write(names.data(), (std::streamsize)names.size());
+
+				// sources are read on io threads one batch ahead of the one being compressed and written
+				IOService ioService;
+				const auto readBatch = [&ioService, &sources](size_t _first)
+					{
+						std::vector<std::filesystem::path> paths;
+						uint64_t size = 0;
+						for (size_t i = _first; i < sources.size() && (paths.empty() || size < readAheadSize); i++)
+						{
+							paths.push_back(sources[i].path_);
+							size += sources[i].size_;
+						}
+						return ioService.Read(std::move(paths));
+					};
+
+				std::shared_ptr<IOService::Batch> batch = readBatch(0);
+				std::shared_ptr<IOService::Batch> nextBatch;
+				size_t batchFirst = 0;
+
+				std::vector<char> deflated;
+				for (size_t i = 0; i < sources.size(); i++)
+				{
+					if (i == batchFirst + batch->GetNumReads())
+					{
+						batchFirst = i;
+						batch = std::move(nextBatch);
+					}
+
+					if (!nextBatch && batchFirst + batch->GetNumReads() < sources.size())
+					{
+						nextBatch = readBatch(batchFirst + batch->GetNumReads());
+					}
+
+					std::span<const std::byte> source;
+					if (!batch->Wait(i - batchFirst, source))
+					{
+						std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to read archive source, path : " + sources[i].path_.string()) << std::endl;
+						return false;
+					}
+
+					Entry& entry = entries[i];
+					entry.size_ = source.size();
+					entry.compression_ = (uint16_t)Compression::NONE;
+
+					const char* data = (const char*)source.data();
+					uint64_t storedSize = source.size();
+					if (_compression == Compression::ZLIB && !source.empty())
+					{
+						unsigned long deflatedSize = compressBound((unsigned long)source.size());
+						deflated.resize(deflatedSize);
+						if (compress2((unsigned char*)deflated.data(), &deflatedSize, (const unsigned char*)source.data(), (unsigned long)source.size(), zlibBestLevel) == zlibOk && deflatedSize * 8 < source.size() * 7)
+						{
+							entry.compression_ = (uint16_t)Compression::ZLIB;
+							data = deflated.data();
+							storedSize = deflatedSize;
+						}
+					}
+
+					entry.offset_ = (entry.compression_ == (uint16_t)Compression::NONE) ? Align(offset, alignment) : offset;
+					entry.storedSize_ = storedSize;
+					_stream.write(padding.data(), (std::streamsize)(entry.offset_ - offset));
+					_stream.write(data, (std::streamsize)storedSize);
+					offset = entry.offset_ + storedSize;
+				}
+
+				std::stable_sort(entries.begin(), entries.end(), [](const Entry& _lhs, const Entry& _rhs) { return _lhs.hash_ < _rhs.hash_; });
+				_stream.seekp(0);
+				_stream.write((const char*)&header, sizeof(FileHeader));
+				_stream.write((const char*)entries.data(), (std::streamsize)(sizeof(Entry) * entries.size()));
+				return true;
+			});
+
+		if (!written)
+		{
+			return false;
+		}
+
+		std::cout << Log::Format(Log::Category::file, Log::Level::message, "built archive with " + std::to_string(entries.size()) + " entries, path : " + _outPath.string()) << std::endl;
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "mapped_file.h"
+
+namespace file
+{
+	// read-only pack (.pak) of many files behind a single mapping, entries are found by binary search over a table sorted by path hash,
+	// stored entries start on a page boundary so their views can be handed out without copying, deflated ones are packed tightly
+	class Archive final : public std::enable_shared_from_this<Archive>
+	{
+	public:
+		static constexpr uint32_t version = 1;
+		static constexpr const char* extension = ".pak";
+		static constexpr uint64_t alignment = 4096;
+
+		enum class Compression
+		{
+			NONE,
+			ZLIB, // entries that do not shrink by an eighth are stored instead
+		};
+
+		struct Entry
+		{
+			uint64_t hash_ = 0;
+			uint64_t offset_ = 0;
+			uint64_t storedSize_ = 0;
+			uint64_t size_ = 0;
+			uint32_t nameOffset_ = 0;
+			uint16_t nameLength_ = 0;
+			uint16_t compression_ = 0;
+		};
+
+	private:
+		MappedFile file_;
+		const Entry* entries_ = nullptr;
+		uint32_t numEntries_ = 0;
+		std::string_view names_;
+
+	public:
+		bool Open(const std::filesystem::path& _path);
+		bool IsOpen() const;
+		uint32_t GetNumEntries() const;
+
+		// _name is relative to the archive root and normalized with Normalize
+		bool Contains(std::string_view _name) const;
+		// the returned file keeps the archive alive, so this needs the archive to be owned by a shared_ptr
+		bool OpenEntry(std::string_view _name, MappedFile& _outFile) const;
+
+		// forward slashes, no dot segments and lower case, so lookups ignore the spelling of a path
+		static std::string Normalize(std::string_view _path);
+		static uint64_t Hash(std::string_view _name);
+
+		// packs every regular file below _root, entries are named by their normalized path relative to _root
+		static bool Build(const std::filesystem::path& _root, const std::filesystem::path& _outPath, Compression _compression);
+
+	private:
+		const Entry* Find(std::string_view _name) const;
+	};
+}
\ No newline at end of file
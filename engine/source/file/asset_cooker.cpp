@@ -0,0 +1,439 @@
+#include "asset_cooker.h"
+#include "binary_file.h"
+#include "mesh_cache.h"
+#include "model.h"
+#include "utility/hash.hpp"
+#include "utility/log.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+using utility::Log;
+
+namespace file
+{
+	namespace
+	{
+		constexpr std::array<const char*, 10> modelExtensions = { ".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".blend", ".ply", ".stl", ".x" };
+		constexpr std::array<const char*, 8> textureExtensions = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".gif", ".hdr" };
+		constexpr std::array<const char*, 4> normalMapSuffixes = { "_n", "_normal", "_nrm", "_norm" };
+
+		struct Fingerprint
+		{
+			uint64_t size_ = 0;
+			int64_t writeTime_ = 0;
+			uint64_t hash_ = 0;
+		};
+
+		struct Record
+		{
+			std::string source_; // relative to the source root
+			Fingerprint fingerprint_;
+			std::string output_; // relative to the output root
+			std::vector<std::pair<std::string, Fingerprint>> dependencies_;
+		};
+
+		struct Job
+		{
+			std::string relativePath_;
+			std::filesystem::path sourcePath_;
+			bool model_ = false;
+		};
+
+		enum class Outcome
+		{
+			COOKED,
+			SKIPPED,
+			FAILED,
+		};
+
+		std::string ToLower(std::string _text)
+		{
+			std::transform(_text.begin(), _text.end(), _text.begin(), [](char _c) { return (_c >= 'A' && _c <= 'Z') ? (char)(_c - 'A' + 'a') : _c; });
+			return _text;
+		}
+
+		template <size_t N>
+		bool HasExtension(const std::filesystem::path& _path, const std::array<const char*, N>& _extensions)
+		{
+			const std::string extension = ToLower(_path.extension().string());
+			return std::find_if(_extensions.begin(), _extensions.end(), [&](const char* _extension) { return extension == _extension; }) != _extensions.end();
+		}
+
+		bool IsNormalMap(const std::filesystem::path& _path)
+		{
+			const std::string stem = ToLower(_path.stem().string());
+			return std::any_of(normalMapSuffixes.begin(), normalMapSuffixes.end(), [&](const char* _suffix) { return stem.ends_with(_suffix); });
+		}
+
+		// the content is hashed only when size or write time moved, otherwise the hash of _previous is trusted
+		bool TakeFingerprint(const std::filesystem::path& _path, const Fingerprint* _previous, Fingerprint& _outFingerprint)
+		{
+			std::error_code error;
+			_outFingerprint.size_ = (uint64_t)std::filesystem::file_size(_path, error);
+			if (error)
+			{
+				return false;
+			}
+
+			_outFingerprint.writeTime_ = (int64_t)std::filesystem::last_write_time(_path, error).time_since_epoch().count();
+			if (error)
+			{
+				return false;
+			}
+
+			if (_previous && _previous->size_ == _outFingerprint.size_ && _previous->writeTime_ == _outFingerprint.writeTime_)
+			{
+				_outFingerprint.hash_ = _previous->hash_;
+				return true;
+			}
+
+			if (_outFingerprint.size_ == 0)
+			{
+				_outFingerprint.hash_ = utility::HashBytes(nullptr, 0);
+				return true;
+			}
+
+			const MappedFile file(_path, MappedFile::AccessPattern::SEQUENTIAL);
+			if (!file.IsOpen())
+			{
+				return false;
+			}
+
+			_outFingerprint.hash_ = utility::HashBytes(file.GetBytes().data(), file.GetSize());
+			return true;
+		}
+
+		// anything that changes what an input cooks into
+		uint64_t GetSettingsHash(const AssetCooker::Settings& _settings)
+		{
+			const std::string settings = std::to_string(AssetCooker::version) + "|" + std::to_string(MeshCache::version) + "|" + std::to_string(TextureContainer::version) + "|" +
+				std::to_string(_settings.colorFormat_ ? (int)*_settings.colorFormat_ : -1) + "|" + std::to_string(_settings.normalFormat_ ? (int)*_settings.normalFormat_ : -1) + "|" +
+				std::to_string(_settings.srgb_) + "|" + std::to_string((int)_settings.quality_) + "|" + std::to_string((int)_settings.supercompression_);
+			return utility::HashBytes(settings.data(), settings.size());
+		}
+
+		std::string ToHex(uint64_t _value)
+		{
+			std::ostringstream stream;
+			stream << std::hex << _value;
+			return stream.str();
+		}
+
+		// one record per line, tab separated : source, size, write time, hash, output, number of dependencies, then path, size, write time and hash per dependency
+		bool ReadDatabase(const std::filesystem::path& _path, uint64_t _settingsHash, std::unordered_map<std::string, Record>& _outRecords)
+		{
+			std::ifstream stream(_path);
+			std::string line;
+			if (!stream.is_open() || !std::getline(stream, line) || line != "cook " + std::to_string(AssetCooker::version) + " " + ToHex(_settingsHash))
+			{
+				return false;
+			}
+
+			while (std::getline(stream, line))
+			{
+				std::vector<std::string> fields;
+				std::istringstream lineStream(line);
+				for (std::string field; std::getline(lineStream, field, '\t');)
+				{
+					fields.push_back(std::move(field));
+				}
+
+				try
+				{
+					auto readFingerprint = [&](size_t _index) { return Fingerprint{ std::stoull(fields[_index]), std::stoll(fields[_index + 1]), std::stoull(fields[_index + 2], nullptr, 16) }; };
+					if (fields.size() < 6 || fields.size() != 6 + std::stoull(fields[5]) * 4)
+					{
+						continue;
+					}
+
+					Record record{ fields[0], readFingerprint(1), fields[4] };
+					for (size_t i = 6; i < fields.size(); i += 4)
+					{
+						record.dependencies_.emplace_back(fields[i], readFingerprint(i + 1));
+					}
+					_outRecords[record.source_] = std::move(record);
+				}
+				catch (const std::exception&)
+				{
+					// a damaged line only costs its input a cook
+				}
+			}
+			return true;
+		}
+
+		bool WriteText(const std::filesystem::path& _path, const std::string& _text)
+		{
+			return WriteAtomically(_path, [&_text](std::ostream& _stream)
+				{
+					_stream.write(_text.data(), (std::streamsize)_text.size());
+					return true;
+				});
+		}
+
+		std::string FormatFingerprint(const Fingerprint& _fingerprint)
+		{
+			return std::to_string(_fingerprint.size_) + "\t" + std::to_string(_fingerprint.writeTime_) + "\t" + ToHex(_fingerprint.hash_);
+		}
+
+		bool CookTexture(const AssetCooker::Settings& _settings, const std::filesystem::path& _sourcePath, const std::filesystem::path& _outputPath)
+		{
+			Image image;
+			if (!image.Load(_sourcePath.string(), true))
+			{
+				return false;
+			}
+
+			const bool normalMap = IsNormalMap(_sourcePath);
+			if (image.GetNumMips() == 1)
+			{
+				image.GenerateMips(Image::MipFilter::KAISER, _settings.srgb_ && !normalMap);
+			}
+
+			// 16 bit and hdr sources keep their precision, hdr ones as rgba16f since few devices sample rgb32f
+			if (image.format_ == Image::Format::R32G32B32_SFLOAT)
+			{
+				image.ConvertToHalf();
+			}
+
+			const std::optional<Image::Format> format = normalMap ? _settings.normalFormat_ : _settings.colorFormat_;
+			if (format && BlockCompressor::IsCompressible(image.format_) && !BlockCompressor::Compress(image, *format, _settings.quality_))
+			{
+				return false;
+			}
+
+			return TextureContainer::Save(_outputPath, image, _settings.supercompression_);
+		}
+
+		// textures cooked alongside the model are referenced by their .ctex, anything outside the source root stays as imported
+		void RemapTexturePath(const AssetCooker::Settings& _settings, std::string& _path)
+		{
+			if (_path.empty() || !AssetCooker::IsTexture(_path))
+			{
+				return;
+			}
+
+			const std::filesystem::path sourceRoot = std::filesystem::absolute(_settings.sourceRoot_).lexically_normal();
+			const std::filesystem::path relativePath = std::filesystem::absolute(_path).lexically_normal().lexically_relative(sourceRoot);
+			if (relativePath.empty() || *relativePath.begin() == "..")
+			{
+				return;
+			}
+
+			_path = AssetCooker::GetOutputPath(_settings, relativePath).generic_string();
+		}
+
+		bool CookModel(const AssetCooker::Settings& _settings, const std::filesystem::path& _sourcePath, const std::filesystem::path& _outputPath, std::vector<std::string>& _outDependencies)
+		{
+			Model model;
+			if (!model.Load(_sourcePath.generic_string(), false))
+			{
+				return false;
+			}
+
+			for (Material& material : model.materials_)
+			{
+				RemapTexturePath(_settings, material.diffuseMapPath_);
+				RemapTexturePath(_settings, material.normalMapPath_);
+			}
+
+			if (!MeshCache::Save(_outputPath, model))
+			{
+				return false;
+			}
+
+			_outDependencies = model.dependencies_;
+			return true;
+		}
+
+		bool AreDependenciesUnchanged(const Record& _previous, std::vector<std::pair<std::string, Fingerprint>>& _outDependencies)
+		{
+			_outDependencies.clear();
+			for (const auto& [path, fingerprint] : _previous.dependencies_)
+			{
+				Fingerprint current;
+				if (!TakeFingerprint(path, &fingerprint, current) || current.hash_ != fingerprint.hash_)
+				{
+					return false;
+				}
+				_outDependencies.emplace_back(path, current);
+			}
+			return true;
+		}
+
+		Outcome Process(const AssetCooker::Settings& _settings, const Job& _job, const Record* _previous, Record& _outRecord)
+		{
+			const std::filesystem::path outputPath = AssetCooker::GetOutputPath(_settings, _job.relativePath_);
+			_outRecord.source_ = _job.relativePath_;
+			_outRecord.output_ = outputPath.lexically_relative(_settings.outputRoot_).generic_string();
+
+			if (!TakeFingerprint(_job.sourcePath_, _previous ? &_previous->fingerprint_ : nullptr, _outRecord.fingerprint_))
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to read cook input, path : " + _job.sourcePath_.string()) << std::endl;
+				return Outcome::FAILED;
+			}
+
+			std::error_code error;
+			if (!_settings.force_ && _previous && _previous->fingerprint_.hash_ == _outRecord.fingerprint_.hash_ && _previous->output_ == _outRecord.output_ &&
+				std::filesystem::exists(outputPath, error) && AreDependenciesUnchanged(*_previous, _outRecord.dependencies_))
+			{
+				return Outcome::SKIPPED;
+			}
+
+			std::filesystem::create_directories(outputPath.parent_path(), error);
+
+			bool cooked = false;
+			std::vector<std::string> dependencies;
+			try
+			{
+				cooked = _job.model_ ? CookModel(_settings, _job.sourcePath_, outputPath, dependencies) : CookTexture(_settings, _job.sourcePath_, outputPath);
+			}
+			catch (const std::exception& _exception)
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, std::string(_exception.what()) + ", path : " + _job.sourcePath_.string()) << std::endl;
+			}
+
+			if (!cooked)
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to cook, path : " + _job.sourcePath_.string()) << std::endl;
+				return Outcome::FAILED;
+			}
+
+			_outRecord.dependencies_.clear();
+			for (const std::string& dependency : dependencies)
+			{
+				Fingerprint fingerprint;
+				if (TakeFingerprint(dependency, nullptr, fingerprint))
+				{
+					_outRecord.dependencies_.emplace_back(std::filesystem::absolute(dependency).lexically_normal().generic_string(), fingerprint);
+				}
+			}
+			return Outcome::COOKED;
+		}
+	}
+
+	bool AssetCooker::IsModel(const std::filesystem::path& _path)
+	{
+		return HasExtension(_path, modelExtensions);
+	}
+
+	bool AssetCooker::IsTexture(const std::filesystem::path& _path)
+	{
+		return HasExtension(_path, textureExtensions);
+	}
+
+	std::filesystem::path AssetCooker::GetOutputPath(const Settings& _settings, const std::filesystem::path& _relativePath)
+	{
+		// named like the caches loaders keep next to their sources
+		const std::filesystem::path outputPath = _settings.outputRoot_ / _relativePath;
+		return IsModel(_relativePath) ? MeshCache::GetCachePath(outputPath) : TextureContainer::GetCachePath(outputPath);
+	}
+
+	bool AssetCooker::Cook(const Settings& _settings, Report& _outReport)
+	{
+		_outReport = Report{};
+
+		const std::filesystem::path outputRoot = std::filesystem::absolute(_settings.outputRoot_).lexically_normal();
+		std::error_code error;
+		std::vector<Job> jobs;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(_settings.sourceRoot_, error))
+		{
+			const std::filesystem::path path = std::filesystem::absolute(entry.path()).lexically_normal();
+			const bool insideOutput = !path.lexically_relative(outputRoot).empty() && *path.lexically_relative(outputRoot).begin() != "..";
+			if (entry.is_regular_file() && !insideOutput && (IsModel(path) || IsTexture(path)))
+			{
+				jobs.push_back({ entry.path().lexically_relative(_settings.sourceRoot_).generic_string(), path, IsModel(path) });
+			}
+		}
+
+		if (error)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::error, "failed to list cook sources, path : " + _settings.sourceRoot_.string()) << std::endl;
+			return false;
+		}
+
+		std::filesystem::create_directories(_settings.outputRoot_, error);
+
+		const uint64_t settingsHash = GetSettingsHash(_settings);
+		const std::filesystem::path databasePath = _settings.outputRoot_ / databaseName;
+		std::unordered_map<std::string, Record> previousRecords;
+		if (!ReadDatabase(databasePath, settingsHash, previousRecords) && std::filesystem::exists(databasePath, error))
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::message, "cook settings or version changed, cooking every input") << std::endl;
+		}
+
+		// models take longest, starting them first keeps one from finishing alone at the end
+		std::sort(jobs.begin(), jobs.end(), [](const Job& _lhs, const Job& _rhs) { return _lhs.model_ > _rhs.model_ || (_lhs.model_ == _rhs.model_ && _lhs.relativePath_ < _rhs.relativePath_); });
+
+		// the thread pool belongs to the application, the cooker runs its own workers and loaders fork inline on them
+		std::vector<Record> records(jobs.size());
+		std::vector<Outcome> outcomes(jobs.size(), Outcome::FAILED);
+		std::atomic<size_t> next = 0;
+		auto work = [&]()
+			{
+				for (size_t i = next++; i < jobs.size(); i = next++)
+				{
+					const auto previous = previousRecords.find(jobs[i].relativePath_);
+					outcomes[i] = Process(_settings, jobs[i], (previous != previousRecords.end()) ? &previous->second : nullptr, records[i]);
+				}
+			};
+
+		const size_t numThreads = std::max<size_t>(1, (_settings.numThreads_ > 0) ? _settings.numThreads_ : std::thread::hardware_concurrency());
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < std::min(numThreads, jobs.size()); i++)
+		{
+			workers.emplace_back(work);
+		}
+		work();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		std::string database = "cook " + std::to_string(version) + " " + ToHex(settingsHash) + "\n";
+		std::string manifest;
+		for (size_t i = 0; i < jobs.size(); i++)
+		{
+			previousRecords.erase(jobs[i].relativePath_);
+			if (outcomes[i] == Outcome::FAILED)
+			{
+				_outReport.numFailed_++;
+				continue;
+			}
+			(outcomes[i] == Outcome::COOKED) ? _outReport.numCooked_++ : _outReport.numSkipped_++;
+
+			const Record& record = records[i];
+			database += record.source_ + "\t" + FormatFingerprint(record.fingerprint_) + "\t" + record.output_ + "\t" + std::to_string(record.dependencies_.size());
+			for (const auto& [path, fingerprint] : record.dependencies_)
+			{
+				database += "\t" + path + "\t" + FormatFingerprint(fingerprint);
+			}
+			database += "\n";
+			manifest += record.source_ + "\t" + record.output_ + "\t" + ToHex(record.fingerprint_.hash_) + "\n";
+		}
+
+		// whatever is left belongs to sources that are gone
+		for (const auto& [source, record] : previousRecords)
+		{
+			if (std::filesystem::remove(_settings.outputRoot_ / record.output_, error))
+			{
+				_outReport.numRemoved_++;
+			}
+		}
+
+		if (!WriteText(databasePath, database) || !WriteText(_settings.outputRoot_ / manifestName, manifest))
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::error, "failed to write cook database, path : " + databasePath.string()) << std::endl;
+			return false;
+		}
+
+		std::cout << Log::Format(Log::Category::file, Log::Level::message, "cooked " + std::to_string(_outReport.numCooked_) + ", skipped " + std::to_string(_outReport.numSkipped_) +
+			", failed " + std::to_string(_outReport.numFailed_) + ", removed " + std::to_string(_outReport.numRemoved_)) << std::endl;
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include "block_compressor.h"
+#include "texture_container.h"
+
+namespace file
+{
+	// offline build step for assets, models are imported and optimized into .cmesh and textures get their chain and
+	// block format in .ctex, cooked materials reference the .ctex of their textures, outputs mirror the source tree under the output root and load as is,
+	// a database next to them lets later runs skip every input whose content and dependencies did not change
+	class AssetCooker final
+	{
+	public:
+		static constexpr uint32_t version = 2; // bump when outputs change meaning, every input is cooked again
+		static constexpr const char* databaseName = "cook.db";
+		static constexpr const char* manifestName = "manifest.txt";
+
+		struct Settings
+		{
+			std::filesystem::path sourceRoot_;
+			std::filesystem::path outputRoot_;
+			std::optional<Image::Format> colorFormat_ = Image::Format::BC7; // none keeps color textures uncompressed
+			std::optional<Image::Format> normalFormat_ = Image::Format::BC5; // for textures named like *_n, *_normal or *_nrm
+			bool srgb_ = true; // color textures filter their chain in linear space
+			BlockCompressor::Quality quality_ = BlockCompressor::Quality::NORMAL;
+			TextureContainer::Supercompression supercompression_ = TextureContainer::Supercompression::NONE;
+			uint32_t numThreads_ = 0; // 0 takes every core
+			bool force_ = false; // cooks every input regardless of the database
+		};
+
+		struct Report
+		{
+			size_t numCooked_ = 0;
+			size_t numSkipped_ = 0;
+			size_t numFailed_ = 0;
+			size_t numRemoved_ = 0; // outputs of sources that disappeared
+		};
+
+	public:
+		static bool IsModel(const std::filesystem::path& _path);
+		static bool IsTexture(const std::filesystem::path& _path);
+		static std::filesystem::path GetOutputPath(const Settings& _settings, const std::filesystem::path& _relativePath);
+
+		// false when the source root could not be listed or the database could not be written, failed inputs only count in the report
+		static bool Cook(const Settings& _settings, Report& _outReport);
+	};
+}
\ No newline at end of file
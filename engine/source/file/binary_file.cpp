@@ -0,0 +1,73 @@
+#include "binary_file.h"
+#include "utility/log.h"
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using utility::Log;
+
+namespace file
+{
+	bool QuerySource(const std::filesystem::path& _sourcePath, uint64_t& _outSize, int64_t& _outWriteTime)
+	{
+		_outSize = 0;
+		_outWriteTime = 0;
+		if (_sourcePath.empty())
+		{
+			return true;
+		}
+
+		std::error_code error;
+		_outSize = (uint64_t)std::filesystem::file_size(_sourcePath, error);
+		if (error)
+		{
+			return false;
+		}
+
+		_outWriteTime = (int64_t)std::filesystem::last_write_time(_sourcePath, error).time_since_epoch().count();
+		return !error;
+	}
+
+	std::filesystem::path GetTemporaryPath(const std::filesystem::path& _path)
+	{
+		// random per thread so other threads and processes writing the same target pick their own name
+		thread_local std::mt19937_64 random(std::random_device{}());
+		std::ostringstream suffix;
+		suffix << "." << std::hex << random() << ".tmp";
+		return std::filesystem::path(_path).concat(suffix.str());
+	}
+
+	bool IsTemporaryPath(const std::filesystem::path& _candidate, const std::filesystem::path& _path)
+	{
+		const std::string name = _candidate.filename().string();
+		const std::string prefix = _path.filename().string() + ".";
+		return _candidate.parent_path() == _path.parent_path() && _candidate.extension() == ".tmp" && name.size() > prefix.size() + 4 && name.starts_with(prefix);
+	}
+
+	bool WriteAtomically(const std::filesystem::path& _path, const std::function<bool(std::ostream&)>& _write)
+	{
+		const std::filesystem::path temporaryPath = GetTemporaryPath(_path);
+
+		bool written = false;
+		{
+			std::ofstream stream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+			written = stream.is_open() && _write(stream) && stream.good();
+		}
+
+		std::error_code error;
+		if (written)
+		{
+			std::filesystem::rename(temporaryPath, _path, error);
+		}
+
+		if (!written || error)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to write file, path : " + _path.string()) << std::endl;
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <span>
+#include <cstddef>
+#include <cstdint>
+
+// helpers shared by the binary formats (.cmesh, .ctex, .pak) and the caches the engine writes
+namespace file
+{
+	// _alignment has to be a power of two
+	constexpr uint64_t Align(uint64_t _offset, uint64_t _alignment)
+	{
+		return (_offset + _alignment - 1) & ~(_alignment - 1);
+	}
+
+	// bounds checked view over mapped bytes, nullptr when _count elements at _offset do not fit
+	template <typename T>
+	const T* Fetch(std::span<const std::byte> _bytes, uint64_t _offset, uint64_t _count = 1)
+	{
+		if (_offset > _bytes.size() || _count > (_bytes.size() - _offset) / sizeof(T))
+		{
+			return nullptr;
+		}
+
+		return (const T*)(_bytes.data() + _offset);
+	}
+
+	// size and write time stamped into a cache to tell when its source changed, both zero for an empty path
+	bool QuerySource(const std::filesystem::path& _sourcePath, uint64_t& _outSize, int64_t& _outWriteTime);
+
+	// unique per call, writers of the same target never share a temporary file
+	std::filesystem::path GetTemporaryPath(const std::filesystem::path& _path);
+	// whether _candidate was named by GetTemporaryPath for _path, by this or an interrupted earlier run
+	bool IsTemporaryPath(const std::filesystem::path& _candidate, const std::filesystem::path& _path);
+
+	// _write fills a temporary file that replaces _path once complete, so a concurrent or interrupted run
+	// never maps a partial file, returning false from _write abandons it and keeps the old file
+	bool WriteAtomically(const std::filesystem::path& _path, const std::function<bool(std::ostream&)>& _write);
+}
\ No newline at end of file
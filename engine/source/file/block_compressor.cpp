@@ -0,0 +1,1044 @@
+#include "block_compressor.h"
+#include "thread/thread_pool.h"
+#include "utility/log.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+using utility::Log;
+
+namespace file
+{
+	namespace
+	{
+		using Texels = std::array<std::array<float, 4>, 16>;
+
+		struct Endpoints
+		{
+			std::array<float, 4> low_{};
+			std::array<float, 4> high_{};
+		};
+
+		constexpr std::array<int32_t, 16> bc7Weights = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		int32_t RoundClamp(float _value, int32_t _max)
+		{
+			return std::clamp((int32_t)std::lround(_value), 0, _max);
+		}
+
+		uint32_t GetNumRefinements(BlockCompressor::Quality _quality)
+		{
+			switch (_quality)
+			{
+			case BlockCompressor::Quality::FAST:
+				return 0;
+			case BlockCompressor::Quality::NORMAL:
+				return 1;
+			default:
+				return 3;
+			}
+		}
+
+		// partial blocks at the image border repeat their last row and column, one and two channel images read as gray and gray alpha
+		void ReadBlock(const uint8_t* _pixels, uint32_t _numChannels, uint32_t _width, uint32_t _height, uint32_t _blockX, uint32_t _blockY, Texels& _out)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				const uint32_t sourceY = std::min(_blockY * 4 + y, _height - 1);
+				for (uint32_t x = 0; x < 4; x++)
+				{
+					const uint32_t sourceX = std::min(_blockX * 4 + x, _width - 1);
+					const uint8_t* pixel = _pixels + ((size_t)sourceY * _width + sourceX) * _numChannels;
+					std::array<float, 4>& texel = _out[y * 4 + x];
+					if (_numChannels >= 3)
+					{
+						texel = { (float)pixel[0], (float)pixel[1], (float)pixel[2], (_numChannels == 4) ? (float)pixel[3] : 255.0f };
+					}
+					else
+					{
+						texel = { (float)pixel[0], (float)pixel[0], (float)pixel[0], (_numChannels == 2) ? (float)pixel[1] : 255.0f };
+					}
+				}
+			}
+		}
+
+		Endpoints FitBoundingBox(const Texels& _texels, uint32_t _numChannels, const bool* _mask)
+		{
+			Endpoints endpoints;
+			endpoints.low_.fill(FLT_MAX);
+			endpoints.high_.fill(-FLT_MAX);
+			for (size_t i = 0; i < _texels.size(); i++)
+			{
+				if (_mask && !_mask[i])
+				{
+					continue;
+				}
+
+				for (uint32_t c = 0; c < _numChannels; c++)
+				{
+					endpoints.low_[c] = std::min(endpoints.low_[c], _texels[i][c]);
+					endpoints.high_[c] = std::max(endpoints.high_[c], _texels[i][c]);
+				}
+			}
+
+			for (uint32_t c = 0; c < _numChannels; c++)
+			{
+				if (endpoints.low_[c] > endpoints.high_[c])
+				{
+					endpoints.low_[c] = endpoints.high_[c] = 0.0f;
+				}
+
+				const float inset = (endpoints.high_[c] - endpoints.low_[c]) / 16.0f;
+				endpoints.low_[c] += inset;
+				endpoints.high_[c] -= inset;
+			}
+			return endpoints;
+		}
+
+		// endpoints spanning the texels along the principal axis of their covariance
+		Endpoints FitPrincipalAxis(const Texels& _texels, uint32_t _numChannels, const bool* _mask)
+		{
+			std::array<float, 4> mean{};
+			float count = 0.0f;
+			for (size_t i = 0; i < _texels.size(); i++)
+			{
+				if (_mask && !_mask[i])
+				{
+					continue;
+				}
+
+				for (uint32_t c = 0; c < _numChannels; c++)
+				{
+					mean[c] += _texels[i][c];
+				}
+				count += 1.0f;
+			}
+
+			Endpoints endpoints;
+			if (count == 0.0f)
+			{
+				return endpoints;
+			}
+
+			for (uint32_t c = 0; c < _numChannels; c++)
+			{
+				mean[c] /= count;
+			}
+
+			float covariance[4][4] = {};
+			for (size_t i = 0; i < _texels.size(); i++)
+			{
+				if (_mask && !_mask[i])
+				{
+					continue;
+				}
+
+				for (uint32_t a = 0; a < _numChannels; a++)
+				{
+					for (uint32_t b = 0; b < _numChannels; b++)
+					{
+						covariance[a][b] += (_texels[i][a] - mean[a]) * (_texels[i][b] - mean[b]);
+					}
+				}
+			}
+
+			// power iteration seeded with the per channel variances
+			std::array<float, 4> axis{};
+			for (uint32_t c = 0; c < _numChannels; c++)
+			{
+				axis[c] = covariance[c][c];
+			}
+
+			for (uint32_t iteration = 0; iteration < 8; iteration++)
+			{
+				std::array<float, 4> next{};
+				float largest = 0.0f;
+				for (uint32_t a = 0; a < _numChannels; a++)
+				{
+					for (uint32_t b = 0; b < _numChannels; b++)
+					{
+						next[a] += covariance[a][b] * axis[b];
+					}
+					largest = std::max(largest, std::abs(next[a]));
+				}
+
+				if (largest <= 0.0f)
+				{
+					break;
+				}
+
+				for (uint32_t c = 0; c < _numChannels; c++)
+				{
+					axis[c] = next[c] / largest;
+				}
+			}
+
+			float length = 0.0f;
+			for (uint32_t c = 0; c < _numChannels; c++)
+			{
+				length += axis[c] * axis[c];
+			}
+
+			if (length <= 0.0f)
+			{
+				endpoints.low_ = endpoints.high_ = mean;
+				return endpoints;
+			}
+
+			length = std::sqrt(length);
+			for (uint32_t c = 0; c < _numChannels; c++)
+			{
+				axis[c] /= length;
+			}
+
+			float minimum = FLT_MAX;
+			float maximum = -FLT_MAX;
+			for (size_t i = 0; i < _texels.size(); i++)
+			{
+				if (_mask && !_mask[i])
+				{
+					continue;
+				}
+
+				float projection = 0.0f;
+				for (uint32_t c = 0; c < _numChannels; c++)
+				{
+					projection += (_texels[i][c] - mean[c]) * axis[c];
+				}
+				minimum = std::min(minimum, projection);
+				maximum = std::max(maximum, projection);
+			}
+
+			for (uint32_t c = 0; c < _numChannels; c++)
+			{
+				endpoints.low_[c] = mean[c] + axis[c] * minimum;
+				endpoints.high_[c] = mean[c] + axis[c] * maximum;
+			}
+			return endpoints;
+		}
+
+		// least squares endpoints for fixed interpolation weights, negative weights leave a texel out
+		bool SolveEndpoints(const Texels& _texels, uint32_t _numChannels, const float* _weights, Endpoints& _out)
+		{
+			float aa = 0.0f;
+			float ab = 0.0f;
+			float bb = 0.0f;
+			std::array<float, 4> ax{};
+			std::array<float, 4> bx{};
+
+			for (size_t i = 0; i < _texels.size(); i++)
+			{
+				const float b = _weights[i];
+				if (b < 0.0f)
+				{
+					continue;
+				}
+
+				const float a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (uint32_t c = 0; c < _numChannels; c++)
+				{
+					ax[c] += a * _texels[i][c];
+					bx[c] += b * _texels[i][c];
+				}
+			}
+
+			const float determinant = aa * bb - ab * ab;
+			if (std::abs(determinant) < 1e-6f)
+			{
+				return false;
+			}
+
+			for (uint32_t c = 0; c < _numChannels; c++)
+			{
+				_out.low_[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.0f, 255.0f);
+				_out.high_[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		uint16_t PackRgb565(const std::array<float, 4>& _color)
+		{
+			return (uint16_t)((RoundClamp(_color[0] * 31.0f / 255.0f, 31) << 11) | (RoundClamp(_color[1] * 63.0f / 255.0f, 63) << 5) | RoundClamp(_color[2] * 31.0f / 255.0f, 31));
+		}
+
+		std::array<int32_t, 3> UnpackRgb565(uint16_t _color)
+		{
+			const int32_t r = (_color >> 11) & 31;
+			const int32_t g = (_color >> 5) & 63;
+			const int32_t b = _color & 31;
+			return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+		}
+
+		struct ColorBlock
+		{
+			uint16_t color0_ = 0;
+			uint16_t color1_ = 0;
+			uint32_t indices_ = 0;
+			float error_ = FLT_MAX;
+			float weights_[16] = {}; // position of each texel between color0_ and color1_, negative when transparent
+		};
+
+		// four color mode needs color0_ > color1_, the three color mode reserves index 3 for transparent texels
+		ColorBlock EvaluateColorBlock(const Texels& _texels, uint16_t _color0, uint16_t _color1, bool _threeColor, const bool* _transparent)
+		{
+			if (_threeColor ? (_color0 > _color1) : (_color0 < _color1))
+			{
+				std::swap(_color0, _color1);
+			}
+
+			ColorBlock block;
+			block.color0_ = _color0;
+			block.color1_ = _color1;
+			block.error_ = 0.0f;
+
+			const std::array<int32_t, 3> color0 = UnpackRgb565(_color0);
+			const std::array<int32_t, 3> color1 = UnpackRgb565(_color1);
+			const bool fourColor = _color0 > _color1;
+
+			std::array<std::array<int32_t, 3>, 4> palette = { color0, color1 };
+			std::array<float, 4> paletteWeights = { 0.0f, 1.0f, 0.5f, -1.0f };
+			const uint32_t numEntries = fourColor ? 4 : 3;
+			for (size_t c = 0; c < 3; c++)
+			{
+				if (fourColor)
+				{
+					palette[2][c] = (2 * color0[c] + color1[c]) / 3;
+					palette[3][c] = (color0[c] + 2 * color1[c]) / 3;
+				}
+				else
+				{
+					palette[2][c] = (color0[c] + color1[c]) / 2;
+				}
+			}
+
+			if (fourColor)
+			{
+				paletteWeights = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				if (_transparent && _transparent[i])
+				{
+					block.indices_ |= 3u << (i * 2);
+					block.weights_[i] = -1.0f;
+					continue;
+				}
+
+				uint32_t bestIndex = 0;
+				float bestError = FLT_MAX;
+				for (uint32_t j = 0; j < numEntries; j++)
+				{
+					const float dr = _texels[i][0] - (float)palette[j][0];
+					const float dg = _texels[i][1] - (float)palette[j][1];
+					const float db = _texels[i][2] - (float)palette[j][2];
+					const float error = dr * dr + dg * dg + db * db;
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = j;
+					}
+				}
+
+				block.indices_ |= bestIndex << (i * 2);
+				block.weights_[i] = paletteWeights[bestIndex];
+				block.error_ += bestError;
+			}
+			return block;
+		}
+
+		void EncodeColorBlock(const Texels& _texels, BlockCompressor::Quality _quality, bool _allowTransparency, uint8_t* _out)
+		{
+			bool transparent[16] = {};
+			bool opaque[16] = {};
+			bool anyTransparent = false;
+			bool anyOpaque = false;
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				transparent[i] = _allowTransparency && _texels[i][3] < 128.0f;
+				opaque[i] = !transparent[i];
+				anyTransparent |= transparent[i];
+				anyOpaque |= opaque[i];
+			}
+
+			ColorBlock best;
+			if (!anyOpaque)
+			{
+				best.indices_ = 0xffffffff;
+			}
+			else
+			{
+				const Endpoints endpoints = (_quality == BlockCompressor::Quality::FAST) ? FitBoundingBox(_texels, 3, opaque) : FitPrincipalAxis(_texels, 3, opaque);
+				best = EvaluateColorBlock(_texels, PackRgb565(endpoints.low_), PackRgb565(endpoints.high_), anyTransparent, transparent);
+
+				for (uint32_t i = 0; i < GetNumRefinements(_quality); i++)
+				{
+					Endpoints refined;
+					if (!SolveEndpoints(_texels, 3, best.weights_, refined))
+					{
+						break;
+					}
+
+					const ColorBlock candidate = EvaluateColorBlock(_texels, PackRgb565(refined.low_), PackRgb565(refined.high_), anyTransparent, transparent);
+					if (candidate.error_ >= best.error_)
+					{
+						break;
+					}
+					best = candidate;
+				}
+			}
+
+			_out[0] = (uint8_t)(best.color0_ & 0xff);
+			_out[1] = (uint8_t)(best.color0_ >> 8);
+			_out[2] = (uint8_t)(best.color1_ & 0xff);
+			_out[3] = (uint8_t)(best.color1_ >> 8);
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				_out[4 + i] = (uint8_t)(best.indices_ >> (i * 8));
+			}
+		}
+
+		struct ChannelBlock
+		{
+			uint8_t endpoint0_ = 0;
+			uint8_t endpoint1_ = 0;
+			uint64_t indices_ = 0;
+			float error_ = FLT_MAX;
+			float weights_[16] = {}; // negative for the constant 0 and 255 entries of the six value mode
+		};
+
+		// eight interpolated values when endpoint0_ > endpoint1_, otherwise six plus the constants 0 and 255
+		ChannelBlock EvaluateChannelBlock(const Texels& _texels, uint8_t _endpoint0, uint8_t _endpoint1, bool _sixValues)
+		{
+			if (_sixValues ? (_endpoint0 > _endpoint1) : (_endpoint0 < _endpoint1))
+			{
+				std::swap(_endpoint0, _endpoint1);
+			}
+
+			ChannelBlock block;
+			block.endpoint0_ = _endpoint0;
+			block.endpoint1_ = _endpoint1;
+			block.error_ = 0.0f;
+
+			std::array<float, 8> palette = { (float)_endpoint0, (float)_endpoint1 };
+			std::array<float, 8> paletteWeights = { 0.0f, 1.0f };
+			if (_endpoint0 > _endpoint1)
+			{
+				for (uint32_t i = 2; i < 8; i++)
+				{
+					palette[i] = (float)((8 - i) * _endpoint0 + (i - 1) * _endpoint1) / 7.0f;
+					paletteWeights[i] = (float)(i - 1) / 7.0f;
+				}
+			}
+			else
+			{
+				for (uint32_t i = 2; i < 6; i++)
+				{
+					palette[i] = (float)((6 - i) * _endpoint0 + (i - 1) * _endpoint1) / 5.0f;
+					paletteWeights[i] = (float)(i - 1) / 5.0f;
+				}
+				palette[6] = 0.0f;
+				palette[7] = 255.0f;
+				paletteWeights[6] = paletteWeights[7] = -1.0f;
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t bestIndex = 0;
+				float bestError = FLT_MAX;
+				for (uint32_t j = 0; j < 8; j++)
+				{
+					const float difference = _texels[i][0] - palette[j];
+					if (difference * difference < bestError)
+					{
+						bestError = difference * difference;
+						bestIndex = j;
+					}
+				}
+
+				block.indices_ |= (uint64_t)bestIndex << (i * 3);
+				block.weights_[i] = paletteWeights[bestIndex];
+				block.error_ += bestError;
+			}
+			return block;
+		}
+
+		ChannelBlock RefineChannelBlock(const Texels& _texels, ChannelBlock _block, bool _sixValues, BlockCompressor::Quality _quality)
+		{
+			for (uint32_t i = 0; i < GetNumRefinements(_quality); i++)
+			{
+				Endpoints refined;
+				if (!SolveEndpoints(_texels, 1, _block.weights_, refined))
+				{
+					break;
+				}
+
+				const ChannelBlock candidate = EvaluateChannelBlock(_texels, (uint8_t)RoundClamp(refined.low_[0], 255), (uint8_t)RoundClamp(refined.high_[0], 255), _sixValues);
+				if (candidate.error_ >= _block.error_)
+				{
+					break;
+				}
+				_block = candidate;
+			}
+			return _block;
+		}
+
+		void EncodeChannelBlock(const Texels& _texels, uint32_t _channel, BlockCompressor::Quality _quality, uint8_t* _out)
+		{
+			Texels values{};
+			float minimum = 255.0f;
+			float maximum = 0.0f;
+			float innerMinimum = 255.0f;
+			float innerMaximum = 0.0f;
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				const float value = _texels[i][_channel];
+				values[i][0] = value;
+				minimum = std::min(minimum, value);
+				maximum = std::max(maximum, value);
+				if (value > 0.0f && value < 255.0f)
+				{
+					innerMinimum = std::min(innerMinimum, value);
+					innerMaximum = std::max(innerMaximum, value);
+				}
+			}
+
+			ChannelBlock best = EvaluateChannelBlock(values, (uint8_t)maximum, (uint8_t)minimum, false);
+			best = RefineChannelBlock(values, best, false, _quality);
+
+			// blocks that touch 0 or 255 can spend all interpolated values on the rest
+			if (_quality == BlockCompressor::Quality::HIGH && innerMinimum <= innerMaximum && (minimum == 0.0f || maximum == 255.0f))
+			{
+				ChannelBlock candidate = EvaluateChannelBlock(values, (uint8_t)innerMinimum, (uint8_t)innerMaximum, true);
+				candidate = RefineChannelBlock(values, candidate, true, _quality);
+				if (candidate.error_ < best.error_)
+				{
+					best = candidate;
+				}
+			}
+
+			_out[0] = best.endpoint0_;
+			_out[1] = best.endpoint1_;
+			for (uint32_t i = 0; i < 6; i++)
+			{
+				_out[2 + i] = (uint8_t)(best.indices_ >> (i * 8));
+			}
+		}
+
+		struct Bc7Block
+		{
+			std::array<std::array<int32_t, 4>, 2> endpoints_{}; // 7 bits per channel
+			std::array<int32_t, 2> pBits_{};
+			std::array<uint8_t, 16> indices_{};
+			float error_ = FLT_MAX;
+			float weights_[16] = {};
+		};
+
+		int32_t ChoosePBit(const std::array<float, 4>& _endpoint)
+		{
+			float errors[2] = {};
+			for (int32_t p = 0; p < 2; p++)
+			{
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					const int32_t decoded = (RoundClamp((_endpoint[c] - (float)p) * 0.5f, 127) << 1) | p;
+					errors[p] += ((float)decoded - _endpoint[c]) * ((float)decoded - _endpoint[c]);
+				}
+			}
+			return (errors[1] < errors[0]) ? 1 : 0;
+		}
+
+		// mode 6, a single rgba subset with 7.7.7.7 endpoints, a p-bit each and 4 bit indices
+		Bc7Block EvaluateBc7Block(const Texels& _texels, const Endpoints& _endpoints, int32_t _pBit0, int32_t _pBit1)
+		{
+			Bc7Block block;
+			block.pBits_ = { _pBit0, _pBit1 };
+			block.error_ = 0.0f;
+
+			std::array<std::array<int32_t, 4>, 2> decoded{};
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				block.endpoints_[0][c] = RoundClamp((_endpoints.low_[c] - (float)_pBit0) * 0.5f, 127);
+				block.endpoints_[1][c] = RoundClamp((_endpoints.high_[c] - (float)_pBit1) * 0.5f, 127);
+				decoded[0][c] = (block.endpoints_[0][c] << 1) | _pBit0;
+				decoded[1][c] = (block.endpoints_[1][c] << 1) | _pBit1;
+			}
+
+			std::array<std::array<float, 4>, 16> palette{};
+			for (uint32_t j = 0; j < 16; j++)
+			{
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					palette[j][c] = (float)(((64 - bc7Weights[j]) * decoded[0][c] + bc7Weights[j] * decoded[1][c] + 32) >> 6);
+				}
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				uint32_t bestIndex = 0;
+				float bestError = FLT_MAX;
+				for (uint32_t j = 0; j < 16; j++)
+				{
+					float error = 0.0f;
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						const float difference = _texels[i][c] - palette[j][c];
+						error += difference * difference;
+					}
+
+					if (error < bestError)
+					{
+						bestError = error;
+						bestIndex = j;
+					}
+				}
+
+				block.indices_[i] = (uint8_t)bestIndex;
+				block.weights_[i] = (float)bc7Weights[bestIndex] / 64.0f;
+				block.error_ += bestError;
+			}
+			return block;
+		}
+
+		Bc7Block EvaluateBc7Block(const Texels& _texels, const Endpoints& _endpoints, BlockCompressor::Quality _quality)
+		{
+			if (_quality != BlockCompressor::Quality::HIGH)
+			{
+				return EvaluateBc7Block(_texels, _endpoints, ChoosePBit(_endpoints.low_), ChoosePBit(_endpoints.high_));
+			}
+
+			Bc7Block best;
+			for (int32_t pBits = 0; pBits < 4; pBits++)
+			{
+				const Bc7Block candidate = EvaluateBc7Block(_texels, _endpoints, pBits & 1, pBits >> 1);
+				if (candidate.error_ < best.error_)
+				{
+					best = candidate;
+				}
+			}
+			return best;
+		}
+
+		class BitWriter
+		{
+		private:
+			uint8_t* out_;
+			uint32_t position_ = 0;
+
+		public:
+			BitWriter(uint8_t* _out) : out_(_out) {}
+
+		public:
+			void Write(uint32_t _value, uint32_t _numBits)
+			{
+				for (uint32_t i = 0; i < _numBits; i++, position_++)
+				{
+					if ((_value >> i) & 1)
+					{
+						out_[position_ / 8] |= (uint8_t)(1 << (position_ % 8));
+					}
+				}
+			}
+		};
+
+		void EncodeBc7Block(const Texels& _texels, BlockCompressor::Quality _quality, uint8_t* _out)
+		{
+			const Endpoints endpoints = (_quality == BlockCompressor::Quality::FAST) ? FitBoundingBox(_texels, 4, nullptr) : FitPrincipalAxis(_texels, 4, nullptr);
+			Bc7Block best = EvaluateBc7Block(_texels, endpoints, _quality);
+
+			for (uint32_t i = 0; i < GetNumRefinements(_quality); i++)
+			{
+				Endpoints refined;
+				if (!SolveEndpoints(_texels, 4, best.weights_, refined))
+				{
+					break;
+				}
+
+				const Bc7Block candidate = EvaluateBc7Block(_texels, refined, _quality);
+				if (candidate.error_ >= best.error_)
+				{
+					break;
+				}
+				best = candidate;
+			}
+
+			// the anchor texel stores three index bits, so its top bit has to be clear
+			if (best.indices_[0] >= 8)
+			{
+				std::swap(best.endpoints_[0], best.endpoints_[1]);
+				std::swap(best.pBits_[0], best.pBits_[1]);
+				for (uint8_t& index : best.indices_)
+				{
+					index = 15 - index;
+				}
+			}
+
+			std::fill(_out, _out + 16, (uint8_t)0);
+			BitWriter writer(_out);
+			writer.Write(1 << 6, 7);
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				writer.Write(best.endpoints_[0][c], 7);
+				writer.Write(best.endpoints_[1][c], 7);
+			}
+			writer.Write(best.pBits_[0], 1);
+			writer.Write(best.pBits_[1], 1);
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				writer.Write(best.indices_[i], (i == 0) ? 3 : 4);
+			}
+		}
+
+		void EncodeBlock(const Texels& _texels, Image::Format _format, BlockCompressor::Quality _quality, uint8_t* _out)
+		{
+			switch (_format)
+			{
+			case Image::Format::BC1:
+				EncodeColorBlock(_texels, _quality, true, _out);
+				break;
+			case Image::Format::BC3:
+				EncodeChannelBlock(_texels, 3, _quality, _out);
+				EncodeColorBlock(_texels, _quality, false, _out + 8);
+				break;
+			case Image::Format::BC4:
+				EncodeChannelBlock(_texels, 0, _quality, _out);
+				break;
+			case Image::Format::BC5:
+				EncodeChannelBlock(_texels, 0, _quality, _out);
+				EncodeChannelBlock(_texels, 1, _quality, _out + 8);
+				break;
+			case Image::Format::BC7:
+				EncodeBc7Block(_texels, _quality, _out);
+				break;
+			default:
+				break;
+			}
+		}
+
+		using DecodedBlock = std::array<std::array<uint8_t, 4>, 16>;
+
+		// the three color mode only when color0 is not above color1, which bc3 color blocks never use
+		void DecodeColorBlock(const uint8_t* _block, bool _allowThreeColor, DecodedBlock& _out)
+		{
+			const uint16_t color0 = (uint16_t)(_block[0] | (_block[1] << 8));
+			const uint16_t color1 = (uint16_t)(_block[2] | (_block[3] << 8));
+			const std::array<int32_t, 3> endpoint0 = UnpackRgb565(color0);
+			const std::array<int32_t, 3> endpoint1 = UnpackRgb565(color1);
+			const bool fourColor = !_allowThreeColor || color0 > color1;
+
+			std::array<std::array<uint8_t, 4>, 4> palette{};
+			for (size_t c = 0; c < 3; c++)
+			{
+				palette[0][c] = (uint8_t)endpoint0[c];
+				palette[1][c] = (uint8_t)endpoint1[c];
+				palette[2][c] = (uint8_t)(fourColor ? (2 * endpoint0[c] + endpoint1[c]) / 3 : (endpoint0[c] + endpoint1[c]) / 2);
+				palette[3][c] = (uint8_t)(fourColor ? (endpoint0[c] + 2 * endpoint1[c]) / 3 : 0);
+			}
+			palette[0][3] = palette[1][3] = palette[2][3] = 255;
+			palette[3][3] = fourColor ? 255 : 0;
+
+			const uint32_t indices = (uint32_t)_block[4] | ((uint32_t)_block[5] << 8) | ((uint32_t)_block[6] << 16) | ((uint32_t)_block[7] << 24);
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				_out[i] = palette[(indices >> (i * 2)) & 3];
+			}
+		}
+
+		void DecodeChannelBlock(const uint8_t* _block, uint32_t _channel, DecodedBlock& _out)
+		{
+			const int32_t endpoint0 = _block[0];
+			const int32_t endpoint1 = _block[1];
+
+			std::array<uint8_t, 8> palette = { (uint8_t)endpoint0, (uint8_t)endpoint1 };
+			if (endpoint0 > endpoint1)
+			{
+				for (int32_t j = 1; j < 7; j++)
+				{
+					palette[j + 1] = (uint8_t)(((7 - j) * endpoint0 + j * endpoint1) / 7);
+				}
+			}
+			else
+			{
+				for (int32_t j = 1; j < 5; j++)
+				{
+					palette[j + 1] = (uint8_t)(((5 - j) * endpoint0 + j * endpoint1) / 5);
+				}
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+
+			uint64_t indices = 0;
+			for (uint32_t i = 0; i < 6; i++)
+			{
+				indices |= (uint64_t)_block[2 + i] << (i * 8);
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				_out[i][_channel] = palette[(indices >> (i * 3)) & 7];
+			}
+		}
+
+		class BitReader
+		{
+		private:
+			const uint8_t* in_;
+			uint32_t position_ = 0;
+
+		public:
+			BitReader(const uint8_t* _in) : in_(_in) {}
+
+		public:
+			uint32_t Read(uint32_t _numBits)
+			{
+				uint32_t value = 0;
+				for (uint32_t i = 0; i < _numBits; i++, position_++)
+				{
+					value |= (uint32_t)((in_[position_ / 8] >> (position_ % 8)) & 1) << i;
+				}
+				return value;
+			}
+		};
+
+		// only mode 6, the one EncodeBc7Block writes
+		bool DecodeBc7Block(const uint8_t* _block, DecodedBlock& _out)
+		{
+			BitReader reader(_block);
+			if (reader.Read(7) != (1 << 6))
+			{
+				return false;
+			}
+
+			std::array<std::array<int32_t, 4>, 2> endpoints{};
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				endpoints[0][c] = (int32_t)reader.Read(7);
+				endpoints[1][c] = (int32_t)reader.Read(7);
+			}
+
+			const int32_t pBit0 = (int32_t)reader.Read(1);
+			const int32_t pBit1 = (int32_t)reader.Read(1);
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				endpoints[0][c] = (endpoints[0][c] << 1) | pBit0;
+				endpoints[1][c] = (endpoints[1][c] << 1) | pBit1;
+			}
+
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				const int32_t weight = bc7Weights[reader.Read((i == 0) ? 3 : 4)];
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					_out[i][c] = (uint8_t)(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+				}
+			}
+			return true;
+		}
+
+		// texels come out the way the device samples them, bc4 and bc5 leave the missing channels at 0 with an opaque alpha
+		bool DecodeBlock(const uint8_t* _block, Image::Format _format, DecodedBlock& _out)
+		{
+			for (std::array<uint8_t, 4>& texel : _out)
+			{
+				texel = { 0, 0, 0, 255 };
+			}
+
+			switch (_format)
+			{
+			case Image::Format::BC1:
+				DecodeColorBlock(_block, true, _out);
+				return true;
+			case Image::Format::BC3:
+				DecodeColorBlock(_block + 8, false, _out);
+				DecodeChannelBlock(_block, 3, _out);
+				return true;
+			case Image::Format::BC4:
+				DecodeChannelBlock(_block, 0, _out);
+				return true;
+			case Image::Format::BC5:
+				DecodeChannelBlock(_block, 0, _out);
+				DecodeChannelBlock(_block + 8, 1, _out);
+				return true;
+			case Image::Format::BC7:
+				return DecodeBc7Block(_block, _out);
+			default:
+				return false;
+			}
+		}
+	}
+
+	bool BlockCompressor::Compress(Image& _image, Image::Format _format, Quality _quality)
+	{
+		if (!IsBlockCompressed(_format))
+		{
+			return false;
+		}
+
+		if (!_image.IsLoaded() || !IsCompressible(_image.format_))
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "block compression expects an uncompressed 8 bit image") << std::endl;
+			return false;
+		}
+
+		const uint32_t numChannels = Image::GetNumChannels(_image.format_);
+
+		struct BlockRow
+		{
+			uint32_t level_;
+			uint32_t row_;
+		};
+
+		const uint32_t numMips = _image.GetNumMips();
+		std::vector<Image::MipLevel> mips(numMips);
+		std::vector<BlockRow> blockRows;
+		size_t offset = 0;
+		for (uint32_t i = 0; i < numMips; i++)
+		{
+			const Image::MipLevel source = _image.GetMip(i);
+			mips[i] = Image::MipLevel{ source.width_, source.height_, offset, GetCompressedSize(_format, source.width_, source.height_) };
+			offset += mips[i].size_;
+
+			for (uint32_t row = 0; row < (source.height_ + 3) / 4; row++)
+			{
+				blockRows.push_back(BlockRow{ i, row });
+			}
+		}
+
+		const size_t blockSize = GetBlockSize(_format);
+		std::vector<uint8_t> compressed(offset);
+
+		thread::ThreadPool::ParallelFor(blockRows.size(), [&](size_t _index)
+			{
+				const BlockRow& blockRow = blockRows[_index];
+				const Image::MipLevel source = _image.GetMip(blockRow.level_);
+				const uint32_t numBlocksX = (source.width_ + 3) / 4;
+				uint8_t* out = compressed.data() + mips[blockRow.level_].offset_ + (size_t)blockRow.row_ * numBlocksX * blockSize;
+
+				Texels texels;
+				for (uint32_t x = 0; x < numBlocksX; x++)
+				{
+					ReadBlock(_image.colors_.data() + source.offset_, numChannels, source.width_, source.height_, x, blockRow.row_, texels);
+					EncodeBlock(texels, _format, _quality, out + x * blockSize);
+				}
+			});
+
+		_image.colors_ = std::move(compressed);
+		_image.mips_ = std::move(mips);
+		_image.format_ = _format;
+		_image.numChannels_ = Image::GetNumChannels(_format);
+		return true;
+	}
+
+	bool BlockCompressor::Decompress(Image& _image)
+	{
+		if (!_image.IsLoaded() || !IsBlockCompressed(_image.format_))
+		{
+			return false;
+		}
+
+		struct BlockRow
+		{
+			uint32_t level_;
+			uint32_t row_;
+		};
+
+		const uint32_t numMips = _image.GetNumMips();
+		const uint32_t pixelSize = Image::GetPixelSize(Image::Format::R8G8B8A8);
+		std::vector<Image::MipLevel> mips(numMips);
+		std::vector<BlockRow> blockRows;
+		size_t offset = 0;
+		for (uint32_t i = 0; i < numMips; i++)
+		{
+			const Image::MipLevel source = _image.GetMip(i);
+			mips[i] = Image::MipLevel{ source.width_, source.height_, offset, (size_t)source.width_ * source.height_ * pixelSize };
+			offset += mips[i].size_;
+
+			for (uint32_t row = 0; row < (source.height_ + 3) / 4; row++)
+			{
+				blockRows.push_back(BlockRow{ i, row });
+			}
+		}
+
+		const size_t blockSize = GetBlockSize(_image.format_);
+		std::vector<uint8_t> decompressed(offset);
+		std::atomic<bool> decoded = true;
+
+		thread::ThreadPool::ParallelFor(blockRows.size(), [&](size_t _index)
+			{
+				const BlockRow& blockRow = blockRows[_index];
+				const Image::MipLevel source = _image.GetMip(blockRow.level_);
+				const uint32_t numBlocksX = (source.width_ + 3) / 4;
+				const uint8_t* in = _image.colors_.data() + source.offset_ + (size_t)blockRow.row_ * numBlocksX * blockSize;
+				uint8_t* out = decompressed.data() + mips[blockRow.level_].offset_;
+
+				DecodedBlock texels;
+				for (uint32_t x = 0; x < numBlocksX; x++)
+				{
+					if (!DecodeBlock(in + x * blockSize, _image.format_, texels))
+					{
+						decoded = false;
+						return;
+					}
+
+					// partial blocks at the image border drop their texels past the edge
+					for (uint32_t y = 0; y < 4 && blockRow.row_ * 4 + y < source.height_; y++)
+					{
+						for (uint32_t i = 0; i < 4 && x * 4 + i < source.width_; i++)
+						{
+							const size_t pixel = (size_t)(blockRow.row_ * 4 + y) * source.width_ + x * 4 + i;
+							std::copy(texels[y * 4 + i].begin(), texels[y * 4 + i].end(), out + pixel * pixelSize);
+						}
+					}
+				}
+			});
+
+		if (!decoded)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "block compressed image uses a mode that cannot be decoded") << std::endl;
+			return false;
+		}
+
+		_image.colors_ = std::move(decompressed);
+		_image.mips_ = std::move(mips);
+		_image.format_ = Image::Format::R8G8B8A8;
+		_image.numChannels_ = 4;
+		return true;
+	}
+
+	bool BlockCompressor::IsCompressible(Image::Format _format)
+	{
+		return _format == Image::Format::R8 || _format == Image::Format::R8G8 || _format == Image::Format::R8G8B8A8;
+	}
+
+	bool BlockCompressor::IsBlockCompressed(Image::Format _format)
+	{
+		return GetBlockSize(_format) != 0;
+	}
+
+	size_t BlockCompressor::GetBlockSize(Image::Format _format)
+	{
+		switch (_format)
+		{
+		case Image::Format::BC1:
+		case Image::Format::BC4:
+			return 8;
+		case Image::Format::BC3:
+		case Image::Format::BC5:
+		case Image::Format::BC7:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	size_t BlockCompressor::GetCompressedSize(Image::Format _format, uint32_t _width, uint32_t _height)
+	{
+		return (size_t)((_width + 3) / 4) * ((_height + 3) / 4) * GetBlockSize(_format);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include "image.h"
+
+namespace file
+{
+	// encodes 8 bit images into 4x4 bc blocks, every mip level is compressed and block rows are spread over thread::ThreadPool
+	class BlockCompressor final
+	{
+	public:
+		enum class Quality
+		{
+			FAST, // bounding box endpoints
+			NORMAL, // principal axis endpoints refined once
+			HIGH, // more refinement passes, bc4 also tries the six value mode and bc7 every p-bit pair
+		};
+
+	public:
+		// bc1 takes rgb with one bit alpha, bc3 rgb with bc4 alpha, bc4 red, bc5 red and green and bc7 rgba
+		static bool Compress(Image& _image, Image::Format _format, Quality _quality);
+		// back to rgba8 for devices that cannot sample the block format, bc7 only in the mode Compress writes
+		static bool Decompress(Image& _image);
+
+		static bool IsCompressible(Image::Format _format);
+		static bool IsBlockCompressed(Image::Format _format);
+		static size_t GetBlockSize(Image::Format _format);
+		static size_t GetCompressedSize(Image::Format _format, uint32_t _width, uint32_t _height);
+	};
+}
\ No newline at end of file
@@ -1,20 +1,49 @@
 #include "explorer.h"
+#include "virtual_file_system.h"
+#include <filesystem>
 
 namespace file
 {
-	std::vector<char> Explorer::LoadFile(std::wstring_view _filePath, bool _reversed, bool _binary)
+	std::vector<char> Explorer::LoadFile(std::wstring_view _filePath, bool _binary)
 	{
-		std::ifstream file(_filePath.data(), (_reversed ? std::ios::ate : 0) | (_binary ? std::ios::binary : 0));
+		const std::filesystem::path filePath(_filePath);
+
+		// archived files are stored raw, text mode drops the carriage returns a text stream would have translated
+		MappedFile archived;
+		if (VirtualFileSystem::OpenArchived(filePath, archived))
+		{
+			const std::span<const std::byte> bytes = archived.GetBytes();
+			std::vector<char> buffer((const char*)bytes.data(), (const char*)bytes.data() + bytes.size());
+			if (!_binary)
+			{
+				std::erase_if(buffer, [](char _c) { return _c == '\r'; });
+			}
+			return buffer;
+		}
+
+		std::error_code error;
+		const uintmax_t fileSize = std::filesystem::file_size(filePath, error);
+		if (error)
+		{
+			return std::vector<char>{};
+		}
+
+		std::ifstream file(filePath, _binary ? std::ios::in | std::ios::binary : std::ios::in);
 		if (!file.is_open())
 		{
 			return std::vector<char>{};
 		}
 
-		std::vector<char> buffer((size_t)file.tellg());
-		file.seekg(0);
+		std::vector<char> buffer((size_t)fileSize);
 		file.read(buffer.data(), buffer.size());
+		buffer.resize((size_t)file.gcount()); // text mode may shrink the content while translating line endings
 
 		file.close();
 		return buffer;
 	}
+
+	MappedFile Explorer::MapFile(std::wstring_view _filePath, MappedFile::AccessPattern _accessPattern)
+	{
+		return VirtualFileSystem::Open(std::filesystem::path(_filePath), _accessPattern);
+	}
 }
\ No newline at end of file
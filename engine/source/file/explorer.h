@@ -2,12 +2,14 @@
 #include <string_view>
 #include <fstream>
 #include <vector>
+#include "mapped_file.h"
 
 namespace file
 {
 	class Explorer final
 	{
 	public:
-		static std::vector<char> LoadFile(std::wstring_view _filePath, bool _reversed, bool _binary);
+		static std::vector<char> LoadFile(std::wstring_view _filePath, bool _binary);
+		static MappedFile MapFile(std::wstring_view _filePath, MappedFile::AccessPattern _accessPattern = MappedFile::AccessPattern::SEQUENTIAL);
 	};
 }
\ No newline at end of file
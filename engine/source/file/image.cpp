@@ -1,5 +1,13 @@
 #include "image.h"
+#include "mip_generator.h"
+#include "mapped_file.h"
+#include "virtual_file_system.h"
 #include <string_view>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include "thread/thread_pool.h"
+#include "math/half.h"
 #include "utility/log.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -9,25 +17,192 @@ using utility::Log;
 
 namespace file
 {
-	bool Image::Load(std::string_view _path)
+	namespace
 	{
+		constexpr uint32_t expansionBandHeight = 64;
+
+		// averages _factor x _factor blocks of the decoded pixels, the last row and column of blocks absorb the remainder
+		template<typename T>
+		void DownsampleBox(const T* _source, uint32_t _width, uint32_t _height, uint32_t _numChannels, uint32_t _factor, T* _destination, uint32_t _outWidth, uint32_t _outHeight)
+		{
+			thread::ThreadPool::ParallelFor(_outHeight, [&](size_t _y)
+				{
+					const uint32_t firstY = (uint32_t)_y * _factor;
+					const uint32_t lastY = (_y + 1 == _outHeight) ? _height : firstY + _factor;
+					std::vector<float> sums((size_t)_outWidth * _numChannels);
+					for (uint32_t y = firstY; y < lastY; y++)
+					{
+						const T* row = _source + (size_t)y * _width * _numChannels;
+						for (uint32_t x = 0; x < _outWidth; x++)
+						{
+							const size_t first = (size_t)x * _factor * _numChannels;
+							const size_t last = ((x + 1 == _outWidth) ? _width : (x + 1) * _factor) * (size_t)_numChannels;
+							float* sum = sums.data() + (size_t)x * _numChannels;
+							for (size_t i = first; i < last; i += _numChannels)
+							{
+								for (uint32_t c = 0; c < _numChannels; c++)
+								{
+									sum[c] += (float)row[i + c];
+								}
+							}
+						}
+					}
+
+					T* out = _destination + _y * _outWidth * _numChannels;
+					for (uint32_t x = 0; x < _outWidth; x++)
+					{
+						const uint32_t columns = (x + 1 == _outWidth) ? _width - x * _factor : _factor;
+						const float scale = 1.0f / (float)(columns * (lastY - firstY));
+						for (uint32_t c = 0; c < _numChannels; c++)
+						{
+							const float value = sums[(size_t)x * _numChannels + c] * scale;
+							out[(size_t)x * _numChannels + c] = std::is_floating_point_v<T> ? (T)value : (T)(value + 0.5f);
+						}
+					}
+				});
+		}
+
+		// widens rgb to rgba and 16 bit color to half floats, every other format is copied as decoded
+		void ConvertPixels(const void* _source, uint32_t _numChannels, Image::Format _format, size_t _numPixels, uint8_t* _destination)
+		{
+			if (_format == Image::Format::R8G8B8A8 && _numChannels == 3)
+			{
+				const uint8_t* source = (const uint8_t*)_source;
+				for (size_t i = 0; i < _numPixels; i++)
+				{
+					_destination[i * 4 + 0] = source[i * 3 + 0];
+					_destination[i * 4 + 1] = source[i * 3 + 1];
+					_destination[i * 4 + 2] = source[i * 3 + 2];
+					_destination[i * 4 + 3] = 0xff;
+				}
+				return;
+			}
+
+			if (_format == Image::Format::R16G16B16A16_SFLOAT)
+			{
+				const uint16_t* source = (const uint16_t*)_source;
+				uint16_t* destination = (uint16_t*)_destination;
+				const uint16_t opaque = math::FloatToHalf(1.0f);
+				for (size_t i = 0; i < _numPixels; i++)
+				{
+					const uint16_t* pixel = source + i * _numChannels;
+					const bool gray = _numChannels < 3;
+					for (uint32_t c = 0; c < 3; c++)
+					{
+						destination[i * 4 + c] = math::FloatToHalf((float)pixel[gray ? 0 : c] / 65535.0f);
+					}
+					destination[i * 4 + 3] = (_numChannels == 2 || _numChannels == 4) ? math::FloatToHalf((float)pixel[_numChannels - 1] / 65535.0f) : opaque;
+				}
+				return;
+			}
+
+			memcpy(_destination, _source, _numPixels * Image::GetPixelSize(_format));
+		}
+	}
+
+	bool Image::Load(std::string_view _path, bool _reserveMips, uint32_t _maxSize)
+	{
+		// decoding from a mapping spares stb its small buffered reads
+		const MappedFile file = VirtualFileSystem::Open(std::filesystem::path(_path), MappedFile::AccessPattern::SEQUENTIAL);
+		const std::span<const std::byte> bytes = file.GetBytes();
+
+		const stbi_uc* encoded = (const stbi_uc*)bytes.data();
+		const int length = (int)bytes.size();
+
 		int width, height, numChannels;
-		stbi_uc* loaded = stbi_load(_path.data(), &width, &height, &numChannels, STBI_rgb_alpha);
+		if (!file.IsOpen() || !stbi_info_from_memory(encoded, length, &width, &height, &numChannels))
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to load image, path : " + std::string(_path.data()));
+			return false;
+		}
+
+		void* loaded = nullptr;
+		size_t componentSize = 1;
+		if (stbi_is_hdr_from_memory(encoded, length))
+		{
+			loaded = stbi_loadf_from_memory(encoded, length, &width, &height, &numChannels, 3);
+			numChannels = 3;
+			componentSize = sizeof(float);
+			format_ = Format::R32G32B32_SFLOAT;
+		}
+		else if (stbi_is_16_bit_from_memory(encoded, length))
+		{
+			loaded = stbi_load_16_from_memory(encoded, length, &width, &height, &numChannels, 0);
+			componentSize = sizeof(uint16_t);
+			format_ = (numChannels == 1) ? Format::R16 : Format::R16G16B16A16_SFLOAT;
+		}
+		else
+		{
+			loaded = stbi_load_from_memory(encoded, length, &width, &height, &numChannels, 0);
+			format_ = (numChannels == 1) ? Format::R8 : (numChannels == 2) ? Format::R8G8 : Format::R8G8B8A8;
+		}
+
 		if (!loaded)
 		{
 			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to load image, path : " + std::string(_path.data()));
 			return false;
 		}
 
+		// oversized images are box filtered by a power of two before conversion so the full size copy is never made
+		uint32_t factor = 1;
+		while (_maxSize > 0 && (uint32_t)std::max(width, height) / factor > _maxSize)
+		{
+			factor *= 2;
+		}
+
+		if (factor > 1)
+		{
+			const uint32_t outWidth = std::max(1u, (uint32_t)width / factor);
+			const uint32_t outHeight = std::max(1u, (uint32_t)height / factor);
+			void* reduced = STBI_MALLOC((size_t)outWidth * outHeight * numChannels * componentSize);
+			if (componentSize == sizeof(float))
+			{
+				DownsampleBox((const float*)loaded, width, height, numChannels, factor, (float*)reduced, outWidth, outHeight);
+			}
+			else if (componentSize == sizeof(uint16_t))
+			{
+				DownsampleBox((const uint16_t*)loaded, width, height, numChannels, factor, (uint16_t*)reduced, outWidth, outHeight);
+			}
+			else
+			{
+				DownsampleBox((const stbi_uc*)loaded, width, height, numChannels, factor, (stbi_uc*)reduced, outWidth, outHeight);
+			}
+
+			stbi_image_free(loaded);
+			loaded = reduced;
+			width = (int)outWidth;
+			height = (int)outHeight;
+		}
+
 		width_ = width;
 		height_ = height;
+		numChannels_ = GetNumChannels(format_);
+		const uint32_t pixelSize = GetPixelSize(format_);
 
-		const size_t numPixels = size_t(width) * height;
-		const size_t size = size_t(width) * height * numChannels;
-		constexpr uint8_t maxColor = std::numeric_limits<uint8_t>::max();
-		
-		colors_.resize(numPixels * 4);
-		memcpy(colors_.data(), loaded, colors_.size());
+		// a reserved chain lets GenerateMips append levels without moving the first one
+		const size_t size = size_t(width) * height * pixelSize;
+		size_t capacity = size;
+		for (uint32_t w = width_, h = height_; _reserveMips && (w > 1 || h > 1);)
+		{
+			w = std::max(1u, w / 2);
+			h = std::max(1u, h / 2);
+			capacity += (size_t)w * h * pixelSize;
+		}
+
+		colors_.clear();
+		colors_.reserve(capacity);
+		colors_.resize(size);
+		mips_ = { MipLevel{ width_, height_, 0, size } };
+
+		// conversion out of the decoder buffer happens in row bands on the thread pool
+		const uint32_t numBands = (height_ + expansionBandHeight - 1) / expansionBandHeight;
+		thread::ThreadPool::ParallelFor(numBands, [&](size_t _band)
+			{
+				const size_t firstPixel = _band * expansionBandHeight * width_;
+				const size_t lastPixel = std::min<size_t>(firstPixel + (size_t)expansionBandHeight * width_, (size_t)width_ * height_);
+				const uint8_t* source = (const uint8_t*)loaded + firstPixel * numChannels * componentSize;
+				ConvertPixels(source, (uint32_t)numChannels, format_, lastPixel - firstPixel, colors_.data() + firstPixel * pixelSize);
+			});
 
 		stbi_image_free(loaded);
 
@@ -44,4 +219,127 @@ namespace file
 		size_t index = size_t(_x* width_) + _y;
 		return (index >= colors_.size()) ? NULL : colors_[index];
 	}
+
+	void Image::GenerateMips(MipFilter _filter, bool _srgb, bool _wrap)
+	{
+		MipGenerator::Generate(*this, _filter, _srgb, _wrap);
+	}
+
+	uint32_t Image::GetNumMips() const
+	{
+		if (mips_.empty())
+		{
+			return IsLoaded() ? 1 : 0;
+		}
+		return (uint32_t)mips_.size();
+	}
+
+	Image::MipLevel Image::GetMip(uint32_t _level) const
+	{
+		if (mips_.empty())
+		{
+			return MipLevel{ width_, height_, 0, colors_.size() };
+		}
+		return mips_.at(_level);
+	}
+
+	size_t Image::DropLevels(uint32_t _maxSize)
+	{
+		size_t numDropped = 0;
+		while (_maxSize > 0 && numDropped + 1 < mips_.size() && std::max(mips_[numDropped].width_, mips_[numDropped].height_) > _maxSize)
+		{
+			numDropped++;
+		}
+
+		if (numDropped == 0)
+		{
+			return 0;
+		}
+
+		const size_t droppedSize = mips_[numDropped].offset_;
+		mips_.erase(mips_.begin(), mips_.begin() + numDropped);
+		for (MipLevel& mip : mips_)
+		{
+			mip.offset_ -= droppedSize;
+		}
+
+		width_ = mips_.front().width_;
+		height_ = mips_.front().height_;
+		if (!colors_.empty())
+		{
+			colors_.erase(colors_.begin(), colors_.begin() + droppedSize);
+		}
+		return droppedSize;
+	}
+
+	void Image::ConvertToHalf()
+	{
+		if (format_ != Format::R32G32B32_SFLOAT)
+		{
+			return;
+		}
+
+		const size_t numPixels = colors_.size() / GetPixelSize(Format::R32G32B32_SFLOAT);
+		std::vector<uint8_t> converted(numPixels * GetPixelSize(Format::R16G16B16A16_SFLOAT));
+
+		const float* source = (const float*)colors_.data();
+		uint16_t* destination = (uint16_t*)converted.data();
+		const uint16_t opaque = math::FloatToHalf(1.0f);
+		for (size_t i = 0; i < numPixels; i++)
+		{
+			destination[i * 4 + 0] = math::FloatToHalf(source[i * 3 + 0]);
+			destination[i * 4 + 1] = math::FloatToHalf(source[i * 3 + 1]);
+			destination[i * 4 + 2] = math::FloatToHalf(source[i * 3 + 2]);
+			destination[i * 4 + 3] = opaque;
+		}
+
+		// levels are packed back to back so they shrink in proportion
+		for (MipLevel& mip : mips_)
+		{
+			mip.offset_ = mip.offset_ / 3 * 2;
+			mip.size_ = mip.size_ / 3 * 2;
+		}
+
+		colors_ = std::move(converted);
+		format_ = Format::R16G16B16A16_SFLOAT;
+		numChannels_ = 4;
+	}
+
+	uint32_t Image::GetPixelSize(Format _format)
+	{
+		switch (_format)
+		{
+		case Format::R8:
+			return 1;
+		case Format::R8G8:
+		case Format::R16:
+			return 2;
+		case Format::R8G8B8A8:
+			return 4;
+		case Format::R16G16B16A16_SFLOAT:
+			return 8;
+		case Format::R32G32B32_SFLOAT:
+			return 12;
+		default:
+			return 0;
+		}
+	}
+
+	uint32_t Image::GetNumChannels(Format _format)
+	{
+		switch (_format)
+		{
+		case Format::R8:
+		case Format::R16:
+		case Format::BC4:
+			return 1;
+		case Format::R8G8:
+		case Format::BC5:
+			return 2;
+		case Format::R32G32B32_SFLOAT:
+			return 3;
+		default:
+			return 4;
+		}
+	}
 }
\ No newline at end of file
@@ -6,12 +6,68 @@ namespace file
 {
 	struct Image
 	{
-		std::vector<uint8_t> colors_;
+	public:
+		enum class Format
+		{
+			R8G8B8A8,
+			BC1,
+			BC3,
+			BC4,
+			BC5,
+			BC7,
+			R8,
+			R8G8,
+			R16,
+			R16G16B16A16_SFLOAT,
+			R32G32B32_SFLOAT,
+		};
+
+		enum class MipFilter
+		{
+			BOX,
+			KAISER,
+			LANCZOS,
+		};
+
+		struct MipLevel
+		{
+			uint32_t width_ = 0;
+			uint32_t height_ = 0;
+			size_t offset_ = 0; // into colors_
+			size_t size_ = 0;
+		};
+
+	public:
+		std::vector<uint8_t> colors_; // every mip level back to back, largest first
+		std::vector<MipLevel> mips_;
 		uint32_t width_ = 0;
 		uint32_t height_ = 0;
+		uint32_t numChannels_ = 4;
+		Format format_ = Format::R8G8B8A8;
 
-		bool Load(std::string_view _path);
+		// keeps the source channel count and depth, r8, rg8 and rgba8 for 8 bit sources (rgb gains an opaque alpha),
+		// r16 or rgba16f for 16 bit sources and rgb32f for hdr files,
+		// _reserveMips makes room for a later GenerateMips so the chain is appended in place,
+		// a nonzero _maxSize box filters larger images by a power of two until both dimensions fit
+		bool Load(std::string_view _path, bool _reserveMips = false, uint32_t _maxSize = 0);
 		bool IsLoaded() const;
 		uint8_t At(uint32_t _x, uint32_t _y) const;
+
+		// replaces every level below the first with a full chain down to 1x1,
+		// _srgb filters color channels in linear space and _wrap samples across edges for tiling textures
+		void GenerateMips(MipFilter _filter = MipFilter::KAISER, bool _srgb = false, bool _wrap = true);
+		uint32_t GetNumMips() const;
+		MipLevel GetMip(uint32_t _level) const;
+
+		// removes leading levels larger than _maxSize while smaller ones remain, returns the bytes they took,
+		// colors_ is trimmed when it holds the levels and left alone for mapped images
+		size_t DropLevels(uint32_t _maxSize);
+
+		// rgb32f to rgba16f on every level, for devices that cannot sample three component floats
+		void ConvertToHalf();
+
+		// bytes per pixel, 0 for block compressed formats
+		static uint32_t GetPixelSize(Format _format);
+		static uint32_t GetNumChannels(Format _format);
 	};
 }
\ No newline at end of file
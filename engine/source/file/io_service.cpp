@@ -0,0 +1,157 @@
+#include "io_service.h"
+#include "utility/log.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <tuple>
+
+using utility::Log;
+
+namespace file
+{
+	size_t IOService::Batch::GetNumReads() const
+	{
+		return paths_.size();
+	}
+
+	bool IOService::Batch::Wait(size_t _index, std::span<const std::byte>& _outBytes)
+	{
+		std::unique_lock lock(mutex_);
+		condition_.wait(lock, [this, _index]() { return states_[_index] != State::PENDING; });
+
+		_outBytes = ranges_[_index];
+		return states_[_index] == State::READ;
+	}
+
+	void IOService::Batch::WaitAll()
+	{
+		std::unique_lock lock(mutex_);
+		condition_.wait(lock, [this]() { return numPending_ == 0; });
+	}
+
+	void IOService::Batch::Complete(size_t _index, bool _read)
+	{
+		if (!_read)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to read file, path : " + paths_[_index].string()) << std::endl;
+		}
+
+		if (onCompleted_)
+		{
+			onCompleted_(_index, _read);
+		}
+
+		{
+			std::lock_guard lock(mutex_);
+			states_[_index] = _read ? State::READ : State::FAILED;
+			numPending_--;
+		}
+		condition_.notify_all();
+	}
+
+	IOService::IOService(uint32_t _numThreads)
+	{
+		for (uint32_t i = 0; i < std::max(_numThreads, 1u); i++)
+		{
+			workers_.emplace_back(&IOService::WorkerThread, this);
+		}
+	}
+
+	IOService::~IOService()
+	{
+		{
+			std::lock_guard lock(mutex_);
+			stop_ = true;
+		}
+
+		condition_.notify_all();
+		for (std::thread& worker : workers_)
+		{
+			worker.join();
+		}
+	}
+
+	std::shared_ptr<IOService::Batch> IOService::Read(std::vector<std::filesystem::path> _paths, std::function<void(size_t, bool)> _onCompleted)
+	{
+		auto batch = std::make_shared<Batch>();
+		batch->paths_ = std::move(_paths);
+		batch->onCompleted_ = std::move(_onCompleted);
+		batch->states_.resize(batch->paths_.size(), Batch::State::PENDING);
+		batch->numPending_ = batch->paths_.size();
+
+		// sizes are taken now, files without one are not queued at all
+		std::vector<uint64_t> sizes(batch->paths_.size());
+		std::vector<size_t> missing;
+		uint64_t arenaSize = 0;
+		for (size_t i = 0; i < batch->paths_.size(); i++)
+		{
+			std::error_code error;
+			sizes[i] = std::filesystem::file_size(batch->paths_[i], error);
+			if (error)
+			{
+				sizes[i] = 0;
+				missing.push_back(i);
+			}
+			arenaSize += sizes[i];
+		}
+
+		batch->arena_ = std::make_unique_for_overwrite<std::byte[]>(arenaSize);
+		uint64_t offset = 0;
+		for (uint64_t size : sizes)
+		{
+			batch->ranges_.emplace_back(batch->arena_.get() + offset, size);
+			offset += size;
+		}
+
+		{
+			std::lock_guard lock(mutex_);
+			for (size_t i = 0, j = 0; i < batch->paths_.size(); i++)
+			{
+				if (j < missing.size() && missing[j] == i)
+				{
+					j++;
+					continue;
+				}
+				reads_.emplace(batch, i);
+			}
+		}
+		condition_.notify_all();
+
+		for (size_t i : missing)
+		{
+			batch->Complete(i, false);
+		}
+		return batch;
+	}
+
+	void IOService::WorkerThread()
+	{
+		while (true)
+		{
+			std::shared_ptr<Batch> batch;
+			size_t index = 0;
+			{
+				std::unique_lock lock(mutex_);
+				condition_.wait(lock, [this]() { return stop_ || !reads_.empty(); });
+				if (reads_.empty())
+				{
+					return;
+				}
+
+				std::tie(batch, index) = std::move(reads_.front());
+				reads_.pop();
+			}
+
+			// a file that grew since the batch was sized is read as far as its range goes, one that shrank fails
+			const std::span<std::byte> range = batch->ranges_[index];
+			std::ifstream stream(batch->paths_[index], std::ios::in | std::ios::binary);
+			bool read = stream.is_open();
+			if (read && !range.empty())
+			{
+				stream.read((char*)range.data(), (std::streamsize)range.size());
+				read = (size_t)stream.gcount() == range.size();
+			}
+			batch->Complete(index, read);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace file
+{
+	// reads whole files in batches on io threads of its own, so many reads are in flight while the caller
+	// works through the finished ones and blocking reads never occupy thread::ThreadPool workers
+	class IOService final
+	{
+	public:
+		// every file of a batch is read into one arena sized from the files when the batch is submitted
+		class Batch
+		{
+			friend class IOService;
+
+		private:
+			enum class State : uint8_t
+			{
+				PENDING,
+				READ,
+				FAILED,
+			};
+
+			std::vector<std::filesystem::path> paths_;
+			std::vector<std::span<std::byte>> ranges_; // into arena_
+			std::unique_ptr<std::byte[]> arena_;
+			std::function<void(size_t, bool)> onCompleted_;
+
+			std::mutex mutex_;
+			std::condition_variable condition_;
+			std::vector<State> states_;
+			size_t numPending_ = 0;
+
+		public:
+			size_t GetNumReads() const;
+			// blocks until the _index-th file is read, false when it failed, _outBytes stays valid while the batch lives
+			bool Wait(size_t _index, std::span<const std::byte>& _outBytes);
+			void WaitAll();
+
+		private:
+			void Complete(size_t _index, bool _read);
+		};
+
+	private:
+		std::vector<std::thread> workers_;
+		std::queue<std::pair<std::shared_ptr<Batch>, size_t>> reads_;
+		std::mutex mutex_;
+		std::condition_variable condition_;
+		bool stop_ = false;
+
+	public:
+		IOService(uint32_t _numThreads = 8);
+		// reads still queued are finished first so no batch waits forever
+		~IOService();
+
+		IOService(const IOService&) = delete;
+		IOService& operator=(const IOService&) = delete;
+
+	public:
+		// _onCompleted runs once per file with its index and whether it was read, on an io thread
+		// or right away for files that cannot be found
+		std::shared_ptr<Batch> Read(std::vector<std::filesystem::path> _paths, std::function<void(size_t, bool)> _onCompleted = {});
+
+	private:
+		void WorkerThread();
+	};
+}
\ No newline at end of file
@@ -0,0 +1,230 @@
+#include "mapped_file.h"
+#include "utility/log.h"
+#include <utility>
+
+#ifdef _WIN32
+#include "window/window_min.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using utility::Log;
+
+namespace file
+{
+	MappedFile::MappedFile(const std::filesystem::path& _path, AccessPattern _accessPattern)
+	{
+		Open(_path, _accessPattern);
+	}
+
+	MappedFile::MappedFile(MappedFile&& _other) noexcept
+	{
+		*this = std::move(_other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& _other) noexcept
+	{
+		if (this != &_other)
+		{
+			Close();
+
+			fileHandle_ = std::exchange(_other.fileHandle_, nullptr);
+			mappingHandle_ = std::exchange(_other.mappingHandle_, nullptr);
+			data_ = std::exchange(_other.data_, nullptr);
+			size_ = std::exchange(_other.size_, 0);
+			opened_ = std::exchange(_other.opened_, false);
+			owner_ = std::move(_other.owner_);
+		}
+
+		return *this;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	MappedFile MappedFile::FromMemory(std::shared_ptr<const void> _owner, std::span<const std::byte> _bytes)
+	{
+		MappedFile file;
+		file.owner_ = std::move(_owner);
+		file.data_ = _bytes.empty() ? nullptr : _bytes.data();
+		file.size_ = _bytes.size();
+		file.opened_ = true;
+		return file;
+	}
+
+	bool MappedFile::Open(const std::filesystem::path& _path, AccessPattern _accessPattern)
+	{
+		Close();
+
+#ifdef _WIN32
+		DWORD flags = FILE_ATTRIBUTE_NORMAL;
+		if (_accessPattern == AccessPattern::SEQUENTIAL)
+		{
+			flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+		}
+		else if (_accessPattern == AccessPattern::RANDOM)
+		{
+			flags |= FILE_FLAG_RANDOM_ACCESS;
+		}
+
+		HANDLE file = CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to open file for mapping, path : " + _path.string()) << std::endl;
+			return false;
+		}
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize))
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to query file size, path : " + _path.string()) << std::endl;
+			CloseHandle(file);
+			return false;
+		}
+
+		fileHandle_ = file;
+		size_ = (size_t)fileSize.QuadPart;
+		opened_ = true;
+
+		// zero sized files can not be mapped, they are still valid files with empty contents
+		if (size_ == 0)
+		{
+			return true;
+		}
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to create file mapping, path : " + _path.string()) << std::endl;
+			Close();
+			return false;
+		}
+
+		mappingHandle_ = mapping;
+		data_ = (const std::byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int descriptor = open(_path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to open file for mapping, path : " + _path.string()) << std::endl;
+			return false;
+		}
+
+		struct stat status{};
+		if (fstat(descriptor, &status) != 0)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to query file size, path : " + _path.string()) << std::endl;
+			close(descriptor);
+			return false;
+		}
+
+		size_ = (size_t)status.st_size;
+		opened_ = true;
+
+		if (size_ == 0)
+		{
+			close(descriptor);
+			return true;
+		}
+
+		void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		close(descriptor); // mapping keeps its own reference to the file
+		data_ = (mapped == MAP_FAILED) ? nullptr : (const std::byte*)mapped;
+#endif
+
+		if (data_ == nullptr)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to map view of file, path : " + _path.string()) << std::endl;
+			Close();
+			return false;
+		}
+
+		Advise(_accessPattern);
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		// views only drop their reference, the owner unmaps or frees the bytes
+		if (owner_)
+		{
+			data_ = nullptr;
+		}
+		owner_ = nullptr;
+
+#ifdef _WIN32
+		if (data_)
+		{
+			UnmapViewOfFile(data_);
+		}
+		if (mappingHandle_)
+		{
+			CloseHandle((HANDLE)mappingHandle_);
+		}
+		if (fileHandle_)
+		{
+			CloseHandle((HANDLE)fileHandle_);
+		}
+#else
+		if (data_)
+		{
+			munmap((void*)data_, size_);
+		}
+#endif
+
+		fileHandle_ = nullptr;
+		mappingHandle_ = nullptr;
+		data_ = nullptr;
+		size_ = 0;
+		opened_ = false;
+	}
+
+	void MappedFile::Advise(AccessPattern _accessPattern) const
+	{
+		if (data_ == nullptr)
+		{
+			return;
+		}
+
+#ifdef _WIN32
+		// windows takes the access pattern as a file flag on open, sequential reads additionally prefetch the whole view
+		if (_accessPattern == AccessPattern::SEQUENTIAL)
+		{
+			WIN32_MEMORY_RANGE_ENTRY range{};
+			range.VirtualAddress = (PVOID)data_;
+			range.NumberOfBytes = size_;
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		}
+#else
+		int advice = MADV_NORMAL;
+		switch (_accessPattern)
+		{
+		case AccessPattern::SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+		case AccessPattern::RANDOM: advice = MADV_RANDOM; break;
+		default: break;
+		}
+
+		madvise((void*)data_, size_, advice);
+#endif
+	}
+
+	bool MappedFile::IsOpen() const
+	{
+		return opened_;
+	}
+
+	size_t MappedFile::GetSize() const
+	{
+		return size_;
+	}
+
+	std::span<const std::byte> MappedFile::GetBytes() const
+	{
+		return std::span<const std::byte>(data_, data_ ? size_ : 0);
+	}
+}
\ No newline at end of file
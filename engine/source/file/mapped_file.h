@@ -0,0 +1,50 @@
+#pragma once
+#include <filesystem>
+#include <span>
+#include <memory>
+#include <cstddef>
+
+namespace file
+{
+	// read-only view of a whole file mapped into memory, bytes come straight from the page cache,
+	// archived files are views into the archive mapping or a decompressed buffer kept alive by owner_
+	class MappedFile final
+	{
+	public:
+		enum class AccessPattern
+		{
+			NORMAL,
+			SEQUENTIAL,
+			RANDOM,
+		};
+
+	private:
+		void* fileHandle_ = nullptr;
+		void* mappingHandle_ = nullptr;
+		const std::byte* data_ = nullptr;
+		size_t size_ = 0;
+		bool opened_ = false;
+		std::shared_ptr<const void> owner_;
+
+	public:
+		MappedFile() = default;
+		MappedFile(const std::filesystem::path& _path, AccessPattern _accessPattern = AccessPattern::NORMAL);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&& _other) noexcept;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&& _other) noexcept;
+		~MappedFile();
+
+	public:
+		static MappedFile FromMemory(std::shared_ptr<const void> _owner, std::span<const std::byte> _bytes);
+
+	public:
+		bool Open(const std::filesystem::path& _path, AccessPattern _accessPattern = AccessPattern::NORMAL);
+		void Close();
+		void Advise(AccessPattern _accessPattern) const;
+
+		bool IsOpen() const;
+		size_t GetSize() const;
+		std::span<const std::byte> GetBytes() const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include "mesh_cache.h"
+#include "binary_file.h"
+#include "mapped_file.h"
+#include "virtual_file_system.h"
+#include "model.h"
+#include "utility/log.h"
+#include <cstring>
+#include <type_traits>
+
+using utility::Log;
+
+namespace file
+{
+	namespace
+	{
+		constexpr uint32_t magic = 'C' | ('M' << 8) | ('S' << 16) | ('H' << 24);
+		constexpr uint64_t sectionAlignment = 16;
+		constexpr uint32_t maxAttributes = 16;
+
+		struct FileHeader
+		{
+			uint32_t magic_ = magic;
+			uint32_t version_ = MeshCache::version;
+			uint64_t sourceSize_ = 0;
+			int64_t sourceWriteTime_ = 0;
+			uint32_t numMeshes_ = 0;
+			uint32_t numMaterials_ = 0;
+			uint64_t meshTableOffset_ = 0;
+			uint64_t materialTableOffset_ = 0;
+		};
+
+		struct MeshRecord
+		{
+			uint32_t numAttributes_ = 0;
+			uint32_t attributeSizes_[maxAttributes] = {};
+			uint32_t materialIndex_ = 0;
+			uint32_t numLods_ = 0;
+			uint32_t numMeshlets_ = 0;
+			uint64_t vertexOffset_ = 0;
+			uint64_t vertexSize_ = 0;
+			uint64_t indexOffset_ = 0;
+			uint64_t numIndices_ = 0;
+			uint64_t lodTableOffset_ = 0;
+			uint64_t meshletOffset_ = 0;
+			uint64_t meshletVertexOffset_ = 0;
+			uint64_t numMeshletVertices_ = 0;
+			uint64_t meshletTriangleOffset_ = 0;
+			uint64_t numMeshletTriangleBytes_ = 0;
+			float boundsMin_[3] = {};
+			float boundsMax_[3] = {};
+		};
+
+		struct LodRecord
+		{
+			uint64_t indexOffset_ = 0;
+			uint64_t numIndices_ = 0;
+			float error_ = 0.0f;
+			uint32_t padding_ = 0;
+		};
+
+		struct MaterialRecord
+		{
+			uint64_t diffuseMapOffset_ = 0;
+			uint64_t normalMapOffset_ = 0;
+			uint32_t diffuseMapLength_ = 0;
+			uint32_t normalMapLength_ = 0;
+		};
+
+		static_assert(sizeof(FileHeader) == 48);
+		static_assert(sizeof(MeshRecord) == 184);
+		static_assert(sizeof(Meshlet) == 60 && std::is_trivially_copyable_v<Meshlet>); // stored as is
+		static_assert(sizeof(LodRecord) == 24);
+		static_assert(sizeof(MaterialRecord) == 24);
+
+		// a stale or corrupt file must not hand indices past the vertices to the device
+		template <typename Index>
+		bool AreInRange(const Index* _indices, uint64_t _numIndices, uint64_t _numVertices)
+		{
+			for (uint64_t i = 0; i < _numIndices; i++)
+			{
+				if (_indices[i] >= _numVertices)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool AreMeshletsValid(const Meshlet* _meshlets, uint64_t _numMeshlets, const uint32_t* _meshletVertices, uint64_t _numMeshletVertices, const uint8_t* _meshletTriangles, uint64_t _numMeshletTriangleBytes, uint64_t _numVertices)
+		{
+			if (!AreInRange(_meshletVertices, _numMeshletVertices, _numVertices))
+			{
+				return false;
+			}
+
+			for (uint64_t i = 0; i < _numMeshlets; i++)
+			{
+				const Meshlet& meshlet = _meshlets[i];
+				const bool validRanges = (uint64_t)meshlet.vertexOffset_ + meshlet.numVertices_ <= _numMeshletVertices && (uint64_t)meshlet.triangleOffset_ + (uint64_t)meshlet.numTriangles_ * 3 <= _numMeshletTriangleBytes;
+				if (!validRanges || !AreInRange(_meshletTriangles + meshlet.triangleOffset_, (uint64_t)meshlet.numTriangles_ * 3, meshlet.numVertices_))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		class Writer
+		{
+		private:
+			std::vector<std::byte> bytes_;
+
+		public:
+			uint64_t Reserve(uint64_t _size)
+			{
+				const uint64_t offset = Align(bytes_.size(), sectionAlignment);
+				bytes_.resize(offset + _size);
+				return offset;
+			}
+
+			uint64_t Write(const void* _data, uint64_t _size)
+			{
+				const uint64_t offset = Reserve(_size);
+				if (_size > 0)
+				{
+					memcpy(bytes_.data() + offset, _data, _size);
+				}
+				return offset;
+			}
+
+			template <typename T>
+			T& At(uint64_t _offset)
+			{
+				return *(T*)(bytes_.data() + _offset);
+			}
+
+			const std::vector<std::byte>& GetBytes() const
+			{
+				return bytes_;
+			}
+		};
+	}
+
+	bool MeshCache::IsCooked(const std::filesystem::path& _path)
+	{
+		return _path.extension() == extension;
+	}
+
+	std::filesystem::path MeshCache::GetCachePath(const std::filesystem::path& _sourcePath)
+	{
+		std::filesystem::path cachePath = _sourcePath;
+		cachePath += extension;
+		return cachePath;
+	}
+
+	bool MeshCache::Load(const std::filesystem::path& _path, Model& _outModel, const std::filesystem::path& _sourcePath)
+	{
+		uint64_t sourceSize = 0;
+		int64_t sourceWriteTime = 0;
+		if (!QuerySource(_sourcePath, sourceSize, sourceWriteTime))
+		{
+			return false;
+		}
+
+		// cooked files may sit in an archive
+		if (!VirtualFileSystem::Exists(_path))
+		{
+			return false;
+		}
+
+		const MappedFile mapped = VirtualFileSystem::Open(_path, MappedFile::AccessPattern::SEQUENTIAL);
+		const std::span<const std::byte> bytes = mapped.GetBytes();
+
+		const FileHeader* header = Fetch<FileHeader>(bytes, 0);
+		if (!header || header->magic_ != magic || header->version_ != version)
+		{
+			return false;
+		}
+
+		if (header->sourceSize_ != sourceSize || header->sourceWriteTime_ != sourceWriteTime)
+		{
+			return false;
+		}
+
+		const MeshRecord* meshRecords = Fetch<MeshRecord>(bytes, header->meshTableOffset_, header->numMeshes_);
+		const MaterialRecord* materialRecords = Fetch<MaterialRecord>(bytes, header->materialTableOffset_, header->numMaterials_);
+		if (!meshRecords || !materialRecords)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted mesh cache, path : " + _path.string()) << std::endl;
+			return false;
+		}
+
+		Model model;
+		model.meshes_.resize(header->numMeshes_);
+		for (uint32_t i = 0; i < header->numMeshes_; i++)
+		{
+			const MeshRecord& record = meshRecords[i];
+			const std::byte* vertices = Fetch<std::byte>(bytes, record.vertexOffset_, record.vertexSize_);
+			const uint32_t* indices = Fetch<uint32_t>(bytes, record.indexOffset_, record.numIndices_);
+			const LodRecord* lodRecords = Fetch<LodRecord>(bytes, record.lodTableOffset_, record.numLods_);
+			const Meshlet* meshlets = Fetch<Meshlet>(bytes, record.meshletOffset_, record.numMeshlets_);
+			const uint32_t* meshletVertices = Fetch<uint32_t>(bytes, record.meshletVertexOffset_, record.numMeshletVertices_);
+			const uint8_t* meshletTriangles = Fetch<uint8_t>(bytes, record.meshletTriangleOffset_, record.numMeshletTriangleBytes_);
+			if (!vertices || !indices || !lodRecords || !meshlets || !meshletVertices || !meshletTriangles || record.numAttributes_ > maxAttributes)
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted mesh cache, path : " + _path.string()) << std::endl;
+				return false;
+			}
+
+			utility::ByteBuffer::Layout layout;
+			for (uint32_t j = 0; j < record.numAttributes_; j++)
+			{
+				layout.AddAttribute(record.attributeSizes_[j]);
+			}
+
+			// like the extents of texture levels, every index is checked against the vertices it reads
+			const uint64_t stride = layout.GetSizeInBytes();
+			const uint64_t numVertices = stride ? record.vertexSize_ / stride : 0;
+			const bool validVertices = stride ? (record.vertexSize_ % stride == 0) : (record.vertexSize_ == 0);
+			const bool validMaterial = header->numMaterials_ == 0 || record.materialIndex_ < header->numMaterials_;
+			if (!validVertices || !validMaterial || !AreInRange(indices, record.numIndices_, numVertices) ||
+				!AreMeshletsValid(meshlets, record.numMeshlets_, meshletVertices, record.numMeshletVertices_, meshletTriangles, record.numMeshletTriangleBytes_, numVertices))
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted mesh cache, path : " + _path.string()) << std::endl;
+				return false;
+			}
+
+			Mesh& mesh = model.meshes_[i];
+			mesh.vertices_.SetLayout(layout);
+			mesh.vertices_.Resize(numVertices);
+			memcpy(mesh.vertices_.GetRawBufferAddress(), vertices, mesh.vertices_.GetSizeInBytes());
+			mesh.indices_.assign(indices, indices + record.numIndices_);
+			mesh.materialIndex_ = record.materialIndex_;
+			mesh.boundsMin_ = math::Float3(record.boundsMin_[0], record.boundsMin_[1], record.boundsMin_[2]);
+			mesh.boundsMax_ = math::Float3(record.boundsMax_[0], record.boundsMax_[1], record.boundsMax_[2]);
+
+			mesh.meshlets_.assign(meshlets, meshlets + record.numMeshlets_);
+			mesh.meshletVertices_.assign(meshletVertices, meshletVertices + record.numMeshletVertices_);
+			mesh.meshletTriangles_.assign(meshletTriangles, meshletTriangles + record.numMeshletTriangleBytes_);
+
+			mesh.lods_.resize(record.numLods_);
+			for (uint32_t j = 0; j < record.numLods_; j++)
+			{
+				const uint32_t* lodIndices = Fetch<uint32_t>(bytes, lodRecords[j].indexOffset_, lodRecords[j].numIndices_);
+				if (!lodIndices || !AreInRange(lodIndices, lodRecords[j].numIndices_, numVertices))
+				{
+					std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted mesh cache, path : " + _path.string()) << std::endl;
+					return false;
+				}
+
+				mesh.lods_[j].indices_.assign(lodIndices, lodIndices + lodRecords[j].numIndices_);
+				mesh.lods_[j].error_ = lodRecords[j].error_;
+			}
+		}
+
+		model.materials_.resize(header->numMaterials_);
+		for (uint32_t i = 0; i < header->numMaterials_; i++)
+		{
+			const MaterialRecord& record = materialRecords[i];
+			const char* diffuseMapPath = Fetch<char>(bytes, record.diffuseMapOffset_, record.diffuseMapLength_);
+			const char* normalMapPath = Fetch<char>(bytes, record.normalMapOffset_, record.normalMapLength_);
+			if (!diffuseMapPath || !normalMapPath)
+			{
+				return false;
+			}
+
+			model.materials_[i].diffuseMapPath_.assign(diffuseMapPath, record.diffuseMapLength_);
+			model.materials_[i].normalMapPath_.assign(normalMapPath, record.normalMapLength_);
+		}
+
+		_outModel = std::move(model);
+		return true;
+	}
+
+	bool MeshCache::Save(const std::filesystem::path& _path, const Model& _model, const std::filesystem::path& _sourcePath)
+	{
+		FileHeader header;
+		if (!QuerySource(_sourcePath, header.sourceSize_, header.sourceWriteTime_))
+		{
+			return false;
+		}
+
+		header.numMeshes_ = (uint32_t)_model.meshes_.size();
+		header.numMaterials_ = (uint32_t)_model.materials_.size();
+
+		Writer writer;
+		const uint64_t headerOffset = writer.Reserve(sizeof(FileHeader));
+		header.meshTableOffset_ = writer.Reserve(sizeof(MeshRecord) * header.numMeshes_);
+		header.materialTableOffset_ = writer.Reserve(sizeof(MaterialRecord) * header.numMaterials_);
+
+		for (uint32_t i = 0; i < header.numMeshes_; i++)
+		{
+			const Mesh& mesh = _model.meshes_[i];
+			const std::optional<utility::ByteBuffer::Layout> layout = mesh.vertices_.GetLayout();
+
+			MeshRecord record;
+			record.numAttributes_ = layout ? (uint32_t)layout->GetNumAttibutes() : 0;
+			if (record.numAttributes_ > maxAttributes)
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, "too many vertex attributes to cache mesh, path : " + _path.string()) << std::endl;
+				return false;
+			}
+
+			for (uint32_t j = 0; j < record.numAttributes_; j++)
+			{
+				record.attributeSizes_[j] = (uint32_t)layout->GetAttributeSize(j);
+			}
+
+			record.materialIndex_ = mesh.materialIndex_;
+			record.vertexSize_ = mesh.vertices_.GetSizeInBytes();
+			record.vertexOffset_ = writer.Write(mesh.vertices_.GetRawBufferAddress(), record.vertexSize_);
+			record.numIndices_ = mesh.indices_.size();
+			record.indexOffset_ = writer.Write(mesh.indices_.data(), mesh.indices_.size() * sizeof(uint32_t));
+			record.boundsMin_[0] = mesh.boundsMin_.x_;
+			record.boundsMin_[1] = mesh.boundsMin_.y_;
+			record.boundsMin_[2] = mesh.boundsMin_.z_;
+			record.boundsMax_[0] = mesh.boundsMax_.x_;
+			record.boundsMax_[1] = mesh.boundsMax_.y_;
+			record.boundsMax_[2] = mesh.boundsMax_.z_;
+
+			record.numMeshlets_ = (uint32_t)mesh.meshlets_.size();
+			record.meshletOffset_ = writer.Write(mesh.meshlets_.data(), mesh.meshlets_.size() * sizeof(Meshlet));
+			record.numMeshletVertices_ = mesh.meshletVertices_.size();
+			record.meshletVertexOffset_ = writer.Write(mesh.meshletVertices_.data(), mesh.meshletVertices_.size() * sizeof(uint32_t));
+			record.numMeshletTriangleBytes_ = mesh.meshletTriangles_.size();
+			record.meshletTriangleOffset_ = writer.Write(mesh.meshletTriangles_.data(), mesh.meshletTriangles_.size());
+
+			record.numLods_ = (uint32_t)mesh.lods_.size();
+			record.lodTableOffset_ = writer.Reserve(sizeof(LodRecord) * record.numLods_);
+			for (uint32_t j = 0; j < record.numLods_; j++)
+			{
+				LodRecord lodRecord;
+				lodRecord.numIndices_ = mesh.lods_[j].indices_.size();
+				lodRecord.indexOffset_ = writer.Write(mesh.lods_[j].indices_.data(), mesh.lods_[j].indices_.size() * sizeof(uint32_t));
+				lodRecord.error_ = mesh.lods_[j].error_;
+
+				writer.At<LodRecord>(record.lodTableOffset_ + sizeof(LodRecord) * j) = lodRecord;
+			}
+
+			writer.At<MeshRecord>(header.meshTableOffset_ + sizeof(MeshRecord) * i) = record;
+		}
+
+		for (uint32_t i = 0; i < header.numMaterials_; i++)
+		{
+			const Material& material = _model.materials_[i];
+
+			MaterialRecord record;
+			record.diffuseMapLength_ = (uint32_t)material.diffuseMapPath_.size();
+			record.diffuseMapOffset_ = writer.Write(material.diffuseMapPath_.data(), record.diffuseMapLength_);
+			record.normalMapLength_ = (uint32_t)material.normalMapPath_.size();
+			record.normalMapOffset_ = writer.Write(material.normalMapPath_.data(), record.normalMapLength_);
+
+			writer.At<MaterialRecord>(header.materialTableOffset_ + sizeof(MaterialRecord) * i) = record;
+		}
+
+		writer.At<FileHeader>(headerOffset) = header;
+
+		return WriteAtomically(_path, [&writer](std::ostream& _stream)
+			{
+				_stream.write((const char*)writer.GetBytes().data(), (std::streamsize)writer.GetBytes().size());
+				return true;
+			});
+	}
+}
\ No newline at end of file
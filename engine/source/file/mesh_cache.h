@@ -0,0 +1,24 @@
+#pragma once
+#include <filesystem>
+#include "utility/forward_declaration.h"
+
+namespace file
+{
+	// versioned binary image of an imported model (.cmesh) stored next to its source or cooked on its own,
+	// loading is a single mapping followed by offset fix-ups and bulk copies, no assimp involved
+	class MeshCache final
+	{
+	public:
+		static constexpr uint32_t version = 4;
+		static constexpr const char* extension = ".cmesh";
+
+	public:
+		static bool IsCooked(const std::filesystem::path& _path);
+		static std::filesystem::path GetCachePath(const std::filesystem::path& _sourcePath);
+
+		// fails when the file is missing or was written by another version,
+		// _sourcePath ties the file to the source it was made from and fails it once the source changed, cooked files have none
+		static bool Load(const std::filesystem::path& _path, Model& _outModel, const std::filesystem::path& _sourcePath = {});
+		static bool Save(const std::filesystem::path& _path, const Model& _model, const std::filesystem::path& _sourcePath = {});
+	};
+}
\ No newline at end of file
@@ -0,0 +1,396 @@
+#include "mesh_optimizer.h"
+#include "model.h"
+#include <unordered_map>
+#include <string_view>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cmath>
+
+namespace file
+{
+	namespace
+	{
+		constexpr uint32_t invalidIndex = ~0u;
+
+		math::Float3 GetPosition(const utility::ByteBuffer& _vertices, size_t _stride, size_t _offset, uint32_t _index)
+		{
+			float position[3] = {};
+			memcpy(position, _vertices.GetRawBufferAddress() + _stride * _index + _offset, sizeof(position));
+			return math::Float3(position[0], position[1], position[2]);
+		}
+
+		// triangles referencing each vertex, packed in a single array
+		struct Adjacency
+		{
+			std::vector<uint32_t> offsets_;
+			std::vector<uint32_t> triangles_;
+			std::vector<uint32_t> counts_;
+
+			Adjacency(const std::vector<uint32_t>& _indices, size_t _numVertices)
+				: offsets_(_numVertices + 1, 0)
+				, triangles_(_indices.size())
+				, counts_(_numVertices, 0)
+			{
+				for (uint32_t index : _indices)
+				{
+					counts_[index]++;
+				}
+
+				std::partial_sum(counts_.begin(), counts_.end(), offsets_.begin() + 1);
+
+				std::vector<uint32_t> cursors(offsets_.begin(), offsets_.end() - 1);
+				for (size_t i = 0; i < _indices.size(); i++)
+				{
+					triangles_[cursors[_indices[i]]++] = (uint32_t)(i / 3);
+				}
+			}
+		};
+	}
+
+	MeshOptimizer::Report MeshOptimizer::Optimize(Mesh& _mesh, uint32_t _cacheSize)
+	{
+		Report report;
+		report.numVerticesBefore_ = _mesh.vertices_.GetNumElements();
+		report.before_ = AnalyzeVertexCache(_mesh, _cacheSize);
+
+		RemoveDuplicateVertices(_mesh);
+		OptimizeVertexCache(_mesh, _cacheSize);
+		OptimizeOverdraw(_mesh, 1.05f, _cacheSize);
+		OptimizeVertexFetch(_mesh);
+
+		report.numVerticesAfter_ = _mesh.vertices_.GetNumElements();
+		report.after_ = AnalyzeVertexCache(_mesh, _cacheSize);
+		return report;
+	}
+
+	void MeshOptimizer::RemoveDuplicateVertices(Mesh& _mesh)
+	{
+		const size_t numVertices = _mesh.vertices_.GetNumElements();
+		const size_t stride = _mesh.vertices_.GetElementSize();
+		const char* rawBytes = (const char*)_mesh.vertices_.GetRawBufferAddress();
+
+		// vertices are compared bit for bit, same as what the gpu would fetch
+		std::unordered_map<std::string_view, uint32_t> uniqueVertices;
+		uniqueVertices.reserve(numVertices);
+
+		std::vector<uint32_t> remap(numVertices);
+		uint32_t numUniqueVertices = 0;
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			auto [iterator, inserted] = uniqueVertices.try_emplace(std::string_view(rawBytes + stride * i, stride), numUniqueVertices);
+			remap[i] = iterator->second;
+			numUniqueVertices += inserted ? 1 : 0;
+		}
+
+		if (numUniqueVertices != numVertices)
+		{
+			RemapVertices(_mesh, remap, numUniqueVertices);
+		}
+	}
+
+	// tipsify, sander et al. 2007
+	void MeshOptimizer::OptimizeVertexCache(Mesh& _mesh, uint32_t _cacheSize)
+	{
+		OptimizeVertexCache(_mesh.indices_, _mesh.vertices_.GetNumElements(), _cacheSize);
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& _indices, size_t _numVertices, uint32_t _cacheSize)
+	{
+		const std::vector<uint32_t>& indices = _indices;
+		const size_t numVertices = _numVertices;
+		const size_t numTriangles = indices.size() / 3;
+		if (numTriangles == 0)
+		{
+			return;
+		}
+
+		const Adjacency adjacency(indices, numVertices);
+		std::vector<uint32_t> liveTriangles = adjacency.counts_;
+		std::vector<uint32_t> cacheTimestamps(numVertices, 0);
+		std::vector<bool> emitted(numTriangles, false);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+
+		std::vector<uint32_t> optimized;
+		optimized.reserve(indices.size());
+
+		uint32_t timestamp = _cacheSize + 1;
+		uint32_t cursor = 0;
+		uint32_t fanningVertex = 0;
+
+		while (fanningVertex != invalidIndex)
+		{
+			candidates.clear();
+
+			for (uint32_t i = adjacency.offsets_[fanningVertex]; i < adjacency.offsets_[fanningVertex + 1]; i++)
+			{
+				const uint32_t triangle = adjacency.triangles_[i];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+
+				for (uint32_t j = 0; j < 3; j++)
+				{
+					const uint32_t vertex = indices[triangle * 3 + j];
+					optimized.push_back(vertex);
+					deadEnds.push_back(vertex);
+					candidates.push_back(vertex);
+					liveTriangles[vertex]--;
+
+					if (timestamp - cacheTimestamps[vertex] > _cacheSize)
+					{
+						cacheTimestamps[vertex] = timestamp++;
+					}
+				}
+
+				emitted[triangle] = true;
+			}
+
+			// prefer the candidate that is still in the cache and will stay there while its fan is emitted
+			fanningVertex = invalidIndex;
+			int64_t bestPriority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (liveTriangles[vertex] == 0)
+				{
+					continue;
+				}
+
+				int64_t priority = 0;
+				if (timestamp - cacheTimestamps[vertex] + 2 * liveTriangles[vertex] <= _cacheSize)
+				{
+					priority = timestamp - cacheTimestamps[vertex];
+				}
+
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					fanningVertex = vertex;
+				}
+			}
+
+			// dead end, fall back to recently used vertices and then to input order
+			while (fanningVertex == invalidIndex && !deadEnds.empty())
+			{
+				const uint32_t vertex = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[vertex] > 0)
+				{
+					fanningVertex = vertex;
+				}
+			}
+
+			while (fanningVertex == invalidIndex && cursor < numVertices)
+			{
+				if (liveTriangles[cursor] > 0)
+				{
+					fanningVertex = cursor;
+				}
+				cursor++;
+			}
+		}
+
+		_indices = std::move(optimized);
+	}
+
+	void MeshOptimizer::OptimizeOverdraw(Mesh& _mesh, float _threshold, uint32_t _cacheSize)
+	{
+		const std::optional<utility::ByteBuffer::Layout> layout = _mesh.vertices_.GetLayout();
+		const size_t numVertices = _mesh.vertices_.GetNumElements();
+		const size_t numTriangles = _mesh.indices_.size() / 3;
+		if (!layout || numTriangles == 0)
+		{
+			return;
+		}
+
+		const size_t stride = layout->GetSizeInBytes();
+		const size_t positionOffset = layout->GetAttributeOffset(0);
+
+		// clusters start wherever the cache is flushed, which tipsify output does only at dead ends
+		std::vector<uint32_t> clusterStarts;
+		{
+			std::vector<uint32_t> cacheTimestamps(numVertices, 0);
+			uint32_t timestamp = _cacheSize + 1;
+			for (size_t i = 0; i < numTriangles; i++)
+			{
+				uint32_t numMisses = 0;
+				for (size_t j = 0; j < 3; j++)
+				{
+					const uint32_t vertex = _mesh.indices_[i * 3 + j];
+					if (timestamp - cacheTimestamps[vertex] > _cacheSize)
+					{
+						cacheTimestamps[vertex] = timestamp++;
+						numMisses++;
+					}
+				}
+
+				if (i == 0 || numMisses == 3)
+				{
+					clusterStarts.push_back((uint32_t)i);
+				}
+			}
+		}
+
+		struct Cluster
+		{
+			uint32_t begin_ = 0;
+			uint32_t end_ = 0;
+			float sortKey_ = 0.0f;
+		};
+
+		std::vector<Cluster> clusters(clusterStarts.size());
+		std::vector<math::Float3> centroids(clusters.size());
+		std::vector<math::Float3> normals(clusters.size());
+		math::Float3 meshCentroid;
+		float meshArea = 0.0f;
+
+		for (size_t i = 0; i < clusters.size(); i++)
+		{
+			clusters[i].begin_ = clusterStarts[i];
+			clusters[i].end_ = (i + 1 < clusterStarts.size()) ? clusterStarts[i + 1] : (uint32_t)numTriangles;
+
+			math::Float3 centroid;
+			math::Float3 normal;
+			float clusterArea = 0.0f;
+
+			for (uint32_t j = clusters[i].begin_; j < clusters[i].end_; j++)
+			{
+				const math::Float3 p0 = GetPosition(_mesh.vertices_, stride, positionOffset, _mesh.indices_[j * 3 + 0]);
+				const math::Float3 p1 = GetPosition(_mesh.vertices_, stride, positionOffset, _mesh.indices_[j * 3 + 1]);
+				const math::Float3 p2 = GetPosition(_mesh.vertices_, stride, positionOffset, _mesh.indices_[j * 3 + 2]);
+
+				const math::Float3 e0(p1.x_ - p0.x_, p1.y_ - p0.y_, p1.z_ - p0.z_);
+				const math::Float3 e1(p2.x_ - p0.x_, p2.y_ - p0.y_, p2.z_ - p0.z_);
+				const math::Float3 cross(e0.y_ * e1.z_ - e0.z_ * e1.y_, e0.z_ * e1.x_ - e0.x_ * e1.z_, e0.x_ * e1.y_ - e0.y_ * e1.x_);
+				const float area = std::sqrt(cross.x_ * cross.x_ + cross.y_ * cross.y_ + cross.z_ * cross.z_);
+
+				// the unnormalized cross product already weighs each face normal by its area
+				normal = math::Float3(normal.x_ + cross.x_, normal.y_ + cross.y_, normal.z_ + cross.z_);
+				centroid = math::Float3(
+					centroid.x_ + (p0.x_ + p1.x_ + p2.x_) * area / 3.0f,
+					centroid.y_ + (p0.y_ + p1.y_ + p2.y_) * area / 3.0f,
+					centroid.z_ + (p0.z_ + p1.z_ + p2.z_) * area / 3.0f);
+				clusterArea += area;
+			}
+
+			meshCentroid = math::Float3(meshCentroid.x_ + centroid.x_, meshCentroid.y_ + centroid.y_, meshCentroid.z_ + centroid.z_);
+			meshArea += clusterArea;
+
+			const float inverseArea = clusterArea > 0.0f ? 1.0f / clusterArea : 0.0f;
+			centroids[i] = math::Float3(centroid.x_ * inverseArea, centroid.y_ * inverseArea, centroid.z_ * inverseArea);
+
+			const float length = std::sqrt(normal.x_ * normal.x_ + normal.y_ * normal.y_ + normal.z_ * normal.z_);
+			const float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+			normals[i] = math::Float3(normal.x_ * inverseLength, normal.y_ * inverseLength, normal.z_ * inverseLength);
+		}
+
+		const float inverseMeshArea = meshArea > 0.0f ? 1.0f / meshArea : 0.0f;
+		meshCentroid = math::Float3(meshCentroid.x_ * inverseMeshArea, meshCentroid.y_ * inverseMeshArea, meshCentroid.z_ * inverseMeshArea);
+
+		// clusters facing away from the center occlude the rest, so they are drawn first
+		for (size_t i = 0; i < clusters.size(); i++)
+		{
+			clusters[i].sortKey_ =
+				(centroids[i].x_ - meshCentroid.x_) * normals[i].x_ +
+				(centroids[i].y_ - meshCentroid.y_) * normals[i].y_ +
+				(centroids[i].z_ - meshCentroid.z_) * normals[i].z_;
+		}
+
+		std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& _lhs, const Cluster& _rhs) { return _lhs.sortKey_ > _rhs.sortKey_; });
+
+		std::vector<uint32_t> reordered;
+		reordered.reserve(_mesh.indices_.size());
+		for (const Cluster& cluster : clusters)
+		{
+			reordered.insert(reordered.end(), _mesh.indices_.begin() + cluster.begin_ * 3, _mesh.indices_.begin() + cluster.end_ * 3);
+		}
+
+		const float acmrBefore = AnalyzeVertexCache(_mesh.indices_, numVertices, _cacheSize).acmr_;
+		const float acmrAfter = AnalyzeVertexCache(reordered, numVertices, _cacheSize).acmr_;
+		if (acmrAfter <= acmrBefore * _threshold)
+		{
+			_mesh.indices_ = std::move(reordered);
+		}
+	}
+
+	void MeshOptimizer::OptimizeVertexFetch(Mesh& _mesh)
+	{
+		// vertices are laid out in the order they are first referenced, unreferenced ones are dropped
+		std::vector<uint32_t> remap(_mesh.vertices_.GetNumElements(), invalidIndex);
+		uint32_t numVertices = 0;
+		for (uint32_t index : _mesh.indices_)
+		{
+			if (remap[index] == invalidIndex)
+			{
+				remap[index] = numVertices++;
+			}
+		}
+
+		RemapVertices(_mesh, remap, numVertices);
+	}
+
+	MeshOptimizer::Statistics MeshOptimizer::AnalyzeVertexCache(const Mesh& _mesh, uint32_t _cacheSize)
+	{
+		return AnalyzeVertexCache(_mesh.indices_, _mesh.vertices_.GetNumElements(), _cacheSize);
+	}
+
+	MeshOptimizer::Statistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& _indices, size_t _numVertices, uint32_t _cacheSize)
+	{
+		Statistics statistics;
+		if (_indices.empty())
+		{
+			return statistics;
+		}
+
+		// fifo cache simulation, a vertex stays resident until cacheSize newer misses happened
+		std::vector<uint32_t> cacheTimestamps(_numVertices, 0);
+		uint32_t timestamp = _cacheSize + 1;
+		size_t numMisses = 0;
+		size_t numReferencedVertices = 0;
+		for (uint32_t index : _indices)
+		{
+			numReferencedVertices += (cacheTimestamps[index] == 0) ? 1 : 0;
+			if (timestamp - cacheTimestamps[index] > _cacheSize)
+			{
+				cacheTimestamps[index] = timestamp++;
+				numMisses++;
+			}
+		}
+
+		statistics.acmr_ = (float)numMisses / (float)(_indices.size() / 3);
+		statistics.atvr_ = (float)numMisses / (float)numReferencedVertices;
+		return statistics;
+	}
+
+	void MeshOptimizer::RemapVertices(Mesh& _mesh, const std::vector<uint32_t>& _remap, uint32_t _numVertices)
+	{
+		const std::optional<utility::ByteBuffer::Layout> layout = _mesh.vertices_.GetLayout();
+		if (!layout)
+		{
+			return;
+		}
+
+		const size_t stride = layout->GetSizeInBytes();
+
+		utility::ByteBuffer vertices;
+		vertices.SetLayout(*layout);
+		vertices.Resize(_numVertices);
+
+		for (size_t i = 0; i < _remap.size(); i++)
+		{
+			if (_remap[i] != invalidIndex)
+			{
+				memcpy(vertices.GetRawBufferAddress() + stride * _remap[i], _mesh.vertices_.GetRawBufferAddress() + stride * i, stride);
+			}
+		}
+
+		for (uint32_t& index : _mesh.indices_)
+		{
+			index = _remap[index];
+		}
+
+		_mesh.vertices_ = std::move(vertices);
+	}
+}
\ No newline at end of file
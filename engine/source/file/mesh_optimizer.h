@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "utility/forward_declaration.h"
+
+namespace file
+{
+	// reorders and compacts imported meshes before they reach the gpu, positions are expected in attribute 0
+	class MeshOptimizer final
+	{
+	public:
+		static constexpr uint32_t defaultCacheSize = 16;
+
+		struct Statistics
+		{
+			float acmr_ = 0.0f; // average cache miss ratio, transformed vertices per triangle
+			float atvr_ = 0.0f; // average transform to vertex ratio, 1.0 means every vertex is shaded once
+		};
+
+		struct Report
+		{
+			Statistics before_;
+			Statistics after_;
+			size_t numVerticesBefore_ = 0;
+			size_t numVerticesAfter_ = 0;
+		};
+
+	public:
+		// runs every stage in order, deduplication, vertex cache, overdraw and vertex fetch
+		static Report Optimize(Mesh& _mesh, uint32_t _cacheSize = defaultCacheSize);
+
+		static void RemoveDuplicateVertices(Mesh& _mesh);
+		static void OptimizeVertexCache(Mesh& _mesh, uint32_t _cacheSize = defaultCacheSize);
+		static void OptimizeVertexCache(std::vector<uint32_t>& _indices, size_t _numVertices, uint32_t _cacheSize = defaultCacheSize);
+		// clusters are only reordered while the vertex cache efficiency stays within the given ratio
+		static void OptimizeOverdraw(Mesh& _mesh, float _threshold = 1.05f, uint32_t _cacheSize = defaultCacheSize);
+		static void OptimizeVertexFetch(Mesh& _mesh);
+
+		static Statistics AnalyzeVertexCache(const Mesh& _mesh, uint32_t _cacheSize = defaultCacheSize);
+
+	private:
+		static Statistics AnalyzeVertexCache(const std::vector<uint32_t>& _indices, size_t _numVertices, uint32_t _cacheSize);
+		static void RemapVertices(Mesh& _mesh, const std::vector<uint32_t>& _remap, uint32_t _numVertices);
+	};
+}
\ No newline at end of file
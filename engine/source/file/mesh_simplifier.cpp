@@ -0,0 +1,464 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+#include "model.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+
+namespace file
+{
+	namespace
+	{
+		struct Quadric
+		{
+			double a2_ = 0.0, ab_ = 0.0, ac_ = 0.0, ad_ = 0.0;
+			double b2_ = 0.0, bc_ = 0.0, bd_ = 0.0;
+			double c2_ = 0.0, cd_ = 0.0;
+			double d2_ = 0.0;
+			double weight_ = 0.0;
+
+			Quadric() = default;
+
+			// squared distance to the plane ax + by + cz + d = 0, weighted by the triangle area
+			Quadric(double _a, double _b, double _c, double _d, double _weight)
+				: a2_(_a * _a * _weight), ab_(_a * _b * _weight), ac_(_a * _c * _weight), ad_(_a * _d * _weight)
+				, b2_(_b * _b * _weight), bc_(_b * _c * _weight), bd_(_b * _d * _weight)
+				, c2_(_c * _c * _weight), cd_(_c * _d * _weight)
+				, d2_(_d * _d * _weight)
+				, weight_(_weight)
+			{}
+
+			Quadric& operator+=(const Quadric& _other)
+			{
+				a2_ += _other.a2_; ab_ += _other.ab_; ac_ += _other.ac_; ad_ += _other.ad_;
+				b2_ += _other.b2_; bc_ += _other.bc_; bd_ += _other.bd_;
+				c2_ += _other.c2_; cd_ += _other.cd_;
+				d2_ += _other.d2_;
+				weight_ += _other.weight_;
+				return *this;
+			}
+
+			// mean squared distance of the accumulated planes to the given point
+			double Evaluate(const double* _point) const
+			{
+				const double x = _point[0];
+				const double y = _point[1];
+				const double z = _point[2];
+
+				const double error =
+					a2_ * x * x + 2.0 * ab_ * x * y + 2.0 * ac_ * x * z + 2.0 * ad_ * x +
+					b2_ * y * y + 2.0 * bc_ * y * z + 2.0 * bd_ * y +
+					c2_ * z * z + 2.0 * cd_ * z +
+					d2_;
+
+				return weight_ > 0.0 ? std::abs(error) / weight_ : 0.0;
+			}
+		};
+
+		struct Collapse
+		{
+			uint32_t from_ = 0;
+			uint32_t to_ = 0;
+			double cost_ = 0.0;
+			double geometricError_ = 0.0;
+		};
+
+		void Cross(const double* _lhs, const double* _rhs, double* _out)
+		{
+			_out[0] = _lhs[1] * _rhs[2] - _lhs[2] * _rhs[1];
+			_out[1] = _lhs[2] * _rhs[0] - _lhs[0] * _rhs[2];
+			_out[2] = _lhs[0] * _rhs[1] - _lhs[1] * _rhs[0];
+		}
+
+		double Dot(const double* _lhs, const double* _rhs)
+		{
+			return _lhs[0] * _rhs[0] + _lhs[1] * _rhs[1] + _lhs[2] * _rhs[2];
+		}
+
+		void TriangleNormal(const double* _p0, const double* _p1, const double* _p2, double* _out)
+		{
+			const double e0[3] = { _p1[0] - _p0[0], _p1[1] - _p0[1], _p1[2] - _p0[2] };
+			const double e1[3] = { _p2[0] - _p0[0], _p2[1] - _p0[1], _p2[2] - _p0[2] };
+			Cross(e0, e1, _out);
+		}
+	}
+
+	void MeshSimplifier::GenerateLods(Mesh& _mesh)
+	{
+		GenerateLods(_mesh, Settings{});
+	}
+
+	void MeshSimplifier::GenerateLods(Mesh& _mesh, const Settings& _settings)
+	{
+		_mesh.lods_.clear();
+
+		const std::optional<utility::ByteBuffer::Layout> layout = _mesh.vertices_.GetLayout();
+		if (!layout || _mesh.indices_.empty())
+		{
+			return;
+		}
+
+		const size_t numVertices = _mesh.vertices_.GetNumElements();
+		const size_t stride = layout->GetSizeInBytes();
+		const size_t positionOffset = layout->GetAttributeOffset(0);
+
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			float position[3] = {};
+			memcpy(position, _mesh.vertices_.GetRawBufferAddress() + stride * i + positionOffset, sizeof(position));
+			for (size_t j = 0; j < 3; j++)
+			{
+				minimum[j] = std::min(minimum[j], position[j]);
+				maximum[j] = std::max(maximum[j], position[j]);
+			}
+		}
+
+		const float diagonal = std::sqrt(
+			(maximum[0] - minimum[0]) * (maximum[0] - minimum[0]) +
+			(maximum[1] - minimum[1]) * (maximum[1] - minimum[1]) +
+			(maximum[2] - minimum[2]) * (maximum[2] - minimum[2]));
+		const float errorBudget = _settings.maxError_ * diagonal;
+
+		const std::vector<uint32_t>* previousIndices = &_mesh.indices_;
+		float previousError = 0.0f;
+
+		for (uint32_t i = 0; i < _settings.maxLods_; i++)
+		{
+			const size_t targetIndexCount = (size_t)((float)(previousIndices->size() / 3) * _settings.triangleRatio_) * 3;
+			if (targetIndexCount < 3 || previousError >= errorBudget)
+			{
+				break;
+			}
+
+			MeshLod lod;
+			const float error = Simplify(_mesh, *previousIndices, targetIndexCount, errorBudget - previousError, _settings.attributeWeight_, lod.indices_);
+
+			// a level that barely removes anything is not worth a draw path of its own
+			if (lod.indices_.empty() || (float)lod.indices_.size() > (float)previousIndices->size() * 0.95f)
+			{
+				break;
+			}
+
+			// errors of consecutive levels add up in the worst case since each one is simplified from the previous
+			lod.error_ = previousError + error;
+			MeshOptimizer::OptimizeVertexCache(lod.indices_, numVertices);
+
+			previousError = lod.error_;
+			_mesh.lods_.push_back(std::move(lod));
+			previousIndices = &_mesh.lods_.back().indices_;
+		}
+	}
+
+	float MeshSimplifier::Simplify(const Mesh& _mesh, const std::vector<uint32_t>& _indices, size_t _targetIndexCount, float _maxError, float _attributeWeight, std::vector<uint32_t>& _outIndices)
+	{
+		_outIndices = _indices;
+
+		const std::optional<utility::ByteBuffer::Layout> layout = _mesh.vertices_.GetLayout();
+		if (!layout || _indices.size() <= _targetIndexCount)
+		{
+			return 0.0f;
+		}
+
+		const size_t numVertices = _mesh.vertices_.GetNumElements();
+		const size_t stride = layout->GetSizeInBytes();
+		const size_t positionOffset = layout->GetAttributeOffset(0);
+		const uint8_t* rawBytes = _mesh.vertices_.GetRawBufferAddress();
+
+		// positions are normalized to a unit box so that costs and thresholds do not depend on the model scale
+		std::vector<double> positions(numVertices * 3);
+		double minimum[3] = { DBL_MAX, DBL_MAX, DBL_MAX };
+		double maximum[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			float position[3] = {};
+			memcpy(position, rawBytes + stride * i + positionOffset, sizeof(position));
+			for (size_t j = 0; j < 3; j++)
+			{
+				positions[i * 3 + j] = position[j];
+				minimum[j] = std::min(minimum[j], (double)position[j]);
+				maximum[j] = std::max(maximum[j], (double)position[j]);
+			}
+		}
+
+		const double extent = std::max({ maximum[0] - minimum[0], maximum[1] - minimum[1], maximum[2] - minimum[2], DBL_MIN });
+		const double scale = 1.0 / extent;
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			for (size_t j = 0; j < 3; j++)
+			{
+				positions[i * 3 + j] = (positions[i * 3 + j] - minimum[j]) * scale;
+			}
+		}
+
+		// every attribute but the position takes part in the collapse cost
+		std::vector<size_t> attributeFloatOffsets;
+		for (size_t i = 1; i < layout->GetNumAttibutes(); i++)
+		{
+			for (size_t j = 0; j < layout->GetAttributeSize(i) / sizeof(float); j++)
+			{
+				attributeFloatOffsets.push_back(layout->GetAttributeOffset(i) + j * sizeof(float));
+			}
+		}
+
+		auto attributeDistance = [&](uint32_t _lhs, uint32_t _rhs)
+			{
+				double distance = 0.0;
+				for (size_t offset : attributeFloatOffsets)
+				{
+					float lhs = 0.0f;
+					float rhs = 0.0f;
+					memcpy(&lhs, rawBytes + stride * _lhs + offset, sizeof(float));
+					memcpy(&rhs, rawBytes + stride * _rhs + offset, sizeof(float));
+					distance += (double)(lhs - rhs) * (double)(lhs - rhs);
+				}
+				return distance;
+			};
+
+		// vertices sharing a position across an attribute seam, or lying on an open border, are never moved
+		std::vector<uint32_t> positionGroups(numVertices);
+		std::vector<uint32_t> groupSizes(numVertices, 0);
+		{
+			std::unordered_map<std::string_view, uint32_t> uniquePositions;
+			uniquePositions.reserve(numVertices);
+			for (uint32_t i = 0; i < numVertices; i++)
+			{
+				const std::string_view key((const char*)(rawBytes + stride * i + positionOffset), sizeof(float) * 3);
+				positionGroups[i] = uniquePositions.try_emplace(key, i).first->second;
+				groupSizes[positionGroups[i]]++;
+			}
+		}
+
+		std::vector<bool> locked(numVertices, false);
+		{
+			std::unordered_set<uint64_t> edges;
+			edges.reserve(_indices.size());
+			for (size_t i = 0; i < _indices.size(); i += 3)
+			{
+				for (size_t j = 0; j < 3; j++)
+				{
+					const uint64_t from = positionGroups[_indices[i + j]];
+					const uint64_t to = positionGroups[_indices[i + (j + 1) % 3]];
+					edges.insert((from << 32) | to);
+				}
+			}
+
+			for (size_t i = 0; i < _indices.size(); i += 3)
+			{
+				for (size_t j = 0; j < 3; j++)
+				{
+					const uint32_t from = _indices[i + j];
+					const uint32_t to = _indices[i + (j + 1) % 3];
+					if (!edges.contains(((uint64_t)positionGroups[to] << 32) | positionGroups[from]))
+					{
+						locked[from] = true;
+						locked[to] = true;
+					}
+				}
+			}
+
+			for (uint32_t i = 0; i < numVertices; i++)
+			{
+				locked[i] = locked[i] || groupSizes[positionGroups[i]] > 1;
+			}
+		}
+
+		std::vector<Quadric> quadrics(numVertices);
+		for (size_t i = 0; i < _indices.size(); i += 3)
+		{
+			const double* p0 = &positions[_indices[i + 0] * 3];
+			const double* p1 = &positions[_indices[i + 1] * 3];
+			const double* p2 = &positions[_indices[i + 2] * 3];
+
+			double normal[3] = {};
+			TriangleNormal(p0, p1, p2, normal);
+			const double length = std::sqrt(Dot(normal, normal));
+			if (length <= 0.0)
+			{
+				continue;
+			}
+
+			normal[0] /= length;
+			normal[1] /= length;
+			normal[2] /= length;
+
+			const Quadric quadric(normal[0], normal[1], normal[2], -Dot(normal, p0), length * 0.5);
+			quadrics[_indices[i + 0]] += quadric;
+			quadrics[_indices[i + 1]] += quadric;
+			quadrics[_indices[i + 2]] += quadric;
+		}
+
+		const double maxCost = ((double)_maxError * scale) * ((double)_maxError * scale);
+		const size_t targetTriangles = _targetIndexCount / 3;
+		double resultError = 0.0;
+
+		std::vector<uint32_t> adjacencyOffsets(numVertices + 1);
+		std::vector<uint32_t> adjacentTriangles;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> remap(numVertices);
+		std::vector<bool> touched(numVertices);
+
+		while (_outIndices.size() / 3 > targetTriangles)
+		{
+			const size_t numTriangles = _outIndices.size() / 3;
+
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (uint32_t index : _outIndices)
+			{
+				adjacencyOffsets[index + 1]++;
+			}
+			std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+			adjacentTriangles.resize(_outIndices.size());
+			std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < _outIndices.size(); i++)
+			{
+				adjacentTriangles[cursors[_outIndices[i]]++] = (uint32_t)(i / 3);
+			}
+
+			auto evaluate = [&](uint32_t _from, uint32_t _to, Collapse& _outCollapse)
+				{
+					if (locked[_from])
+					{
+						return false;
+					}
+
+					Quadric quadric = quadrics[_from];
+					quadric += quadrics[_to];
+
+					_outCollapse.from_ = _from;
+					_outCollapse.to_ = _to;
+					_outCollapse.geometricError_ = quadric.Evaluate(&positions[_to * 3]);
+					_outCollapse.cost_ = _outCollapse.geometricError_ + _attributeWeight * attributeDistance(_from, _to);
+					return true;
+				};
+
+			collapses.clear();
+			for (size_t i = 0; i < _outIndices.size(); i += 3)
+			{
+				for (size_t j = 0; j < 3; j++)
+				{
+					const uint32_t a = _outIndices[i + j];
+					const uint32_t b = _outIndices[i + (j + 1) % 3];
+					if (a > b)
+					{
+						continue;
+					}
+
+					Collapse forward;
+					Collapse backward;
+					const bool forwardValid = evaluate(a, b, forward);
+					const bool backwardValid = evaluate(b, a, backward);
+					if (forwardValid || backwardValid)
+					{
+						collapses.push_back((forwardValid && (!backwardValid || forward.cost_ <= backward.cost_)) ? forward : backward);
+					}
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& _lhs, const Collapse& _rhs) { return _lhs.cost_ < _rhs.cost_; });
+
+			// rejects collapses that would turn a surrounding triangle over
+			auto flips = [&](uint32_t _from, uint32_t _to)
+				{
+					for (uint32_t i = adjacencyOffsets[_from]; i < adjacencyOffsets[_from + 1]; i++)
+					{
+						const uint32_t* triangle = &_outIndices[adjacentTriangles[i] * 3];
+						if (triangle[0] == _to || triangle[1] == _to || triangle[2] == _to)
+						{
+							continue;
+						}
+
+						double before[3] = {};
+						double after[3] = {};
+						const double* p[3] = { &positions[triangle[0] * 3], &positions[triangle[1] * 3], &positions[triangle[2] * 3] };
+						TriangleNormal(p[0], p[1], p[2], before);
+						for (size_t j = 0; j < 3; j++)
+						{
+							p[j] = (triangle[j] == _from) ? &positions[_to * 3] : p[j];
+						}
+						TriangleNormal(p[0], p[1], p[2], after);
+
+						if (Dot(before, after) <= 0.25 * std::sqrt(Dot(before, before) * Dot(after, after)))
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+
+			std::iota(remap.begin(), remap.end(), 0);
+			std::fill(touched.begin(), touched.end(), false);
+
+			// interior collapses remove two triangles each
+			const size_t collapseBudget = (numTriangles - targetTriangles) / 2 + 1;
+			size_t numCollapses = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.cost_ > maxCost || numCollapses >= collapseBudget)
+				{
+					break;
+				}
+
+				if (touched[collapse.from_] || touched[collapse.to_] || flips(collapse.from_, collapse.to_))
+				{
+					continue;
+				}
+
+				remap[collapse.from_] = collapse.to_;
+				quadrics[collapse.to_] += quadrics[collapse.from_];
+				resultError = std::max(resultError, collapse.geometricError_);
+				numCollapses++;
+
+				// the one ring is frozen for the rest of the pass so that the flip tests above stay valid
+				for (uint32_t i = adjacencyOffsets[collapse.from_]; i < adjacencyOffsets[collapse.from_ + 1]; i++)
+				{
+					const uint32_t* triangle = &_outIndices[adjacentTriangles[i] * 3];
+					touched[triangle[0]] = true;
+					touched[triangle[1]] = true;
+					touched[triangle[2]] = true;
+				}
+			}
+
+			if (numCollapses == 0)
+			{
+				break;
+			}
+
+			size_t writeCursor = 0;
+			for (size_t i = 0; i < _outIndices.size(); i += 3)
+			{
+				const uint32_t a = remap[_outIndices[i + 0]];
+				const uint32_t b = remap[_outIndices[i + 1]];
+				const uint32_t c = remap[_outIndices[i + 2]];
+				if (a == b || b == c || c == a)
+				{
+					continue;
+				}
+
+				_outIndices[writeCursor++] = a;
+				_outIndices[writeCursor++] = b;
+				_outIndices[writeCursor++] = c;
+			}
+			_outIndices.resize(writeCursor);
+		}
+
+		return (float)(std::sqrt(resultError) * extent);
+	}
+
+	float MeshSimplifier::ProjectError(float _error, float _distance, float _fovY, float _viewportHeight)
+	{
+		if (_distance <= 0.0f)
+		{
+			return FLT_MAX;
+		}
+
+		return _error / _distance * (_viewportHeight * 0.5f / std::tan(_fovY * 0.5f));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "utility/forward_declaration.h"
+
+namespace file
+{
+	// quadric error edge collapse (garland and heckbert 1997) restricted to existing vertices,
+	// so every level of detail indexes the same vertex buffer as the full mesh
+	class MeshSimplifier final
+	{
+	public:
+		struct Settings
+		{
+			uint32_t maxLods_ = 4;
+			float triangleRatio_ = 0.5f; // target triangle count of each level relative to the previous one
+			float maxError_ = 0.02f; // relative to the bounding box diagonal, levels stop once this is exceeded
+			float attributeWeight_ = 0.001f; // weight of non position attribute differences in the collapse cost
+		};
+
+	public:
+		// replaces _mesh.lods_, positions are expected in attribute 0 and every attribute is read as floats
+		static void GenerateLods(Mesh& _mesh);
+		static void GenerateLods(Mesh& _mesh, const Settings& _settings);
+
+		// simplifies _indices towards _targetIndexCount and returns the reached object space error
+		static float Simplify(const Mesh& _mesh, const std::vector<uint32_t>& _indices, size_t _targetIndexCount, float _maxError, float _attributeWeight, std::vector<uint32_t>& _outIndices);
+
+		// error in pixels for a level seen from _distance with a vertical field of view of _fovY radians
+		static float ProjectError(float _error, float _distance, float _fovY, float _viewportHeight);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,307 @@
+#include "meshlet_builder.h"
+#include "model.h"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+
+namespace file
+{
+	namespace
+	{
+		constexpr uint8_t unassigned = 0xff;
+
+		// a cone is only kept while every triangle stays within about 84 degrees of its axis
+		constexpr float minConeSpread = 0.1f;
+
+		void ReadPosition(const Mesh& _mesh, size_t _stride, size_t _offset, uint32_t _index, float* _out)
+		{
+			memcpy(_out, _mesh.vertices_.GetRawBufferAddress() + _stride * _index + _offset, sizeof(float) * 3);
+		}
+	}
+
+	void MeshletBuilder::Build(Mesh& _mesh)
+	{
+		_mesh.meshlets_.clear();
+		_mesh.meshletVertices_.clear();
+		_mesh.meshletTriangles_.clear();
+
+		const std::optional<utility::ByteBuffer::Layout> layout = _mesh.vertices_.GetLayout();
+		const std::vector<uint32_t>& indices = _mesh.indices_;
+		const size_t numVertices = _mesh.vertices_.GetNumElements();
+		const size_t numTriangles = indices.size() / 3;
+		if (!layout || numTriangles == 0)
+		{
+			return;
+		}
+
+		const size_t stride = layout->GetSizeInBytes();
+		const size_t positionOffset = layout->GetAttributeOffset(0);
+
+		std::vector<float> triangleCentroids(numTriangles * 3);
+		for (size_t i = 0; i < numTriangles; i++)
+		{
+			for (size_t j = 0; j < 3; j++)
+			{
+				float position[3] = {};
+				ReadPosition(_mesh, stride, positionOffset, indices[i * 3 + j], position);
+				triangleCentroids[i * 3 + 0] += position[0] / 3.0f;
+				triangleCentroids[i * 3 + 1] += position[1] / 3.0f;
+				triangleCentroids[i * 3 + 2] += position[2] / 3.0f;
+			}
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+		for (uint32_t index : indices)
+		{
+			adjacencyOffsets[index + 1]++;
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+		std::vector<uint32_t> adjacentTriangles(indices.size());
+		{
+			std::vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				adjacentTriangles[cursors[indices[i]]++] = (uint32_t)(i / 3);
+			}
+		}
+
+		std::vector<bool> emitted(numTriangles, false);
+		std::vector<uint8_t> localIndices(numVertices, unassigned);
+		std::vector<uint32_t> candidates;
+		size_t seedCursor = 0;
+
+		Meshlet meshlet;
+		float centroidSum[3] = {};
+
+		auto flush = [&]()
+			{
+				if (meshlet.numTriangles_ == 0)
+				{
+					return;
+				}
+
+				for (uint32_t i = 0; i < meshlet.numVertices_; i++)
+				{
+					localIndices[_mesh.meshletVertices_[meshlet.vertexOffset_ + i]] = unassigned;
+				}
+
+				ComputeBounds(_mesh, meshlet);
+				_mesh.meshlets_.push_back(meshlet);
+
+				meshlet = Meshlet{};
+				meshlet.vertexOffset_ = (uint32_t)_mesh.meshletVertices_.size();
+				meshlet.triangleOffset_ = (uint32_t)_mesh.meshletTriangles_.size();
+				centroidSum[0] = centroidSum[1] = centroidSum[2] = 0.0f;
+				candidates.clear();
+			};
+
+		auto countNewVertices = [&](uint32_t _triangle)
+			{
+				uint32_t numNewVertices = 0;
+				for (size_t j = 0; j < 3; j++)
+				{
+					numNewVertices += (localIndices[indices[_triangle * 3 + j]] == unassigned) ? 1 : 0;
+				}
+				return numNewVertices;
+			};
+
+		for (size_t numEmitted = 0; numEmitted < numTriangles; numEmitted++)
+		{
+			// grow through shared vertices first, then towards the cluster centroid to keep it compact
+			uint32_t bestTriangle = ~0u;
+			uint32_t bestNewVertices = ~0u;
+			float bestDistance = FLT_MAX;
+
+			size_t writeCursor = 0;
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				const uint32_t triangle = candidates[i];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+				candidates[writeCursor++] = triangle;
+
+				const uint32_t numNewVertices = countNewVertices(triangle);
+				if (meshlet.numVertices_ + numNewVertices > maxVertices)
+				{
+					continue;
+				}
+
+				const float inverseCount = 1.0f / (float)meshlet.numTriangles_;
+				const float dx = triangleCentroids[triangle * 3 + 0] - centroidSum[0] * inverseCount;
+				const float dy = triangleCentroids[triangle * 3 + 1] - centroidSum[1] * inverseCount;
+				const float dz = triangleCentroids[triangle * 3 + 2] - centroidSum[2] * inverseCount;
+				const float distance = dx * dx + dy * dy + dz * dz;
+
+				if (numNewVertices < bestNewVertices || (numNewVertices == bestNewVertices && distance < bestDistance))
+				{
+					bestTriangle = triangle;
+					bestNewVertices = numNewVertices;
+					bestDistance = distance;
+				}
+			}
+			candidates.resize(writeCursor);
+
+			if (bestTriangle == ~0u)
+			{
+				flush();
+
+				while (emitted[seedCursor])
+				{
+					seedCursor++;
+				}
+				bestTriangle = (uint32_t)seedCursor;
+			}
+
+			emitted[bestTriangle] = true;
+			for (size_t j = 0; j < 3; j++)
+			{
+				const uint32_t vertex = indices[bestTriangle * 3 + j];
+				if (localIndices[vertex] == unassigned)
+				{
+					localIndices[vertex] = (uint8_t)meshlet.numVertices_++;
+					_mesh.meshletVertices_.push_back(vertex);
+
+					for (uint32_t k = adjacencyOffsets[vertex]; k < adjacencyOffsets[vertex + 1]; k++)
+					{
+						if (!emitted[adjacentTriangles[k]])
+						{
+							candidates.push_back(adjacentTriangles[k]);
+						}
+					}
+				}
+
+				_mesh.meshletTriangles_.push_back(localIndices[vertex]);
+			}
+
+			centroidSum[0] += triangleCentroids[bestTriangle * 3 + 0];
+			centroidSum[1] += triangleCentroids[bestTriangle * 3 + 1];
+			centroidSum[2] += triangleCentroids[bestTriangle * 3 + 2];
+			meshlet.numTriangles_++;
+
+			if (meshlet.numTriangles_ == maxTriangles || meshlet.numVertices_ == maxVertices)
+			{
+				flush();
+			}
+		}
+
+		flush();
+	}
+
+	void MeshletBuilder::ComputeBounds(const Mesh& _mesh, Meshlet& _meshlet)
+	{
+		const std::optional<utility::ByteBuffer::Layout> layout = _mesh.vertices_.GetLayout();
+		if (!layout || _meshlet.numTriangles_ == 0)
+		{
+			return;
+		}
+
+		const size_t stride = layout->GetSizeInBytes();
+		const size_t positionOffset = layout->GetAttributeOffset(0);
+
+		// sphere around the center of the bounding box
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t i = 0; i < _meshlet.numVertices_; i++)
+		{
+			float position[3] = {};
+			ReadPosition(_mesh, stride, positionOffset, _mesh.meshletVertices_[_meshlet.vertexOffset_ + i], position);
+			for (size_t j = 0; j < 3; j++)
+			{
+				minimum[j] = std::min(minimum[j], position[j]);
+				maximum[j] = std::max(maximum[j], position[j]);
+			}
+		}
+
+		const float center[3] = { (minimum[0] + maximum[0]) * 0.5f, (minimum[1] + maximum[1]) * 0.5f, (minimum[2] + maximum[2]) * 0.5f };
+		float radiusSquared = 0.0f;
+		for (uint32_t i = 0; i < _meshlet.numVertices_; i++)
+		{
+			float position[3] = {};
+			ReadPosition(_mesh, stride, positionOffset, _mesh.meshletVertices_[_meshlet.vertexOffset_ + i], position);
+			const float dx = position[0] - center[0];
+			const float dy = position[1] - center[1];
+			const float dz = position[2] - center[2];
+			radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+		}
+
+		_meshlet.center_ = math::Float3(center[0], center[1], center[2]);
+		_meshlet.radius_ = std::sqrt(radiusSquared);
+
+		// normal cone from the geometric normals of the triangles
+		std::vector<float> normals;
+		std::vector<float> points;
+		normals.reserve(_meshlet.numTriangles_ * 3);
+		points.reserve(_meshlet.numTriangles_ * 3);
+		float axis[3] = {};
+
+		for (uint32_t i = 0; i < _meshlet.numTriangles_; i++)
+		{
+			float p[3][3] = {};
+			for (size_t j = 0; j < 3; j++)
+			{
+				const uint8_t localIndex = _mesh.meshletTriangles_[_meshlet.triangleOffset_ + i * 3 + j];
+				ReadPosition(_mesh, stride, positionOffset, _mesh.meshletVertices_[_meshlet.vertexOffset_ + localIndex], p[j]);
+			}
+
+			const float e0[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			const float e1[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			float normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length <= 0.0f)
+			{
+				continue;
+			}
+
+			for (size_t j = 0; j < 3; j++)
+			{
+				normal[j] /= length;
+				axis[j] += normal[j];
+				normals.push_back(normal[j]);
+				points.push_back(p[0][j]);
+			}
+		}
+
+		const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		_meshlet.coneApex_ = _meshlet.center_;
+		_meshlet.coneCutoff_ = 1.0f;
+		if (axisLength <= 0.0f)
+		{
+			_meshlet.coneAxis_ = math::Float3();
+			return;
+		}
+
+		axis[0] /= axisLength;
+		axis[1] /= axisLength;
+		axis[2] /= axisLength;
+		_meshlet.coneAxis_ = math::Float3(axis[0], axis[1], axis[2]);
+
+		float minimumDot = 1.0f;
+		for (size_t i = 0; i < normals.size(); i += 3)
+		{
+			minimumDot = std::min(minimumDot, normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]);
+		}
+
+		if (minimumDot <= minConeSpread)
+		{
+			return; // too wide to ever be rejected
+		}
+
+		// the apex is moved back along the axis until every triangle plane lies in front of it
+		float maxDistance = 0.0f;
+		for (size_t i = 0; i < normals.size(); i += 3)
+		{
+			const float toCenter[3] = { center[0] - points[i], center[1] - points[i + 1], center[2] - points[i + 2] };
+			const float planeDistance = toCenter[0] * normals[i] + toCenter[1] * normals[i + 1] + toCenter[2] * normals[i + 2];
+			const float axisDot = axis[0] * normals[i] + axis[1] * normals[i + 1] + axis[2] * normals[i + 2];
+			maxDistance = std::max(maxDistance, planeDistance / axisDot);
+		}
+
+		_meshlet.coneApex_ = math::Float3(center[0] - axis[0] * maxDistance, center[1] - axis[1] * maxDistance, center[2] - axis[2] * maxDistance);
+		_meshlet.coneCutoff_ = std::sqrt(1.0f - minimumDot * minimumDot);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include "utility/forward_declaration.h"
+
+namespace file
+{
+	// splits a mesh into small clusters with bounds and normal cones for cluster level culling,
+	// the original index buffer is left untouched
+	class MeshletBuilder final
+	{
+	public:
+		static constexpr uint32_t maxVertices = 64;
+		static constexpr uint32_t maxTriangles = 124;
+
+	public:
+		// replaces the meshlet data of _mesh, positions are expected in attribute 0
+		static void Build(Mesh& _mesh);
+		static void ComputeBounds(const Mesh& _mesh, Meshlet& _meshlet);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,441 @@
+#include "mip_generator.h"
+#include "thread/thread_pool.h"
+#include "math/half.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define MIP_GENERATOR_X64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MIP_GENERATOR_AVX2
+#else
+#define MIP_GENERATOR_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace file
+{
+	namespace
+	{
+		constexpr uint32_t bandHeight = 16;
+		constexpr uint32_t encodeTableSize = 16384;
+
+		struct Kernel
+		{
+			int32_t firstOffset_ = 0;
+			std::vector<float> weights_;
+		};
+
+		float Sinc(float _x)
+		{
+			constexpr float pi = 3.14159265358979f;
+			return (std::abs(_x) < 1e-6f) ? 1.0f : std::sin(pi * _x) / (pi * _x);
+		}
+
+		// zeroth order modified bessel function of the first kind
+		float BesselI0(float _x)
+		{
+			float sum = 1.0f;
+			float term = 1.0f;
+			for (int32_t i = 1; i < 32; i++)
+			{
+				term *= (_x * 0.5f / (float)i) * (_x * 0.5f / (float)i);
+				sum += term;
+			}
+			return sum;
+		}
+
+		Kernel MakeKernel(Image::MipFilter _filter, bool _downsample)
+		{
+			if (!_downsample)
+			{
+				return Kernel{ 0, { 1.0f } };
+			}
+
+			if (_filter == Image::MipFilter::BOX)
+			{
+				return Kernel{ 0, { 0.5f, 0.5f } };
+			}
+
+			// three destination pixels of support on each side, so twelve source taps around the 2x2 footprint
+			constexpr int32_t radius = 3;
+			constexpr float kaiserAlpha = 4.0f;
+
+			Kernel kernel;
+			kernel.firstOffset_ = -(2 * radius - 1);
+			kernel.weights_.resize(4 * radius);
+
+			float sum = 0.0f;
+			for (size_t i = 0; i < kernel.weights_.size(); i++)
+			{
+				// distance from the output pixel center in destination pixels
+				const float t = ((float)(kernel.firstOffset_ + (int32_t)i) - 0.5f) * 0.5f;
+				float window = 0.0f;
+				if (_filter == Image::MipFilter::LANCZOS)
+				{
+					window = Sinc(t / (float)radius);
+				}
+				else
+				{
+					const float ratio = t / (float)radius;
+					window = BesselI0(kaiserAlpha * std::sqrt(std::max(0.0f, 1.0f - ratio * ratio))) / BesselI0(kaiserAlpha);
+				}
+
+				kernel.weights_[i] = Sinc(t) * window;
+				sum += kernel.weights_[i];
+			}
+
+			for (float& weight : kernel.weights_)
+			{
+				weight /= sum;
+			}
+			return kernel;
+		}
+
+		int32_t Address(int32_t _index, int32_t _size, bool _wrap)
+		{
+			if (_wrap)
+			{
+				return ((_index % _size) + _size) % _size;
+			}
+			return std::clamp(_index, 0, _size - 1);
+		}
+
+		float SrgbToLinear(float _value)
+		{
+			return (_value <= 0.04045f) ? _value / 12.92f : std::pow((_value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float LinearToSrgb(float _value)
+		{
+			return (_value <= 0.0031308f) ? _value * 12.92f : 1.055f * std::pow(_value, 1.0f / 2.4f) - 0.055f;
+		}
+
+		struct ConversionTables
+		{
+			std::array<float, 256> linearDecode_{};
+			std::array<float, 256> srgbDecode_{};
+			std::array<uint8_t, encodeTableSize> srgbEncode_{};
+
+			ConversionTables()
+			{
+				for (uint32_t i = 0; i < 256; i++)
+				{
+					linearDecode_[i] = (float)i / 255.0f;
+					srgbDecode_[i] = SrgbToLinear((float)i / 255.0f);
+				}
+
+				for (uint32_t i = 0; i < encodeTableSize; i++)
+				{
+					srgbEncode_[i] = (uint8_t)std::lround(LinearToSrgb((float)i / (float)(encodeTableSize - 1)) * 255.0f);
+				}
+			}
+		};
+
+		const ConversionTables& GetConversionTables()
+		{
+			static const ConversionTables tables;
+			return tables;
+		}
+
+		enum class Component
+		{
+			UNORM8,
+			UNORM16,
+			FLOAT16,
+			FLOAT32,
+		};
+
+		Component GetComponent(Image::Format _format)
+		{
+			switch (_format)
+			{
+			case Image::Format::R16:
+				return Component::UNORM16;
+			case Image::Format::R16G16B16A16_SFLOAT:
+				return Component::FLOAT16;
+			case Image::Format::R32G32B32_SFLOAT:
+				return Component::FLOAT32;
+			default:
+				return Component::UNORM8;
+			}
+		}
+
+		void DecodeRow(const uint8_t* _row, Component _component, size_t _count, const std::vector<const float*>& _decodeTables, float* _out)
+		{
+			const size_t numChannels = _decodeTables.size();
+			for (size_t i = 0; i < _count; i++)
+			{
+				switch (_component)
+				{
+				case Component::UNORM8:
+					_out[i] = _decodeTables[i % numChannels][_row[i]];
+					break;
+				case Component::UNORM16:
+					_out[i] = (float)((const uint16_t*)_row)[i] / 65535.0f;
+					break;
+				case Component::FLOAT16:
+					_out[i] = math::HalfToFloat(((const uint16_t*)_row)[i]);
+					break;
+				case Component::FLOAT32:
+					_out[i] = ((const float*)_row)[i];
+					break;
+				}
+			}
+		}
+
+		// unorm values saturate, float values only lose the negative ringing of the wider kernels
+		void EncodeRow(const float* _row, Component _component, size_t _count, const std::vector<bool>& _encodeSrgb, const ConversionTables& _tables, uint8_t* _out)
+		{
+			const size_t numChannels = _encodeSrgb.size();
+			for (size_t i = 0; i < _count; i++)
+			{
+				switch (_component)
+				{
+				case Component::UNORM8:
+				{
+					const float value = std::clamp(_row[i], 0.0f, 1.0f);
+					_out[i] = _encodeSrgb[i % numChannels]
+						? _tables.srgbEncode_[(size_t)(value * (float)(encodeTableSize - 1) + 0.5f)]
+						: (uint8_t)(value * 255.0f + 0.5f);
+					break;
+				}
+				case Component::UNORM16:
+					((uint16_t*)_out)[i] = (uint16_t)(std::clamp(_row[i], 0.0f, 1.0f) * 65535.0f + 0.5f);
+					break;
+				case Component::FLOAT16:
+					((uint16_t*)_out)[i] = math::FloatToHalf(std::max(_row[i], 0.0f));
+					break;
+				case Component::FLOAT32:
+					((float*)_out)[i] = std::max(_row[i], 0.0f);
+					break;
+				}
+			}
+		}
+
+#ifdef MIP_GENERATOR_X64
+		bool SupportsAvx2()
+		{
+#ifdef _MSC_VER
+			int info[4] = {};
+			__cpuid(info, 0);
+			if (info[0] < 7)
+			{
+				return false;
+			}
+
+			// the os has to save ymm registers as well
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+			{
+				return false;
+			}
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+
+		MIP_GENERATOR_AVX2 void FilterVerticalAvx2(const float* const* _rows, const float* _weights, size_t _numTaps, size_t _count, float* _out)
+		{
+			size_t i = 0;
+			for (; i + 8 <= _count; i += 8)
+			{
+				__m256 sum = _mm256_setzero_ps();
+				for (size_t k = 0; k < _numTaps; k++)
+				{
+					sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(_weights[k]), _mm256_loadu_ps(_rows[k] + i)));
+				}
+				_mm256_storeu_ps(_out + i, sum);
+			}
+
+			for (; i < _count; i++)
+			{
+				float sum = 0.0f;
+				for (size_t k = 0; k < _numTaps; k++)
+				{
+					sum += _weights[k] * _rows[k][i];
+				}
+				_out[i] = sum;
+			}
+		}
+
+		// two rgba pixels per register, one in each 128 bit lane
+		MIP_GENERATOR_AVX2 uint32_t FilterHorizontalRgbaAvx2(const float* _row, const uint32_t* _columns, const float* _weights, size_t _numTaps, uint32_t _width, float* _out)
+		{
+			uint32_t x = 0;
+			for (; x + 2 <= _width; x += 2)
+			{
+				const uint32_t* columns0 = _columns + (size_t)x * _numTaps;
+				const uint32_t* columns1 = columns0 + _numTaps;
+
+				__m256 sum = _mm256_setzero_ps();
+				for (size_t k = 0; k < _numTaps; k++)
+				{
+					const __m256 pixels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(_row + (size_t)columns0[k] * 4)), _mm_loadu_ps(_row + (size_t)columns1[k] * 4), 1);
+					sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(_weights[k]), pixels));
+				}
+				_mm256_storeu_ps(_out + (size_t)x * 4, sum);
+			}
+			return x;
+		}
+#endif
+
+		void FilterVertical(const float* const* _rows, const float* _weights, size_t _numTaps, size_t _count, float* _out, bool _useAvx2)
+		{
+#ifdef MIP_GENERATOR_X64
+			if (_useAvx2)
+			{
+				FilterVerticalAvx2(_rows, _weights, _numTaps, _count, _out);
+				return;
+			}
+#endif
+			for (size_t i = 0; i < _count; i++)
+			{
+				float sum = 0.0f;
+				for (size_t k = 0; k < _numTaps; k++)
+				{
+					sum += _weights[k] * _rows[k][i];
+				}
+				_out[i] = sum;
+			}
+		}
+
+		void FilterHorizontal(const float* _row, const uint32_t* _columns, const float* _weights, size_t _numTaps, uint32_t _width, uint32_t _numChannels, float* _out, bool _useAvx2)
+		{
+			uint32_t x = 0;
+#ifdef MIP_GENERATOR_X64
+			if (_useAvx2 && _numChannels == 4)
+			{
+				x = FilterHorizontalRgbaAvx2(_row, _columns, _weights, _numTaps, _width, _out);
+			}
+#endif
+			for (; x < _width; x++)
+			{
+				const uint32_t* columns = _columns + (size_t)x * _numTaps;
+				for (uint32_t c = 0; c < _numChannels; c++)
+				{
+					float sum = 0.0f;
+					for (size_t k = 0; k < _numTaps; k++)
+					{
+						sum += _weights[k] * _row[(size_t)columns[k] * _numChannels + c];
+					}
+					_out[(size_t)x * _numChannels + c] = sum;
+				}
+			}
+		}
+	}
+
+	void MipGenerator::Generate(Image& _image, Image::MipFilter _filter, bool _srgb, bool _wrap)
+	{
+		const uint32_t pixelSize = Image::GetPixelSize(_image.format_);
+		if (_image.width_ == 0 || _image.height_ == 0 || pixelSize == 0)
+		{
+			return;
+		}
+
+#ifdef MIP_GENERATOR_X64
+		static const bool useAvx2 = SupportsAvx2();
+#else
+		constexpr bool useAvx2 = false;
+#endif
+
+		const uint32_t numChannels = Image::GetNumChannels(_image.format_);
+		const Component component = GetComponent(_image.format_);
+		const ConversionTables& tables = GetConversionTables();
+
+		// color channels of 8 bit images (gray or rgb) are filtered in linear space, alpha and wider data never are
+		const uint32_t numColorChannels = (numChannels >= 3) ? 3 : 1;
+		std::vector<const float*> decodeTables(numChannels);
+		std::vector<bool> encodeSrgb(numChannels);
+		for (uint32_t c = 0; c < numChannels; c++)
+		{
+			encodeSrgb[c] = _srgb && component == Component::UNORM8 && c < numColorChannels;
+			decodeTables[c] = encodeSrgb[c] ? tables.srgbDecode_.data() : tables.linearDecode_.data();
+		}
+
+		std::vector<Image::MipLevel> mips(1, Image::MipLevel{ _image.width_, _image.height_, 0, (size_t)_image.width_ * _image.height_ * pixelSize });
+		while (mips.back().width_ > 1 || mips.back().height_ > 1)
+		{
+			const Image::MipLevel& previous = mips.back();
+			Image::MipLevel mip;
+			mip.width_ = std::max(1u, previous.width_ / 2);
+			mip.height_ = std::max(1u, previous.height_ / 2);
+			mip.offset_ = previous.offset_ + previous.size_;
+			mip.size_ = (size_t)mip.width_ * mip.height_ * pixelSize;
+			mips.push_back(mip);
+		}
+
+		_image.colors_.resize(mips.back().offset_ + mips.back().size_);
+		_image.mips_ = mips;
+
+		for (size_t level = 1; level < mips.size(); level++)
+		{
+			const Image::MipLevel& source = mips[level - 1];
+			const Image::MipLevel& destination = mips[level];
+			const uint8_t* sourceBytes = _image.colors_.data() + source.offset_;
+			uint8_t* destinationBytes = _image.colors_.data() + destination.offset_;
+
+			const uint32_t stepX = (source.width_ > 1) ? 2 : 1;
+			const uint32_t stepY = (source.height_ > 1) ? 2 : 1;
+			const Kernel kernelX = MakeKernel(_filter, stepX == 2);
+			const Kernel kernelY = MakeKernel(_filter, stepY == 2);
+
+			std::vector<uint32_t> columns((size_t)destination.width_ * kernelX.weights_.size());
+			for (uint32_t x = 0; x < destination.width_; x++)
+			{
+				for (size_t k = 0; k < kernelX.weights_.size(); k++)
+				{
+					columns[x * kernelX.weights_.size() + k] = (uint32_t)Address((int32_t)(x * stepX) + kernelX.firstOffset_ + (int32_t)k, (int32_t)source.width_, _wrap);
+				}
+			}
+
+			const uint32_t numBands = (destination.height_ + bandHeight - 1) / bandHeight;
+			thread::ThreadPool::ParallelFor(numBands, [&](size_t _band)
+				{
+					const uint32_t firstRow = (uint32_t)_band * bandHeight;
+					const uint32_t lastRow = std::min(firstRow + bandHeight, destination.height_);
+					const size_t sourceRowLength = (size_t)source.width_ * numChannels;
+					const size_t destinationRowLength = (size_t)destination.width_ * numChannels;
+					const size_t sourcePitch = (size_t)source.width_ * pixelSize;
+					const size_t destinationPitch = (size_t)destination.width_ * pixelSize;
+
+					// every source row the band touches is decoded once
+					const int32_t firstSourceRow = (int32_t)(firstRow * stepY) + kernelY.firstOffset_;
+					const int32_t numSourceRows = (int32_t)((lastRow - 1) * stepY) + kernelY.firstOffset_ + (int32_t)kernelY.weights_.size() - firstSourceRow;
+
+					std::vector<float> decodedRows((size_t)numSourceRows * sourceRowLength);
+					for (int32_t i = 0; i < numSourceRows; i++)
+					{
+						const uint8_t* row = sourceBytes + (size_t)Address(firstSourceRow + i, (int32_t)source.height_, _wrap) * sourcePitch;
+						DecodeRow(row, component, sourceRowLength, decodeTables, decodedRows.data() + (size_t)i * sourceRowLength);
+					}
+
+					std::vector<const float*> taps(kernelY.weights_.size());
+					std::vector<float> filteredRow(sourceRowLength);
+					std::vector<float> outputRow(destinationRowLength);
+
+					for (uint32_t y = firstRow; y < lastRow; y++)
+					{
+						const int32_t tapRow = (int32_t)(y * stepY) + kernelY.firstOffset_ - firstSourceRow;
+						for (size_t k = 0; k < taps.size(); k++)
+						{
+							taps[k] = decodedRows.data() + (size_t)(tapRow + (int32_t)k) * sourceRowLength;
+						}
+
+						FilterVertical(taps.data(), kernelY.weights_.data(), taps.size(), sourceRowLength, filteredRow.data(), useAvx2);
+						FilterHorizontal(filteredRow.data(), columns.data(), kernelX.weights_.data(), kernelX.weights_.size(), destination.width_, numChannels, outputRow.data(), useAvx2);
+
+						EncodeRow(outputRow.data(), component, destinationRowLength, encodeSrgb, tables, destinationBytes + (size_t)y * destinationPitch);
+					}
+				});
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include "image.h"
+
+namespace file
+{
+	// cpu downsampling behind Image::GenerateMips, every level is built from the previous one
+	// with a separable 2:1 filter while row bands are spread over thread::ThreadPool
+	class MipGenerator final
+	{
+	public:
+		static void Generate(Image& _image, Image::MipFilter _filter, bool _srgb, bool _wrap);
+	};
+}
\ No newline at end of file
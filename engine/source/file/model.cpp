@@ -3,7 +3,21 @@
 #include "../thirdparty/assimp/Importer.hpp"
 #include "../thirdparty/assimp/scene.h"
 #include "../thirdparty/assimp/postprocess.h"
+#include "../thirdparty/assimp/IOSystem.hpp"
+#include "../thirdparty/assimp/IOStream.hpp"
 #include "math/vector.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
+#include "virtual_file_system.h"
+#include "thread/thread_pool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <mutex>
 
 #if _DEBUG
 #pragma comment(lib, "assimp/bin/assimp-vc143-mtd.lib")
@@ -17,12 +31,156 @@ using utility::Log;
 
 namespace file
 {
-	bool Model::Load(const std::string& _path)
+	namespace
+	{
+		class VirtualIOStream : public Assimp::IOStream
+		{
+		private:
+			MappedFile file_;
+			size_t position_ = 0;
+
+		public:
+			VirtualIOStream(MappedFile&& _file)
+				: file_(std::move(_file))
+			{
+			}
+
+		public:
+			virtual size_t Read(void* _buffer, size_t _size, size_t _count) override
+			{
+				if (_size == 0)
+				{
+					return 0;
+				}
+
+				const size_t numElements = std::min(_count, (file_.GetSize() - position_) / _size);
+				memcpy(_buffer, file_.GetBytes().data() + position_, numElements * _size);
+				position_ += numElements * _size;
+				return numElements;
+			}
+
+			virtual size_t Write(const void* _buffer, size_t _size, size_t _count) override
+			{
+				return 0;
+			}
+
+			virtual aiReturn Seek(size_t _offset, aiOrigin _origin) override
+			{
+				const size_t base = (_origin == aiOrigin_CUR) ? position_ : (_origin == aiOrigin_END) ? file_.GetSize() : 0;
+				if (base + _offset > file_.GetSize())
+				{
+					return aiReturn_FAILURE;
+				}
+
+				position_ = base + _offset;
+				return aiReturn_SUCCESS;
+			}
+
+			virtual size_t Tell() const override
+			{
+				return position_;
+			}
+
+			virtual size_t FileSize() const override
+			{
+				return file_.GetSize();
+			}
+
+			virtual void Flush() override
+			{
+			}
+		};
+
+		// lets assimp read models and the files they reference, material libraries among them, out of mounted archives
+		class VirtualIOSystem : public Assimp::IOSystem
+		{
+		private:
+			std::vector<std::string> openedPaths_;
+
+		public:
+			// every file opened since the last call
+			std::vector<std::string> TakeOpenedPaths()
+			{
+				return std::move(openedPaths_);
+			}
+
+			virtual bool Exists(const char* _path) const override
+			{
+				return VirtualFileSystem::Exists(_path);
+			}
+
+			virtual char getOsSeparator() const override
+			{
+				return '/';
+			}
+
+			virtual Assimp::IOStream* Open(const char* _path, const char* _mode) override
+			{
+				if (strchr(_mode, 'w') || strchr(_mode, 'a') || !VirtualFileSystem::Exists(_path))
+				{
+					return nullptr;
+				}
+
+				MappedFile file = VirtualFileSystem::Open(_path, MappedFile::AccessPattern::SEQUENTIAL);
+				if (!file.IsOpen())
+				{
+					return nullptr;
+				}
+
+				openedPaths_.push_back(_path);
+				return new VirtualIOStream(std::move(file));
+			}
+
+			virtual void Close(Assimp::IOStream* _stream) override
+			{
+				delete _stream;
+			}
+		};
+	}
+
+	bool Model::Load(const std::string& _path, bool _useCache)
+	{
+		if (MeshCache::IsCooked(_path))
+		{
+			return MeshCache::Load(_path, *this);
+		}
+
+		// caches sit next to loose sources, archived models are expected to be cooked already
+		_useCache = _useCache && !VirtualFileSystem::IsArchived(_path);
+
+		if (_useCache && MeshCache::Load(MeshCache::GetCachePath(_path), *this, _path))
+		{
+			return true;
+		}
+
+		if (!Import(_path))
+		{
+			return false;
+		}
+
+		if (_useCache && !MeshCache::Save(MeshCache::GetCachePath(_path), *this, _path))
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to write back mesh cache, path : " + _path) << std::endl;
+		}
+
+		return true;
+	}
+
+	bool Model::Import(const std::string& _path)
 	{
 		size_t separater = _path.find_last_of('/');
 		std::string parentDir(_path.begin(), _path.begin() + ((std::string::npos == separater) ? 0 : _path.find_last_of('/') + 1));
 
-		static Assimp::Importer importer;
+		// one importer per thread so models can be imported in parallel, the importer owns its io system
+		thread_local Assimp::Importer importer;
+		thread_local VirtualIOSystem* ioSystem = nullptr;
+		if (!ioSystem)
+		{
+			ioSystem = new VirtualIOSystem();
+			importer.SetIOHandler(ioSystem);
+		}
+		ioSystem->TakeOpenedPaths();
+
 		const aiScene* scene = importer.ReadFile(_path.data(),
 			aiProcess_ConvertToLeftHanded |
 			aiProcess_JoinIdenticalVertices |
@@ -33,11 +191,19 @@ namespace file
 			aiProcess_LimitBoneWeights |
 			aiProcess_ValidateDataStructure |
 			aiProcess_OptimizeMeshes |
-			aiProcess_SplitLargeMeshes |
-			aiProcess_ImproveCacheLocality
+			aiProcess_SplitLargeMeshes
 		);
 		importer.ApplyPostProcessing(aiProcess_CalcTangentSpace);
 
+		dependencies_.clear();
+		for (std::string& openedPath : ioSystem->TakeOpenedPaths())
+		{
+			if (VirtualFileSystem::GetAbsoluteName(openedPath) != VirtualFileSystem::GetAbsoluteName(_path))
+			{
+				dependencies_.push_back(std::move(openedPath));
+			}
+		}
+
 		if (!scene)
 		{
 			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to load model");
@@ -51,50 +217,29 @@ namespace file
 		vertexLayout.AddAttribute<math::Float3>(); // bitangent
 		vertexLayout.AddAttribute<math::Float2>(); // texcoord
 
-		for (uint32_t i = 0; i < scene->mNumMeshes; i++)
-		{
-			Mesh mesh;
-			mesh.vertices_.SetLayout(vertexLayout);
+		// every mesh is written into its own slot so the output order never depends on scheduling
+		meshes_.clear();
+		meshes_.resize(scene->mNumMeshes);
 
-			for (uint32_t j = 0; j < (*scene->mMeshes[i]).mNumVertices; j++)
-			{
-				auto vertex = mesh.vertices_.Add();
-				vertex.Get<math::Float3>(0) = *(math::Float3*)(&(*scene->mMeshes[i]).mVertices[j]);
-				vertex.Get<math::Float3>(1) = *(math::Float3*)(&(*scene->mMeshes[i]).mNormals[j]);
+		std::vector<MeshOptimizer::Report> reports(scene->mNumMeshes);
 
-				if (scene->mMeshes[i]->HasTangentsAndBitangents())
-				{
-					vertex.Get<math::Float3>(2) = *(math::Float3*)(&(*scene->mMeshes[i]).mTangents[j]);
-					vertex.Get<math::Float3>(3) = *(math::Float3*)(&(*scene->mMeshes[i]).mBitangents[j]);
-				}
-				else
-				{
-					vertex.Get<math::Float3>(2) = math::Float3{};
-					vertex.Get<math::Float3>(3) = math::Float3{};
-				}
+		thread::ThreadPool::ParallelFor(scene->mNumMeshes, [&](size_t _index)
+			{
+				ConvertMesh(*scene->mMeshes[_index], vertexLayout, meshes_[_index]);
+				reports[_index] = MeshOptimizer::Optimize(meshes_[_index]);
 
-				if (scene->mMeshes[i]->HasTextureCoords(0))
-				{
-					vertex.Get<math::Float2>(4) = *(math::Float3*)(&(*scene->mMeshes[i]).mTextureCoords[0][j]);
-				}
-				else
+				// meshes split below get their levels of detail and meshlets per part
+				if (meshes_[_index].vertices_.GetNumElements() <= maxShortIndexedVertices)
 				{
-					vertex.Get<math::Float2>(4) = math::Float2{};
+					MeshSimplifier::GenerateLods(meshes_[_index]);
+					MeshletBuilder::Build(meshes_[_index]);
 				}
-			}
+			});
 
-			mesh.indices_.reserve((size_t)(*scene->mMeshes[i]).mNumFaces * 3);
-			for (uint32_t uFace = 0; uFace < (*scene->mMeshes[i]).mNumFaces; uFace++)
-			{
-				mesh.indices_.push_back((*scene->mMeshes[i]).mFaces[uFace].mIndices[0]);
-				mesh.indices_.push_back((*scene->mMeshes[i]).mFaces[uFace].mIndices[1]);
-				mesh.indices_.push_back((*scene->mMeshes[i]).mFaces[uFace].mIndices[2]);
-			}
-
-			mesh.materialIndex_ = (*scene->mMeshes[i]).mMaterialIndex;
-			meshes_.push_back(std::move(mesh));
-		}
+		LogOptimization(_path, reports);
+		SplitMeshes(maxShortIndexedVertices);
 
+		materials_.clear();
 		for (uint32_t i = 0; i < scene->mNumMaterials; i++)
 		{
 			Material material;
@@ -115,6 +260,171 @@ namespace file
 		return true;
 	}
 
+	void Model::ConvertMesh(const aiMesh& _source, const utility::ByteBuffer::Layout& _layout, Mesh& _outMesh)
+	{
+		// attributes are copied one at a time as strided runs into the interleaved buffer instead of per vertex lookups
+		auto copyAttribute = [&_source, &_layout, &_outMesh](size_t _attributeIndex, const aiVector3D* _sourceData)
+			{
+				if (_sourceData == nullptr)
+				{
+					return; // left zeroed by Resize
+				}
+
+				const size_t stride = _layout.GetSizeInBytes();
+				const size_t size = _layout.GetAttributeSize(_attributeIndex);
+				uint8_t* destination = _outMesh.vertices_.GetRawBufferAddress() + _layout.GetAttributeOffset(_attributeIndex);
+				for (uint32_t i = 0; i < _source.mNumVertices; i++)
+				{
+					memcpy(destination + stride * i, &_sourceData[i], size);
+				}
+			};
+
+		_outMesh.vertices_.SetLayout(_layout);
+		_outMesh.vertices_.Resize(_source.mNumVertices);
+
+		copyAttribute(0, _source.mVertices);
+		copyAttribute(1, _source.mNormals);
+		copyAttribute(2, _source.HasTangentsAndBitangents() ? _source.mTangents : nullptr);
+		copyAttribute(3, _source.HasTangentsAndBitangents() ? _source.mBitangents : nullptr);
+		copyAttribute(4, _source.HasTextureCoords(0) ? _source.mTextureCoords[0] : nullptr);
+
+		_outMesh.indices_.resize((size_t)_source.mNumFaces * 3);
+		for (uint32_t i = 0; i < _source.mNumFaces; i++)
+		{
+			memcpy(&_outMesh.indices_[(size_t)i * 3], _source.mFaces[i].mIndices, sizeof(uint32_t) * 3);
+		}
+
+		_outMesh.boundsMin_ = math::Float3(FLT_MAX, FLT_MAX, FLT_MAX);
+		_outMesh.boundsMax_ = math::Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (uint32_t i = 0; i < _source.mNumVertices; i++)
+		{
+			const aiVector3D& position = _source.mVertices[i];
+			_outMesh.boundsMin_ = math::Float3(std::min(_outMesh.boundsMin_.x_, position.x), std::min(_outMesh.boundsMin_.y_, position.y), std::min(_outMesh.boundsMin_.z_, position.z));
+			_outMesh.boundsMax_ = math::Float3(std::max(_outMesh.boundsMax_.x_, position.x), std::max(_outMesh.boundsMax_.y_, position.y), std::max(_outMesh.boundsMax_.z_, position.z));
+		}
+
+		_outMesh.materialIndex_ = _source.mMaterialIndex;
+	}
+
+	void Model::LogOptimization(const std::string& _path, const std::vector<MeshOptimizer::Report>& _reports) const
+	{
+		size_t numTriangles = 0;
+		size_t numVerticesBefore = 0;
+		size_t numVerticesAfter = 0;
+		float missesBefore = 0.0f;
+		float missesAfter = 0.0f;
+		for (size_t i = 0; i < _reports.size(); i++)
+		{
+			const float meshTriangles = (float)(meshes_[i].indices_.size() / 3);
+			numTriangles += meshes_[i].indices_.size() / 3;
+			numVerticesBefore += _reports[i].numVerticesBefore_;
+			numVerticesAfter += _reports[i].numVerticesAfter_;
+			missesBefore += _reports[i].before_.acmr_ * meshTriangles;
+			missesAfter += _reports[i].after_.acmr_ * meshTriangles;
+		}
+
+		if (numTriangles == 0 || numVerticesAfter == 0)
+		{
+			return;
+		}
+
+		std::stringstream message;
+		message << std::fixed << std::setprecision(3)
+			<< "optimized meshes, acmr " << missesBefore / numTriangles << " -> " << missesAfter / numTriangles
+			<< ", atvr " << missesAfter / numVerticesAfter
+			<< ", vertices " << numVerticesBefore << " -> " << numVerticesAfter
+			<< ", path : " << _path;
+		std::cout << Log::Format(Log::Category::file, Log::Level::message, message.str()) << std::endl;
+	}
+
+	void Model::SplitMeshes(uint32_t _maxVertices)
+	{
+		constexpr uint32_t unassigned = ~0u;
+		_maxVertices = std::max(_maxVertices, 3u);
+
+		std::vector<Mesh> splitMeshes;
+		splitMeshes.reserve(meshes_.size());
+
+		for (Mesh& mesh : meshes_)
+		{
+			const std::optional<utility::ByteBuffer::Layout> layout = mesh.vertices_.GetLayout();
+			if (!layout || mesh.vertices_.GetNumElements() <= _maxVertices)
+			{
+				splitMeshes.push_back(std::move(mesh));
+				continue;
+			}
+
+			const size_t stride = layout->GetSizeInBytes();
+			const size_t positionOffset = layout->GetAttributeOffset(0);
+			std::vector<uint32_t> remap(mesh.vertices_.GetNumElements(), unassigned);
+			std::vector<uint32_t> partVertices;
+			std::vector<uint32_t> partIndices;
+
+			// triangles are taken in index order, which the optimizer already made spatially coherent
+			auto finishPart = [&]()
+				{
+					Mesh part;
+					part.materialIndex_ = mesh.materialIndex_;
+					part.vertices_.SetLayout(*layout);
+					part.vertices_.Resize(partVertices.size());
+					part.boundsMin_ = math::Float3(FLT_MAX, FLT_MAX, FLT_MAX);
+					part.boundsMax_ = math::Float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+					for (size_t i = 0; i < partVertices.size(); i++)
+					{
+						const uint8_t* source = mesh.vertices_.GetRawBufferAddress() + stride * partVertices[i];
+						memcpy(part.vertices_.GetRawBufferAddress() + stride * i, source, stride);
+						remap[partVertices[i]] = unassigned;
+
+						math::Float3 position;
+						memcpy(&position, source + positionOffset, sizeof(float) * 3);
+						part.boundsMin_ = math::Float3(std::min(part.boundsMin_.x_, position.x_), std::min(part.boundsMin_.y_, position.y_), std::min(part.boundsMin_.z_, position.z_));
+						part.boundsMax_ = math::Float3(std::max(part.boundsMax_.x_, position.x_), std::max(part.boundsMax_.y_, position.y_), std::max(part.boundsMax_.z_, position.z_));
+					}
+
+					part.indices_ = std::move(partIndices);
+					MeshSimplifier::GenerateLods(part);
+					MeshletBuilder::Build(part);
+					splitMeshes.push_back(std::move(part));
+
+					partVertices.clear();
+					partIndices.clear();
+				};
+
+			for (size_t i = 0; i + 2 < mesh.indices_.size(); i += 3)
+			{
+				uint32_t numNewVertices = 0;
+				for (size_t j = 0; j < 3; j++)
+				{
+					numNewVertices += (remap[mesh.indices_[i + j]] == unassigned) ? 1 : 0;
+				}
+
+				if (partVertices.size() + numNewVertices > _maxVertices)
+				{
+					finishPart();
+				}
+
+				for (size_t j = 0; j < 3; j++)
+				{
+					uint32_t& local = remap[mesh.indices_[i + j]];
+					if (local == unassigned)
+					{
+						local = (uint32_t)partVertices.size();
+						partVertices.push_back(mesh.indices_[i + j]);
+					}
+					partIndices.push_back(local);
+				}
+			}
+
+			if (!partIndices.empty())
+			{
+				finishPart();
+			}
+		}
+
+		meshes_ = std::move(splitMeshes);
+	}
+
 	bool Model::IsLoaded() const
 	{
 		return !meshes_.empty();
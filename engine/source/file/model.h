@@ -1,6 +1,10 @@
 #pragma once
 #include <string>
 #include "utility/byte_buffer.h"
+#include "math/vector.h"
+#include "mesh_optimizer.h"
+
+struct aiMesh;
 
 namespace file
 {
@@ -10,20 +14,61 @@ namespace file
 		std::string normalMapPath_;
 	};
 
+	struct MeshLod
+	{
+		std::vector<uint32_t> indices_; // indexes the vertices of the owning mesh
+		float error_ = 0.0f; // object space deviation from the full mesh, see MeshSimplifier::ProjectError
+	};
+
+	// cluster of at most MeshletBuilder::maxVertices vertices and maxTriangles triangles
+	struct Meshlet
+	{
+		uint32_t vertexOffset_ = 0; // into Mesh::meshletVertices_
+		uint32_t triangleOffset_ = 0; // into Mesh::meshletTriangles_, three local vertex indices per triangle
+		uint32_t numVertices_ = 0;
+		uint32_t numTriangles_ = 0;
+
+		math::Float3 center_;
+		float radius_ = 0.0f;
+
+		// the whole cluster faces away when dot(normalize(coneApex_ - cameraPosition), coneAxis_) >= coneCutoff_
+		math::Float3 coneApex_;
+		math::Float3 coneAxis_;
+		float coneCutoff_ = 1.0f;
+	};
+
 	struct Mesh
 	{
 		utility::ByteBuffer vertices_;
 		std::vector<uint32_t> indices_;
+		std::vector<MeshLod> lods_; // coarser levels ordered from detailed to coarse, indices_ being level 0
+		std::vector<Meshlet> meshlets_; // clusters covering indices_
+		std::vector<uint32_t> meshletVertices_;
+		std::vector<uint8_t> meshletTriangles_;
 		uint32_t materialIndex_ = 0;
+		math::Float3 boundsMin_;
+		math::Float3 boundsMax_;
 	};
 
 	struct Model
 	{
 	public:
+		static constexpr uint32_t maxShortIndexedVertices = 65536; // imported meshes are split to be drawn with 16 bit indices
+
 		std::vector<Material> materials_;
 		std::vector<Mesh> meshes_;
+		std::vector<std::string> dependencies_; // files the last import read besides the source, material libraries among them
 
-		bool Load(const std::string& _path);
+		bool Load(const std::string& _path, bool _useCache = true); // a cooked .cmesh is loaded as is
 		bool IsLoaded() const;
+
+		// breaks meshes with more vertices than _maxVertices into parts that can be drawn with 16 bit indices,
+		// levels of detail and meshlets are rebuilt for every part
+		void SplitMeshes(uint32_t _maxVertices = maxShortIndexedVertices);
+
+	private:
+		bool Import(const std::string& _path);
+		static void ConvertMesh(const aiMesh& _source, const utility::ByteBuffer::Layout& _layout, Mesh& _outMesh);
+		void LogOptimization(const std::string& _path, const std::vector<MeshOptimizer::Report>& _reports) const;
 	};
 }
\ No newline at end of file
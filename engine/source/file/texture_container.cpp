@@ -0,0 +1,313 @@
+#include "texture_container.h"
+#include "binary_file.h"
+#include "block_compressor.h"
+#include "zlib_api.h"
+#include "virtual_file_system.h"
+#include "thread/thread_pool.h"
+#include "utility/log.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <cstring>
+
+using utility::Log;
+
+namespace file
+{
+	namespace
+	{
+		constexpr uint32_t magic = 'C' | ('T' << 8) | ('E' << 16) | ('X' << 24);
+		constexpr uint64_t sectionAlignment = 16;
+		constexpr uint32_t maxMips = 32;
+
+		struct FileHeader
+		{
+			uint32_t magic_ = magic;
+			uint32_t version_ = TextureContainer::version;
+			uint64_t sourceSize_ = 0;
+			int64_t sourceWriteTime_ = 0;
+			uint32_t width_ = 0;
+			uint32_t height_ = 0;
+			uint32_t numChannels_ = 0;
+			uint32_t format_ = 0;
+			uint32_t numMips_ = 0;
+			uint32_t supercompression_ = 0;
+		};
+
+		struct LevelRecord
+		{
+			uint32_t width_ = 0;
+			uint32_t height_ = 0;
+			uint64_t offset_ = 0;
+			uint64_t storedSize_ = 0;
+			uint64_t size_ = 0;
+		};
+
+		static_assert(sizeof(FileHeader) == 48);
+		static_assert(sizeof(LevelRecord) == 32);
+
+		uint64_t GetLevelSize(Image::Format _format, uint32_t _width, uint32_t _height)
+		{
+			if (BlockCompressor::IsBlockCompressed(_format))
+			{
+				return BlockCompressor::GetCompressedSize(_format, _width, _height);
+			}
+
+			return (uint64_t)_width * _height * Image::GetPixelSize(_format);
+		}
+
+		// validates the header and level table, the mapping stays open for the caller
+		bool Open(const std::filesystem::path& _path, const std::filesystem::path& _sourcePath, MappedFile& _outFile, const FileHeader*& _outHeader, const LevelRecord*& _outLevels)
+		{
+			uint64_t sourceSize = 0;
+			int64_t sourceWriteTime = 0;
+			if (!QuerySource(_sourcePath, sourceSize, sourceWriteTime))
+			{
+				return false;
+			}
+
+			if (!VirtualFileSystem::Exists(_path))
+			{
+				return false;
+			}
+
+			_outFile = VirtualFileSystem::Open(_path, MappedFile::AccessPattern::SEQUENTIAL);
+			if (!_outFile.IsOpen())
+			{
+				return false;
+			}
+
+			const std::span<const std::byte> bytes = _outFile.GetBytes();
+			_outHeader = Fetch<FileHeader>(bytes, 0);
+			if (!_outHeader || _outHeader->magic_ != magic || _outHeader->version_ != TextureContainer::version)
+			{
+				return false;
+			}
+
+			if (_outHeader->sourceSize_ != sourceSize || _outHeader->sourceWriteTime_ != sourceWriteTime)
+			{
+				return false;
+			}
+
+			_outLevels = Fetch<LevelRecord>(bytes, Align(sizeof(FileHeader), sectionAlignment), _outHeader->numMips_);
+			if (!_outLevels || _outHeader->numMips_ == 0 || _outHeader->numMips_ > maxMips || _outHeader->format_ > (uint32_t)Image::Format::R32G32B32_SFLOAT)
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted texture container, path : " + _path.string()) << std::endl;
+				return false;
+			}
+
+			// a level whose size disagrees with its extent would make the upload read past the staged bytes
+			const Image::Format format = (Image::Format)_outHeader->format_;
+			for (uint32_t i = 0; i < _outHeader->numMips_; i++)
+			{
+				const LevelRecord& level = _outLevels[i];
+				const bool validExtent = level.width_ > 0 && level.height_ > 0 && level.width_ <= _outHeader->width_ && level.height_ <= _outHeader->height_;
+				if (!validExtent || level.size_ != GetLevelSize(format, level.width_, level.height_) || !Fetch<std::byte>(bytes, level.offset_, level.storedSize_))
+				{
+					std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted texture container, path : " + _path.string()) << std::endl;
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		Image DescribeImage(const FileHeader& _header)
+		{
+			Image image;
+			image.width_ = _header.width_;
+			image.height_ = _header.height_;
+			image.numChannels_ = _header.numChannels_;
+			image.format_ = (Image::Format)_header.format_;
+			return image;
+		}
+	}
+
+	bool TextureContainer::IsContainer(const std::filesystem::path& _path)
+	{
+		return _path.extension() == extension;
+	}
+
+	std::filesystem::path TextureContainer::GetCachePath(const std::filesystem::path& _sourcePath, uint32_t _maxSize)
+	{
+		std::filesystem::path cachePath = _sourcePath;
+		if (_maxSize > 0)
+		{
+			cachePath += "." + std::to_string(_maxSize);
+		}
+		cachePath += extension;
+		return cachePath;
+	}
+
+	bool TextureContainer::Load(const std::filesystem::path& _path, Image& _outImage, const std::filesystem::path& _sourcePath)
+	{
+		MappedFile file;
+		const FileHeader* header = nullptr;
+		const LevelRecord* levels = nullptr;
+		if (!Open(_path, _sourcePath, file, header, levels))
+		{
+			return false;
+		}
+
+		Image image = DescribeImage(*header);
+		image.mips_.resize(header->numMips_);
+		size_t size = 0;
+		for (uint32_t i = 0; i < header->numMips_; i++)
+		{
+			image.mips_[i] = Image::MipLevel{ levels[i].width_, levels[i].height_, size, levels[i].size_ };
+			size += levels[i].size_;
+		}
+		image.colors_.resize(size);
+
+		// levels inflate independently
+		std::atomic<bool> failed = false;
+		const std::byte* bytes = file.GetBytes().data();
+		thread::ThreadPool::ParallelFor(header->numMips_, [&](size_t _level)
+			{
+				const LevelRecord& level = levels[_level];
+				uint8_t* destination = image.colors_.data() + image.mips_[_level].offset_;
+				const uint8_t* source = (const uint8_t*)(bytes + level.offset_);
+
+				if (header->supercompression_ == (uint32_t)Supercompression::NONE)
+				{
+					if (level.storedSize_ != level.size_)
+					{
+						failed = true;
+						return;
+					}
+					memcpy(destination, source, level.size_);
+					return;
+				}
+
+				unsigned long inflatedSize = (unsigned long)level.size_;
+				if (uncompress(destination, &inflatedSize, source, (unsigned long)level.storedSize_) != zlibOk || inflatedSize != level.size_)
+				{
+					failed = true;
+				}
+			});
+
+		if (failed)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "corrupted texture container, path : " + _path.string()) << std::endl;
+			return false;
+		}
+
+		_outImage = std::move(image);
+		return true;
+	}
+
+	bool TextureContainer::Map(const std::filesystem::path& _path, Mapping& _outMapping, const std::filesystem::path& _sourcePath)
+	{
+		Mapping mapping;
+		const FileHeader* header = nullptr;
+		const LevelRecord* levels = nullptr;
+		if (!Open(_path, _sourcePath, mapping.file_, header, levels) || header->supercompression_ != (uint32_t)Supercompression::NONE)
+		{
+			return false;
+		}
+
+		mapping.image_ = DescribeImage(*header);
+		mapping.image_.mips_.resize(header->numMips_);
+
+		const uint64_t first = levels[0].offset_;
+		uint64_t last = first;
+		for (uint32_t i = 0; i < header->numMips_; i++)
+		{
+			if (levels[i].offset_ < first || levels[i].storedSize_ != levels[i].size_)
+			{
+				return false;
+			}
+
+			mapping.image_.mips_[i] = Image::MipLevel{ levels[i].width_, levels[i].height_, levels[i].offset_ - first, levels[i].size_ };
+			last = std::max(last, levels[i].offset_ + levels[i].size_);
+		}
+
+		mapping.levels_ = std::span<const uint8_t>((const uint8_t*)(mapping.file_.GetBytes().data() + first), last - first);
+		_outMapping = std::move(mapping);
+		return true;
+	}
+
+	bool TextureContainer::Save(const std::filesystem::path& _path, const Image& _image, Supercompression _supercompression, const std::filesystem::path& _sourcePath)
+	{
+		FileHeader header;
+		if (!QuerySource(_sourcePath, header.sourceSize_, header.sourceWriteTime_))
+		{
+			return false;
+		}
+
+		header.width_ = _image.width_;
+		header.height_ = _image.height_;
+		header.numChannels_ = _image.numChannels_;
+		header.format_ = (uint32_t)_image.format_;
+		header.numMips_ = _image.GetNumMips();
+		header.supercompression_ = (uint32_t)_supercompression;
+		if (header.numMips_ == 0 || header.numMips_ > maxMips)
+		{
+			return false;
+		}
+
+		// zlib counts in unsigned long, which is 32 bits on windows
+		if (_supercompression == Supercompression::ZLIB && _image.GetMip(0).size_ > std::numeric_limits<unsigned long>::max() / 2)
+		{
+			_supercompression = Supercompression::NONE;
+			header.supercompression_ = (uint32_t)_supercompression;
+		}
+
+		std::vector<std::vector<uint8_t>> deflatedLevels(header.numMips_);
+		if (_supercompression == Supercompression::ZLIB)
+		{
+			std::atomic<bool> failed = false;
+			thread::ThreadPool::ParallelFor(header.numMips_, [&](size_t _level)
+				{
+					const Image::MipLevel mip = _image.GetMip((uint32_t)_level);
+					unsigned long deflatedSize = compressBound((unsigned long)mip.size_);
+					deflatedLevels[_level].resize(deflatedSize);
+					if (compress2(deflatedLevels[_level].data(), &deflatedSize, _image.colors_.data() + mip.offset_, (unsigned long)mip.size_, zlibDefaultLevel) != zlibOk)
+					{
+						failed = true;
+						return;
+					}
+					deflatedLevels[_level].resize(deflatedSize);
+				});
+
+			if (failed)
+			{
+				std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to deflate texture, path : " + _path.string()) << std::endl;
+				return false;
+			}
+		}
+
+		std::vector<LevelRecord> levels(header.numMips_);
+		uint64_t offset = Align(Align(sizeof(FileHeader), sectionAlignment) + sizeof(LevelRecord) * header.numMips_, sectionAlignment);
+		for (uint32_t i = 0; i < header.numMips_; i++)
+		{
+			const Image::MipLevel mip = _image.GetMip(i);
+			levels[i].width_ = mip.width_;
+			levels[i].height_ = mip.height_;
+			levels[i].offset_ = offset;
+			levels[i].size_ = mip.size_;
+			levels[i].storedSize_ = (_supercompression == Supercompression::ZLIB) ? deflatedLevels[i].size() : mip.size_;
+			offset = Align(offset + levels[i].storedSize_, sectionAlignment);
+		}
+
+		return WriteAtomically(_path, [&](std::ostream& _stream)
+			{
+				const char padding[sectionAlignment] = {};
+				auto writeAt = [&](uint64_t _offset, const void* _data, uint64_t _size)
+					{
+						_stream.write(padding, (std::streamsize)(_offset - (uint64_t)_stream.tellp()));
+						_stream.write((const char*)_data, (std::streamsize)_size);
+					};
+
+				writeAt(0, &header, sizeof(FileHeader));
+				writeAt(Align(sizeof(FileHeader), sectionAlignment), levels.data(), sizeof(LevelRecord) * levels.size());
+				for (uint32_t i = 0; i < header.numMips_; i++)
+				{
+					const Image::MipLevel mip = _image.GetMip(i);
+					const void* data = (_supercompression == Supercompression::ZLIB) ? (const void*)deflatedLevels[i].data() : (const void*)(_image.colors_.data() + mip.offset_);
+					writeAt(levels[i].offset_, data, levels[i].storedSize_);
+				}
+				return true;
+			});
+	}
+}
\ No newline at end of file
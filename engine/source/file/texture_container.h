@@ -0,0 +1,41 @@
+#pragma once
+#include <filesystem>
+#include <span>
+#include "image.h"
+#include "mapped_file.h"
+
+namespace file
+{
+	// cooked texture (.ctex) holding every mip level in its final format behind a small header,
+	// levels are either stored raw so a mapping can be copied straight into a staging buffer, or deflated one by one
+	class TextureContainer final
+	{
+	public:
+		static constexpr uint32_t version = 1;
+		static constexpr const char* extension = ".ctex";
+
+		enum class Supercompression
+		{
+			NONE,
+			ZLIB,
+		};
+
+		// levels_ covers every raw level, image_ describes them with offsets relative to levels_ and leaves colors_ empty
+		struct Mapping
+		{
+			MappedFile file_;
+			Image image_;
+			std::span<const uint8_t> levels_;
+		};
+
+	public:
+		static bool IsContainer(const std::filesystem::path& _path);
+		// capped loads get their own cache so a later run with a larger cap never picks up a smaller image
+		static std::filesystem::path GetCachePath(const std::filesystem::path& _sourcePath, uint32_t _maxSize = 0);
+
+		// _sourcePath ties the file to the source it was cooked from, stale or mismatching files fail to load
+		static bool Load(const std::filesystem::path& _path, Image& _outImage, const std::filesystem::path& _sourcePath = {});
+		static bool Map(const std::filesystem::path& _path, Mapping& _outMapping, const std::filesystem::path& _sourcePath = {});
+		static bool Save(const std::filesystem::path& _path, const Image& _image, Supercompression _supercompression, const std::filesystem::path& _sourcePath = {});
+	};
+}
\ No newline at end of file
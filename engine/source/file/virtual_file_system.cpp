@@ -0,0 +1,124 @@
+#include "virtual_file_system.h"
+#include "utility/log.h"
+#include <algorithm>
+#include <mutex>
+
+using utility::Log;
+
+namespace file
+{
+	bool VirtualFileSystem::Mount(const std::filesystem::path& _archivePath, const std::filesystem::path& _directory)
+	{
+		std::shared_ptr<Archive> archive = std::make_shared<Archive>();
+		if (!archive->Open(_archivePath))
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::warning, "failed to mount archive, path : " + _archivePath.string()) << std::endl;
+			return false;
+		}
+
+		std::filesystem::path directory = _directory;
+		if (directory.empty())
+		{
+			directory = _archivePath;
+			directory.replace_extension();
+		}
+
+		std::unique_lock lock(mutex_);
+		mountPoints_.push_back({ GetAbsoluteName(directory) + '/', _archivePath, std::move(archive) });
+		return true;
+	}
+
+	bool VirtualFileSystem::MountPacked(const std::filesystem::path& _directory)
+	{
+		std::filesystem::path directory = std::filesystem::absolute(_directory).lexically_normal();
+		if (!directory.has_filename())
+		{
+			directory = directory.parent_path();
+		}
+
+		std::filesystem::path archivePath = directory;
+		archivePath += Archive::extension;
+
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(archivePath, error) || !Mount(archivePath, directory))
+		{
+			return false;
+		}
+
+		std::cout << Log::Format(Log::Category::file, Log::Level::message, "mounted archive, path : " + archivePath.string()) << std::endl;
+		return true;
+	}
+
+	void VirtualFileSystem::Unmount(const std::filesystem::path& _archivePath)
+	{
+		// files opened from the archive keep it mapped until they are closed
+		std::unique_lock lock(mutex_);
+		std::erase_if(mountPoints_, [&](const MountPoint& _mountPoint) { return _mountPoint.archivePath_ == _archivePath; });
+	}
+
+	void VirtualFileSystem::UnmountAll()
+	{
+		std::unique_lock lock(mutex_);
+		mountPoints_.clear();
+	}
+
+	bool VirtualFileSystem::Exists(const std::filesystem::path& _path)
+	{
+		std::error_code error;
+		return IsArchived(_path) || std::filesystem::exists(_path, error);
+	}
+
+	bool VirtualFileSystem::IsArchived(const std::filesystem::path& _path)
+	{
+		std::string name;
+		return Resolve(_path, name) != nullptr;
+	}
+
+	bool VirtualFileSystem::OpenArchived(const std::filesystem::path& _path, MappedFile& _outFile)
+	{
+		std::string name;
+		const std::shared_ptr<const Archive> archive = Resolve(_path, name);
+		return archive && archive->OpenEntry(name, _outFile);
+	}
+
+	MappedFile VirtualFileSystem::Open(const std::filesystem::path& _path, MappedFile::AccessPattern _accessPattern)
+	{
+		MappedFile file;
+		if (OpenArchived(_path, file))
+		{
+			file.Advise(_accessPattern);
+			return file;
+		}
+		return MappedFile(_path, _accessPattern);
+	}
+
+	std::string VirtualFileSystem::GetAbsoluteName(const std::filesystem::path& _path)
+	{
+		std::error_code error;
+		const std::filesystem::path absolutePath = std::filesystem::absolute(_path, error);
+		return Archive::Normalize((error ? _path : absolutePath).generic_string());
+	}
+
+	std::shared_ptr<const Archive> VirtualFileSystem::Resolve(const std::filesystem::path& _path, std::string& _outName)
+	{
+		std::shared_lock lock(mutex_);
+		if (mountPoints_.empty())
+		{
+			return nullptr;
+		}
+
+		const std::string name = GetAbsoluteName(_path);
+		for (auto mountPoint = mountPoints_.rbegin(); mountPoint != mountPoints_.rend(); mountPoint++)
+		{
+			if (name.starts_with(mountPoint->prefix_))
+			{
+				_outName = name.substr(mountPoint->prefix_.size());
+				if (mountPoint->archive_->Contains(_outName))
+				{
+					return mountPoint->archive_;
+				}
+			}
+		}
+		return nullptr;
+	}
+}
\ No newline at end of file
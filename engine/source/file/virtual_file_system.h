@@ -0,0 +1,49 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "archive.h"
+#include "mapped_file.h"
+
+namespace file
+{
+	// resolves paths against mounted archives before falling back to loose files, so loaders read both the same way,
+	// an archive mounted at a directory serves every path below it, later mounts shadow earlier ones
+	class VirtualFileSystem final
+	{
+	private:
+		struct MountPoint
+		{
+			std::string prefix_; // normalized absolute directory with a trailing slash
+			std::filesystem::path archivePath_;
+			std::shared_ptr<const Archive> archive_;
+		};
+
+	private:
+		inline static std::shared_mutex mutex_;
+		inline static std::vector<MountPoint> mountPoints_;
+
+	public:
+		// _directory defaults to the archive path without its extension, the directory it was usually built from
+		static bool Mount(const std::filesystem::path& _archivePath, const std::filesystem::path& _directory = {});
+		// mounts <_directory>.pak at _directory when pak_builder packed it, false when there is no such archive
+		static bool MountPacked(const std::filesystem::path& _directory);
+		static void Unmount(const std::filesystem::path& _archivePath);
+		static void UnmountAll();
+
+		static bool Exists(const std::filesystem::path& _path);
+		static bool IsArchived(const std::filesystem::path& _path);
+		static bool OpenArchived(const std::filesystem::path& _path, MappedFile& _outFile);
+		// archived entries first, then the loose file
+		static MappedFile Open(const std::filesystem::path& _path, MappedFile::AccessPattern _accessPattern = MappedFile::AccessPattern::NORMAL);
+
+		// absolute path normalized with Archive::Normalize, one spelling per file
+		static std::string GetAbsoluteName(const std::filesystem::path& _path);
+
+	private:
+		// archive holding _path with the entry name relative to its mount point
+		static std::shared_ptr<const Archive> Resolve(const std::filesystem::path& _path, std::string& _outName);
+	};
+}
\ No newline at end of file
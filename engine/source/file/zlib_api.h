@@ -0,0 +1,22 @@
+#pragma once
+
+#if _DEBUG
+#pragma comment(lib, "zlib/zlibstaticd.lib")
+#else
+#pragma comment(lib, "zlib/zlibstatic.lib")
+#endif
+
+// the bundled zlib ships as a static library only, so the few entry points used by the engine are declared directly
+extern "C"
+{
+	unsigned long compressBound(unsigned long _sourceLength);
+	int compress2(unsigned char* _destination, unsigned long* _destinationLength, const unsigned char* _source, unsigned long _sourceLength, int _level);
+	int uncompress(unsigned char* _destination, unsigned long* _destinationLength, const unsigned char* _source, unsigned long _sourceLength);
+}
+
+namespace file
+{
+	constexpr int zlibOk = 0;
+	constexpr int zlibDefaultLevel = -1;
+	constexpr int zlibBestLevel = 9;
+}
\ No newline at end of file
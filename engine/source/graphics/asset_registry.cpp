@@ -0,0 +1,193 @@
+#include "asset_registry.h"
+#include "material.h"
+#include "file/binary_file.h"
+#include "file/virtual_file_system.h"
+#include "utility/hash.hpp"
+#include "utility/log.h"
+#include <format>
+#include <iostream>
+
+using utility::Log;
+
+namespace graphics
+{
+	namespace
+	{
+		// everything besides the source that changes what a texture ends up holding
+		std::string GetSettingsKey(const Texture::Layout& _layout)
+		{
+			return std::format("|{}|{}|{}|{}|{}|{}|{}|{}", (int)_layout.format_, _layout.size_, _layout.numElements_, _layout.srgb_, _layout.generateMips_, _layout.useCache_, (int)_layout.category_, (int)_layout.compressionQuality_);
+		}
+
+		std::string GetContentKey(uint64_t _hash, size_t _size)
+		{
+			return std::format("#{:016x}:{}", _hash, _size);
+		}
+	}
+
+	AssetRegistry::AssetRegistry(GraphicsAPI& _graphicsAPI)
+		: graphicsAPI_(_graphicsAPI)
+	{
+	}
+
+	std::shared_ptr<Texture> AssetRegistry::AcquireTexture(const Texture::Layout& _layout)
+	{
+		const std::string settingsKey = GetSettingsKey(_layout);
+
+		if (_layout.initializationType_ == Texture::InitializationType::BUFFER)
+		{
+			if (!_layout.buffer_.has_value())
+			{
+				return graphicsAPI_.CreateTexture(_layout);
+			}
+
+			const file::Image& image = *_layout.buffer_;
+			const uint64_t hash = utility::HashBytes(image.colors_.data(), image.colors_.size(), ((uint64_t)image.width_ << 32) | image.height_);
+			const std::string key = GetContentKey(hash, image.colors_.size()) + std::format("|{}|{}", (int)image.format_, image.mips_.size()) + settingsKey;
+			return Acquire(textures_, key, [&]() { return graphicsAPI_.CreateTexture(_layout); });
+		}
+
+		// size and write time stand in for the contents so nothing is read before the texture streams in,
+		// archived files can not change while mounted
+		const std::filesystem::path path(_layout.imagePath_);
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+		if (!file::VirtualFileSystem::IsArchived(path))
+		{
+			file::QuerySource(path, size, writeTime);
+		}
+
+		const std::string key = file::VirtualFileSystem::GetAbsoluteName(path) + std::format("@{}:{}", size, writeTime) + settingsKey;
+		return Acquire(textures_, key, [&]() { return graphicsAPI_.CreateTexture(_layout); });
+	}
+
+	std::shared_ptr<Mesh> AssetRegistry::AcquireMesh(const Mesh::Layout& _layout)
+	{
+		const uint64_t vertexHash = utility::HashBytes(_layout.vertices_.GetRawBufferAddress(), _layout.vertices_.GetSizeInBytes());
+		const uint64_t indexHash = utility::HashBytes(_layout.indices_.data(), _layout.indices_.size() * sizeof(uint32_t), vertexHash);
+		const uint64_t hash = utility::HashBytes(_layout.lods_.data(), _layout.lods_.size() * sizeof(Mesh::Lod), indexHash);
+		const std::string key = GetContentKey(hash, _layout.vertices_.GetSizeInBytes()) + std::format("|{}|{}|{}|{}", _layout.indices_.size(), _layout.lods_.size(), _layout.vertices_.GetElementSize(), (int)_layout.indexFormat_);
+		return Acquire(meshes_, key, [&]() { return graphicsAPI_.CreateMesh(_layout); });
+	}
+
+	std::shared_ptr<Mesh> AssetRegistry::AcquireMesh(const file::Mesh& _mesh, bool _evictable)
+	{
+		Mesh::Layout layout;
+		layout.vertices_ = _mesh.vertices_;
+		layout.indices_ = _mesh.indices_;
+		layout.evictable_ = _evictable;
+
+		if (!_mesh.lods_.empty())
+		{
+			layout.lods_.push_back(Mesh::Lod{ 0, (uint32_t)_mesh.indices_.size(), 0.0f });
+			for (const file::MeshLod& lod : _mesh.lods_)
+			{
+				layout.lods_.push_back(Mesh::Lod{ (uint32_t)layout.indices_.size(), (uint32_t)lod.indices_.size(), lod.error_ });
+				layout.indices_.insert(layout.indices_.end(), lod.indices_.begin(), lod.indices_.end());
+			}
+		}
+
+		return AcquireMesh(layout);
+	}
+
+	std::shared_ptr<Material> AssetRegistry::AcquireMaterial(const file::Material& _material, const Texture::Layout& _textureLayout, std::shared_ptr<Texture> _fallbackMap)
+	{
+		auto acquireMap = [&](const std::string& _path)
+			{
+				Texture::Layout layout = _textureLayout;
+				layout.initializationType_ = Texture::InitializationType::FILE;
+				layout.imagePath_ = _path;
+				return _path.empty() ? _fallbackMap : AcquireTexture(layout);
+			};
+
+		// maps are shared already, so equal pairs of them make equal materials
+		const std::shared_ptr<Texture> diffuseMap = acquireMap(_material.diffuseMapPath_);
+		const std::shared_ptr<Texture> normalMap = acquireMap(_material.normalMapPath_);
+		const std::string key = std::format("{}|{}", (const void*)diffuseMap.get(), (const void*)normalMap.get());
+		return Acquire(materials_, key, [&]()
+			{
+				std::shared_ptr<Material> material = graphicsAPI_.CreateMaterial();
+				material->SetFixedBinding(Material::FixedBindingIndex::DIFFUSE_MAP, diffuseMap);
+				material->SetFixedBinding(Material::FixedBindingIndex::NORMAL_MAP, normalMap);
+				return material;
+			});
+	}
+
+	std::shared_ptr<const file::Model> AssetRegistry::AcquireModel(const std::string& _path, bool _useCache)
+	{
+		return Acquire(models_, file::VirtualFileSystem::GetAbsoluteName(_path), [&]()
+			{
+				std::shared_ptr<file::Model> model = std::make_shared<file::Model>();
+				return model->Load(_path, _useCache) ? std::shared_ptr<const file::Model>(std::move(model)) : nullptr;
+			});
+	}
+
+	size_t AssetRegistry::Collect()
+	{
+		return Collect(textures_) + Collect(meshes_) + Collect(materials_) + Collect(models_);
+	}
+
+	template <typename T, typename Create>
+	std::shared_ptr<T> AssetRegistry::Acquire(Table<T>& _table, const std::string& _key, Create&& _create)
+	{
+		std::unique_lock lock(_table.mutex_);
+		Slot<T>& slot = _table.slots_[_key];
+		if (std::shared_ptr<T> asset = slot.asset_.lock())
+		{
+			return asset;
+		}
+
+		// another thread is loading the same asset, wait for it instead of loading a second copy
+		if (slot.loading_.valid())
+		{
+			const std::shared_future<std::shared_ptr<T>> loading = slot.loading_;
+			lock.unlock();
+			return loading.get();
+		}
+
+		std::promise<std::shared_ptr<T>> promise;
+		slot.loading_ = promise.get_future().share();
+		lock.unlock();
+
+		// waiters see the same exception, the slot goes so the next request tries again
+		std::shared_ptr<T> asset;
+		try
+		{
+			asset = _create();
+		}
+		catch (...)
+		{
+			lock.lock();
+			_table.slots_.erase(_key);
+			lock.unlock();
+
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+
+		// the table may have rehashed meanwhile, failed loads leave no entry so they are retried next time
+		lock.lock();
+		if (asset)
+		{
+			Slot<T>& loadedSlot = _table.slots_[_key];
+			loadedSlot.asset_ = asset;
+			loadedSlot.loading_ = {};
+		}
+		else
+		{
+			_table.slots_.erase(_key);
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "failed to acquire asset, key : " + _key) << std::endl;
+		}
+		lock.unlock();
+
+		promise.set_value(asset);
+		return asset;
+	}
+
+	template <typename T>
+	size_t AssetRegistry::Collect(Table<T>& _table)
+	{
+		std::lock_guard lock(_table.mutex_);
+		return std::erase_if(_table.slots_, [](const auto& _slot) { return _slot.second.asset_.expired() && !_slot.second.loading_.valid(); });
+	}
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+#include "graphics_api.h"
+#include "file/model.h"
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace graphics
+{
+	// hands out shared assets, texture files keyed by normalized path, size and write time and everything else by content hash,
+	// so materials naming one map through different spellings share a single decode and upload, the returned handles are
+	// the reference counts, the registry only keeps weak references and a request for an asset that is still loading waits for that load
+	class AssetRegistry
+	{
+	private:
+		template <typename T>
+		struct Slot
+		{
+			std::weak_ptr<T> asset_;
+			std::shared_future<std::shared_ptr<T>> loading_;
+		};
+
+		template <typename T>
+		struct Table
+		{
+			std::mutex mutex_;
+			std::unordered_map<std::string, Slot<T>> slots_;
+		};
+
+	private:
+		GraphicsAPI& graphicsAPI_;
+		Table<Texture> textures_;
+		Table<Mesh> meshes_;
+		Table<Material> materials_;
+		Table<const file::Model> models_;
+
+	public:
+		AssetRegistry(GraphicsAPI& _graphicsAPI);
+
+	public:
+		std::shared_ptr<Texture> AcquireTexture(const Texture::Layout& _layout);
+		std::shared_ptr<Mesh> AcquireMesh(const Mesh::Layout& _layout);
+		// levels of detail of _mesh are appended to its index buffer
+		std::shared_ptr<Mesh> AcquireMesh(const file::Mesh& _mesh, bool _evictable = false);
+		// maps of the material are acquired with _textureLayout, missing maps are bound to _fallbackMap
+		std::shared_ptr<Material> AcquireMaterial(const file::Material& _material, const Texture::Layout& _textureLayout, std::shared_ptr<Texture> _fallbackMap);
+		std::shared_ptr<const file::Model> AcquireModel(const std::string& _path, bool _useCache = true);
+
+		// drops entries whose assets died with their last handle, returns how many went away
+		size_t Collect();
+
+	private:
+		template <typename T, typename Create>
+		static std::shared_ptr<T> Acquire(Table<T>& _table, const std::string& _key, Create&& _create);
+		template <typename T>
+		static size_t Collect(Table<T>& _table);
+	};
+}
\ No newline at end of file
@@ -13,6 +13,13 @@ namespace graphics
 		TRIANGLE_LIST
 	};
 
+	enum class IndexFormat
+	{
+		NONE, // narrowest format that can address every vertex
+		UINT16,
+		UINT32
+	};
+
 	enum class ComparisonFunc
 	{
 		NONE,
@@ -55,8 +62,21 @@ namespace graphics
 		B8G8R8_NORM,
 		B8G8R8A8_UNORM,
 		B8G8R8A8_NORM,
+		R8_UNORM,
+		R8G8_UNORM,
+		R16_UNORM,
+		R16G16B16A16_SFLOAT,
+		R32G32B32_SFLOAT,
 		D32_SFLOAT,
 		D32_SFLOAT_U8_UINT,
+		BC1_RGBA_UNORM,
+		BC1_RGBA_SRGB,
+		BC3_UNORM,
+		BC3_SRGB,
+		BC4_UNORM,
+		BC5_UNORM,
+		BC7_UNORM,
+		BC7_SRGB,
 	};
 
 	enum class ImageUsage
@@ -82,5 +102,6 @@ namespace graphics
 	{
 		std::shared_ptr<Mesh> mesh_;
 		std::shared_ptr<Material> material_;
+		uint32_t lod_ = 0; // clamped to the coarsest level of mesh_, see Mesh::SelectLod
 	};
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #pragma once
+#include <array>
 #include "pipeline.h"
 #include "mesh.h"
 #include "uniform_buffer.h"
 #include "texture.h"
 #include "render_target.h"
+#include "residency_manager.h"
 
 namespace graphics
 {
@@ -17,22 +19,38 @@ namespace graphics
 
 		struct Config
 		{
+			// applied while textures load, larger images are downscaled or lose their top mips
+			struct TextureLimits
+			{
+				std::array<uint32_t, (size_t)Texture::Category::TC_MAX> maxSizes_{}; // largest dimension per category, 0 keeps the full size
+				size_t memoryBudget_ = 0; // bytes every texture may take together, new textures shrink to what is left, 0 disables
+			};
+
 			uint32_t numFrameConcurrency_ = 2;// experimental value
 			
-			// todo : make actual dynamic pool
-			uint32_t numMaxDescriptorSets_ = 128;
-			uint32_t numMaxSamplers_ = 128;
-			uint32_t numMaxUBuffers_ = 128;
+			// descriptor pools are created in pages of this many sets, each new page twice the last up to the max
+			uint32_t numDescriptorSetsPerPage_ = 64;
+			uint32_t numMaxDescriptorSetsPerPage_ = 1024;
+
+			TextureLimits textureLimits_;
+			ResidencyManager::Budget residencyBudget_;
+			std::string pipelineCachePath_ = "pipeline_cache.bin"; // driver pipeline cache kept between runs, empty keeps it in memory only
+			uint64_t stagingBufferSize_ = 32ull << 20; // ring uploads are staged through, larger uploads get a buffer of their own
 		};
 
 	protected:
 		Config config_;
+		ResidencyManager residencyManager_;
 
 	public:
 		virtual ~GraphicsAPI() = default;
 
 	public:
 		Config GetConfig() const { return config_; }
+		// affects textures created afterwards
+		void SetTextureLimits(const Config::TextureLimits& _textureLimits) { config_.textureLimits_ = _textureLimits; }
+		void SetResidencyBudget(const ResidencyManager::Budget& _budget) { config_.residencyBudget_ = _budget; residencyManager_.SetBudget(_budget); }
+		ResidencyManager& GetResidencyManager() { return residencyManager_; }
 
 		virtual std::shared_ptr<Pipeline> CreatePipeline(const Pipeline::Layout& _pipelineLayout) = 0;
 		virtual std::shared_ptr<Mesh> CreateMesh(const Mesh::Layout& _meshLayout) = 0;
@@ -1,7 +1,7 @@
 #pragma once
 #include <array>
 #include <memory>
-#include "utility/forward_declaration.h"
+#include "shader.h"
 
 namespace graphics
 {
@@ -17,6 +17,7 @@ namespace graphics
 
 	protected:
 		std::array<std::shared_ptr<ShaderBinding>, (int32_t)FixedBindingIndex::FB_MAX> fixedBindings_;
+		std::array<uint32_t, (int32_t)FixedBindingIndex::FB_MAX> compiledGenerations_{};
 		bool pendingCompilation_ = false;
 
 	public:
@@ -31,7 +32,25 @@ namespace graphics
 
 		bool IsCompiled() const
 		{
-			return !pendingCompilation_;
+			if (pendingCompilation_)
+			{
+				return false;
+			}
+
+			// streamed textures recreate their images
+			for (uint32_t i = 0; i < fixedBindings_.size(); i++)
+			{
+				if (fixedBindings_[i] && fixedBindings_[i]->GetGeneration() != compiledGenerations_[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		const std::array<std::shared_ptr<ShaderBinding>, (int32_t)FixedBindingIndex::FB_MAX>& GetFixedBindings() const
+		{
+			return fixedBindings_;
 		}
 	};
 }
\ No newline at end of file
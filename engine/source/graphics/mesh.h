@@ -1,17 +1,32 @@
 #pragma once
 #include "utility/byte_buffer.h"
 #include "utility/forward_declaration.h"
+#include "common.h"
+#include "streamable.h"
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace graphics
 {
-	class Mesh
+	class Mesh : public Streamable
 	{
 	public:
+		// range of the index buffer drawing one level of detail
+		struct Lod
+		{
+			uint32_t firstIndex_ = 0;
+			uint32_t numIndices_ = 0;
+			float error_ = 0.0f; // object space deviation from level 0, see file::MeshSimplifier::ProjectError
+		};
+
 		struct Layout
 		{
 			utility::ByteBuffer vertices_;
-			std::vector<uint32_t> indices_;
+			std::vector<uint32_t> indices_; // every level of detail one after another
+			std::vector<Lod> lods_; // ranges of indices_ from detailed to coarse, empty when indices_ is a single level
+			IndexFormat indexFormat_ = IndexFormat::NONE;
+			bool evictable_ = false; // keeps a host copy so the buffers can be freed and uploaded again
 		};
 
 	public:
@@ -20,11 +35,26 @@ namespace graphics
 	protected:
 		uint32_t numVertices_;
 		uint32_t numIndices_;
+		IndexFormat indexFormat_ = IndexFormat::UINT32;
+		std::vector<Lod> lods_; // never empty, level 0 being the full mesh
 		std::shared_ptr<Material> material_;
 
 	public:
 		uint32_t GetNumVertices() const { return numVertices_; };
-		uint32_t GetNumIndices() const { return numIndices_; };
+		uint32_t GetNumIndices() const { return numIndices_; }; // of level 0
+		uint32_t GetNumLods() const { return (uint32_t)lods_.size(); };
+		const Lod& GetLod(uint32_t _index) const { return lods_[std::min(_index, GetNumLods() - 1)]; };
+		// coarsest level that stays within _maxError in object space
+		uint32_t SelectLod(float _maxError) const
+		{
+			uint32_t index = 0;
+			while (index + 1 < GetNumLods() && lods_[index + 1].error_ <= _maxError)
+			{
+				index++;
+			}
+			return index;
+		};
+		IndexFormat GetIndexFormat() const { return indexFormat_; };
 		void SetMaterial(std::shared_ptr<Material> _material) { material_ = _material; }
 	};
 }
\ No newline at end of file
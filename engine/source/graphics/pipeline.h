@@ -4,6 +4,7 @@
 #include "utility/forward_declaration.h"
 #include "utility/log.h"
 #include "shader.h"
+#include "shader_reflection.h"
 #include <string_view>
 #include <array>
 
@@ -23,13 +24,18 @@ namespace graphics
 			Viewport viewport_;
 			std::wstring_view vertexShaderPath_;
 			std::wstring_view pixelShaderPath_;
-			utility::ByteBuffer::Layout vertexInputLayout_;
-			ShaderDescriptor shaderDescriptor_;
+			utility::ByteBuffer::Layout vertexInputLayout_; // reflected from the vertex shader when left empty
+			ShaderDescriptor shaderDescriptor_; // bindings are reflected from the shaders, ones written here are only checked against them
 		};
 
+		// materials bind their fixed bindings to the first set, bindings of the descriptor go to the second
+		static constexpr uint32_t materialDescriptorSet = 0;
+		static constexpr uint32_t pipelineDescriptorSet = 1;
+
 	protected:
 		std::array<std::shared_ptr<ShaderBinding>, 512> shaderBindings_;
 		ShaderDescriptor shaderDescriptor_;
+		ShaderReflection reflection_;
 
 	public:
 		Pipeline(const Layout& _layout) : shaderDescriptor_(_layout.shaderDescriptor_) {}
@@ -37,19 +43,22 @@ namespace graphics
 
 	public:
 		uint32_t GetNumBindings() const { return (uint32_t)shaderDescriptor_.bindings_.size(); }
+		const ShaderDescriptor& GetShaderDescriptor() const { return shaderDescriptor_; }
+		const ShaderReflection& GetReflection() const { return reflection_; }
 
 		virtual std::shared_ptr<RenderTarget> CreateRenderTarget(uint32_t _width, uint32_t _height) const = 0;
 		virtual bool BindShaderBinding(std::shared_ptr<ShaderBinding> _shaderBinding, uint32_t _slot)
 		{
 			using utility::Log;
 
-			if (_slot >= shaderDescriptor_.bindings_.size())
+			const ShaderDescriptor::Binding* binding = shaderDescriptor_.FindBinding(_slot);
+			if (!binding || _slot >= shaderBindings_.size())
 			{
 				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Tried to bind with invalid slot to pipeline") << std::endl;
 				return false;
 			}
 
-			if (shaderDescriptor_.bindings_[_slot].type_ != _shaderBinding->type_)
+			if (binding->type_ != _shaderBinding->type_)
 			{
 				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Tried to bind different binding type to pipeline") << std::endl;
 				return false;
@@ -58,5 +67,20 @@ namespace graphics
 			shaderBindings_[_slot] = _shaderBinding;
 			return true;
 		}
+
+		// by block name for uniform buffers and variable name for textures, as declared in the shaders
+		bool BindShaderBinding(std::shared_ptr<ShaderBinding> _shaderBinding, std::string_view _name)
+		{
+			using utility::Log;
+
+			const ShaderDescriptor::Binding* binding = shaderDescriptor_.FindBinding(_name);
+			if (!binding)
+			{
+				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Tried to bind to a name the pipeline does not declare : " + std::string(_name)) << std::endl;
+				return false;
+			}
+
+			return BindShaderBinding(_shaderBinding, binding->slot_);
+		}
 	};
 }
\ No newline at end of file
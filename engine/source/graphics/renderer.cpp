@@ -19,6 +19,8 @@ namespace graphics
 			return;
 		}
 
+		// the frame advances before drawing so this frame's touches are never the least recent
+		_graphicsAPI.GetResidencyManager().Update(_graphicsAPI.GetConfig().numFrameConcurrency_);
 		entryPass_->Execute(_graphicsAPI, passResources_);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include "residency_manager.h"
+#include "common.h"
+#include "mesh.h"
+#include "material.h"
+#include "texture.h"
+#include <algorithm>
+
+namespace graphics
+{
+	void ResidencyManager::SetBudget(const Budget& _budget)
+	{
+		std::lock_guard lock(mutex_);
+		budget_ = _budget;
+	}
+
+	void ResidencyManager::SetReleaseMemory(std::function<void()> _releaseMemory)
+	{
+		std::lock_guard lock(mutex_);
+		releaseMemory_ = std::move(_releaseMemory);
+	}
+
+	void ResidencyManager::Register(std::shared_ptr<Streamable> _resource)
+	{
+		// new resources count as used now so they are not evicted before their first draw
+		_resource->lastUsedFrame_ = frame_.load();
+
+		std::lock_guard lock(mutex_);
+		resources_.push_back(_resource);
+	}
+
+	void ResidencyManager::Touch(Streamable& _resource)
+	{
+		_resource.lastUsedFrame_ = frame_.load();
+		if (_resource.IsEvicted())
+		{
+			_resource.Restore();
+		}
+	}
+
+	void ResidencyManager::Touch(const Drawable& _drawable)
+	{
+		if (_drawable.mesh_)
+		{
+			Touch(*_drawable.mesh_);
+		}
+
+		if (_drawable.material_)
+		{
+			for (const std::shared_ptr<ShaderBinding>& binding : _drawable.material_->GetFixedBindings())
+			{
+				if (binding && binding->type_ == ShaderBinding::Type::TEXTURE_2D)
+				{
+					Touch(static_cast<Texture&>(*binding));
+				}
+			}
+		}
+	}
+
+	void ResidencyManager::Update(uint32_t _numFramesInFlight)
+	{
+		const uint64_t frame = ++frame_;
+
+		Budget budget;
+		std::function<void()> releaseMemory;
+		std::vector<std::shared_ptr<Streamable>> resources;
+		{
+			std::lock_guard lock(mutex_);
+			std::erase_if(resources_, [](const std::weak_ptr<Streamable>& _resource) { return _resource.expired(); });
+
+			budget = budget_;
+			releaseMemory = releaseMemory_;
+			resources.reserve(resources_.size());
+			for (const std::weak_ptr<Streamable>& resource : resources_)
+			{
+				if (std::shared_ptr<Streamable> locked = resource.lock())
+				{
+					resources.push_back(std::move(locked));
+				}
+			}
+		}
+
+		// evicted resources are left out, their fallbacks are small and may still be shrinking
+		size_t deviceMemory = 0;
+		size_t hostMemory = 0;
+		for (const std::shared_ptr<Streamable>& resource : resources)
+		{
+			deviceMemory += resource->IsEvicted() ? 0 : resource->GetDeviceMemory();
+			hostMemory += resource->GetHostMemory();
+		}
+
+		const bool overDeviceBudget = budget.deviceMemory_ > 0 && deviceMemory > budget.deviceMemory_;
+		const bool overHostBudget = budget.hostMemory_ > 0 && hostMemory > budget.hostMemory_;
+		if (overDeviceBudget || overHostBudget)
+		{
+			std::vector<std::pair<uint64_t, Streamable*>> leastRecentlyUsed;
+			leastRecentlyUsed.reserve(resources.size());
+			for (const std::shared_ptr<Streamable>& resource : resources)
+			{
+				leastRecentlyUsed.emplace_back(resource->lastUsedFrame_.load(), resource.get());
+			}
+			std::sort(leastRecentlyUsed.begin(), leastRecentlyUsed.end(), [](const auto& _lhs, const auto& _rhs) { return _lhs.first < _rhs.first; });
+
+			for (const auto& [lastUsedFrame, resource] : leastRecentlyUsed)
+			{
+				if (!overDeviceBudget || frame - lastUsedFrame <= _numFramesInFlight)
+				{
+					break;
+				}
+
+				// once within the budget, the remaining candidates are only evicted to move them out of sparse blocks
+				if (deviceMemory <= budget.deviceMemory_ && !resource->IsInSparseMemory())
+				{
+					continue;
+				}
+
+				const size_t size = resource->GetDeviceMemory();
+				// evicting a resource still uploading would throw away a copy nothing has drawn yet
+				if (!resource->IsEvicted() && resource->IsUploaded() && resource->Evict())
+				{
+					deviceMemory -= std::min(size, deviceMemory);
+				}
+			}
+
+			// blocks emptied by this or earlier evictions, spares included
+			if (overDeviceBudget && releaseMemory)
+			{
+				releaseMemory();
+			}
+
+			// host copies of evicted resources are all that brings them back
+			for (const auto& [lastUsedFrame, resource] : leastRecentlyUsed)
+			{
+				if (!overHostBudget || hostMemory <= budget.hostMemory_)
+				{
+					break;
+				}
+
+				const size_t size = resource->GetHostMemory();
+				if (size > 0 && !resource->IsEvicted())
+				{
+					resource->ReleaseHostMemory();
+					hostMemory -= std::min(size, hostMemory);
+				}
+			}
+		}
+
+		deviceMemory_ = deviceMemory;
+		hostMemory_ = hostMemory;
+	}
+
+	size_t ResidencyManager::GetDeviceMemory() const
+	{
+		return deviceMemory_;
+	}
+
+	size_t ResidencyManager::GetHostMemory() const
+	{
+		return hostMemory_;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include "streamable.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace graphics
+{
+	// keeps textures and meshes within memory budgets, resources drawn least recently are evicted first
+	// and come back when a draw touches them again
+	class ResidencyManager
+	{
+	public:
+		struct Budget
+		{
+			size_t deviceMemory_ = 0; // bytes resident textures and meshes may take together, 0 disables eviction
+			size_t hostMemory_ = 0; // bytes of host copies kept to bring meshes back, 0 keeps every copy
+		};
+
+	private:
+		std::mutex mutex_;
+		std::vector<std::weak_ptr<Streamable>> resources_;
+		Budget budget_;
+		std::function<void()> releaseMemory_;
+		std::atomic<uint64_t> frame_ = 0;
+		std::atomic<size_t> deviceMemory_ = 0;
+		std::atomic<size_t> hostMemory_ = 0;
+
+	public:
+		void SetBudget(const Budget& _budget);
+		void Register(std::shared_ptr<Streamable> _resource);
+		// called after evictions so the backend gives back memory blocks they left empty
+		void SetReleaseMemory(std::function<void()> _releaseMemory);
+
+		// stamps the current frame and brings evicted resources back
+		void Touch(Streamable& _resource);
+		void Touch(const Drawable& _drawable);
+
+		// called once per frame before drawing, nothing used by the last _numFramesInFlight frames is evicted
+		void Update(uint32_t _numFramesInFlight);
+
+		// as of the last update, evicted resources are not counted
+		size_t GetDeviceMemory() const;
+		size_t GetHostMemory() const;
+	};
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include "graphics/common.h"
 #include <vector>
 #include <memory>
+#include <string>
+#include <string_view>
 
 namespace graphics
 {
@@ -27,6 +29,8 @@ namespace graphics
 
 	public:
 		virtual std::shared_ptr<BindingImpl> GetBindingImpl() const { return nullptr; }
+		// changes whenever the binding impl starts pointing at new objects, descriptors written before are stale
+		virtual uint32_t GetGeneration() const { return 0; }
 	};
 
 	struct ShaderDescriptor
@@ -35,8 +39,10 @@ namespace graphics
 		{
 			ShaderBinding::Type type_;
 			uint32_t numElements_ = 1;
-			uint32_t slot_ = std::numeric_limits<uint32_t>::max();
+			uint32_t slot_ = std::numeric_limits<uint32_t>::max(); // binding number within the pipeline's descriptor set
 			ShaderStage stage_;
+			std::string name_;
+			bool used_ = true; // declared but never read bindings stay out of the layout and descriptor updates
 		};
 
 		struct Output
@@ -51,5 +57,29 @@ namespace graphics
 
 		std::vector<Binding> bindings_;
 		std::vector<Output> outputs;
+
+		const Binding* FindBinding(uint32_t _slot) const
+		{
+			for (const Binding& binding : bindings_)
+			{
+				if (binding.slot_ == _slot)
+				{
+					return &binding;
+				}
+			}
+			return nullptr;
+		}
+
+		const Binding* FindBinding(std::string_view _name) const
+		{
+			for (const Binding& binding : bindings_)
+			{
+				if (binding.name_ == _name)
+				{
+					return &binding;
+				}
+			}
+			return nullptr;
+		}
 	};
 }
\ No newline at end of file
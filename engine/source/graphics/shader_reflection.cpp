@@ -0,0 +1,601 @@
+#include "shader_reflection.h"
+#include "utility/log.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+using utility::Log;
+
+namespace graphics
+{
+	namespace
+	{
+		// the part of the spir-v specification reflection needs
+		namespace spirv
+		{
+			constexpr uint32_t magic = 0x07230203;
+			constexpr uint32_t headerSize = 5;
+
+			enum Op : uint16_t
+			{
+				OP_NAME = 5,
+				OP_MEMBER_NAME = 6,
+				OP_ENTRY_POINT = 15,
+				OP_TYPE_BOOL = 20,
+				OP_TYPE_INT = 21,
+				OP_TYPE_FLOAT = 22,
+				OP_TYPE_VECTOR = 23,
+				OP_TYPE_MATRIX = 24,
+				OP_TYPE_IMAGE = 25,
+				OP_TYPE_SAMPLED_IMAGE = 27,
+				OP_TYPE_ARRAY = 28,
+				OP_TYPE_RUNTIME_ARRAY = 29,
+				OP_TYPE_STRUCT = 30,
+				OP_TYPE_POINTER = 32,
+				OP_CONSTANT = 43,
+				OP_FUNCTION = 54,
+				OP_FUNCTION_CALL = 57,
+				OP_VARIABLE = 59,
+				OP_IMAGE_TEXEL_POINTER = 60,
+				OP_LOAD = 61,
+				OP_STORE = 62,
+				OP_COPY_MEMORY = 63,
+				OP_ACCESS_CHAIN = 65,
+				OP_IN_BOUNDS_ACCESS_CHAIN = 66,
+				OP_PTR_ACCESS_CHAIN = 67,
+				OP_ARRAY_LENGTH = 68,
+				OP_DECORATE = 71,
+				OP_MEMBER_DECORATE = 72,
+			};
+
+			enum Decoration : uint32_t
+			{
+				BLOCK = 2,
+				ARRAY_STRIDE = 6,
+				MATRIX_STRIDE = 7,
+				BUILT_IN = 11,
+				LOCATION = 30,
+				BINDING = 33,
+				DESCRIPTOR_SET = 34,
+				OFFSET = 35,
+			};
+
+			enum StorageClass : uint32_t
+			{
+				UNIFORM_CONSTANT = 0,
+				INPUT = 1,
+				UNIFORM = 2,
+				PUSH_CONSTANT = 9,
+			};
+
+			enum ExecutionModel : uint32_t
+			{
+				VERTEX = 0,
+				FRAGMENT = 4,
+			};
+
+			constexpr uint32_t dim2D = 1;
+		}
+
+		using Decorations = std::unordered_map<uint32_t, uint32_t>; // decoration to its first literal, 0 for those without one
+
+		struct Type
+		{
+			uint16_t op_ = 0;
+			std::vector<uint32_t> operands_; // words after the result id
+		};
+
+		struct Variable
+		{
+			uint32_t id_ = 0;
+			uint32_t type_ = 0; // pointee type
+			uint32_t storageClass_ = 0;
+		};
+
+		struct Module
+		{
+			ShaderStage stage_{};
+			bool vertex_ = false;
+			std::unordered_map<uint32_t, std::string> names_;
+			std::unordered_map<uint32_t, std::unordered_map<uint32_t, std::string>> memberNames_;
+			std::unordered_map<uint32_t, Decorations> decorations_;
+			std::unordered_map<uint32_t, std::unordered_map<uint32_t, Decorations>> memberDecorations_;
+			std::unordered_map<uint32_t, Type> types_;
+			std::unordered_map<uint32_t, uint32_t> constants_;
+			std::vector<Variable> variables_;
+			std::unordered_set<uint32_t> usedIds_;
+
+			std::optional<uint32_t> GetDecoration(uint32_t _id, uint32_t _decoration) const
+			{
+				const auto decorations = decorations_.find(_id);
+				if (decorations == decorations_.end())
+				{
+					return std::nullopt;
+				}
+
+				const auto decoration = decorations->second.find(_decoration);
+				return (decoration != decorations->second.end()) ? std::optional<uint32_t>(decoration->second) : std::nullopt;
+			}
+
+			std::optional<uint32_t> GetMemberDecoration(uint32_t _id, uint32_t _member, uint32_t _decoration) const
+			{
+				const auto members = memberDecorations_.find(_id);
+				if (members == memberDecorations_.end())
+				{
+					return std::nullopt;
+				}
+
+				const auto decorations = members->second.find(_member);
+				if (decorations == members->second.end())
+				{
+					return std::nullopt;
+				}
+
+				const auto decoration = decorations->second.find(_decoration);
+				return (decoration != decorations->second.end()) ? std::optional<uint32_t>(decoration->second) : std::nullopt;
+			}
+
+			const Type* GetType(uint32_t _id) const
+			{
+				const auto type = types_.find(_id);
+				return (type != types_.end()) ? &type->second : nullptr;
+			}
+
+			std::string GetName(uint32_t _id) const
+			{
+				const auto name = names_.find(_id);
+				return (name != names_.end()) ? name->second : std::string();
+			}
+
+			std::string GetMemberName(uint32_t _id, uint32_t _member) const
+			{
+				const auto members = memberNames_.find(_id);
+				if (members == memberNames_.end())
+				{
+					return std::string();
+				}
+
+				const auto name = members->second.find(_member);
+				return (name != members->second.end()) ? name->second : std::string();
+			}
+
+			// bytes the type takes in a buffer, strides decorated on the type or its parent member take precedence
+			uint32_t GetSize(uint32_t _typeId, uint32_t _matrixStride = 0) const
+			{
+				const Type* type = GetType(_typeId);
+				if (!type)
+				{
+					return 0;
+				}
+
+				switch (type->op_)
+				{
+				case spirv::OP_TYPE_BOOL:
+					return 4;
+				case spirv::OP_TYPE_INT:
+				case spirv::OP_TYPE_FLOAT:
+					return type->operands_[0] / 8;
+				case spirv::OP_TYPE_VECTOR:
+					return type->operands_[1] * GetSize(type->operands_[0]);
+				case spirv::OP_TYPE_MATRIX:
+					return type->operands_[1] * (_matrixStride ? _matrixStride : GetSize(type->operands_[0]));
+				case spirv::OP_TYPE_ARRAY:
+				{
+					const auto length = constants_.find(type->operands_[1]);
+					const uint32_t stride = GetDecoration(_typeId, spirv::ARRAY_STRIDE).value_or(GetSize(type->operands_[0], _matrixStride));
+					return (length != constants_.end()) ? length->second * stride : 0;
+				}
+				case spirv::OP_TYPE_STRUCT:
+				{
+					uint32_t size = 0;
+					for (uint32_t i = 0; i < type->operands_.size(); i++)
+					{
+						const uint32_t offset = GetMemberDecoration(_typeId, i, spirv::OFFSET).value_or(size);
+						size = std::max(size, offset + GetSize(type->operands_[i], GetMemberDecoration(_typeId, i, spirv::MATRIX_STRIDE).value_or(0)));
+					}
+					return size;
+				}
+				}
+
+				return 0;
+			}
+		};
+
+		std::string ReadString(const uint32_t* _words, size_t _numWords)
+		{
+			const char* characters = (const char*)_words;
+			return std::string(characters, strnlen(characters, _numWords * sizeof(uint32_t)));
+		}
+
+		// operands Parse reads of each instruction it looks at
+		uint32_t GetMinOperands(uint16_t _op)
+		{
+			switch (_op)
+			{
+			case spirv::OP_NAME:
+			case spirv::OP_TYPE_BOOL:
+			case spirv::OP_TYPE_STRUCT:
+			case spirv::OP_FUNCTION:
+				return 1;
+			case spirv::OP_ENTRY_POINT:
+			case spirv::OP_DECORATE:
+			case spirv::OP_MEMBER_NAME:
+			case spirv::OP_TYPE_FLOAT:
+			case spirv::OP_TYPE_RUNTIME_ARRAY:
+			case spirv::OP_TYPE_SAMPLED_IMAGE:
+			case spirv::OP_STORE:
+			case spirv::OP_COPY_MEMORY:
+				return 2;
+			case spirv::OP_MEMBER_DECORATE:
+			case spirv::OP_TYPE_INT:
+			case spirv::OP_TYPE_VECTOR:
+			case spirv::OP_TYPE_MATRIX:
+			case spirv::OP_TYPE_ARRAY:
+			case spirv::OP_TYPE_POINTER:
+			case spirv::OP_CONSTANT:
+			case spirv::OP_FUNCTION_CALL:
+			case spirv::OP_VARIABLE:
+			case spirv::OP_LOAD:
+			case spirv::OP_IMAGE_TEXEL_POINTER:
+			case spirv::OP_ACCESS_CHAIN:
+			case spirv::OP_IN_BOUNDS_ACCESS_CHAIN:
+			case spirv::OP_PTR_ACCESS_CHAIN:
+			case spirv::OP_ARRAY_LENGTH:
+				return 3;
+			case spirv::OP_TYPE_IMAGE:
+				return 8;
+			}
+
+			return 0;
+		}
+
+		bool Parse(const std::vector<uint32_t>& _words, Module& _outModule)
+		{
+			if (_words.size() < spirv::headerSize || _words[0] != spirv::magic)
+			{
+				return false;
+			}
+
+			bool insideFunction = false;
+			bool foundEntryPoint = false;
+			for (size_t position = spirv::headerSize; position < _words.size();)
+			{
+				const uint16_t op = (uint16_t)(_words[position] & 0xffff);
+				const uint32_t numWords = _words[position] >> 16;
+				if (numWords == 0 || position + numWords > _words.size())
+				{
+					return false;
+				}
+
+				const uint32_t* operands = _words.data() + position + 1;
+				const uint32_t numOperands = numWords - 1;
+				position += numWords;
+
+				if (numOperands < GetMinOperands(op))
+				{
+					return false;
+				}
+
+				switch (op)
+				{
+				case spirv::OP_NAME:
+					_outModule.names_[operands[0]] = ReadString(operands + 1, numOperands - 1);
+					break;
+				case spirv::OP_MEMBER_NAME:
+					_outModule.memberNames_[operands[0]][operands[1]] = ReadString(operands + 2, numOperands - 2);
+					break;
+				case spirv::OP_ENTRY_POINT:
+					// a module with several entry points reflects as its first one
+					if (!foundEntryPoint)
+					{
+						foundEntryPoint = true;
+						_outModule.vertex_ = (operands[0] == spirv::VERTEX);
+						_outModule.stage_ = (operands[0] == spirv::VERTEX) ? ShaderStage::VERTEX : (operands[0] == spirv::FRAGMENT) ? ShaderStage::PIXEL : ShaderStage{};
+					}
+					break;
+				case spirv::OP_DECORATE:
+					_outModule.decorations_[operands[0]][operands[1]] = (numOperands > 2) ? operands[2] : 0;
+					break;
+				case spirv::OP_MEMBER_DECORATE:
+					_outModule.memberDecorations_[operands[0]][operands[1]][operands[2]] = (numOperands > 3) ? operands[3] : 0;
+					break;
+				case spirv::OP_TYPE_BOOL:
+				case spirv::OP_TYPE_INT:
+				case spirv::OP_TYPE_FLOAT:
+				case spirv::OP_TYPE_VECTOR:
+				case spirv::OP_TYPE_MATRIX:
+				case spirv::OP_TYPE_IMAGE:
+				case spirv::OP_TYPE_SAMPLED_IMAGE:
+				case spirv::OP_TYPE_ARRAY:
+				case spirv::OP_TYPE_RUNTIME_ARRAY:
+				case spirv::OP_TYPE_STRUCT:
+				case spirv::OP_TYPE_POINTER:
+					_outModule.types_[operands[0]] = { op, std::vector<uint32_t>(operands + 1, operands + numOperands) };
+					break;
+				case spirv::OP_CONSTANT:
+					_outModule.constants_[operands[1]] = operands[2];
+					break;
+				case spirv::OP_FUNCTION:
+					insideFunction = true;
+					break;
+				case spirv::OP_VARIABLE:
+					if (!insideFunction)
+					{
+						const Type* pointer = _outModule.GetType(operands[0]);
+						_outModule.variables_.push_back({ operands[1], (pointer && pointer->op_ == spirv::OP_TYPE_POINTER) ? pointer->operands_[1] : 0, operands[2] });
+					}
+					break;
+				case spirv::OP_LOAD:
+				case spirv::OP_IMAGE_TEXEL_POINTER:
+				case spirv::OP_ACCESS_CHAIN:
+				case spirv::OP_IN_BOUNDS_ACCESS_CHAIN:
+				case spirv::OP_PTR_ACCESS_CHAIN:
+				case spirv::OP_ARRAY_LENGTH:
+					_outModule.usedIds_.insert(operands[2]);
+					break;
+				case spirv::OP_STORE:
+				case spirv::OP_COPY_MEMORY:
+					_outModule.usedIds_.insert(operands[0]);
+					_outModule.usedIds_.insert(operands[1]);
+					break;
+				case spirv::OP_FUNCTION_CALL:
+					_outModule.usedIds_.insert(operands + 3, operands + numOperands);
+					break;
+				}
+			}
+
+			return true;
+		}
+
+		ShaderStage Combine(ShaderStage _lhs, ShaderStage _rhs)
+		{
+			return (ShaderStage)((uint8_t)_lhs | (uint8_t)_rhs);
+		}
+	}
+
+	utility::ByteBuffer::Layout ShaderReflection::UniformBlock::CreateLayout() const
+	{
+		utility::ByteBuffer::Layout layout;
+		for (const Member& member : members_)
+		{
+			layout.AddAttribute(member.size_, member.offset_);
+		}
+		return layout;
+	}
+
+	bool ShaderReflection::Reflect(std::span<const std::byte> _code)
+	{
+		// copied since nothing guarantees _code is word aligned
+		std::vector<uint32_t> words(_code.size() / sizeof(uint32_t));
+		memcpy(words.data(), _code.data(), words.size() * sizeof(uint32_t));
+
+		Module module;
+		if (!Parse(words, module))
+		{
+			return false;
+		}
+
+		for (const Variable& variable : module.variables_)
+		{
+			const Type* type = module.GetType(variable.type_);
+			if (!type)
+			{
+				continue;
+			}
+
+			const std::string name = module.GetName(variable.id_);
+			const bool used = module.usedIds_.contains(variable.id_);
+
+			if (variable.storageClass_ == spirv::INPUT)
+			{
+				const std::optional<uint32_t> location = module.GetDecoration(variable.id_, spirv::LOCATION);
+				if (!module.vertex_ || !location || FindVertexInput(*location))
+				{
+					continue;
+				}
+
+				const Type* componentType = (type->op_ == spirv::OP_TYPE_VECTOR) ? module.GetType(type->operands_[0]) : type;
+				if (!componentType || (componentType->op_ != spirv::OP_TYPE_FLOAT && componentType->op_ != spirv::OP_TYPE_INT))
+				{
+					std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Reflection - vertex input " + name + " has a type vertex buffers cannot feed") << std::endl;
+					continue;
+				}
+
+				VertexInput input;
+				input.name_ = name;
+				input.location_ = *location;
+				input.componentType_ = (componentType->op_ == spirv::OP_TYPE_FLOAT) ? ComponentType::FLOAT : componentType->operands_[1] ? ComponentType::INT : ComponentType::UINT;
+				input.numComponents_ = (type->op_ == spirv::OP_TYPE_VECTOR) ? type->operands_[1] : 1;
+				vertexInputs_.push_back(input);
+				continue;
+			}
+
+			if (variable.storageClass_ == spirv::PUSH_CONSTANT)
+			{
+				if (type->op_ != spirv::OP_TYPE_STRUCT || type->operands_.empty())
+				{
+					continue;
+				}
+
+				uint32_t offset = std::numeric_limits<uint32_t>::max();
+				for (uint32_t i = 0; i < type->operands_.size(); i++)
+				{
+					offset = std::min(offset, module.GetMemberDecoration(variable.type_, i, spirv::OFFSET).value_or(0));
+				}
+
+				const uint32_t size = module.GetSize(variable.type_) - offset;
+				const auto range = std::find_if(pushConstantRanges_.begin(), pushConstantRanges_.end(), [&](const PushConstantRange& _range) { return _range.offset_ == offset && _range.size_ == size; });
+				if (range != pushConstantRanges_.end())
+				{
+					range->stages_ = Combine(range->stages_, module.stage_);
+				}
+				else
+				{
+					pushConstantRanges_.push_back({ module.stage_, offset, size });
+				}
+				continue;
+			}
+
+			if (variable.storageClass_ != spirv::UNIFORM && variable.storageClass_ != spirv::UNIFORM_CONSTANT)
+			{
+				continue;
+			}
+
+			Binding binding;
+			binding.set_ = module.GetDecoration(variable.id_, spirv::DESCRIPTOR_SET).value_or(0);
+			binding.binding_ = module.GetDecoration(variable.id_, spirv::BINDING).value_or(0);
+			binding.stages_ = module.stage_;
+			binding.used_ = used;
+
+			// arrays of resources take one descriptor per element
+			uint32_t elementTypeId = variable.type_;
+			const Type* elementType = type;
+			while (elementType && elementType->op_ == spirv::OP_TYPE_ARRAY)
+			{
+				const auto length = module.constants_.find(elementType->operands_[1]);
+				binding.numElements_ *= (length != module.constants_.end()) ? length->second : 1;
+				elementTypeId = elementType->operands_[0];
+				elementType = module.GetType(elementTypeId);
+			}
+
+			if (!elementType)
+			{
+				continue;
+			}
+
+			const Type* imageType = (elementType->op_ == spirv::OP_TYPE_SAMPLED_IMAGE) ? module.GetType(elementType->operands_[0]) : nullptr;
+			if (variable.storageClass_ == spirv::UNIFORM && elementType->op_ == spirv::OP_TYPE_STRUCT && module.GetDecoration(elementTypeId, spirv::BLOCK))
+			{
+				binding.type_ = ShaderBinding::Type::UNIFORM_BUFFER;
+				binding.name_ = module.GetName(elementTypeId);
+			}
+			else if (imageType && imageType->operands_[1] == spirv::dim2D)
+			{
+				binding.type_ = ShaderBinding::Type::TEXTURE_2D;
+				binding.name_ = name;
+			}
+			else
+			{
+				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Reflection - " + name + " is a kind of binding the engine cannot bind, it is left out") << std::endl;
+				continue;
+			}
+
+			const auto existing = std::find_if(bindings_.begin(), bindings_.end(), [&](const Binding& _binding) { return _binding.set_ == binding.set_ && _binding.binding_ == binding.binding_; });
+			if (existing != bindings_.end())
+			{
+				if (existing->type_ != binding.type_ || existing->numElements_ != binding.numElements_)
+				{
+					std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Reflection - stages disagree on set " + std::to_string(binding.set_) + " binding " + std::to_string(binding.binding_)) << std::endl;
+				}
+
+				existing->stages_ = Combine(existing->stages_, binding.stages_);
+				existing->used_ = existing->used_ || binding.used_;
+				continue;
+			}
+
+			bindings_.push_back(binding);
+
+			if (binding.type_ == ShaderBinding::Type::UNIFORM_BUFFER)
+			{
+				UniformBlock block;
+				block.name_ = binding.name_;
+				block.set_ = binding.set_;
+				block.binding_ = binding.binding_;
+				block.size_ = module.GetSize(elementTypeId);
+
+				const Type* blockType = module.GetType(elementTypeId);
+				for (uint32_t i = 0; i < blockType->operands_.size(); i++)
+				{
+					Member member;
+					member.name_ = module.GetMemberName(elementTypeId, i);
+					member.offset_ = module.GetMemberDecoration(elementTypeId, i, spirv::OFFSET).value_or(0);
+					member.size_ = module.GetSize(blockType->operands_[i], module.GetMemberDecoration(elementTypeId, i, spirv::MATRIX_STRIDE).value_or(0));
+					block.members_.push_back(member);
+				}
+
+				std::sort(block.members_.begin(), block.members_.end(), [](const Member& _lhs, const Member& _rhs) { return _lhs.offset_ < _rhs.offset_; });
+				uniformBlocks_.push_back(block);
+			}
+		}
+
+		return true;
+	}
+
+	const std::vector<ShaderReflection::Binding>& ShaderReflection::GetBindings() const
+	{
+		return bindings_;
+	}
+
+	const std::vector<ShaderReflection::UniformBlock>& ShaderReflection::GetUniformBlocks() const
+	{
+		return uniformBlocks_;
+	}
+
+	const std::vector<ShaderReflection::VertexInput>& ShaderReflection::GetVertexInputs() const
+	{
+		return vertexInputs_;
+	}
+
+	const std::vector<ShaderReflection::PushConstantRange>& ShaderReflection::GetPushConstantRanges() const
+	{
+		return pushConstantRanges_;
+	}
+
+	const ShaderReflection::Binding* ShaderReflection::FindBinding(uint32_t _set, uint32_t _binding) const
+	{
+		const auto binding = std::find_if(bindings_.begin(), bindings_.end(), [&](const Binding& _candidate) { return _candidate.set_ == _set && _candidate.binding_ == _binding; });
+		return (binding != bindings_.end()) ? &*binding : nullptr;
+	}
+
+	const ShaderReflection::UniformBlock* ShaderReflection::FindUniformBlock(std::string_view _name) const
+	{
+		const auto block = std::find_if(uniformBlocks_.begin(), uniformBlocks_.end(), [&](const UniformBlock& _candidate) { return _candidate.name_ == _name; });
+		return (block != uniformBlocks_.end()) ? &*block : nullptr;
+	}
+
+	const ShaderReflection::VertexInput* ShaderReflection::FindVertexInput(uint32_t _location) const
+	{
+		const auto input = std::find_if(vertexInputs_.begin(), vertexInputs_.end(), [&](const VertexInput& _candidate) { return _candidate.location_ == _location; });
+		return (input != vertexInputs_.end()) ? &*input : nullptr;
+	}
+
+	std::vector<ShaderDescriptor::Binding> ShaderReflection::CreateBindings(uint32_t _set) const
+	{
+		std::vector<ShaderDescriptor::Binding> bindings;
+		for (const Binding& binding : bindings_)
+		{
+			if (binding.set_ != _set)
+			{
+				continue;
+			}
+
+			ShaderDescriptor::Binding descriptorBinding;
+			descriptorBinding.type_ = binding.type_;
+			descriptorBinding.numElements_ = binding.numElements_;
+			descriptorBinding.slot_ = binding.binding_;
+			descriptorBinding.stage_ = binding.stages_;
+			descriptorBinding.name_ = binding.name_;
+			descriptorBinding.used_ = binding.used_;
+			bindings.push_back(descriptorBinding);
+		}
+
+		std::sort(bindings.begin(), bindings.end(), [](const ShaderDescriptor::Binding& _lhs, const ShaderDescriptor::Binding& _rhs) { return _lhs.slot_ < _rhs.slot_; });
+		return bindings;
+	}
+
+	utility::ByteBuffer::Layout ShaderReflection::CreateVertexInputLayout() const
+	{
+		std::vector<VertexInput> inputs = vertexInputs_;
+		std::sort(inputs.begin(), inputs.end(), [](const VertexInput& _lhs, const VertexInput& _rhs) { return _lhs.location_ < _rhs.location_; });
+
+		utility::ByteBuffer::Layout layout;
+		for (const VertexInput& input : inputs)
+		{
+			layout.AddAttribute(input.numComponents_ * sizeof(uint32_t));
+		}
+		return layout;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include "shader.h"
+#include "utility/byte_buffer.h"
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace graphics
+{
+	// reads descriptor bindings, push constants, vertex inputs and uniform block layouts out of spir-v,
+	// reflecting several stages into one instance merges them the way a pipeline sees them
+	class ShaderReflection
+	{
+	public:
+		enum class ComponentType
+		{
+			FLOAT,
+			INT,
+			UINT,
+		};
+
+		struct VertexInput
+		{
+			std::string name_;
+			uint32_t location_ = 0;
+			ComponentType componentType_ = ComponentType::FLOAT;
+			uint32_t numComponents_ = 0;
+		};
+
+		struct Binding
+		{
+			std::string name_; // block name for uniform buffers, variable name otherwise
+			uint32_t set_ = 0;
+			uint32_t binding_ = 0;
+			ShaderBinding::Type type_{};
+			uint32_t numElements_ = 1;
+			ShaderStage stages_{};
+			bool used_ = false; // read by some function rather than only declared
+		};
+
+		struct Member
+		{
+			std::string name_;
+			uint32_t offset_ = 0;
+			uint32_t size_ = 0;
+		};
+
+		struct UniformBlock
+		{
+			std::string name_;
+			uint32_t set_ = 0;
+			uint32_t binding_ = 0;
+			uint32_t size_ = 0;
+			std::vector<Member> members_;
+
+			// one attribute per member at the offsets the shader reads them from
+			utility::ByteBuffer::Layout CreateLayout() const;
+		};
+
+		struct PushConstantRange
+		{
+			ShaderStage stages_{};
+			uint32_t offset_ = 0;
+			uint32_t size_ = 0;
+		};
+
+	private:
+		std::vector<Binding> bindings_;
+		std::vector<UniformBlock> uniformBlocks_;
+		std::vector<VertexInput> vertexInputs_;
+		std::vector<PushConstantRange> pushConstantRanges_;
+
+	public:
+		// false when _code is not spir-v, the stage comes from the entry point
+		bool Reflect(std::span<const std::byte> _code);
+
+		const std::vector<Binding>& GetBindings() const;
+		const std::vector<UniformBlock>& GetUniformBlocks() const;
+		const std::vector<VertexInput>& GetVertexInputs() const;
+		const std::vector<PushConstantRange>& GetPushConstantRanges() const;
+
+		const Binding* FindBinding(uint32_t _set, uint32_t _binding) const;
+		const UniformBlock* FindUniformBlock(std::string_view _name) const;
+		const VertexInput* FindVertexInput(uint32_t _location) const;
+
+		// bindings of _set with their binding numbers as slots
+		std::vector<ShaderDescriptor::Binding> CreateBindings(uint32_t _set) const;
+		// vertex inputs packed in location order
+		utility::ByteBuffer::Layout CreateVertexInputLayout() const;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "utility/forward_declaration.h"
+
+namespace graphics
+{
+	// resource the residency manager may shrink when memory runs short and bring back once it is drawn again, sizes are in bytes
+	class Streamable
+	{
+		friend class ResidencyManager;
+
+	private:
+		std::atomic<uint64_t> lastUsedFrame_ = 0;
+
+	public:
+		virtual ~Streamable() = default;
+
+	public:
+		virtual size_t GetDeviceMemory() const = 0;
+		// kept on the host only to bring the resource back or shrink it cheaply, resources streaming from a cache keep none
+		virtual size_t GetHostMemory() const { return 0; }
+		virtual bool IsEvicted() const = 0;
+		// false while the last upload may still be on its way to the device, such resources are not evicted
+		virtual bool IsUploaded() { return true; }
+		// true when its memory sits in a mostly empty block, evicting and restoring it moves it to a fuller one
+		virtual bool IsInSparseMemory() { return false; }
+
+		// shrinks the resource down to a fallback, returns false when it could not be brought back and was left alone
+		virtual bool Evict() = 0;
+		virtual void Restore() = 0;
+		// the resource stays resident but can no longer be evicted
+		virtual void ReleaseHostMemory() {}
+	};
+}
\ No newline at end of file
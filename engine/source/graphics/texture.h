@@ -1,12 +1,13 @@
 #pragma once
 #include "shader.h"
-#include "file/image.h"
+#include "streamable.h"
+#include "file/block_compressor.h"
 #include <optional>
 #include <string_view>
 
 namespace graphics
 {
-	class Texture : public ShaderBinding
+	class Texture : public ShaderBinding, public Streamable
 	{
 	public:
 		enum class InitializationType
@@ -15,14 +16,29 @@ namespace graphics
 			BUFFER,
 		};
 
+		// picks the size cap out of GraphicsAPI::Config::TextureLimits
+		enum class Category
+		{
+			GENERIC,
+			COLOR,
+			NORMAL,
+			DATA,
+			TC_MAX
+		};
+
 		struct Layout
 		{
 			ImageFormat format_ = ImageFormat::R8G8B8A8_UNORM;
 			uint32_t size_ = 0;
 			uint32_t numElements_ = 1;
 			InitializationType initializationType_ = InitializationType::FILE;
-			std::string_view imagePath_;
+			std::string_view imagePath_; // a cooked .ctex is loaded as is
 			std::optional<file::Image> buffer_;
+			bool generateMips_ = true; // builds the chain on the cpu when the image carries a single level
+			bool srgb_ = false; // filters color channels of the chain in linear space
+			bool useCache_ = true; // keeps the prepared image in a .ctex next to the source
+			Category category_ = Category::GENERIC;
+			file::BlockCompressor::Quality compressionQuality_ = file::BlockCompressor::Quality::NORMAL; // used when format_ is a bc format
 		};
 
 	public:
@@ -11,7 +11,7 @@ namespace graphics
 		{
 			uint32_t size_ = 0;
 			uint32_t numElements_ = 1;
-			bool persistentMapping_ = false;
+			bool persistentMapping_ = false; // the vulkan backend keeps all host visible memory mapped regardless
 		};
 
 	public:
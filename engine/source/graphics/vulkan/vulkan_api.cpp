@@ -2,6 +2,10 @@
 #include "vulkan_result.hpp"
 #include "vulkan_utility.h"
 #include "vulkan_pipeline.h"
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_memory_allocator.h"
+#include "vulkan_staging_ring.h"
+#include "vulkan_descriptor_allocator.h"
 #include "vulkan_render_target.h"
 #include "vulkan_mesh.h"
 #include "vulkan_material.h"
@@ -27,9 +31,13 @@ namespace graphics
 		CreateInstance();
 		SelectPhysicalDevice(_window);
 		CreateLogicalDevice();
+		memoryAllocator_ = std::make_unique<VulkanMemoryAllocator>(logicalDevice_, physicalDevice_);
+		residencyManager_.SetReleaseMemory([memoryAllocator = memoryAllocator_.get()]() { memoryAllocator->ReleaseEmptyBlocks(); });
+		stagingRing_ = std::make_unique<VulkanStagingRing>(logicalDevice_, *memoryAllocator_, GetGraphicsQueue(), logicalDevice_.get_queue_index(vkb::QueueType::graphics).value(), config_.stagingBufferSize_);
+		pipelineCache_ = std::make_unique<VulkanPipelineCache>(logicalDevice_, physicalDevice_, config_.pipelineCachePath_);
 		CreateSwapchain();
 		CreateCommandPools();
-		CreateDescriptorPool();
+		descriptorAllocator_ = std::make_unique<VulkanDescriptorAllocator>(logicalDevice_, config_.numFrameConcurrency_, config_.numDescriptorSetsPerPage_, config_.numMaxDescriptorSetsPerPage_);
 		CreateSwapchainRenderTargets();
 		CreateSyncObjects();
 	}
@@ -48,8 +56,12 @@ namespace graphics
 			//vkFreeCommandBuffers(logicalDevice_, commandPool_, 1, &frame.commandBuffer_);
 		}
 
-		vkDestroyDescriptorPool(logicalDevice_, descriptorPool_, nullptr);
-		vkDestroyCommandPool(logicalDevice_, transferCommandPool_, nullptr);
+		pipelineCache_.reset();
+		stagingRing_.reset();
+		residencyManager_.SetReleaseMemory(nullptr);
+		memoryAllocator_.reset();
+		descriptorAllocator_.reset();
+		VulkanMaterial::DestroyDescriptorSetLayout(logicalDevice_);
 		vkDestroyCommandPool(logicalDevice_, commandPool_, nullptr);
 
 		vkb::destroy_swapchain(swapchain_);
@@ -65,26 +77,28 @@ namespace graphics
 
 	std::shared_ptr<Pipeline> VulkanAPI::CreatePipeline(const Pipeline::Layout& _pipelineLayout)
 	{
-		return std::make_shared<VulkanPipeline>(logicalDevice_, physicalDevice_, _pipelineLayout);
+		return std::make_shared<VulkanPipeline>(logicalDevice_, *memoryAllocator_, *descriptorAllocator_, *pipelineCache_, _pipelineLayout);
 	}
 
 	std::shared_ptr<Mesh> VulkanAPI::CreateMesh(const Mesh::Layout& _meshLayout)
 	{
-		return std::make_shared<VulkanMesh>(logicalDevice_, physicalDevice_, *logicalDevice_.get_queue(vkb::QueueType::transfer), transferCommandPool_,  _meshLayout);
+		auto mesh = std::make_shared<VulkanMesh>(logicalDevice_, *memoryAllocator_, *stagingRing_, _meshLayout);
+		residencyManager_.Register(mesh);
+		return mesh;
 	}
 
 	std::shared_ptr<Material> VulkanAPI::CreateMaterial()
 	{
 		VulkanMaterial::Initializer initializer{};
 		initializer.logicalDevice_ = logicalDevice_;
-		initializer.descriptorPool_ = CreateDescriptorPool(VulkanMaterial::GetDescriptorSetLayoutBindings());
+		initializer.descriptorAllocator_ = descriptorAllocator_.get();
 
 		return std::make_shared<VulkanMaterial>(std::move(initializer));
 	}
 
 	std::shared_ptr<UniformBuffer> VulkanAPI::CreateUniformBuffer(const UniformBuffer::Layout& _layout)
 	{
-		return std::make_shared<VulkanUniformBuffer>(logicalDevice_, physicalDevice_, _layout);
+		return std::make_shared<VulkanUniformBuffer>(logicalDevice_, *memoryAllocator_, _layout);
 	}
 
 	std::shared_ptr<Texture> VulkanAPI::CreateTexture(const Texture::Layout& _textureLayout)
@@ -92,10 +106,14 @@ namespace graphics
 		VulkanTexture::Initializer initializer{};
 		initializer.logicalDevice_ = logicalDevice_;
 		initializer.physicalDevice_ = physicalDevice_;
-		initializer.graphicsQueue_ = *logicalDevice_.get_queue(vkb::QueueType::graphics);
-		initializer.commandPool_ = commandPool_;
-
-		return std::make_shared<VulkanTexture>(initializer, _textureLayout);
+		initializer.memoryAllocator_ = memoryAllocator_.get();
+		initializer.stagingRing_ = stagingRing_.get();
+		initializer.maxSize_ = config_.textureLimits_.maxSizes_[(size_t)_textureLayout.category_];
+		initializer.memoryBudget_ = config_.textureLimits_.memoryBudget_;
+
+		auto texture = std::make_shared<VulkanTexture>(initializer, _textureLayout);
+		residencyManager_.Register(texture);
+		return texture;
 	}
 
 	std::shared_ptr<RenderPass> VulkanAPI::CreateRenderPass()
@@ -146,17 +164,19 @@ namespace graphics
 		return commandBuffer;
 	}
 
-	VkDescriptorSet VulkanAPI::AllocateDescriptorSet(VkDescriptorSetLayout _descriptorSetLayout) const
+	VulkanMemoryAllocator& VulkanAPI::GetMemoryAllocator() const
+	{
+		return *memoryAllocator_;
+	}
+
+	VulkanStagingRing& VulkanAPI::GetStagingRing() const
+	{
+		return *stagingRing_;
+	}
+
+	VulkanDescriptorAllocator& VulkanAPI::GetDescriptorAllocator() const
 	{
-		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-		VkDescriptorSetAllocateInfo descriptorSetAllocateInfo{};
-		descriptorSetAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		descriptorSetAllocateInfo.descriptorPool = descriptorPool_;
-		descriptorSetAllocateInfo.descriptorSetCount = 1;
-		descriptorSetAllocateInfo.pSetLayouts = &_descriptorSetLayout;
-		vkAllocateDescriptorSets(logicalDevice_, &descriptorSetAllocateInfo, &descriptorSet) >> VulkanResultChecker::Get();
-
-		return descriptorSet;
+		return *descriptorAllocator_;
 	}
 
 	bool VulkanAPI::WaitSwapchainImage()
@@ -172,6 +192,7 @@ namespace graphics
 		}
 
 		vkResetFences(logicalDevice_, 1, &currentFrame.frameFence_) >> VulkanResultChecker::Get();
+		descriptorAllocator_->BeginFrame(frameIndex_);
 		return true;
 	}
 
@@ -207,6 +228,7 @@ namespace graphics
 		vkb::InstanceBuilder builder;
 		builder.request_validation_layers();
 		builder.use_default_debug_messenger();
+		builder.require_api_version(1, 1, 0); // memory requirements 2 and dedicated allocations are core from 1.1
 		instance_ = Build(builder, &vkb::InstanceBuilder::build);
 	}
 
@@ -226,8 +248,14 @@ namespace graphics
 		vkb::PhysicalDeviceSelector deviceSelector(instance_);
 		deviceSelector.set_surface(surface);
 		deviceSelector.set_required_features(requiredFeatures);
+		deviceSelector.set_minimum_version(1, 1);
 		physicalDevice_ = Build(deviceSelector, &vkb::PhysicalDeviceSelector::select, vkb::DeviceSelectionMode::partially_and_fully_suitable);
 
+		// block compressed textures are used whenever the device can sample them
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures(physicalDevice_, &supportedFeatures);
+		physicalDevice_.features.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
 		VkPhysicalDeviceProperties properties{};
 		vkGetPhysicalDeviceProperties(physicalDevice_, &properties);
 	}
@@ -257,31 +285,8 @@ namespace graphics
 		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 		commandPoolCreateInfo.queueFamilyIndex = logicalDevice_.get_queue_index(vkb::QueueType::graphics).value();
 		vkCreateCommandPool(logicalDevice_, &commandPoolCreateInfo, nullptr, &commandPool_) >> VulkanResultChecker::Get();
-
-		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-		commandPoolCreateInfo.queueFamilyIndex = logicalDevice_.get_queue_index(vkb::QueueType::transfer).value();
-		vkCreateCommandPool(logicalDevice_, &commandPoolCreateInfo, nullptr, &transferCommandPool_) >> VulkanResultChecker::Get();
 	}
 
-    void VulkanAPI::CreateDescriptorPool()
-    {
-		std::vector<VkDescriptorPoolSize> poolSizes;
-		VkDescriptorPoolSize poolSize{};
-		poolSize.type = VkDescriptorType::VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSize.descriptorCount = config_.numMaxSamplers_;
-		poolSizes.push_back(poolSize);
-		poolSize.type = VkDescriptorType::VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSize.descriptorCount = config_.numMaxUBuffers_;
-		poolSizes.push_back(poolSize);
-
-		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
-		descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		descriptorPoolCreateInfo.maxSets = config_.numMaxDescriptorSets_;
-		descriptorPoolCreateInfo.poolSizeCount = (uint32_t)poolSizes.size();
-		descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
-		vkCreateDescriptorPool(logicalDevice_, &descriptorPoolCreateInfo, nullptr, &descriptorPool_);
-    }
-
 	void VulkanAPI::CreateSyncObjects()
 	{
 		VkSemaphoreCreateInfo semaphoreCreateInfo{};
@@ -326,48 +331,4 @@ namespace graphics
 		CreateSwapchain();
 		CreateSwapchainRenderTargets();
 	}
-
-	VkDescriptorPool VulkanAPI::CreateDescriptorPool(const std::vector<VkDescriptorSetLayoutBinding>& _bindings) const
-	{
-		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
-		std::vector<VkDescriptorPoolSize> poolSizes;
-
-		uint32_t numSamplers = 0;
-		uint32_t numUniformBuffers = 0;
-
-		for (const auto& binding : _bindings)
-		{
-			if (binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-			{
-				numSamplers++;
-			}
-			else if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-			{
-				numUniformBuffers++;
-			}
-		}
-
-		VkDescriptorPoolSize poolSize{};
-		poolSize.type = VkDescriptorType::VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSize.descriptorCount = numSamplers;
-		if (poolSize.descriptorCount != 0)
-		{
-			poolSizes.push_back(poolSize);
-		}
-		poolSize.type = VkDescriptorType::VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSize.descriptorCount = numUniformBuffers;
-		if (poolSize.descriptorCount != 0)
-		{
-			poolSizes.push_back(poolSize);
-		}
-
-		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
-		descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		descriptorPoolCreateInfo.maxSets = 1;
-		descriptorPoolCreateInfo.poolSizeCount = (uint32_t)poolSizes.size();
-		descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
-
-		vkCreateDescriptorPool(logicalDevice_, &descriptorPoolCreateInfo, nullptr, &descriptorPool);
-		return descriptorPool;
-	}
 }
@@ -23,8 +23,10 @@ namespace graphics
 		vkb::Device logicalDevice_;
 		vkb::Swapchain swapchain_;
 		VkCommandPool commandPool_;
-		VkCommandPool transferCommandPool_;
-		VkDescriptorPool descriptorPool_;
+		std::unique_ptr<VulkanMemoryAllocator> memoryAllocator_;
+		std::unique_ptr<VulkanStagingRing> stagingRing_;
+		std::unique_ptr<VulkanDescriptorAllocator> descriptorAllocator_;
+		std::unique_ptr<VulkanPipelineCache> pipelineCache_;
 
 		std::vector<std::shared_ptr<VulkanRenderTarget>> swapchainRenderTargets_;
 		std::vector<Frame> frames_;
@@ -55,7 +57,9 @@ namespace graphics
 		VkSemaphore GetCommandExecutionSemaphore() const;
 		VkFence GetFrameFence() const;
 		VkCommandBuffer AllocateCommnadBuffer() const;
-		VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout _descriptorSetLayout) const;
+		VulkanMemoryAllocator& GetMemoryAllocator() const;
+		VulkanStagingRing& GetStagingRing() const;
+		VulkanDescriptorAllocator& GetDescriptorAllocator() const;
 
 	private:
 		void CreateInstance();
@@ -63,11 +67,8 @@ namespace graphics
 		void CreateLogicalDevice();
 		void CreateSwapchain();
 		void CreateCommandPools();
-		void CreateDescriptorPool();
 		void CreateSyncObjects();
 		void CreateSwapchainRenderTargets();
 		void RecreateSwapchain();
-
-		VkDescriptorPool CreateDescriptorPool(const std::vector<VkDescriptorSetLayoutBinding>& _bindings) const;
 	};
 }
\ No newline at end of file
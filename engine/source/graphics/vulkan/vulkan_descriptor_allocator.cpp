@@ -0,0 +1,228 @@
+#include "vulkan_descriptor_allocator.h"
+#include "vulkan_result.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace graphics
+{
+	VulkanDescriptorAllocator::VulkanDescriptorAllocator(VkDevice _logicalDevice, uint32_t _numFrameSlots, uint32_t _numSetsPerPage, uint32_t _numMaxSetsPerPage)
+		: logicalDevice_(_logicalDevice)
+		, numSetsPerPage_(std::max(_numSetsPerPage, 1u))
+		, numSetsPerFramePool_(std::max(_numSetsPerPage, 1u))
+		, numMaxSetsPerPage_(std::max(_numMaxSetsPerPage, _numSetsPerPage))
+	{
+		frameSlots_.resize(std::max(_numFrameSlots, 1u));
+	}
+
+	VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+	{
+		for (const Page& page : pages_)
+		{
+			vkDestroyDescriptorPool(logicalDevice_, page.pool_, nullptr);
+		}
+
+		for (FrameSlot& frameSlot : frameSlots_)
+		{
+			for (VkDescriptorPool pool : frameSlot.pools_)
+			{
+				vkDestroyDescriptorPool(logicalDevice_, pool, nullptr);
+			}
+		}
+	}
+
+	VkDescriptorSet VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout _layout)
+	{
+		std::lock_guard lock(mutex_);
+
+		auto freeSets = freeSets_.find(_layout);
+		if (freeSets != freeSets_.end() && !freeSets->second.empty())
+		{
+			const VkDescriptorSet descriptorSet = freeSets->second.back();
+			freeSets->second.pop_back();
+			return descriptorSet;
+		}
+
+		// newest pages are the largest and the likeliest to have room
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		for (auto page = pages_.rbegin(); page != pages_.rend(); page++)
+		{
+			if (!page->hasRoom_)
+			{
+				continue;
+			}
+
+			if (TryAllocate(page->pool_, _layout, descriptorSet))
+			{
+				page->numSets_++;
+				setPages_[descriptorSet] = page->pool_;
+				return descriptorSet;
+			}
+			page->hasRoom_ = false;
+		}
+
+		Page& page = pages_.emplace_back();
+		page.pool_ = CreatePool(numSetsPerPage_, true);
+		if (!TryAllocate(page.pool_, _layout, descriptorSet))
+		{
+			throw std::runtime_error("VulkanDescriptorAllocator::Allocate() : set does not fit an empty page");
+		}
+		page.numSets_++;
+		setPages_[descriptorSet] = page.pool_;
+		return descriptorSet;
+	}
+
+	void VulkanDescriptorAllocator::Free(VkDescriptorSetLayout _layout, VkDescriptorSet _descriptorSet)
+	{
+		if (_descriptorSet == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		std::lock_guard lock(mutex_);
+		frameSlots_[frameIndex_].freedSets_.emplace_back(_layout, _descriptorSet);
+	}
+
+	VkDescriptorSet VulkanDescriptorAllocator::AllocateFrameSet(VkDescriptorSetLayout _layout)
+	{
+		std::lock_guard lock(mutex_);
+
+		FrameSlot& frameSlot = frameSlots_[frameIndex_];
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		for (; frameSlot.currentPool_ < frameSlot.pools_.size(); frameSlot.currentPool_++)
+		{
+			if (TryAllocate(frameSlot.pools_[frameSlot.currentPool_], _layout, descriptorSet))
+			{
+				return descriptorSet;
+			}
+		}
+
+		frameSlot.pools_.push_back(CreatePool(numSetsPerFramePool_, false));
+		if (!TryAllocate(frameSlot.pools_.back(), _layout, descriptorSet))
+		{
+			throw std::runtime_error("VulkanDescriptorAllocator::AllocateFrameSet() : set does not fit an empty page");
+		}
+		return descriptorSet;
+	}
+
+	void VulkanDescriptorAllocator::BeginFrame(uint32_t _frameIndex)
+	{
+		std::lock_guard lock(mutex_);
+
+		frameIndex_ = _frameIndex % (uint32_t)frameSlots_.size();
+		FrameSlot& frameSlot = frameSlots_[frameIndex_];
+
+		for (VkDescriptorPool pool : frameSlot.pools_)
+		{
+			vkResetDescriptorPool(logicalDevice_, pool, 0) >> VulkanResultChecker::Get();
+		}
+		frameSlot.currentPool_ = 0;
+
+		for (const auto& [layout, descriptorSet] : frameSlot.freedSets_)
+		{
+			freeSets_[layout].push_back(descriptorSet);
+		}
+		frameSlot.freedSets_.clear();
+
+		for (VkDescriptorSet descriptorSet : frameSlot.releasedSets_)
+		{
+			FreeToPage(descriptorSet);
+		}
+		frameSlot.releasedSets_.clear();
+	}
+
+	void VulkanDescriptorAllocator::ReleaseLayout(VkDescriptorSetLayout _layout)
+	{
+		std::lock_guard lock(mutex_);
+
+		// the handle may come back for another layout, so sets still waiting on frames are kept apart from now on
+		for (FrameSlot& frameSlot : frameSlots_)
+		{
+			std::erase_if(frameSlot.freedSets_, [&frameSlot, _layout](const std::pair<VkDescriptorSetLayout, VkDescriptorSet>& _freed)
+				{
+					if (_freed.first != _layout)
+					{
+						return false;
+					}
+
+					frameSlot.releasedSets_.push_back(_freed.second);
+					return true;
+				});
+		}
+
+		auto freeSets = freeSets_.find(_layout);
+		if (freeSets != freeSets_.end())
+		{
+			for (VkDescriptorSet descriptorSet : freeSets->second)
+			{
+				FreeToPage(descriptorSet);
+			}
+			freeSets_.erase(freeSets);
+		}
+	}
+
+	VkDescriptorPool VulkanDescriptorAllocator::CreatePool(uint32_t& _numSets, bool _freeable)
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (VkDescriptorPoolSize poolSize : poolSizesPerSet)
+		{
+			poolSize.descriptorCount *= _numSets;
+			poolSizes.push_back(poolSize);
+		}
+
+		VkDescriptorPoolCreateInfo descriptorPoolCreateInfo{};
+		descriptorPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		descriptorPoolCreateInfo.flags = _freeable ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+		descriptorPoolCreateInfo.maxSets = _numSets;
+		descriptorPoolCreateInfo.poolSizeCount = (uint32_t)poolSizes.size();
+		descriptorPoolCreateInfo.pPoolSizes = poolSizes.data();
+
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		vkCreateDescriptorPool(logicalDevice_, &descriptorPoolCreateInfo, nullptr, &descriptorPool) >> VulkanResultChecker::Get();
+
+		// pools double so many sets still end up in a handful of them
+		_numSets = std::min(_numSets * 2, numMaxSetsPerPage_);
+		return descriptorPool;
+	}
+
+	void VulkanDescriptorAllocator::FreeToPage(VkDescriptorSet _descriptorSet)
+	{
+		auto page = setPages_.find(_descriptorSet);
+		if (page == setPages_.end())
+		{
+			return;
+		}
+
+		const VkDescriptorPool pool = page->second;
+		vkFreeDescriptorSets(logicalDevice_, pool, 1, &_descriptorSet) >> VulkanResultChecker::Get();
+		setPages_.erase(page);
+
+		auto owner = std::find_if(pages_.begin(), pages_.end(), [pool](const Page& _page) { return _page.pool_ == pool; });
+		owner->numSets_--;
+		owner->hasRoom_ = true;
+
+		// the newest page stays to take the next sets
+		if (owner->numSets_ == 0 && owner != pages_.end() - 1)
+		{
+			vkDestroyDescriptorPool(logicalDevice_, pool, nullptr);
+			pages_.erase(owner);
+		}
+	}
+
+	bool VulkanDescriptorAllocator::TryAllocate(VkDescriptorPool _pool, VkDescriptorSetLayout _layout, VkDescriptorSet& _outDescriptorSet) const
+	{
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = _pool;
+		allocateInfo.descriptorSetCount = 1;
+		allocateInfo.pSetLayouts = &_layout;
+
+		const VkResult result = vkAllocateDescriptorSets(logicalDevice_, &allocateInfo, &_outDescriptorSet);
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+		{
+			return false;
+		}
+
+		result >> VulkanResultChecker::Get();
+		return true;
+	}
+}
\ No newline at end of file
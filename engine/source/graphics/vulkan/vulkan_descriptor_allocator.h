@@ -0,0 +1,77 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace graphics
+{
+	// descriptor sets come from pools created in pages that grow as they fill up, freed sets are handed out again
+	// to the next allocation with the same layout, sets written every frame come from per frame pools reset as a whole
+	class VulkanDescriptorAllocator
+	{
+	private:
+		struct Page
+		{
+			VkDescriptorPool pool_ = VK_NULL_HANDLE;
+			uint32_t numSets_ = 0; // allocated from it, recycled ones included
+			bool hasRoom_ = true; // cleared once an allocation failed, set again when a set goes back
+		};
+
+		struct FrameSlot
+		{
+			std::vector<VkDescriptorPool> pools_;
+			size_t currentPool_ = 0;
+			std::vector<std::pair<VkDescriptorSetLayout, VkDescriptorSet>> freedSets_; // reusable once the slot comes around again
+			std::vector<VkDescriptorSet> releasedSets_; // of layouts destroyed since, returned to their page instead
+		};
+
+		// descriptors of each type a page holds per set, sets needing more simply leave a page earlier
+		static constexpr VkDescriptorPoolSize poolSizesPerSet[] =
+		{
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		};
+
+	private:
+		VkDevice logicalDevice_ = VK_NULL_HANDLE;
+		uint32_t numSetsPerPage_ = 0; // size of the next page
+		uint32_t numSetsPerFramePool_ = 0; // size of the next frame pool, grown apart from the pages
+		uint32_t numMaxSetsPerPage_ = 0;
+
+		std::mutex mutex_;
+		std::vector<Page> pages_; // sets of destroyed layouts go back to theirs, pages left empty that way are destroyed
+		std::unordered_map<VkDescriptorSet, VkDescriptorPool> setPages_;
+		std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeSets_;
+		std::vector<FrameSlot> frameSlots_;
+		uint32_t frameIndex_ = 0;
+
+	public:
+		// pages start at _numSetsPerPage sets and double up to _numMaxSetsPerPage, _numFrameSlots is the number of frames in flight
+		VulkanDescriptorAllocator(VkDevice _logicalDevice, uint32_t _numFrameSlots, uint32_t _numSetsPerPage, uint32_t _numMaxSetsPerPage);
+		~VulkanDescriptorAllocator();
+
+		VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+		VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+	public:
+		VkDescriptorSet Allocate(VkDescriptorSetLayout _layout);
+		// frames still in flight may bind _descriptorSet, it is handed out again once they are done
+		void Free(VkDescriptorSetLayout _layout, VkDescriptorSet _descriptorSet);
+		// valid until the same frame slot begins again, nothing to free
+		VkDescriptorSet AllocateFrameSet(VkDescriptorSetLayout _layout);
+
+		// called once the slot's previous frame finished on the device
+		void BeginFrame(uint32_t _frameIndex);
+		// sets of a layout about to be destroyed can no longer be written, freed ones go back to their page
+		// once no frame in flight binds them, sets still allocated with it have to be freed as well
+		void ReleaseLayout(VkDescriptorSetLayout _layout);
+
+	private:
+		// _freeable pages give single sets back, frame pools are only ever reset, _numSets doubles for the next one
+		VkDescriptorPool CreatePool(uint32_t& _numSets, bool _freeable);
+		void FreeToPage(VkDescriptorSet _descriptorSet);
+		// false when the pool ran out of room
+		bool TryAllocate(VkDescriptorPool _pool, VkDescriptorSetLayout _layout, VkDescriptorSet& _outDescriptorSet) const;
+	};
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "vulkan_material.h"
 #include "vulkan_utility.h"
 #include "vulkan_shader_binding.h"
+#include "vulkan_descriptor_allocator.h"
 #include "utility/log.h"
 
 namespace graphics
@@ -9,25 +10,20 @@ namespace graphics
 
 	VulkanMaterial::VulkanMaterial(Initializer _initializer)
 		: logicalDevice_(_initializer.logicalDevice_)
-		, descriptorPool_(_initializer.descriptorPool_)
+		, descriptorAllocator_(*_initializer.descriptorAllocator_)
 	{
 		if (descriptorSetLayout_ == VK_NULL_HANDLE)
 		{
 			descriptorSetLayout_ = CreateDescriptorSetLayout(logicalDevice_);
 		}
 
-		CreateDescriptorSet(_initializer.descriptorPool_);
+		CreateDescriptorSet();
 	}
 
 	VulkanMaterial::~VulkanMaterial()
 	{
-		if (descriptorSetLayout_ != VK_NULL_HANDLE)
-		{
-			vkDestroyDescriptorSetLayout(logicalDevice_, descriptorSetLayout_, nullptr);
-			descriptorSetLayout_ = VK_NULL_HANDLE;
-		}
-
-		vkDestroyDescriptorPool(logicalDevice_, descriptorPool_, nullptr);
+		// recycled for the next material once no frame in flight binds it
+		descriptorAllocator_.Free(descriptorSetLayout_, descriptorSet_);
 	}
 
 	std::vector<VkDescriptorSetLayoutBinding> VulkanMaterial::GetDescriptorSetLayoutBindings()
@@ -75,32 +71,39 @@ namespace graphics
 		return descriptorSetLayout;
 	}
 
+	void VulkanMaterial::DestroyDescriptorSetLayout(VkDevice _logicalDevice)
+	{
+		vkDestroyDescriptorSetLayout(_logicalDevice, descriptorSetLayout_, nullptr);
+		descriptorSetLayout_ = VK_NULL_HANDLE;
+	}
+
 	VkDescriptorSet VulkanMaterial::GetDescriptorSet() const
 	{
 		return descriptorSet_;
 	}
 
-	void VulkanMaterial::CreateDescriptorSet(VkDescriptorPool _descriptorPool)
+	void VulkanMaterial::CreateDescriptorSet()
 	{
-		VkDescriptorSetAllocateInfo allocateInfo{};
-		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocateInfo.descriptorPool = _descriptorPool;
-		allocateInfo.descriptorSetCount = 1;
-		allocateInfo.pSetLayouts = &descriptorSetLayout_;
-
-		vkAllocateDescriptorSets(logicalDevice_, &allocateInfo, &descriptorSet_);
+		descriptorSet_ = descriptorAllocator_.Allocate(descriptorSetLayout_);
 	}
 
 	void VulkanMaterial::UpdateDescriptorSet()
 	{
-		if (pendingCompilation_ == false)
+		if (IsCompiled())
 		{
 			using utility::Log;
 			std::cout << Log::Format(Log::Category::graphics, Log::Level::message, "Material - Tried to update descriptor set when there's no change") << std::endl;
 			return;
 		}
 
+		// frames in flight may bind the current set, once written it is swapped for a fresh one and recycled after them
+		if (written_)
+		{
+			VkDescriptorSet previousDescriptorSet = descriptorSet_;
+			CreateDescriptorSet();
+			descriptorAllocator_.Free(descriptorSetLayout_, previousDescriptorSet);
+		}
+
 		std::vector<VkWriteDescriptorSet> descriptorWrites;
 		for (uint32_t i = 0; i < fixedBindings_.size(); i++)
 		{
@@ -113,6 +116,8 @@ namespace graphics
 			write.descriptorCount = 1;
 			write.pTexelBufferView = nullptr;
 
+			// taken before the info so a texture replaced meanwhile is written again next time
+			compiledGenerations_[i] = fixedBindings_[i]->GetGeneration();
 			auto casted = std::static_pointer_cast<VulkanShaderBinding>(fixedBindings_[i]->GetBindingImpl());
 			casted->FillBindingInfo(write);
 
@@ -121,5 +126,6 @@ namespace graphics
 
 		vkUpdateDescriptorSets(logicalDevice_, (uint32_t)descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
 		pendingCompilation_ = false;
+		written_ = true;
 	}
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "graphics/material.h"
+#include "utility/forward_declaration.h"
 #include <vector>
 #include <vulkan/vulkan.h>
 
@@ -11,14 +12,15 @@ namespace graphics
 		struct Initializer
 		{
 			VkDevice logicalDevice_;
-			VkDescriptorPool descriptorPool_;
+			VulkanDescriptorAllocator* descriptorAllocator_ = nullptr;
 		};
 
 	private:
-		static VkDescriptorSetLayout descriptorSetLayout_;
+		static VkDescriptorSetLayout descriptorSetLayout_; // shared by every material, lives as long as the device
 		VkDevice logicalDevice_;
-		VkDescriptorSet descriptorSet_;
-		VkDescriptorPool descriptorPool_;
+		VulkanDescriptorAllocator& descriptorAllocator_;
+		VkDescriptorSet descriptorSet_ = VK_NULL_HANDLE;
+		bool written_ = false;
 
 	public:
 		VulkanMaterial(Initializer _initializer);
@@ -27,10 +29,12 @@ namespace graphics
 	public:
 		static std::vector< VkDescriptorSetLayoutBinding> GetDescriptorSetLayoutBindings();
 		static VkDescriptorSetLayout CreateDescriptorSetLayout(VkDevice _logicalDevice);
+		static void DestroyDescriptorSetLayout(VkDevice _logicalDevice);
 		VkDescriptorSet GetDescriptorSet() const;
+		// called before recording, the set returned by GetDescriptorSet() may change
 		void UpdateDescriptorSet();
 
 	private:
-		void CreateDescriptorSet(VkDescriptorPool _descriptorPool);
+		void CreateDescriptorSet();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "vulkan_memory_allocator.h"
+#include "vulkan_result.hpp"
+#include "utility/log.h"
+#include <algorithm>
+#include <limits>
+
+using utility::Log;
+
+namespace graphics
+{
+	namespace
+	{
+		constexpr VkDeviceSize smallHeapSize = 1ull << 30; // heaps up to this size get blocks of an eighth of the heap
+	}
+
+	VulkanMemoryAllocator::VulkanMemoryAllocator(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice)
+		: logicalDevice_(_logicalDevice)
+	{
+		vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memoryProperties_);
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+		bufferImageGranularity_ = std::max<VkDeviceSize>(1, properties.limits.bufferImageGranularity);
+		maxMemoryAllocationCount_ = properties.limits.maxMemoryAllocationCount;
+
+		const uint32_t numPoolsPerType = (bufferImageGranularity_ > 1) ? 2 : 1;
+		pools_.resize(memoryProperties_.memoryTypeCount * numPoolsPerType);
+		for (uint32_t i = 0; i < (uint32_t)pools_.size(); i++)
+		{
+			Pool& pool = pools_[i];
+			pool.memoryTypeIndex_ = i / numPoolsPerType;
+
+			const VkDeviceSize heapSize = memoryProperties_.memoryHeaps[memoryProperties_.memoryTypes[pool.memoryTypeIndex_].heapIndex].size;
+			pool.blockSize_ = (heapSize <= smallHeapSize) ? std::max<VkDeviceSize>(heapSize / 8, 1) : defaultBlockSize;
+		}
+	}
+
+	VulkanMemoryAllocator::~VulkanMemoryAllocator()
+	{
+		const Statistics statistics = GetStatistics();
+		if (statistics.numAllocations_ > 0)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Memory allocator - " + std::to_string(statistics.numAllocations_) + " allocations are still alive on destruction") << std::endl;
+		}
+
+		for (Pool& pool : pools_)
+		{
+			for (std::unique_ptr<Block>& block : pool.blocks_)
+			{
+				FreeDeviceMemory(block->memory_, block->mapped_);
+			}
+		}
+	}
+
+	VulkanMemoryAllocator::Allocation VulkanMemoryAllocator::AllocateForBuffer(VkBuffer _buffer, VkMemoryPropertyFlags _properties)
+	{
+		VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+		requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+		requirementsInfo.buffer = _buffer;
+
+		VkMemoryDedicatedRequirements dedicatedRequirements{};
+		dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 requirements{};
+		requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements.pNext = &dedicatedRequirements;
+		vkGetBufferMemoryRequirements2(logicalDevice_, &requirementsInfo, &requirements);
+
+		const bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+		Allocation allocation = Allocate(requirements.memoryRequirements, _properties, false, dedicated, _buffer, VK_NULL_HANDLE);
+		vkBindBufferMemory(logicalDevice_, _buffer, allocation.memory_, allocation.offset_) >> VulkanResultChecker::Get();
+		return allocation;
+	}
+
+	VulkanMemoryAllocator::Allocation VulkanMemoryAllocator::AllocateForImage(VkImage _image, VkMemoryPropertyFlags _properties)
+	{
+		VkImageMemoryRequirementsInfo2 requirementsInfo{};
+		requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+		requirementsInfo.image = _image;
+
+		VkMemoryDedicatedRequirements dedicatedRequirements{};
+		dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 requirements{};
+		requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		requirements.pNext = &dedicatedRequirements;
+		vkGetImageMemoryRequirements2(logicalDevice_, &requirementsInfo, &requirements);
+
+		// every image the backend creates uses optimal tiling
+		const bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+		Allocation allocation = Allocate(requirements.memoryRequirements, _properties, true, dedicated, VK_NULL_HANDLE, _image);
+		vkBindImageMemory(logicalDevice_, _image, allocation.memory_, allocation.offset_) >> VulkanResultChecker::Get();
+		return allocation;
+	}
+
+	void VulkanMemoryAllocator::Free(Allocation& _allocation)
+	{
+		if (!_allocation)
+		{
+			return;
+		}
+
+		std::lock_guard lock(mutex_);
+
+		if (_allocation.block_ == nullptr)
+		{
+			FreeDeviceMemory(_allocation.memory_, _allocation.mapped_);
+			numDedicatedAllocations_--;
+			dedicatedMemory_ -= _allocation.size_;
+		}
+		else
+		{
+			_allocation.block_->allocator_.Free(_allocation.range_);
+			if (_allocation.block_->allocator_.IsEmpty())
+			{
+				FreeEmptyBlocks(_allocation.block_->pool_, 1);
+			}
+		}
+
+		_allocation = Allocation{};
+	}
+
+	VulkanMemoryAllocator::Statistics VulkanMemoryAllocator::GetStatistics() const
+	{
+		std::lock_guard lock(mutex_);
+
+		Statistics statistics;
+		statistics.numDedicatedAllocations_ = numDedicatedAllocations_;
+		statistics.numAllocations_ = numDedicatedAllocations_;
+		statistics.dedicatedMemory_ = dedicatedMemory_;
+
+		for (const Pool& pool : pools_)
+		{
+			for (const std::unique_ptr<Block>& block : pool.blocks_)
+			{
+				statistics.numBlocks_++;
+				statistics.numAllocations_ += block->allocator_.GetNumAllocations();
+				statistics.blockMemory_ += block->allocator_.GetSize();
+				statistics.usedBlockMemory_ += block->allocator_.GetUsedSize();
+			}
+		}
+
+		return statistics;
+	}
+
+	bool VulkanMemoryAllocator::IsInSparseBlock(const Allocation& _allocation, float _maxBlockUsage) const
+	{
+		if (_allocation.block_ == nullptr)
+		{
+			return false;
+		}
+
+		std::lock_guard lock(mutex_);
+		const Block& block = *_allocation.block_;
+		if (pools_[block.pool_].blocks_.front().get() == &block)
+		{
+			return false;
+		}
+		return (float)block.allocator_.GetUsedSize() < (float)block.allocator_.GetSize() * _maxBlockUsage;
+	}
+
+	void VulkanMemoryAllocator::ReleaseEmptyBlocks()
+	{
+		std::lock_guard lock(mutex_);
+
+		for (uint32_t i = 0; i < (uint32_t)pools_.size(); i++)
+		{
+			FreeEmptyBlocks(i, 0);
+		}
+	}
+
+	VulkanMemoryAllocator::Allocation VulkanMemoryAllocator::Allocate(const VkMemoryRequirements& _requirements, VkMemoryPropertyFlags _properties, bool _optimalImage, bool _dedicated, VkBuffer _buffer, VkImage _image)
+	{
+		const uint32_t memoryTypeIndex = FindMemoryTypeIndex(_requirements.memoryTypeBits, _properties);
+		if (memoryTypeIndex == std::numeric_limits<uint32_t>::max())
+		{
+			throw std::runtime_error("VulkanMemoryAllocator::Allocate() : failed to find required memory type");
+		}
+
+		std::lock_guard lock(mutex_);
+
+		// anything above half a block would mostly waste the rest of it
+		const uint32_t pool = GetPoolIndex(memoryTypeIndex, _optimalImage);
+		Allocation allocation;
+		if (_dedicated || _requirements.size > pools_[pool].blockSize_ / 2 || !AllocateFromPool(pool, _requirements, allocation))
+		{
+			allocation = AllocateDedicated(_requirements.size, memoryTypeIndex, _buffer, _image);
+		}
+
+		return allocation;
+	}
+
+	VulkanMemoryAllocator::Allocation VulkanMemoryAllocator::AllocateDedicated(VkDeviceSize _size, uint32_t _memoryTypeIndex, VkBuffer _buffer, VkImage _image)
+	{
+		VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+		dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicatedInfo.buffer = _buffer;
+		dedicatedInfo.image = _image;
+
+		Allocation allocation;
+		AllocateDeviceMemory(_size, _memoryTypeIndex, &dedicatedInfo, allocation.memory_, allocation.mapped_) >> VulkanResultChecker::Get();
+		allocation.size_ = _size;
+
+		numDedicatedAllocations_++;
+		dedicatedMemory_ += _size;
+		return allocation;
+	}
+
+	bool VulkanMemoryAllocator::AllocateFromPool(uint32_t _pool, const VkMemoryRequirements& _requirements, Allocation& _outAllocation)
+	{
+		Pool& pool = pools_[_pool];
+
+		Block* block = nullptr;
+		std::optional<utility::TlsfAllocator::Allocation> range;
+		for (std::unique_ptr<Block>& candidate : pool.blocks_)
+		{
+			range = candidate->allocator_.Allocate(_requirements.size, _requirements.alignment);
+			if (range)
+			{
+				block = candidate.get();
+				break;
+			}
+		}
+
+		if (block == nullptr)
+		{
+			// halved down to the request when the device cannot spare a whole block
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			void* mapped = nullptr;
+			VkDeviceSize blockSize = pool.blockSize_;
+			while (AllocateDeviceMemory(blockSize, pool.memoryTypeIndex_, nullptr, memory, mapped) != VK_SUCCESS)
+			{
+				blockSize /= 2;
+				if (blockSize < _requirements.size)
+				{
+					return false;
+				}
+			}
+
+			pool.blocks_.push_back(std::make_unique<Block>(blockSize));
+			block = pool.blocks_.back().get();
+			block->memory_ = memory;
+			block->mapped_ = mapped;
+			block->pool_ = _pool;
+
+			range = block->allocator_.Allocate(_requirements.size, _requirements.alignment);
+			if (!range)
+			{
+				return false;
+			}
+		}
+
+		_outAllocation.memory_ = block->memory_;
+		_outAllocation.offset_ = range->offset_;
+		_outAllocation.size_ = range->size_;
+		_outAllocation.mapped_ = block->mapped_ ? (uint8_t*)block->mapped_ + range->offset_ : nullptr;
+		_outAllocation.block_ = block;
+		_outAllocation.range_ = *range;
+		return true;
+	}
+
+	uint32_t VulkanMemoryAllocator::FindMemoryTypeIndex(uint32_t _memoryTypeBits, VkMemoryPropertyFlags _properties) const
+	{
+		for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; i++)
+		{
+			if ((_memoryTypeBits & (1 << i)) && (memoryProperties_.memoryTypes[i].propertyFlags & _properties) == _properties)
+			{
+				return i;
+			}
+		}
+
+		return std::numeric_limits<uint32_t>::max();
+	}
+
+	uint32_t VulkanMemoryAllocator::GetPoolIndex(uint32_t _memoryTypeIndex, bool _optimalImage) const
+	{
+		if (bufferImageGranularity_ > 1)
+		{
+			return _memoryTypeIndex * 2 + (_optimalImage ? 1 : 0);
+		}
+
+		return _memoryTypeIndex;
+	}
+
+	VkResult VulkanMemoryAllocator::AllocateDeviceMemory(VkDeviceSize _size, uint32_t _memoryTypeIndex, const void* _next, VkDeviceMemory& _outMemory, void*& _outMapped)
+	{
+		if (numDeviceAllocations_ >= maxMemoryAllocationCount_)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Memory allocator - " + std::to_string(numDeviceAllocations_) + " device allocations reach the limit of the device") << std::endl;
+		}
+
+		VkMemoryAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocateInfo.pNext = _next;
+		allocateInfo.allocationSize = _size;
+		allocateInfo.memoryTypeIndex = _memoryTypeIndex;
+
+		const VkResult result = vkAllocateMemory(logicalDevice_, &allocateInfo, nullptr, &_outMemory);
+		if (result != VK_SUCCESS)
+		{
+			_outMemory = VK_NULL_HANDLE;
+			return result;
+		}
+
+		_outMapped = nullptr;
+		if (memoryProperties_.memoryTypes[_memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			vkMapMemory(logicalDevice_, _outMemory, 0, VK_WHOLE_SIZE, 0, &_outMapped) >> VulkanResultChecker::Get();
+		}
+
+		numDeviceAllocations_++;
+		return VK_SUCCESS;
+	}
+
+	void VulkanMemoryAllocator::FreeDeviceMemory(VkDeviceMemory _memory, void* _mapped)
+	{
+		if (_mapped)
+		{
+			vkUnmapMemory(logicalDevice_, _memory);
+		}
+
+		vkFreeMemory(logicalDevice_, _memory, nullptr);
+		numDeviceAllocations_--;
+	}
+
+	void VulkanMemoryAllocator::FreeEmptyBlocks(uint32_t _pool, size_t _numSpares)
+	{
+		std::vector<std::unique_ptr<Block>>& blocks = pools_[_pool].blocks_;
+
+		size_t numSpares = 0;
+		for (auto it = blocks.begin(); it != blocks.end();)
+		{
+			if (!(*it)->allocator_.IsEmpty() || numSpares++ < _numSpares)
+			{
+				++it;
+				continue;
+			}
+
+			FreeDeviceMemory((*it)->memory_, (*it)->mapped_);
+			it = blocks.erase(it);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+#include "utility/tlsf_allocator.h"
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace graphics
+{
+	// sub-allocates device memory out of large blocks per memory type so resources stop paying for a vkAllocateMemory each,
+	// huge resources and those the driver asks for get a dedicated allocation instead
+	class VulkanMemoryAllocator
+	{
+	private:
+		struct Block;
+
+	public:
+		struct Allocation
+		{
+			VkDeviceMemory memory_ = VK_NULL_HANDLE;
+			VkDeviceSize offset_ = 0;
+			VkDeviceSize size_ = 0;
+			void* mapped_ = nullptr; // host visible memory stays mapped as long as it lives
+			Block* block_ = nullptr; // null for dedicated allocations
+			utility::TlsfAllocator::Allocation range_;
+
+			explicit operator bool() const { return memory_ != VK_NULL_HANDLE; }
+		};
+
+		struct Statistics
+		{
+			uint32_t numBlocks_ = 0;
+			uint32_t numDedicatedAllocations_ = 0;
+			uint32_t numAllocations_ = 0; // sub-allocations and dedicated ones together
+			VkDeviceSize blockMemory_ = 0;
+			VkDeviceSize usedBlockMemory_ = 0;
+			VkDeviceSize dedicatedMemory_ = 0;
+		};
+
+		static constexpr VkDeviceSize defaultBlockSize = 64ull << 20;
+		static constexpr float sparseBlockUsage = 0.25f;
+
+	private:
+		struct Block
+		{
+			VkDeviceMemory memory_ = VK_NULL_HANDLE;
+			void* mapped_ = nullptr;
+			uint32_t pool_ = 0;
+			utility::TlsfAllocator allocator_;
+
+			Block(VkDeviceSize _size) : allocator_(_size) {}
+		};
+
+		// buffers and optimal images sharing a block would have to keep bufferImageGranularity apart,
+		// devices that need that get separate pools for them instead
+		struct Pool
+		{
+			uint32_t memoryTypeIndex_ = 0;
+			VkDeviceSize blockSize_ = defaultBlockSize;
+			std::vector<std::unique_ptr<Block>> blocks_;
+		};
+
+	private:
+		VkDevice logicalDevice_ = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memoryProperties_{};
+		VkDeviceSize bufferImageGranularity_ = 1;
+		uint32_t maxMemoryAllocationCount_ = 0;
+
+		mutable std::mutex mutex_;
+		std::vector<Pool> pools_;
+		uint32_t numDeviceAllocations_ = 0;
+		uint32_t numDedicatedAllocations_ = 0;
+		VkDeviceSize dedicatedMemory_ = 0;
+
+	public:
+		VulkanMemoryAllocator(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice);
+		~VulkanMemoryAllocator();
+
+		VulkanMemoryAllocator(const VulkanMemoryAllocator&) = delete;
+		VulkanMemoryAllocator& operator=(const VulkanMemoryAllocator&) = delete;
+
+	public:
+		// allocates memory for the resource and binds it, throws when no memory type has _properties or the device is out of memory
+		Allocation AllocateForBuffer(VkBuffer _buffer, VkMemoryPropertyFlags _properties);
+		Allocation AllocateForImage(VkImage _image, VkMemoryPropertyFlags _properties);
+		void Free(Allocation& _allocation);
+
+		Statistics GetStatistics() const;
+
+		// defragmentation hooks, owners able to recreate their resource move it when it sits in a block used below _maxBlockUsage
+		// that an earlier block of its pool may take it from, new allocations fill the earliest blocks first,
+		// blocks emptied that way are released afterwards, otherwise one spare block per pool is kept to avoid churn
+		bool IsInSparseBlock(const Allocation& _allocation, float _maxBlockUsage = sparseBlockUsage) const;
+		void ReleaseEmptyBlocks();
+
+	private:
+		Allocation Allocate(const VkMemoryRequirements& _requirements, VkMemoryPropertyFlags _properties, bool _optimalImage, bool _dedicated, VkBuffer _buffer, VkImage _image);
+		Allocation AllocateDedicated(VkDeviceSize _size, uint32_t _memoryTypeIndex, VkBuffer _buffer, VkImage _image);
+		bool AllocateFromPool(uint32_t _pool, const VkMemoryRequirements& _requirements, Allocation& _outAllocation);
+		uint32_t FindMemoryTypeIndex(uint32_t _memoryTypeBits, VkMemoryPropertyFlags _properties) const;
+		uint32_t GetPoolIndex(uint32_t _memoryTypeIndex, bool _optimalImage) const;
+		VkResult AllocateDeviceMemory(VkDeviceSize _size, uint32_t _memoryTypeIndex, const void* _next, VkDeviceMemory& _outMemory, void*& _outMapped);
+		void FreeDeviceMemory(VkDeviceMemory _memory, void* _mapped);
+		// the first _numSpares empty blocks of the pool are kept
+		void FreeEmptyBlocks(uint32_t _pool, size_t _numSpares);
+	};
+}
\ No newline at end of file
@@ -1,26 +1,56 @@
 #include "vulkan_mesh.h"
 #include "vulkan_result.hpp"
 #include "vulkan_utility.h"
+#include "utility/log.h"
+#include <algorithm>
+#include <limits>
+
+using utility::Log;
 
 namespace graphics
 {
-	VulkanMesh::VulkanMesh(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkQueue _transferQueue, VkCommandPool _transferCommandPool, const Mesh::Layout& _meshLayout)
+	VulkanMesh::VulkanMesh(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VulkanStagingRing& _stagingRing, const Mesh::Layout& _meshLayout)
 		: logicalDevice_(_logicalDevice)
+		, memoryAllocator_(_memoryAllocator)
+		, stagingRing_(_stagingRing)
 	{
 		numVertices_ = (uint32_t)_meshLayout.vertices_.GetNumElements();
-		numIndices_ = (uint32_t)_meshLayout.indices_.size();
 
-		CreateVertexBuffer(logicalDevice_, _physicalDevice, _transferQueue, _transferCommandPool, _meshLayout.vertices_);
-		CreateIndexBuffer(logicalDevice_, _physicalDevice, _transferQueue, _transferCommandPool, _meshLayout.indices_);
+		lods_ = _meshLayout.lods_;
+		const bool lodsInRange = std::all_of(lods_.begin(), lods_.end(), [&_meshLayout](const Lod& _lod) { return (size_t)_lod.firstIndex_ + _lod.numIndices_ <= _meshLayout.indices_.size(); });
+		if (!lodsInRange)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "mesh level of detail exceeds the index buffer, drawing the whole buffer instead") << std::endl;
+		}
+		if (lods_.empty() || !lodsInRange)
+		{
+			lods_ = { Lod{ 0, (uint32_t)_meshLayout.indices_.size(), 0.0f } };
+		}
+		numIndices_ = lods_[0].numIndices_;
+
+		const bool fitsShortIndices = numVertices_ <= (uint32_t)std::numeric_limits<uint16_t>::max() + 1;
+		indexFormat_ = _meshLayout.indexFormat_;
+		if (indexFormat_ == IndexFormat::UINT16 && !fitsShortIndices)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "mesh has too many vertices for 16 bit indices, using 32 bit indices instead") << std::endl;
+			indexFormat_ = IndexFormat::UINT32;
+		}
+		else if (indexFormat_ == IndexFormat::NONE)
+		{
+			indexFormat_ = fitsShortIndices ? IndexFormat::UINT16 : IndexFormat::UINT32;
+		}
+
+		CreateBuffers(_meshLayout);
+
+		if (_meshLayout.evictable_)
+		{
+			hostCopy_ = _meshLayout;
+		}
 	}
 
 	VulkanMesh::~VulkanMesh()
 	{
-		vkDestroyBuffer(logicalDevice_, indexBuffer_, nullptr);
-		vkFreeMemory(logicalDevice_, indexBufferMemory_, nullptr);
-
-		vkDestroyBuffer(logicalDevice_, vertexBuffer_, nullptr);
-		vkFreeMemory(logicalDevice_, vertexBufferMemory_, nullptr);
+		DestroyBuffers();
 	}
 
 	VkBuffer VulkanMesh::GetVertexBuffer() const
@@ -33,53 +63,131 @@ namespace graphics
 		return indexBuffer_;
 	}
 
-	void VulkanMesh::CreateVertexBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkQueue _transferQueue, VkCommandPool _transferCommandPool,  const utility::ByteBuffer& _vertices)
+	VkIndexType VulkanMesh::GetIndexType() const
 	{
-		uint32_t vertexBufferSize = (uint32_t)_vertices.GetSizeInBytes();
+		return VulkanTypeConverter::Convert(indexFormat_);
+	}
 
-		VkBuffer vertexStagingBuffer;
-		VkDeviceMemory vertexStagingBufferMemory;
-		VkBufferUsageFlags vertexStagingUsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		VkMemoryPropertyFlags stagingMemoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		CreateBuffer(logicalDevice_, _physicalDevice, vertexStagingUsageFlags, stagingMemoryProperties, vertexBufferSize, vertexStagingBuffer, vertexStagingBufferMemory);
+	size_t VulkanMesh::GetDeviceMemory() const
+	{
+		return deviceMemory_;
+	}
 
-		void* data = nullptr;
-		vkMapMemory(logicalDevice_, vertexStagingBufferMemory, 0, vertexBufferSize, 0, &data) >> VulkanResultChecker::Get();
-		memcpy(data, _vertices.GetRawBufferAddress(), vertexBufferSize);
-		vkUnmapMemory(logicalDevice_, vertexStagingBufferMemory);
+	size_t VulkanMesh::GetHostMemory() const
+	{
+		return hostCopy_ ? hostCopy_->vertices_.GetSizeInBytes() + hostCopy_->indices_.size() * sizeof(uint32_t) : 0;
+	}
 
-		VkBufferUsageFlags vertexBufferUsageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		VkMemoryPropertyFlags vertexBufferMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-		CreateBuffer(logicalDevice_, _physicalDevice, vertexBufferUsageFlags, vertexBufferMemoryProperties, vertexBufferSize, vertexBuffer_, vertexBufferMemory_);
+	bool VulkanMesh::IsEvicted() const
+	{
+		return evicted_;
+	}
+
+	bool VulkanMesh::IsUploaded()
+	{
+		return stagingRing_.IsComplete(uploadSerial_);
+	}
+
+	bool VulkanMesh::IsInSparseMemory()
+	{
+		// only meshes with a host copy can be brought back elsewhere
+		return hostCopy_ && (memoryAllocator_.IsInSparseBlock(vertexBufferMemory_) || memoryAllocator_.IsInSparseBlock(indexBufferMemory_));
+	}
 
-		CopyBuffer(logicalDevice_, _transferQueue, _transferCommandPool, vertexStagingBuffer, vertexBuffer_, vertexBufferSize);
+	bool VulkanMesh::Evict()
+	{
+		if (!hostCopy_ || evicted_)
+		{
+			return false;
+		}
+
+		// the residency manager only evicts meshes no frame in flight still draws
+		DestroyBuffers();
+		evicted_ = true;
+		return true;
+	}
+
+	void VulkanMesh::Restore()
+	{
+		if (!evicted_)
+		{
+			return;
+		}
 
-		vkDestroyBuffer(logicalDevice_, vertexStagingBuffer, nullptr);
-		vkFreeMemory(logicalDevice_, vertexStagingBufferMemory, nullptr);
+		CreateBuffers(*hostCopy_);
+		evicted_ = false;
 	}
 
-	void VulkanMesh::CreateIndexBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkQueue _transferQueue, VkCommandPool _transferCommandPool, const std::vector<uint32_t>& _indices)
+	void VulkanMesh::ReleaseHostMemory()
 	{
-		uint32_t indexBufferSize = (uint32_t)_indices.size() * sizeof(uint32_t);
+		if (!evicted_)
+		{
+			hostCopy_.reset();
+		}
+	}
 
-		VkBuffer indexStagingBuffer;
-		VkDeviceMemory indexStagingBufferMemory;
-		VkBufferUsageFlags vertexStagingUsageFlags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		VkMemoryPropertyFlags stagingMemoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		CreateBuffer(logicalDevice_, _physicalDevice, vertexStagingUsageFlags, stagingMemoryProperties, indexBufferSize, indexStagingBuffer, indexStagingBufferMemory);
+	void VulkanMesh::CreateBuffers(const Mesh::Layout& _meshLayout)
+	{
+		const uint64_t vertexSerial = CreateVertexBuffer(_meshLayout.vertices_);
+		const uint64_t indexSerial = CreateIndexBuffer(_meshLayout.indices_, indexFormat_);
+		uploadSerial_ = std::max(vertexSerial, indexSerial);
 
-		void* data = nullptr;
-		vkMapMemory(logicalDevice_, indexStagingBufferMemory, 0, indexBufferSize, 0, &data) >> VulkanResultChecker::Get();
-		memcpy(data, _indices.data(), indexBufferSize);
-		vkUnmapMemory(logicalDevice_, indexStagingBufferMemory);
+		const size_t indexSize = (indexFormat_ == IndexFormat::UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+		deviceMemory_ = _meshLayout.vertices_.GetSizeInBytes() + _meshLayout.indices_.size() * indexSize;
+	}
 
-		VkBufferUsageFlags vertexBufferUsageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+	void VulkanMesh::DestroyBuffers()
+	{
+		// the buffers may still wait for their upload, they go once it is done
+		stagingRing_.Release([logicalDevice = logicalDevice_, &memoryAllocator = memoryAllocator_, indexBuffer = indexBuffer_, indexBufferMemory = indexBufferMemory_, vertexBuffer = vertexBuffer_, vertexBufferMemory = vertexBufferMemory_]() mutable
+			{
+				DestroyBuffer(logicalDevice, memoryAllocator, indexBuffer, indexBufferMemory);
+				DestroyBuffer(logicalDevice, memoryAllocator, vertexBuffer, vertexBufferMemory);
+			});
+
+		indexBuffer_ = VK_NULL_HANDLE;
+		indexBufferMemory_ = {};
+		vertexBuffer_ = VK_NULL_HANDLE;
+		vertexBufferMemory_ = {};
+		deviceMemory_ = 0;
+	}
+
+	uint64_t VulkanMesh::CreateVertexBuffer(const utility::ByteBuffer& _vertices)
+	{
+		uint32_t vertexBufferSize = (uint32_t)_vertices.GetSizeInBytes();
+
+		VkBufferUsageFlags vertexBufferUsageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 		VkMemoryPropertyFlags vertexBufferMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-		CreateBuffer(logicalDevice_, _physicalDevice, vertexBufferUsageFlags, vertexBufferMemoryProperties, indexBufferSize, indexBuffer_, indexBufferMemory_);
+		CreateBuffer(logicalDevice_, memoryAllocator_, vertexBufferUsageFlags, vertexBufferMemoryProperties, vertexBufferSize, vertexBuffer_, vertexBufferMemory_);
 
-		CopyBuffer(logicalDevice_, _transferQueue, _transferCommandPool, indexStagingBuffer, indexBuffer_, indexBufferSize);
+		// the copy goes out with the frame's uploads, ahead of the first draw that reads it
+		return stagingRing_.CopyToBuffer(vertexBuffer_, 0, _vertices.GetRawBufferAddress(), vertexBufferSize);
+	}
 
-		vkDestroyBuffer(logicalDevice_, indexStagingBuffer, nullptr);
-		vkFreeMemory(logicalDevice_, indexStagingBufferMemory, nullptr);
+	uint64_t VulkanMesh::CreateIndexBuffer(const std::vector<uint32_t>& _indices, IndexFormat _indexFormat)
+	{
+		const uint32_t indexSize = (_indexFormat == IndexFormat::UINT16) ? sizeof(uint16_t) : sizeof(uint32_t);
+		uint32_t indexBufferSize = (uint32_t)_indices.size() * indexSize;
+
+		VkBufferUsageFlags indexBufferUsageFlags = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+		VkMemoryPropertyFlags indexBufferMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		CreateBuffer(logicalDevice_, memoryAllocator_, indexBufferUsageFlags, indexBufferMemoryProperties, indexBufferSize, indexBuffer_, indexBufferMemory_);
+
+		return stagingRing_.CopyToBuffer(indexBuffer_, 0, indexBufferSize, [&_indices, _indexFormat, indexBufferSize](void* _staged)
+			{
+				if (_indexFormat == IndexFormat::UINT16)
+				{
+					// narrowed straight into the staging memory, no intermediate copy
+					uint16_t* narrowIndices = (uint16_t*)_staged;
+					for (size_t i = 0; i < _indices.size(); i++)
+					{
+						narrowIndices[i] = (uint16_t)_indices[i];
+					}
+				}
+				else
+				{
+					memcpy(_staged, _indices.data(), indexBufferSize);
+				}
+			});
 	}
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include "graphics/graphics_api.h"
+#include "vulkan_memory_allocator.h"
+#include "vulkan_staging_ring.h"
 #include <vulkan/vulkan.h>
+#include <optional>
 
 namespace graphics
 {
@@ -8,21 +11,39 @@ namespace graphics
 	{
 	private:
 		VkDevice logicalDevice_;
-		VkBuffer vertexBuffer_;
-		VkBuffer indexBuffer_;
-		VkDeviceMemory vertexBufferMemory_;
-		VkDeviceMemory indexBufferMemory_;
-		
+		VulkanMemoryAllocator& memoryAllocator_;
+		VulkanStagingRing& stagingRing_;
+		VkBuffer vertexBuffer_ = VK_NULL_HANDLE;
+		VkBuffer indexBuffer_ = VK_NULL_HANDLE;
+		VulkanMemoryAllocator::Allocation vertexBufferMemory_;
+		VulkanMemoryAllocator::Allocation indexBufferMemory_;
+		size_t deviceMemory_ = 0;
+		uint64_t uploadSerial_ = 0; // staging ring serial of the last buffer copies
+		std::optional<Mesh::Layout> hostCopy_; // only for evictable meshes
+		bool evicted_ = false;
+
 	public:
-		VulkanMesh(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkQueue _transferQueue, VkCommandPool _transferCommandPool,  const Mesh::Layout& _meshLayout);
+		VulkanMesh(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VulkanStagingRing& _stagingRing, const Mesh::Layout& _meshLayout);
 		~VulkanMesh();
 
 	public:
 		VkBuffer GetVertexBuffer() const;
 		VkBuffer GetIndexBuffer() const;
+		VkIndexType GetIndexType() const;
+
+		virtual size_t GetDeviceMemory() const override;
+		virtual size_t GetHostMemory() const override;
+		virtual bool IsEvicted() const override;
+		virtual bool IsUploaded() override;
+		virtual bool IsInSparseMemory() override;
+		virtual bool Evict() override;
+		virtual void Restore() override;
+		virtual void ReleaseHostMemory() override;
 
 	private:
-		void CreateVertexBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkQueue _transferQueue, VkCommandPool _transferCommandPool,  const utility::ByteBuffer& _vertices);
-		void CreateIndexBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkQueue _transferQueue, VkCommandPool _transferCommandPool, const std::vector<uint32_t>& _indices);
+		void CreateBuffers(const Mesh::Layout& _meshLayout);
+		void DestroyBuffers();
+		uint64_t CreateVertexBuffer(const utility::ByteBuffer& _vertices);
+		uint64_t CreateIndexBuffer(const std::vector<uint32_t>& _indices, IndexFormat _indexFormat);
 	};
 }
\ No newline at end of file
@@ -6,11 +6,15 @@
 #include "vulkan_texture.h"
 #include "vulkan_material.h"
 #include "vulkan_shader_binding.h"
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_descriptor_allocator.h"
 #include "file/explorer.h"
+#include "utility/timer.hpp"
+#include <algorithm>
 
 namespace graphics
 {
-	static VkShaderModule CreateShaderModule(VkDevice _logicalDevice, const std::vector<char>& _shaderCode)
+	static VkShaderModule CreateShaderModule(VkDevice _logicalDevice, std::span<const std::byte> _shaderCode)
 	{
 		VkShaderModuleCreateInfo shaderModuleCreateInfo{};
 		shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -23,18 +27,21 @@ namespace graphics
 		return shaderModule;
 	}
 
-	VulkanPipeline::VulkanPipeline(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const Pipeline::Layout& _pipelineLayout)
+	VulkanPipeline::VulkanPipeline(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VulkanDescriptorAllocator& _descriptorAllocator, VulkanPipelineCache& _pipelineCache, const Pipeline::Layout& _pipelineLayout)
 		: Pipeline(_pipelineLayout)
 		, logicalDevice_(_logicalDevice)
-		, physicalDevice_(_physicalDevice)
+		, memoryAllocator_(_memoryAllocator)
+		, descriptorAllocator_(_descriptorAllocator)
 		, useDepthStencil_(_pipelineLayout.depthFunc_ != ComparisonFunc::NONE)
 	{
 		LoadShaders(_pipelineLayout.vertexShaderPath_, _pipelineLayout.pixelShaderPath_);
-		CreateInstance(_physicalDevice, _pipelineLayout);
+		ApplyReflection();
+		CreateInstance(_pipelineCache, _pipelineLayout);
 	}
 
 	VulkanPipeline::~VulkanPipeline()
 	{
+		descriptorAllocator_.ReleaseLayout(descriptorSetLayout_);
 		vkDestroyDescriptorSetLayout(logicalDevice_, materialDescriptorSetLayout_, nullptr);
 		vkDestroyDescriptorSetLayout(logicalDevice_, descriptorSetLayout_, nullptr);
 		vkDestroyRenderPass(logicalDevice_, renderPass_, nullptr);
@@ -49,64 +56,37 @@ namespace graphics
 		renderTargetLayout.height_ = _height;
 		renderTargetLayout.attachments_ = shaderDescriptor_.outputs;
 
-		return std::make_shared<VulkanRenderTarget>(logicalDevice_, physicalDevice_, renderTargetLayout);
+		return std::make_shared<VulkanRenderTarget>(logicalDevice_, memoryAllocator_, renderTargetLayout);
 	}
 
-	bool VulkanPipeline::BindShaderBinding(std::shared_ptr<ShaderBinding> _shaderBinding, uint32_t _slot)
+	void VulkanPipeline::WriteDescriptorSet(VkDescriptorSet _descriptorSet) const
 	{
-		if (Pipeline::BindShaderBinding(_shaderBinding, _slot) == false)
-		{
-			return false;
-		}
-
-		pendingDescriptorSetUpdate_ = true;
-		return true;
-	}
-
-	bool VulkanPipeline::IsPendingDescriptorSetUpdate() const
-	{
-		return pendingDescriptorSetUpdate_;
-	}
-
-	void VulkanPipeline::UpdateDescriptorSet(const std::vector<VkDescriptorSet>& _descriptSets)
-	{
-		if (pendingDescriptorSetUpdate_ == false)
-		{
-			using utility::Log;
-			std::cout << Log::Format(Log::Category::graphics, Log::Level::message, "Pipeline - Tried to update descriptor set when there's no change") << std::endl;
-			return;
-		}
-
-		uint32_t materialBindingOffset = (uint32_t)Material::FixedBindingIndex::FB_MAX;
-
 		std::vector<VkWriteDescriptorSet> descriptorWrites;
-		for (VkDescriptorSet descriptorSet : _descriptSets)
+		for (uint32_t i = 0; i < shaderBindings_.size(); i++)
 		{
-			for (uint32_t i = 0; i < shaderBindings_.size(); i++)
+			// bindings the shaders never read are not in the layout
+			const ShaderDescriptor::Binding* binding = shaderDescriptor_.FindBinding(i);
+			if (!shaderBindings_[i] || !binding || !binding->used_)
 			{
-				if (!shaderBindings_[i])
-				{
-					continue;
-				}
+				continue;
+			}
 
-				VkWriteDescriptorSet write{};
-				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				write.pNext = nullptr;
-				write.dstSet = descriptorSet;
-				write.dstBinding = i + materialBindingOffset;
-				write.dstArrayElement = 0;
-				write.descriptorCount = 1;
-				write.pTexelBufferView = nullptr;
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.pNext = nullptr;
+			write.dstSet = _descriptorSet;
+			write.dstBinding = i;
+			write.dstArrayElement = 0;
+			write.descriptorCount = 1;
+			write.pTexelBufferView = nullptr;
 
-				auto casted = std::static_pointer_cast<VulkanShaderBinding>(shaderBindings_[i]->GetBindingImpl());
-				casted->FillBindingInfo(write);
+			auto casted = std::static_pointer_cast<VulkanShaderBinding>(shaderBindings_[i]->GetBindingImpl());
+			casted->FillBindingInfo(write);
 
-				descriptorWrites.push_back(write);
-			}
+			descriptorWrites.push_back(write);
 		}
 
 		vkUpdateDescriptorSets(logicalDevice_, (uint32_t)descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
-		pendingDescriptorSetUpdate_ = false;
 	}
 
 	VkPipeline VulkanPipeline::GetInstance() const
@@ -131,23 +111,61 @@ namespace graphics
 
 	void VulkanPipeline::LoadShaders(std::wstring_view _vsPath, std::wstring_view _fsPath)
 	{
-		auto vsCode = file::Explorer::LoadFile(_vsPath, true, true);
-		if (_vsPath.empty() != vsCode.empty())
+		// spir-v is consumed straight from the mapped pages, mapping is page aligned which satisfies pCode alignment
+		file::MappedFile vsCode = file::Explorer::MapFile(_vsPath);
+		if (_vsPath.empty() != vsCode.GetBytes().empty())
 		{
 			throw std::exception("vertex shader path specified but failed to load");
 		}
 
-		auto psCode = file::Explorer::LoadFile(_fsPath, true, true);
-		if (_fsPath.empty() != psCode.empty())
+		file::MappedFile psCode = file::Explorer::MapFile(_fsPath);
+		if (_fsPath.empty() != psCode.GetBytes().empty())
 		{
 			throw std::exception("vertex shader path specified but failed to load");
 		}
 
-		vertexShaderModule_ = CreateShaderModule(logicalDevice_, vsCode);
-		pixelShaderModule_ = CreateShaderModule(logicalDevice_, psCode);
+		if (!reflection_.Reflect(vsCode.GetBytes()) || !reflection_.Reflect(psCode.GetBytes()))
+		{
+			throw std::runtime_error("shader is not spir-v");
+		}
+
+		vertexShaderModule_ = CreateShaderModule(logicalDevice_, vsCode.GetBytes());
+		pixelShaderModule_ = CreateShaderModule(logicalDevice_, psCode.GetBytes());
+	}
+
+	void VulkanPipeline::ApplyReflection()
+	{
+		using utility::Log;
+
+		std::vector<ShaderDescriptor::Binding> reflectedBindings = reflection_.CreateBindings(pipelineDescriptorSet);
+
+		// bindings written by hand used to drift from the shaders silently
+		for (const ShaderDescriptor::Binding& binding : shaderDescriptor_.bindings_)
+		{
+			const auto reflected = std::find_if(reflectedBindings.begin(), reflectedBindings.end(), [&](const ShaderDescriptor::Binding& _reflected) { return _reflected.slot_ == binding.slot_; });
+			if (reflected == reflectedBindings.end())
+			{
+				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline - slot " + std::to_string(binding.slot_) + " is not declared by the shaders") << std::endl;
+			}
+			else if (reflected->type_ != binding.type_ || reflected->numElements_ != binding.numElements_ || reflected->stage_ != binding.stage_)
+			{
+				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline - slot " + std::to_string(binding.slot_) + " does not match the shaders, the reflected binding is used") << std::endl;
+			}
+		}
+
+		for (const ShaderReflection::Binding& binding : reflection_.GetBindings())
+		{
+			const bool fixedBinding = (binding.set_ == materialDescriptorSet && binding.binding_ < (uint32_t)Material::FixedBindingIndex::FB_MAX && binding.type_ == ShaderBinding::Type::TEXTURE_2D);
+			if (binding.set_ != pipelineDescriptorSet && !fixedBinding)
+			{
+				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline - " + binding.name_ + " at set " + std::to_string(binding.set_) + " binding " + std::to_string(binding.binding_) + " is provided by neither materials nor the pipeline") << std::endl;
+			}
+		}
+
+		shaderDescriptor_.bindings_ = std::move(reflectedBindings);
 	}
 
-	void VulkanPipeline::CreateInstance(VkPhysicalDevice _physicalDevice, const Pipeline::Layout& _pipelineLayout)
+	void VulkanPipeline::CreateInstance(VulkanPipelineCache& _pipelineCache, const Pipeline::Layout& _pipelineLayout)
 	{
 		// shader
 		VkPipelineShaderStageCreateInfo shaderStages[2] = {};
@@ -168,29 +186,46 @@ namespace graphics
 		}
 
 		// input description
+		// attribute i feeds location i, attributes the vertex shader never reads only count toward the stride
+		const utility::ByteBuffer::Layout vertexInputLayout = (_pipelineLayout.vertexInputLayout_.GetNumAttibutes() > 0) ? _pipelineLayout.vertexInputLayout_ : reflection_.CreateVertexInputLayout();
 		VkVertexInputBindingDescription bindingDescription{};
 		std::vector<VkVertexInputAttributeDescription> attributeDesctriptions;
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{};
 		{
+			using utility::Log;
+
 			bindingDescription.binding = 0;
-			bindingDescription.stride = (uint32_t)_pipelineLayout.vertexInputLayout_.GetSizeInBytes();
+			bindingDescription.stride = (uint32_t)vertexInputLayout.GetSizeInBytes();
 			bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-			for (size_t i = 0; i < _pipelineLayout.vertexInputLayout_.GetNumAttibutes(); i++)
+			for (size_t i = 0; i < vertexInputLayout.GetNumAttibutes(); i++)
 			{
+				const ShaderReflection::VertexInput* input = reflection_.FindVertexInput((uint32_t)i);
+				if (!input)
+				{
+					continue;
+				}
+
+				if (input->numComponents_ * sizeof(uint32_t) != vertexInputLayout.GetAttributeSize(i))
+				{
+					std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline - vertex input " + input->name_ + " does not match the size of its attribute") << std::endl;
+				}
+
 				VkVertexInputAttributeDescription attributeDesctription{};
 				attributeDesctription.binding = 0;
 				attributeDesctription.location = (uint32_t)i;
+				attributeDesctription.format = VulkanTypeConverter::Convert(input->componentType_, input->numComponents_);
+				attributeDesctription.offset = (uint32_t)vertexInputLayout.GetAttributeOffset(i);
+				attributeDesctriptions.push_back(attributeDesctription);
+			}
 
-				switch (_pipelineLayout.vertexInputLayout_.GetAttributeSize(i))
+			for (const ShaderReflection::VertexInput& input : reflection_.GetVertexInputs())
+			{
+				if (input.location_ >= vertexInputLayout.GetNumAttibutes())
 				{
-				case 8: attributeDesctription.format = VK_FORMAT_R32G32_SFLOAT; break;
-				case 12: attributeDesctription.format = VK_FORMAT_R32G32B32_SFLOAT; break;
+					std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline - vertex input " + input.name_ + " has no attribute in the vertex layout") << std::endl;
 				}
-
-				attributeDesctription.offset = (uint32_t)_pipelineLayout.vertexInputLayout_.GetAttributeOffset(i);
-				attributeDesctriptions.push_back(attributeDesctription);
 			}
 
 			vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -376,17 +411,19 @@ namespace graphics
 
 		// descriptor
 		{
-			std::vector<VkDescriptorSetLayoutBinding> mateerialDescriptorBindings = VulkanMaterial::GetDescriptorSetLayoutBindings();
-			uint32_t materialBindingOffset = (uint32_t)Material::FixedBindingIndex::FB_MAX;
-
 			std::vector<VkDescriptorSetLayoutBinding> descriptorBindings;
-			for (size_t i = 0; i < shaderDescriptor_.bindings_.size(); i++)
+			for (const ShaderDescriptor::Binding& descriptorBinding : shaderDescriptor_.bindings_)
 			{
+				if (!descriptorBinding.used_)
+				{
+					continue;
+				}
+
 				VkDescriptorSetLayoutBinding binding{};
-				binding.binding = (uint32_t)shaderDescriptor_.bindings_[i].slot_ + materialBindingOffset;
-				binding.descriptorCount = shaderDescriptor_.bindings_[i].numElements_;
-				binding.descriptorType = VulkanTypeConverter::Convert(shaderDescriptor_.bindings_[i].type_);
-				binding.stageFlags = VulkanTypeConverter::Convert(shaderDescriptor_.bindings_[i].stage_);
+				binding.binding = descriptorBinding.slot_;
+				binding.descriptorCount = descriptorBinding.numElements_;
+				binding.descriptorType = VulkanTypeConverter::Convert(descriptorBinding.type_);
+				binding.stageFlags = VulkanTypeConverter::Convert(descriptorBinding.stage_);
 				binding.pImmutableSamplers = nullptr;
 
 				descriptorBindings.push_back(binding);
@@ -409,12 +446,22 @@ namespace graphics
 				descriptorSetLayout_
 			};
 
+			std::vector<VkPushConstantRange> pushConstantRanges;
+			for (const ShaderReflection::PushConstantRange& range : reflection_.GetPushConstantRanges())
+			{
+				VkPushConstantRange pushConstantRange{};
+				pushConstantRange.stageFlags = VulkanTypeConverter::Convert(range.stages_);
+				pushConstantRange.offset = range.offset_;
+				pushConstantRange.size = range.size_;
+				pushConstantRanges.push_back(pushConstantRange);
+			}
+
 			VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
 			pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 			pipelineLayoutCreateInfo.setLayoutCount = 2;
 			pipelineLayoutCreateInfo.pSetLayouts = setLayouts;
-			pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-			pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+			pipelineLayoutCreateInfo.pushConstantRangeCount = (uint32_t)pushConstantRanges.size();
+			pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantRanges.data();
 			vkCreatePipelineLayout(logicalDevice_, &pipelineLayoutCreateInfo, nullptr, &layout_) >> VulkanResultChecker::Get();
 		}
 
@@ -437,7 +484,10 @@ namespace graphics
 			pipelineCreateInfo.subpass = 0;
 			pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 			pipelineCreateInfo.basePipelineIndex = -1;
-			vkCreateGraphicsPipelines(logicalDevice_, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &instance_) >> VulkanResultChecker::Get();
+
+			const utility::Timer<double, std::milli> timer;
+			vkCreateGraphicsPipelines(logicalDevice_, _pipelineCache.GetInstance(), 1, &pipelineCreateInfo, nullptr, &instance_) >> VulkanResultChecker::Get();
+			_pipelineCache.AddCreationTime(timer.Peek());
 		}
 		
 		vkDestroyShaderModule(logicalDevice_, vertexShaderModule_, nullptr);
@@ -9,7 +9,8 @@ namespace graphics
 	{
 	private:
 		VkDevice logicalDevice_;
-		VkPhysicalDevice physicalDevice_;
+		VulkanMemoryAllocator& memoryAllocator_;
+		VulkanDescriptorAllocator& descriptorAllocator_;
 		VkPipeline instance_;
 		VkShaderModule vertexShaderModule_;
 		VkShaderModule pixelShaderModule_;
@@ -20,18 +21,15 @@ namespace graphics
 		VkDescriptorSetLayout materialDescriptorSetLayout_;
 		VkDescriptorSetLayout descriptorSetLayout_;
 
-		bool pendingDescriptorSetUpdate_ = false;
-
 	public:
-		VulkanPipeline(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const Pipeline::Layout& _pipelineLayout);
+		VulkanPipeline(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VulkanDescriptorAllocator& _descriptorAllocator, VulkanPipelineCache& _pipelineCache, const Pipeline::Layout& _pipelineLayout);
 		~VulkanPipeline();
 
 	public:
 		virtual std::shared_ptr<RenderTarget> CreateRenderTarget(uint32_t _width, uint32_t _height) const override;
-		virtual bool BindShaderBinding(std::shared_ptr<ShaderBinding> _shaderBinding, uint32_t _slot) override;
 
-		bool IsPendingDescriptorSetUpdate() const;
-		void UpdateDescriptorSet(const std::vector<VkDescriptorSet>& _descriptSets);
+		// writes the bound shader bindings into a set allocated with GetDescriptorSetLayout()
+		void WriteDescriptorSet(VkDescriptorSet _descriptorSet) const;
 
 		VkPipeline GetInstance() const;
 		VkPipelineLayout GetLayout() const;
@@ -41,6 +39,7 @@ namespace graphics
 
 	private:
 		void LoadShaders(std::wstring_view _vsPath, std::wstring_view _fsPath);
-		void CreateInstance(VkPhysicalDevice _physicalDevice, const Pipeline::Layout& _pipelineLayout);
+		void ApplyReflection();
+		void CreateInstance(VulkanPipelineCache& _pipelineCache, const Pipeline::Layout& _pipelineLayout);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_result.hpp"
+#include "file/binary_file.h"
+#include "utility/hash.hpp"
+#include "utility/log.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using utility::Log;
+
+namespace graphics
+{
+	VulkanPipelineCache::VulkanPipelineCache(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const std::filesystem::path& _path)
+		: logicalDevice_(_logicalDevice)
+		, path_(_path)
+	{
+		vkGetPhysicalDeviceProperties(_physicalDevice, &properties_);
+
+		const std::vector<uint8_t> data = Load();
+
+		VkPipelineCacheCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+		vkCreatePipelineCache(logicalDevice_, &createInfo, nullptr, &instance_) >> VulkanResultChecker::Get();
+	}
+
+	VulkanPipelineCache::~VulkanPipelineCache()
+	{
+		Save();
+
+		if (numPipelines_ > 0)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::message, "Pipeline cache - " + std::to_string(numPipelines_) + " pipelines took " + std::to_string(GetCreationTime()) + " ms to create") << std::endl;
+		}
+
+		vkDestroyPipelineCache(logicalDevice_, instance_, nullptr);
+	}
+
+	VkPipelineCache VulkanPipelineCache::GetInstance() const
+	{
+		return instance_;
+	}
+
+	bool VulkanPipelineCache::Save() const
+	{
+		if (path_.empty())
+		{
+			return true;
+		}
+
+		size_t dataSize = 0;
+		if (vkGetPipelineCacheData(logicalDevice_, instance_, &dataSize, nullptr) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		std::vector<uint8_t> data(dataSize);
+		if (vkGetPipelineCacheData(logicalDevice_, instance_, &dataSize, data.data()) != VK_SUCCESS)
+		{
+			return false;
+		}
+		data.resize(dataSize);
+
+		FileHeader header;
+		header.magic_ = magic;
+		header.version_ = version;
+		header.driverVersion_ = properties_.driverVersion;
+		header.dataSize_ = data.size();
+		header.dataHash_ = utility::HashBytes(data.data(), data.size());
+
+		std::error_code error;
+		if (path_.has_parent_path())
+		{
+			std::filesystem::create_directories(path_.parent_path(), error);
+		}
+
+		return file::WriteAtomically(path_, [&header, &data](std::ostream& _stream)
+			{
+				_stream.write((const char*)&header, sizeof(header));
+				_stream.write((const char*)data.data(), data.size());
+				return true;
+			});
+	}
+
+	void VulkanPipelineCache::AddCreationTime(double _milliseconds)
+	{
+		numPipelines_++;
+		creationTime_ += (uint64_t)(_milliseconds * 1000.0);
+	}
+
+	uint32_t VulkanPipelineCache::GetNumPipelines() const
+	{
+		return numPipelines_;
+	}
+
+	double VulkanPipelineCache::GetCreationTime() const
+	{
+		return (double)creationTime_ / 1000.0;
+	}
+
+	std::vector<uint8_t> VulkanPipelineCache::Load() const
+	{
+		if (path_.empty())
+		{
+			return {};
+		}
+
+		std::ifstream stream(path_, std::ios::binary);
+		if (!stream)
+		{
+			return {};
+		}
+
+		std::error_code error;
+		const uintmax_t fileSize = std::filesystem::file_size(path_, error);
+
+		FileHeader header;
+		stream.read((char*)&header, sizeof(header));
+		if (!stream || error || header.magic_ != magic || header.version_ != version)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline cache - " + path_.string() + " is not a pipeline cache, starting empty") << std::endl;
+			return {};
+		}
+
+		if (header.dataSize_ != fileSize - sizeof(header))
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline cache - " + path_.string() + " is damaged, starting empty") << std::endl;
+			return {};
+		}
+
+		std::vector<uint8_t> data(header.dataSize_);
+		stream.read((char*)data.data(), data.size());
+		if (!stream || utility::HashBytes(data.data(), data.size()) != header.dataHash_)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "Pipeline cache - " + path_.string() + " is damaged, starting empty") << std::endl;
+			return {};
+		}
+
+		// drivers are not required to survive data from another device, so the header is checked here first
+		VkPipelineCacheHeaderVersionOne driverHeader{};
+		if (data.size() >= sizeof(driverHeader))
+		{
+			memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+		}
+
+		const bool compatible = data.size() >= sizeof(driverHeader) &&
+			driverHeader.headerSize >= sizeof(driverHeader) && driverHeader.headerSize <= data.size() &&
+			driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+			driverHeader.vendorID == properties_.vendorID &&
+			driverHeader.deviceID == properties_.deviceID &&
+			memcmp(driverHeader.pipelineCacheUUID, properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+			header.driverVersion_ == properties_.driverVersion;
+
+		if (!compatible)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::message, "Pipeline cache - written by another device or driver, starting empty") << std::endl;
+			return {};
+		}
+
+		return data;
+	}
+}
\ No newline at end of file
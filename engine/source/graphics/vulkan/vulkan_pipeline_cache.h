@@ -0,0 +1,57 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <filesystem>
+#include <vector>
+
+namespace graphics
+{
+	// device wide pipeline cache kept on disk between runs, data another device or driver wrote is dropped on load
+	class VulkanPipelineCache
+	{
+	private:
+		// ahead of the driver data, catches files cut short or written by an older engine
+		struct FileHeader
+		{
+			uint32_t magic_ = 0;
+			uint32_t version_ = 0;
+			uint32_t driverVersion_ = 0;
+			uint32_t reserved_ = 0;
+			uint64_t dataSize_ = 0;
+			uint64_t dataHash_ = 0;
+		};
+
+		static constexpr uint32_t magic = 0x43504c43; // "CLPC"
+		static constexpr uint32_t version = 1;
+
+	private:
+		VkDevice logicalDevice_ = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties properties_{};
+		VkPipelineCache instance_ = VK_NULL_HANDLE;
+		std::filesystem::path path_;
+		std::atomic<uint32_t> numPipelines_ = 0;
+		std::atomic<uint64_t> creationTime_ = 0; // microseconds
+
+	public:
+		// an empty _path keeps the cache in memory only
+		VulkanPipelineCache(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const std::filesystem::path& _path);
+		~VulkanPipelineCache();
+
+		VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+		VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+	public:
+		VkPipelineCache GetInstance() const;
+
+		// written to a temporary file first so a crash never leaves a torn cache behind, also done on destruction
+		bool Save() const;
+
+		// pipeline creation time is summed so warm and cold starts can be compared
+		void AddCreationTime(double _milliseconds);
+		uint32_t GetNumPipelines() const;
+		double GetCreationTime() const;
+
+	private:
+		std::vector<uint8_t> Load() const;
+	};
+}
\ No newline at end of file
@@ -3,6 +3,8 @@
 #include "vulkan_result.hpp"
 #include "vulkan_pipeline.h"
 #include "vulkan_render_target.h"
+#include "vulkan_staging_ring.h"
+#include "vulkan_descriptor_allocator.h"
 #include "vulkan_mesh.h"
 #include "vulkan_texture.h"
 #include "vulkan_material.h"
@@ -15,17 +17,13 @@ namespace graphics
 	void VulkanRenderPass::SetPipeline(std::shared_ptr<Pipeline> _pipeline, GraphicsAPI& _graphicsAPI)
 	{
 		commandBuffers_.clear();
-		descriptorSets_.clear();
 
 		pipeline_ = _pipeline;
 
 		auto& vulkanAPI = (VulkanAPI&)_graphicsAPI;
-		auto vulkanPipeline = std::static_pointer_cast<VulkanPipeline>(pipeline_);
-
 		for (uint32_t i = 0; i < _graphicsAPI.GetConfig().numFrameConcurrency_; i++)
 		{
 			commandBuffers_.push_back(vulkanAPI.AllocateCommnadBuffer());
-			descriptorSets_.push_back(vulkanAPI.AllocateDescriptorSet(vulkanPipeline->GetDescriptorSetLayout()));
 		}
 	}
 
@@ -44,7 +42,6 @@ namespace graphics
 
 		uint32_t frameIndex = _graphicsApi.GetCurrentFrameIndex();
 		VkCommandBuffer commandBuffer = commandBuffers_[frameIndex];
-		VkDescriptorSet descriptorSet = descriptorSets_[frameIndex];
 
 		auto& vulkanAPI = (VulkanAPI&)_graphicsApi;
 		auto vulkanPipeline = std::static_pointer_cast<VulkanPipeline>(pipeline_);
@@ -52,9 +49,26 @@ namespace graphics
 
 		VkExtent2D extent = vulkanAPI.GetSwapchainExtent();
 
-		if (vulkanPipeline->IsPendingDescriptorSetUpdate())
+		// written fresh every frame into a set from the frame's pool, no set a frame in flight binds is ever touched
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		if (pipeline_->GetNumBindings() > 0)
+		{
+			descriptorSet = vulkanAPI.GetDescriptorAllocator().AllocateFrameSet(vulkanPipeline->GetDescriptorSetLayout());
+			vulkanPipeline->WriteDescriptorSet(descriptorSet);
+		}
+
+		// evicted meshes are uploaded again and stale materials written before recording starts,
+		// evicted textures draw their fallback until streamed back
+		ResidencyManager& residencyManager = _graphicsApi.GetResidencyManager();
+		for (auto& drawable : drawables_)
 		{
-			vulkanPipeline->UpdateDescriptorSet(descriptorSets_);
+			residencyManager.Touch(drawable);
+
+			auto vulkanMaterial = std::static_pointer_cast<VulkanMaterial>(drawable.material_);
+			if (vulkanMaterial && vulkanMaterial->IsCompiled() == false)
+			{
+				vulkanMaterial->UpdateDescriptorSet();
+			}
 		}
 
 		VkCommandBufferBeginInfo commandBufferBeginInfo{};
@@ -96,16 +110,11 @@ namespace graphics
 			auto vulkanMesh = std::static_pointer_cast<VulkanMesh>(drawable.mesh_);
 			auto vulkanMaterial = std::static_pointer_cast<VulkanMaterial>(drawable.material_);
 
-			if (vulkanMaterial->IsCompiled() == false)
-			{
-				vulkanMaterial->UpdateDescriptorSet();
-			}
-
 			VkBuffer vertexBuffers[] = { vulkanMesh->GetVertexBuffer() };
 			VkDeviceSize offsets[] = { 0 };
 
 			vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(commandBuffer, vulkanMesh->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, vulkanMesh->GetIndexBuffer(), 0, vulkanMesh->GetIndexType());
 
 			if (pipeline_->GetNumBindings() > 0)
 			{
@@ -118,7 +127,8 @@ namespace graphics
 				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkanPipeline->GetLayout(), 0, 2, descriptorSets, 0, nullptr);
 			}
 
-			vkCmdDrawIndexed(commandBuffer, drawable.mesh_->GetNumIndices(), 1, 0, 0, 0);
+			const Mesh::Lod& lod = drawable.mesh_->GetLod(drawable.lod_);
+			vkCmdDrawIndexed(commandBuffer, lod.numIndices_, 1, lod.firstIndex_, 0, 0);
 		}
 
 		vkCmdEndRenderPass(commandBuffer);
@@ -137,6 +147,9 @@ namespace graphics
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
+
+		// uploads recorded since the last frame go first, queue order keeps them ahead of the draws
+		vulkanAPI.GetStagingRing().Submit();
 		vkQueueSubmit(vulkanAPI.GetGraphicsQueue(), 1, &submitInfo, vulkanAPI.GetFrameFence()) >> VulkanResultChecker::Get();
 	}
 }
\ No newline at end of file
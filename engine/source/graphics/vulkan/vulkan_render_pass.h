@@ -1,6 +1,7 @@
 #pragma once
 #include "graphics/render_pass.h"
 #include "vulkan/vulkan.h"
+#include "utility/forward_declaration.h"
 
 namespace graphics
 {
@@ -8,7 +9,6 @@ namespace graphics
 	{
 	private:
 		std::vector<VkCommandBuffer> commandBuffers_;
-		std::vector<VkDescriptorSet> descriptorSets_;
 		std::vector<Drawable> drawables_;
 
 		// for static command buffers
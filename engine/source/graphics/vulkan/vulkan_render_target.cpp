@@ -4,14 +4,15 @@
 
 namespace graphics
 {
-	VulkanRenderTarget::VulkanRenderTarget(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const RenderTarget::Layout& _renderTargetLayout)
+	VulkanRenderTarget::VulkanRenderTarget(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, const RenderTarget::Layout& _renderTargetLayout)
 		: logicalDevice_(_logicalDevice)
+		, memoryAllocator_(&_memoryAllocator)
 		, width_(_renderTargetLayout.width_)
 		, height_(_renderTargetLayout.height_)
 	{
 		for (const ShaderDescriptor::Output& attachmentDescription : _renderTargetLayout.attachments_)
 		{
-			AddAttachment(_physicalDevice, attachmentDescription);
+			AddAttachment(attachmentDescription);
 		}
 	}
 
@@ -36,17 +37,16 @@ namespace graphics
 
 			if (attachment.image_.has_value())
 			{
-				vkFreeMemory(logicalDevice_, *attachment.memory_, nullptr);
 				vkDestroyImage(logicalDevice_, *attachment.image_, nullptr);
+				memoryAllocator_->Free(*attachment.memory_);
 			}
 		}
 	}
 
-	void VulkanRenderTarget::AddAttachment(VkPhysicalDevice _physicalDevice, ShaderDescriptor::Output _description)
+	void VulkanRenderTarget::AddAttachment(ShaderDescriptor::Output _description)
 	{
 		VulkanAttachment attachment;
 		attachment.image_ = VK_NULL_HANDLE;
-		attachment.memory_ = VK_NULL_HANDLE;
 
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -62,14 +62,7 @@ namespace graphics
 		imageCreateInfo.usage = VulkanTypeConverter::Convert(_description.usage_);
 		vkCreateImage(logicalDevice_, &imageCreateInfo, nullptr, &*attachment.image_) >> VulkanResultChecker::Get();
 
-		VkMemoryRequirements memoryRequirements{};
-		vkGetImageMemoryRequirements(logicalDevice_, *attachment.image_, &memoryRequirements);
-		VkMemoryAllocateInfo memoryAllocateInfo{};
-		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		memoryAllocateInfo.allocationSize = memoryRequirements.size;
-		memoryAllocateInfo.memoryTypeIndex = FindMemoryTypeIndex(_physicalDevice, memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		vkAllocateMemory(logicalDevice_, &memoryAllocateInfo, nullptr, &*attachment.memory_);
-		vkBindImageMemory(logicalDevice_, *attachment.image_, *attachment.memory_, 0);
+		attachment.memory_ = memoryAllocator_->AllocateForImage(*attachment.image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 		VkImageViewCreateInfo imageViewCreateInfo{};
 		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
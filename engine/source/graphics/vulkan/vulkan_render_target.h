@@ -1,5 +1,6 @@
 #pragma once
 #include "graphics/graphics_api.h"
+#include "vulkan_memory_allocator.h"
 #include <vulkan/vulkan.h>
 #include <unordered_map>
 
@@ -9,25 +10,26 @@ namespace graphics
 	{
 		VkImageView imageView_;
 		std::optional<VkImage> image_;
-		std::optional<VkDeviceMemory> memory_;
+		std::optional<VulkanMemoryAllocator::Allocation> memory_;
 	};
 
 	class VulkanRenderTarget : public RenderTarget
 	{
 	private:
 		VkDevice logicalDevice_;
+		VulkanMemoryAllocator* memoryAllocator_ = nullptr; // null for swapchain targets, their images are not ours
 		uint32_t width_;
 		uint32_t height_;
 		std::vector <VulkanAttachment> attachments_;
 		std::unordered_map<VkRenderPass, VkFramebuffer> framebuffers_;
 
 	public:
-		VulkanRenderTarget(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const RenderTarget::Layout& _renderTargetLayout);
+		VulkanRenderTarget(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, const RenderTarget::Layout& _renderTargetLayout);
 		VulkanRenderTarget(VkDevice _logicalDevice, uint32_t _width, uint32_t _height, VkImageView _outputImageView);
 		~VulkanRenderTarget();
 
 	public:
-		void AddAttachment(VkPhysicalDevice _physicalDevice, ShaderDescriptor::Output _description);
+		void AddAttachment(ShaderDescriptor::Output _description);
 
 		uint32_t GetNumAttachments() const;
 		std::vector<VkImageView> GetImageViews() const;
@@ -0,0 +1,379 @@
+#include "vulkan_staging_ring.h"
+#include "vulkan_result.hpp"
+#include "vulkan_utility.h"
+#include <chrono>
+#include <cstring>
+
+namespace graphics
+{
+	VulkanStagingRing::VulkanStagingRing(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VkQueue _queue, uint32_t _queueFamilyIndex, VkDeviceSize _size)
+		: logicalDevice_(_logicalDevice)
+		, memoryAllocator_(_memoryAllocator)
+		, queue_(_queue)
+		, size_(_size)
+	{
+		VkCommandPoolCreateInfo commandPoolCreateInfo{};
+		commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		commandPoolCreateInfo.queueFamilyIndex = _queueFamilyIndex;
+		vkCreateCommandPool(logicalDevice_, &commandPoolCreateInfo, nullptr, &commandPool_) >> VulkanResultChecker::Get();
+
+		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		CreateBuffer(logicalDevice_, memoryAllocator_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, properties, size_, buffer_, bufferMemory_);
+	}
+
+	VulkanStagingRing::~VulkanStagingRing()
+	{
+		{
+			std::lock_guard lock(mutex_);
+
+			if (recording_)
+			{
+				SubmitRecording();
+			}
+
+			while (!inFlight_.empty())
+			{
+				Retire(true);
+			}
+
+			// the device is idle by now
+			for (auto& [numSubmits, release] : pendingReleases_)
+			{
+				release();
+			}
+		}
+
+		for (Batch& batch : idle_)
+		{
+			vkDestroyFence(logicalDevice_, batch.fence_, nullptr);
+		}
+
+		vkDestroyCommandPool(logicalDevice_, commandPool_, nullptr);
+		DestroyBuffer(logicalDevice_, memoryAllocator_, buffer_, bufferMemory_);
+	}
+
+	uint64_t VulkanStagingRing::CopyToBuffer(VkBuffer _dstBuffer, VkDeviceSize _dstOffset, VkDeviceSize _size, const std::function<void(void*)>& _write)
+	{
+		// serial 0 is complete from the start
+		if (_size == 0)
+		{
+			return 0;
+		}
+
+		std::unique_lock lock(mutex_);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.dstOffset = _dstOffset;
+		copyRegion.size = _size;
+
+		VkBuffer srcBuffer = VK_NULL_HANDLE;
+		Stage(lock, _size, bufferAlignment, _write, srcBuffer, copyRegion.srcOffset);
+
+		Batch& batch = GetRecordingBatch();
+		vkCmdCopyBuffer(batch.commandBuffer_, srcBuffer, _dstBuffer, 1, &copyRegion);
+		return batch.serial_;
+	}
+
+	uint64_t VulkanStagingRing::CopyToBuffer(VkBuffer _dstBuffer, VkDeviceSize _dstOffset, const void* _data, VkDeviceSize _size)
+	{
+		return CopyToBuffer(_dstBuffer, _dstOffset, _size, [_data, _size](void* _staged) { memcpy(_staged, _data, _size); });
+	}
+
+	uint64_t VulkanStagingRing::CopyToImage(VkImage _image, uint32_t _numMips, std::span<const uint8_t> _bytes, std::span<const VkBufferImageCopy> _regions)
+	{
+		std::unique_lock lock(mutex_);
+
+		VkBuffer srcBuffer = VK_NULL_HANDLE;
+		VkDeviceSize srcOffset = 0;
+		Stage(lock, _bytes.size(), imageAlignment, [_bytes](void* _staged) { memcpy(_staged, _bytes.data(), _bytes.size()); }, srcBuffer, srcOffset);
+
+		Batch& batch = GetRecordingBatch();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = _image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = _numMips;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		batch.imageBarriers_.push_back(barrier);
+
+		ImageCopy imageCopy;
+		imageCopy.buffer_ = srcBuffer;
+		imageCopy.image_ = _image;
+		imageCopy.firstRegion_ = (uint32_t)batch.imageRegions_.size();
+		imageCopy.numRegions_ = (uint32_t)_regions.size();
+		batch.imageCopies_.push_back(imageCopy);
+
+		for (VkBufferImageCopy region : _regions)
+		{
+			region.bufferOffset += srcOffset;
+			batch.imageRegions_.push_back(region);
+		}
+		return batch.serial_;
+	}
+
+	void VulkanStagingRing::Release(std::function<void()> _release)
+	{
+		std::lock_guard lock(mutex_);
+		pendingReleases_.emplace_back(numSubmits_, std::move(_release));
+	}
+
+	bool VulkanStagingRing::IsComplete(uint64_t _serial)
+	{
+		std::lock_guard lock(mutex_);
+
+		Retire(false);
+		return _serial <= completedSerial_;
+	}
+
+	void VulkanStagingRing::Submit()
+	{
+		std::lock_guard lock(mutex_);
+
+		submittingThread_ = std::this_thread::get_id();
+		Retire(false);
+
+		// a frame recorded before the release may go out right after the next submit,
+		// releases older than that submit ride on this batch whose fence also covers that frame
+		std::erase_if(pendingReleases_, [this](std::pair<uint64_t, std::function<void()>>& _pending)
+			{
+				if (_pending.first >= numSubmits_)
+				{
+					return false;
+				}
+
+				GetRecordingBatch().releases_.push_back(std::move(_pending.second));
+				return true;
+			});
+
+		if (recording_)
+		{
+			SubmitRecording();
+		}
+		numSubmits_++;
+		submitted_.notify_all();
+	}
+
+	std::optional<VkDeviceSize> VulkanStagingRing::Reserve(VkDeviceSize _size, VkDeviceSize _alignment)
+	{
+		Retire(false);
+
+		while (true)
+		{
+			// nothing staged or in flight, start over at the front so the whole ring is available
+			if (inFlight_.empty() && !recording_)
+			{
+				head_ = 0;
+				tail_ = 0;
+			}
+
+			// head and tail only grow, a region never wraps around the end of the ring
+			uint64_t lap = head_ / size_;
+			uint64_t offset = (head_ % size_ + _alignment - 1) / _alignment * _alignment;
+			if (offset + _size > size_)
+			{
+				lap++;
+				offset = 0;
+			}
+
+			const uint64_t start = lap * size_ + offset;
+			if (start + _size - tail_ <= size_)
+			{
+				head_ = start + _size;
+				return offset;
+			}
+
+			// what is left is held by the batch being recorded, it only goes out with the frame
+			if (inFlight_.empty())
+			{
+				return std::nullopt;
+			}
+			Retire(true);
+		}
+	}
+
+	void VulkanStagingRing::Stage(std::unique_lock<std::mutex>& _lock, VkDeviceSize _size, VkDeviceSize _alignment, const std::function<void(void*)>& _write, VkBuffer& _outBuffer, VkDeviceSize& _outOffset)
+	{
+		if (_size <= size_ / 2)
+		{
+			if (std::optional<VkDeviceSize> offset = Reserve(_size, _alignment))
+			{
+				_write((uint8_t*)bufferMemory_.mapped_ + *offset);
+				_outBuffer = buffer_;
+				_outOffset = *offset;
+				return;
+			}
+		}
+
+		WaitForOverflow(_lock, _size);
+
+		VkBuffer overflowBuffer = VK_NULL_HANDLE;
+		VulkanMemoryAllocator::Allocation overflowMemory;
+		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		CreateBuffer(logicalDevice_, memoryAllocator_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, properties, _size, overflowBuffer, overflowMemory);
+		_write(overflowMemory.mapped_);
+
+		Batch& batch = GetRecordingBatch();
+		batch.overflowBuffers_.emplace_back(overflowBuffer, overflowMemory);
+		batch.overflowSize_ += _size;
+		overflowSize_ += _size;
+		_outBuffer = overflowBuffer;
+		_outOffset = 0;
+	}
+
+	void VulkanStagingRing::WaitForOverflow(std::unique_lock<std::mutex>& _lock, VkDeviceSize _size)
+	{
+		// a single upload larger than the cap still goes through once nothing else holds overflow buffers
+		while (overflowSize_ > 0 && overflowSize_ + _size > size_)
+		{
+			const VkDeviceSize recordingSize = recording_ ? recording_->overflowSize_ : 0;
+			if (overflowSize_ > recordingSize)
+			{
+				Retire(true);
+				continue;
+			}
+
+			// the rest is held by the batch being recorded
+			if (std::this_thread::get_id() == submittingThread_)
+			{
+				SubmitRecording();
+				continue;
+			}
+
+			// no frame is coming while starting up or shutting down, the cap is exceeded then rather than waiting on
+			const uint64_t numSubmits = numSubmits_;
+			if (!submitted_.wait_for(_lock, std::chrono::milliseconds(100), [&]() { return numSubmits_ != numSubmits; }))
+			{
+				return;
+			}
+		}
+	}
+
+	VulkanStagingRing::Batch& VulkanStagingRing::GetRecordingBatch()
+	{
+		if (recording_)
+		{
+			return *recording_;
+		}
+
+		if (!idle_.empty())
+		{
+			recording_ = std::move(idle_.back());
+			idle_.pop_back();
+		}
+		else
+		{
+			recording_.emplace();
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = commandPool_;
+			allocInfo.commandBufferCount = 1;
+			vkAllocateCommandBuffers(logicalDevice_, &allocInfo, &recording_->commandBuffer_) >> VulkanResultChecker::Get();
+
+			VkFenceCreateInfo fenceCreateInfo{};
+			fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			vkCreateFence(logicalDevice_, &fenceCreateInfo, nullptr, &recording_->fence_) >> VulkanResultChecker::Get();
+		}
+		recording_->serial_ = nextSerial_++;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(recording_->commandBuffer_, &beginInfo) >> VulkanResultChecker::Get();
+
+		return *recording_;
+	}
+
+	void VulkanStagingRing::SubmitRecording()
+	{
+		Batch& batch = *recording_;
+
+		if (!batch.imageBarriers_.empty())
+		{
+			vkCmdPipelineBarrier(batch.commandBuffer_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t)batch.imageBarriers_.size(), batch.imageBarriers_.data());
+
+			for (const ImageCopy& imageCopy : batch.imageCopies_)
+			{
+				vkCmdCopyBufferToImage(batch.commandBuffer_, imageCopy.buffer_, imageCopy.image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageCopy.numRegions_, &batch.imageRegions_[imageCopy.firstRegion_]);
+			}
+
+			for (VkImageMemoryBarrier& barrier : batch.imageBarriers_)
+			{
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			}
+		}
+
+		// later submissions on the queue read what was copied as vertices, indices, uniforms or sampled images
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		vkCmdPipelineBarrier(batch.commandBuffer_, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, (uint32_t)batch.imageBarriers_.size(), batch.imageBarriers_.data());
+		vkEndCommandBuffer(batch.commandBuffer_) >> VulkanResultChecker::Get();
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer_;
+		vkQueueSubmit(queue_, 1, &submitInfo, batch.fence_) >> VulkanResultChecker::Get();
+
+		batch.end_ = head_;
+		batch.imageBarriers_.clear();
+		batch.imageCopies_.clear();
+		batch.imageRegions_.clear();
+		inFlight_.push_back(std::move(batch));
+		recording_.reset();
+	}
+
+	void VulkanStagingRing::Retire(bool _waitOldest)
+	{
+		while (!inFlight_.empty())
+		{
+			Batch& batch = inFlight_.front();
+			if (vkGetFenceStatus(logicalDevice_, batch.fence_) != VK_SUCCESS)
+			{
+				if (!_waitOldest)
+				{
+					break;
+				}
+
+				vkWaitForFences(logicalDevice_, 1, &batch.fence_, VK_TRUE, UINT64_MAX) >> VulkanResultChecker::Get();
+			}
+			_waitOldest = false;
+
+			tail_ = batch.end_;
+			completedSerial_ = batch.serial_;
+			for (auto& [overflowBuffer, overflowMemory] : batch.overflowBuffers_)
+			{
+				DestroyBuffer(logicalDevice_, memoryAllocator_, overflowBuffer, overflowMemory);
+			}
+			batch.overflowBuffers_.clear();
+			overflowSize_ -= batch.overflowSize_;
+			batch.overflowSize_ = 0;
+			for (std::function<void()>& release : batch.releases_)
+			{
+				release();
+			}
+			batch.releases_.clear();
+			vkResetFences(logicalDevice_, 1, &batch.fence_) >> VulkanResultChecker::Get();
+
+			idle_.push_back(std::move(batch));
+			inFlight_.pop_front();
+		}
+	}
+}
\ No newline at end of file
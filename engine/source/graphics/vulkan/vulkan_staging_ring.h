@@ -0,0 +1,108 @@
+#pragma once
+#include "vulkan_memory_allocator.h"
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace graphics
+{
+	// persistently mapped ring that uploads are staged through, copies are recorded into one command buffer
+	// and go out with a single submission per frame, space comes back once the batch's fence signals
+	class VulkanStagingRing
+	{
+	private:
+		struct ImageCopy
+		{
+			VkBuffer buffer_ = VK_NULL_HANDLE;
+			VkImage image_ = VK_NULL_HANDLE;
+			uint32_t firstRegion_ = 0;
+			uint32_t numRegions_ = 0;
+		};
+
+		struct Batch
+		{
+			VkCommandBuffer commandBuffer_ = VK_NULL_HANDLE;
+			VkFence fence_ = VK_NULL_HANDLE;
+			uint64_t serial_ = 0;
+			uint64_t end_ = 0; // ring head when submitted, everything before it is free once the fence signals
+			std::vector<std::pair<VkBuffer, VulkanMemoryAllocator::Allocation>> overflowBuffers_;
+			VkDeviceSize overflowSize_ = 0;
+
+			// image copies are recorded at submission so every transition of the batch fits in one barrier on either side of them
+			std::vector<VkImageMemoryBarrier> imageBarriers_;
+			std::vector<ImageCopy> imageCopies_;
+			std::vector<VkBufferImageCopy> imageRegions_;
+
+			std::vector<std::function<void()>> releases_;
+		};
+
+		static constexpr VkDeviceSize bufferAlignment = 16;
+		static constexpr VkDeviceSize imageAlignment = 48; // a multiple of 4 and of every texel block size, 12 byte float texels included
+
+	private:
+		VkDevice logicalDevice_ = VK_NULL_HANDLE;
+		VulkanMemoryAllocator& memoryAllocator_;
+		VkQueue queue_ = VK_NULL_HANDLE;
+		VkCommandPool commandPool_ = VK_NULL_HANDLE;
+		VkBuffer buffer_ = VK_NULL_HANDLE;
+		VulkanMemoryAllocator::Allocation bufferMemory_;
+		VkDeviceSize size_ = 0;
+
+		std::mutex mutex_;
+		std::condition_variable submitted_;
+		std::thread::id submittingThread_; // the frame thread, the only one allowed to send the recording batch early
+		uint64_t head_ = 0;
+		uint64_t tail_ = 0;
+		uint64_t nextSerial_ = 1;
+		uint64_t completedSerial_ = 0;
+		uint64_t numSubmits_ = 0;
+		VkDeviceSize overflowSize_ = 0; // held by the recording batch and those in flight, capped at the ring size
+		std::optional<Batch> recording_;
+		std::deque<Batch> inFlight_;
+		std::vector<Batch> idle_;
+		std::vector<std::pair<uint64_t, std::function<void()>>> pendingReleases_; // paired with the number of submits when released
+
+	public:
+		// _queue has to be the queue the uploaded resources are used on, submission order then keeps uploads ahead of their use
+		VulkanStagingRing(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VkQueue _queue, uint32_t _queueFamilyIndex, VkDeviceSize _size);
+		~VulkanStagingRing();
+
+		VulkanStagingRing(const VulkanStagingRing&) = delete;
+		VulkanStagingRing& operator=(const VulkanStagingRing&) = delete;
+
+	public:
+		// _write fills the _size staged bytes, the copy into _dstBuffer runs with the next Submit(),
+		// uploads that do not fit the ring get a staging buffer of their own that is released the same way,
+		// once those add up to the ring size loading threads wait for the next frame, the frame thread submits early,
+		// the returned serial tells IsComplete() which batch carries the copy
+		uint64_t CopyToBuffer(VkBuffer _dstBuffer, VkDeviceSize _dstOffset, VkDeviceSize _size, const std::function<void(void*)>& _write);
+		uint64_t CopyToBuffer(VkBuffer _dstBuffer, VkDeviceSize _dstOffset, const void* _data, VkDeviceSize _size);
+
+		// fills every level of a fresh color image and leaves it shader readable, offsets in _regions are relative to _bytes
+		uint64_t CopyToImage(VkImage _image, uint32_t _numMips, std::span<const uint8_t> _bytes, std::span<const VkBufferImageCopy> _regions);
+
+		// runs _release once neither an upload nor a frame submitted so far can still use what it destroys
+		void Release(std::function<void()> _release);
+
+		bool IsComplete(uint64_t _serial);
+
+		// sends everything recorded so far, called ahead of the frame's own submission on the same queue,
+		// only the thread calling it ever submits so loading threads never touch the queue
+		void Submit();
+
+	private:
+		// nullopt when the ring is still full after every submitted batch is done, the upload then gets a buffer of its own
+		std::optional<VkDeviceSize> Reserve(VkDeviceSize _size, VkDeviceSize _alignment);
+		void Stage(std::unique_lock<std::mutex>& _lock, VkDeviceSize _size, VkDeviceSize _alignment, const std::function<void(void*)>& _write, VkBuffer& _outBuffer, VkDeviceSize& _outOffset);
+		void WaitForOverflow(std::unique_lock<std::mutex>& _lock, VkDeviceSize _size);
+		Batch& GetRecordingBatch();
+		void SubmitRecording();
+		void Retire(bool _waitOldest);
+	};
+}
\ No newline at end of file
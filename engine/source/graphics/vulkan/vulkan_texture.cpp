@@ -4,30 +4,163 @@
 #include "vulkan_shader_binding.h"
 #include "thread/thread_pool.h"
 #include "file/path.generated.h"
+#include "file/block_compressor.h"
+#include "file/texture_container.h"
+#include "file/virtual_file_system.h"
 #include "utility/log.h"
+#include <algorithm>
 
 using utility::Log;
 
 namespace graphics
 {
+	// streaming threads publish new images, the thread writing descriptors takes the latest one with every write
 	class VulkanTextureBinding : public VulkanShaderBinding
 	{
-	public:
-		VkDescriptorImageInfo imageInfo_{};
+	private:
+		mutable std::mutex mutex_;
+		VkDescriptorImageInfo publishedImageInfo_{};
+		mutable VkDescriptorImageInfo imageInfo_{}; // read by the descriptor write, only touched by the thread doing it
 
 	public:
+		void Publish(const VkDescriptorImageInfo& _imageInfo)
+		{
+			std::lock_guard lock(mutex_);
+			publishedImageInfo_ = _imageInfo;
+		}
+
 		virtual void FillBindingInfo(VkWriteDescriptorSet& _WriteDescriptorSet) const override
 		{
+			{
+				std::lock_guard lock(mutex_);
+				imageInfo_ = publishedImageInfo_;
+			}
+
 			_WriteDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 			_WriteDescriptorSet.pImageInfo = &imageInfo_;
 		}
 	};
 
+	struct VulkanTexture::StreamState
+	{
+		std::mutex mutex_;
+		VulkanTexture* texture_ = nullptr; // cleared by the destructor, loads queued for a dead texture do nothing
+	};
+
+	namespace
+	{
+		constexpr uint32_t minBudgetSize = 64;
+		constexpr uint32_t evictedSize = 64; // evicted textures keep the levels up to this size
+
+		std::optional<file::Image::Format> GetBlockFormat(ImageFormat _format)
+		{
+			switch (_format)
+			{
+			case ImageFormat::BC1_RGBA_UNORM:
+			case ImageFormat::BC1_RGBA_SRGB:
+				return file::Image::Format::BC1;
+			case ImageFormat::BC3_UNORM:
+			case ImageFormat::BC3_SRGB:
+				return file::Image::Format::BC3;
+			case ImageFormat::BC4_UNORM:
+				return file::Image::Format::BC4;
+			case ImageFormat::BC5_UNORM:
+				return file::Image::Format::BC5;
+			case ImageFormat::BC7_UNORM:
+			case ImageFormat::BC7_SRGB:
+				return file::Image::Format::BC7;
+			default:
+				return std::nullopt;
+			}
+		}
+
+		// the levels of _image no larger than _maxSize, empty when even the smallest level is larger
+		std::unique_ptr<file::Image> CopyTail(const file::Image& _image, uint32_t _maxSize)
+		{
+			uint32_t first = 0;
+			while (first < _image.GetNumMips() && std::max(_image.GetMip(first).width_, _image.GetMip(first).height_) > _maxSize)
+			{
+				first++;
+			}
+
+			if (first == _image.GetNumMips())
+			{
+				return nullptr;
+			}
+
+			const file::Image::MipLevel firstLevel = _image.GetMip(first);
+			auto tail = std::make_unique<file::Image>();
+			tail->width_ = firstLevel.width_;
+			tail->height_ = firstLevel.height_;
+			tail->numChannels_ = _image.numChannels_;
+			tail->format_ = _image.format_;
+			tail->colors_.assign(_image.colors_.begin() + firstLevel.offset_, _image.colors_.end());
+			for (uint32_t i = first; i < (uint32_t)_image.mips_.size(); i++)
+			{
+				file::Image::MipLevel level = _image.mips_[i];
+				level.offset_ -= firstLevel.offset_;
+				tail->mips_.push_back(level);
+			}
+			return tail;
+		}
+
+		ImageFormat GetImageFormat(file::Image::Format _format, bool _srgb)
+		{
+			switch (_format)
+			{
+			case file::Image::Format::BC1:
+				return _srgb ? ImageFormat::BC1_RGBA_SRGB : ImageFormat::BC1_RGBA_UNORM;
+			case file::Image::Format::BC3:
+				return _srgb ? ImageFormat::BC3_SRGB : ImageFormat::BC3_UNORM;
+			case file::Image::Format::BC4:
+				return ImageFormat::BC4_UNORM;
+			case file::Image::Format::BC5:
+				return ImageFormat::BC5_UNORM;
+			case file::Image::Format::BC7:
+				return _srgb ? ImageFormat::BC7_SRGB : ImageFormat::BC7_UNORM;
+			case file::Image::Format::R8:
+				return ImageFormat::R8_UNORM;
+			case file::Image::Format::R8G8:
+				return ImageFormat::R8G8_UNORM;
+			case file::Image::Format::R16:
+				return ImageFormat::R16_UNORM;
+			case file::Image::Format::R16G16B16A16_SFLOAT:
+				return ImageFormat::R16G16B16A16_SFLOAT;
+			case file::Image::Format::R32G32B32_SFLOAT:
+				return ImageFormat::R32G32B32_SFLOAT;
+			default:
+				return ImageFormat::R8G8B8A8_UNORM;
+			}
+		}
+
+		bool IsSampleable(VkPhysicalDevice _physicalDevice, ImageFormat _format)
+		{
+			VkFormatProperties formatProperties{};
+			vkGetPhysicalDeviceFormatProperties(_physicalDevice, VulkanTypeConverter::Convert(_format), &formatProperties);
+			return formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+		}
+
+		// one and two channel images come from gray and gray alpha sources, spread them back over rgb
+		VkComponentMapping GetComponentMapping(VkFormat _format)
+		{
+			switch (_format)
+			{
+			case VK_FORMAT_R8_UNORM:
+			case VK_FORMAT_R16_UNORM:
+				return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+			case VK_FORMAT_R8G8_UNORM:
+				return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G };
+			default:
+				return {};
+			}
+		}
+	}
+
 	VulkanTexture::VulkanTexture(Initializer _initializer, const Texture::Layout& _layout)
 		: logicalDevice_(_initializer.logicalDevice_)
 		, physicalDevice_(_initializer.physicalDevice_)
-		, graphicsQueue_(_initializer.graphicsQueue_)
-		, commandPool_(_initializer.commandPool_)
+		, memoryAllocator_(*_initializer.memoryAllocator_)
+		, stagingRing_(*_initializer.stagingRing_)
 	{
 		std::call_once(placeholderInitialized_, []()
 			{
@@ -37,53 +170,52 @@ namespace graphics
 				}
 			});
 
-		format_ = VulkanTypeConverter::Convert(_layout.format_);
+		layoutFormat_ = _layout.format_;
+		generateMips_ = _layout.generateMips_;
+		srgb_ = _layout.srgb_;
+		compressionQuality_ = _layout.compressionQuality_;
+		maxSize_ = _initializer.maxSize_;
+		memoryBudget_ = _initializer.memoryBudget_;
+		streamState_ = std::make_shared<StreamState>();
+		streamState_->texture_ = this;
 
 		if (_layout.initializationType_ == Texture::InitializationType::FILE)
 		{
-			Initialize(physicalDevice_, graphicsQueue_, commandPool_, placeholder_);
-
-			thread::ThreadPool::EnqueueTask([&]()
-				{
-					deferredImage_ = std::make_unique<file::Image>();
-					if (!deferredImage_->Load(_layout.imagePath_))
-					{
-						std::cout << Log::Format(Log::Category::file, Log::Level::error, "failed to load image, path : " + std::string(_layout.imagePath_)) << std::endl;
-						return;
-					}
+			Initialize(physicalDevice_, placeholder_, placeholder_.colors_);
 
-					vkQueueWaitIdle(graphicsQueue_);
-
-					vkDestroySampler(logicalDevice_, sampler_, nullptr);
-					vkFreeMemory(logicalDevice_, imageMemory_, nullptr);
-					vkDestroyImageView(logicalDevice_, imageView_, nullptr);
-					vkDestroyImage(logicalDevice_, image_, nullptr);
-
-					Initialize(physicalDevice_, graphicsQueue_, commandPool_, *deferredImage_);
-					deferredImage_ = nullptr;
-				});
+			// caches sit next to loose sources, archived images are expected to be cooked already
+			imagePath_ = _layout.imagePath_;
+			useCache_ = _layout.useCache_ && !file::VirtualFileSystem::IsArchived(imagePath_);
+			Stream();
 		}
 		else if (_layout.initializationType_ == Texture::InitializationType::BUFFER)
 		{
 			if (!_layout.buffer_.has_value())
 			{
 				std::cout << Log::Format(Log::Category::file, Log::Level::error, "tried to load image with buffer but has no buffer" + std::string(_layout.imagePath_)) << std::endl;
-				Initialize(physicalDevice_, graphicsQueue_, commandPool_, placeholder_);
+				Initialize(physicalDevice_, placeholder_, placeholder_.colors_);
 			}
 			else
 			{
+				// buffers are taken at their size, only a chain they already carry can lose levels to the cap
 				auto image = _layout.buffer_.value();
-				Initialize(physicalDevice_, graphicsQueue_, commandPool_, image);
+				image.DropLevels(GetMaxSize());
+				Prepare(image);
+				Initialize(physicalDevice_, image, image.colors_);
 			}
 		}
 	}
 
 	VulkanTexture::~VulkanTexture()
 	{
-		vkDestroySampler(logicalDevice_, sampler_, nullptr);
-		vkFreeMemory(logicalDevice_, imageMemory_, nullptr);
-		vkDestroyImageView(logicalDevice_, imageView_, nullptr);
-		vkDestroyImage(logicalDevice_, image_, nullptr);
+		{
+			// waits out a load in progress
+			std::lock_guard lock(streamState_->mutex_);
+			streamState_->texture_ = nullptr;
+		}
+
+		// an upload of the image may not even be submitted yet
+		stagingRing_.Release(DetachImage());
 	}
 
 	std::shared_ptr<ShaderBinding::BindingImpl> VulkanTexture::GetBindingImpl() const
@@ -91,6 +223,11 @@ namespace graphics
 		return bindingImpl_;
 	}
 
+	uint32_t VulkanTexture::GetGeneration() const
+	{
+		return generation_;
+	}
+
 	uint32_t VulkanTexture::GetWidth() const
 	{
 		return width_;
@@ -101,27 +238,285 @@ namespace graphics
 		return height_;
 	}
 
-	void VulkanTexture::Initialize(VkPhysicalDevice _physicalDevice, VkQueue _graphicsQueue, VkCommandPool _commandPool, file::Image& _image)
+	size_t VulkanTexture::GetDeviceMemory() const
 	{
-		width_ = _image.width_;
-		height_ = _image.height_;
+		return memorySize_;
+	}
+
+	bool VulkanTexture::IsEvicted() const
+	{
+		return evicted_;
+	}
+
+	bool VulkanTexture::IsUploaded()
+	{
+		return stagingRing_.IsComplete(uploadSerial_);
+	}
+
+	bool VulkanTexture::IsInSparseMemory()
+	{
+		// a load in progress is about to replace the image anyway
+		std::unique_lock lock(streamState_->mutex_, std::try_to_lock);
+		return lock.owns_lock() && !imagePath_.empty() && memoryAllocator_.IsInSparseBlock(imageMemory_);
+	}
+
+	bool VulkanTexture::Evict()
+	{
+		// buffer textures have nothing to come back from, file textures without a cache
+		// would decode their whole source again unless the tail levels of the last load are at hand
+		if (imagePath_.empty() || (!useCache_ && !file::TextureContainer::IsContainer(imagePath_) && hostMemory_ == 0))
+		{
+			return false;
+		}
+
+		evicted_ = true;
+		Stream();
+		return true;
+	}
+
+	void VulkanTexture::Restore()
+	{
+		evicted_ = false;
+		Stream();
+	}
+
+	size_t VulkanTexture::GetHostMemory() const
+	{
+		return hostMemory_;
+	}
+
+	void VulkanTexture::ReleaseHostMemory()
+	{
+		hostMemory_ = 0;
+		thread::ThreadPool::EnqueueTask([streamState = streamState_]()
+			{
+				std::lock_guard lock(streamState->mutex_);
+				if (streamState->texture_)
+				{
+					streamState->texture_->keepsEvictedImage_ = false;
+					streamState->texture_->evictedImage_ = nullptr;
+					streamState->texture_->hostMemory_ = 0;
+				}
+			});
+	}
+
+	void VulkanTexture::Stream()
+	{
+		thread::ThreadPool::EnqueueTask([streamState = streamState_]()
+			{
+				// one load at a time per texture
+				std::lock_guard lock(streamState->mutex_);
+				if (streamState->texture_)
+				{
+					streamState->texture_->Load();
+				}
+			});
+	}
+
+	void VulkanTexture::Load()
+	{
+		// the cap is taken when loading starts so the budget reflects every texture finished so far,
+		// a load queued behind one that already reached the same cap has nothing left to do
+		const bool evicted = evicted_;
+		const uint32_t fullSize = GetMaxSize();
+		const uint32_t maxSize = evicted ? ((fullSize > 0) ? std::min(fullSize, evictedSize) : evictedSize) : fullSize;
+		if (streamedSize_ == maxSize)
+		{
+			return;
+		}
+
+		// without a cache, evictions upload the tail levels kept at the last load and never decode the source,
+		// the current image stays when they are gone
+		const bool cooked = file::TextureContainer::IsContainer(imagePath_);
+		if (evicted && !cooked && !useCache_)
+		{
+			if (evictedImage_)
+			{
+				Replace(*evictedImage_, evictedImage_->colors_);
+				streamedSize_ = maxSize;
+			}
+			return;
+		}
+
+		// cooked containers and fresh caches are mapped and copied straight into the staging buffer,
+		// a capped load also accepts the full size cache and skips its top levels
+		const std::filesystem::path cookedPath = cooked ? imagePath_ : file::TextureContainer::GetCachePath(imagePath_, maxSize);
+		const std::filesystem::path sourcePath = cooked ? std::filesystem::path() : imagePath_;
+
+		file::TextureContainer::Mapping mapping;
+		if ((cooked || useCache_) && (MapCooked(cookedPath, sourcePath, maxSize, mapping) || (!cooked && maxSize > 0 && MapCooked(file::TextureContainer::GetCachePath(imagePath_), sourcePath, maxSize, mapping))))
+		{
+			Replace(mapping.image_, mapping.levels_);
+			streamedSize_ = maxSize;
+			return;
+		}
+
+		deferredImage_ = std::make_unique<file::Image>();
+		const bool loaded = cooked ? file::TextureContainer::Load(cookedPath, *deferredImage_) : deferredImage_->Load(imagePath_.string(), generateMips_, maxSize);
+		if (!loaded)
+		{
+			std::cout << Log::Format(Log::Category::file, Log::Level::error, "failed to load image, path : " + imagePath_.string()) << std::endl;
+			deferredImage_ = nullptr;
+			return;
+		}
+		deferredImage_->DropLevels(maxSize);
+
+		Prepare(*deferredImage_);
+		if (!cooked && useCache_)
+		{
+			file::TextureContainer::Save(cookedPath, *deferredImage_, file::TextureContainer::Supercompression::NONE, sourcePath);
+		}
+		else if (!cooked && keepsEvictedImage_)
+		{
+			evictedImage_ = CopyTail(*deferredImage_, evictedSize);
+			hostMemory_ = evictedImage_ ? evictedImage_->colors_.size() : 0;
+		}
+
+		Replace(*deferredImage_, deferredImage_->colors_);
+		deferredImage_ = nullptr;
+		streamedSize_ = maxSize;
+	}
 
-		VkBuffer stagingBuffer = VK_NULL_HANDLE;
-		VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
+	uint32_t VulkanTexture::GetMaxSize() const
+	{
+		if (memoryBudget_ == 0)
+		{
+			return maxSize_;
+		}
+
+		// what is left of the budget as the largest power of two rgba square with its chain, never below minBudgetSize
+		const size_t used = residentMemory_.load();
+		const size_t available = (memoryBudget_ > used) ? memoryBudget_ - used : 0;
+		if ((size_t)minBudgetSize * minBudgetSize * 4 * 4 / 3 > available)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "texture memory budget is exhausted, loading at " + std::to_string(minBudgetSize)) << std::endl;
+		}
 
-		CreateStagingBuffer(_physicalDevice, _image, stagingBuffer, stagingBufferMemory);
-		CreateImage(_physicalDevice);
+		uint32_t budgetSize = minBudgetSize;
+		while ((size_t)budgetSize * 2 * budgetSize * 2 * 4 * 4 / 3 <= available)
 		{
-			TransitImageLayout(format_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, _graphicsQueue, _commandPool);
-			CopyBufferToImage(stagingBuffer, _graphicsQueue, _commandPool);
-			TransitImageLayout(format_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, _graphicsQueue, _commandPool);
+			budgetSize *= 2;
 		}
+		return (maxSize_ > 0) ? std::min(maxSize_, budgetSize) : budgetSize;
+	}
+
+	bool VulkanTexture::MapCooked(const std::filesystem::path& _path, const std::filesystem::path& _sourcePath, uint32_t _maxSize, file::TextureContainer::Mapping& _outMapping) const
+	{
+		if (!file::TextureContainer::Map(_path, _outMapping, _sourcePath))
+		{
+			return false;
+		}
+
+		// caches must match how this texture prepares images, cooked files are taken as they are unless the device
+		// cannot sample their format, rgb32f and block formats then go through Prepare like a fresh image
+		if (!_sourcePath.empty() ? !IsPrepared(_outMapping.image_) : !IsSampleable(physicalDevice_, ResolveFormat(_outMapping.image_)))
+		{
+			return false;
+		}
+
+		_outMapping.levels_ = _outMapping.levels_.subspan(_outMapping.image_.DropLevels(_maxSize));
+		return _sourcePath.empty() || _maxSize == 0 || std::max(_outMapping.image_.width_, _outMapping.image_.height_) <= _maxSize;
+	}
+
+	file::Image::Format VulkanTexture::GetTargetFormat(const file::Image& _image) const
+	{
+		// only 8 bit data is block compressed, 16 bit and hdr images keep their precision
+		const std::optional<file::Image::Format> blockFormat = GetBlockFormat(layoutFormat_);
+		if (blockFormat && file::BlockCompressor::IsCompressible(_image.format_) && IsSampleable(physicalDevice_, layoutFormat_))
+		{
+			return *blockFormat;
+		}
+
+		if (_image.format_ == file::Image::Format::R32G32B32_SFLOAT && !IsSampleable(physicalDevice_, ImageFormat::R32G32B32_SFLOAT))
+		{
+			return file::Image::Format::R16G16B16A16_SFLOAT;
+		}
+		return _image.format_;
+	}
+
+	bool VulkanTexture::IsPrepared(const file::Image& _image) const
+	{
+		if (generateMips_ && _image.GetNumMips() == 1 && (_image.width_ > 1 || _image.height_ > 1))
+		{
+			return false;
+		}
+
+		if (file::BlockCompressor::IsBlockCompressed(_image.format_))
+		{
+			return GetBlockFormat(layoutFormat_) == _image.format_ && IsSampleable(physicalDevice_, layoutFormat_);
+		}
+		return _image.format_ == GetTargetFormat(_image);
+	}
+
+	void VulkanTexture::Prepare(file::Image& _image) const
+	{
+		// block formats cooked for another device come back as rgba8
+		if (file::BlockCompressor::IsBlockCompressed(_image.format_) && !IsSampleable(physicalDevice_, ResolveFormat(_image)))
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "block compressed format is not supported by the device, decompressing") << std::endl;
+			file::BlockCompressor::Decompress(_image);
+		}
+
+		if (generateMips_ && _image.GetNumMips() == 1)
+		{
+			_image.GenerateMips(file::Image::MipFilter::KAISER, srgb_);
+		}
+
+		const file::Image::Format targetFormat = GetTargetFormat(_image);
+		if (_image.format_ == targetFormat)
+		{
+			if (GetBlockFormat(layoutFormat_) && file::BlockCompressor::IsCompressible(_image.format_))
+			{
+				std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "block compressed format is not supported by the device, uploading uncompressed") << std::endl;
+			}
+			return;
+		}
+
+		if (targetFormat == file::Image::Format::R16G16B16A16_SFLOAT)
+		{
+			_image.ConvertToHalf();
+			return;
+		}
+
+		file::BlockCompressor::Compress(_image, targetFormat, compressionQuality_);
+	}
+
+	ImageFormat VulkanTexture::ResolveFormat(const file::Image& _image) const
+	{
+		// rgba images that stayed uncompressed, the placeholder among them, fall back to plain rgba, other formats map one to one
+		const std::optional<file::Image::Format> blockFormat = GetBlockFormat(layoutFormat_);
+		if (_image.format_ == file::Image::Format::R8G8B8A8)
+		{
+			return blockFormat ? ImageFormat::R8G8B8A8_UNORM : layoutFormat_;
+		}
+
+		// cooked files keep the format they were cooked with
+		return (blockFormat == _image.format_) ? layoutFormat_ : GetImageFormat(_image.format_, srgb_);
+	}
+
+	void VulkanTexture::Replace(const file::Image& _image, std::span<const uint8_t> _bytes)
+	{
+		std::function<void()> releaseImage = DetachImage();
+		Initialize(physicalDevice_, _image, _bytes);
+
+		// released only after the new image is published, frames recorded from here on write it into new descriptor sets
+		// and the ring holds the old one back until every frame that may still bind it is done
+		stagingRing_.Release(std::move(releaseImage));
+	}
+
+	void VulkanTexture::Initialize(VkPhysicalDevice _physicalDevice, const file::Image& _image, std::span<const uint8_t> _bytes)
+	{
+		format_ = VulkanTypeConverter::Convert(ResolveFormat(_image));
+
+		width_ = _image.width_;
+		height_ = _image.height_;
+		numMips_ = std::max(1u, _image.GetNumMips());
+
+		CreateImage();
+		Upload(_image, _bytes);
 		CreateImageView();
 		CreateSampler(_physicalDevice);
 
-		vkFreeMemory(logicalDevice_, stagingBufferMemory, nullptr);
-		vkDestroyBuffer(logicalDevice_, stagingBuffer, nullptr);
-
 		imageInfo_.imageView = imageView_;
 		imageInfo_.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 		imageInfo_.sampler = sampler_;
@@ -129,24 +524,34 @@ namespace graphics
 		if (!bindingImpl_)
 		{
 			bindingImpl_ = std::make_shared<VulkanTextureBinding>();
-			bindingImpl_->imageInfo_ = imageInfo_;
 		}
+
+		// materials compare generations and write the published image into fresh descriptor sets
+		bindingImpl_->Publish(imageInfo_);
+		generation_++;
 	}
 
-	void VulkanTexture::CreateStagingBuffer(VkPhysicalDevice _physicalDevice, const file::Image& _image, VkBuffer& _outStagingBuffer, VkDeviceMemory& _outBufferMemory)
+	std::function<void()> VulkanTexture::DetachImage()
 	{
-		VkBufferUsageFlags stagingBufferUsages = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-		VkMemoryPropertyFlags stagingBufferProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-
-		CreateBuffer(logicalDevice_, _physicalDevice, stagingBufferUsages, stagingBufferProperties, _image.colors_.size(), _outStagingBuffer, _outBufferMemory);
+		residentMemory_ -= memorySize_;
+		memorySize_ = 0;
 
-		void* data = nullptr;
-		vkMapMemory(logicalDevice_, _outBufferMemory, 0, _image.colors_.size(), 0, &data);
-		memcpy(data, _image.colors_.data(), _image.colors_.size());
-		vkUnmapMemory(logicalDevice_, _outBufferMemory);
+		std::function<void()> release = [logicalDevice = logicalDevice_, &memoryAllocator = memoryAllocator_, sampler = sampler_, imageView = imageView_, image = image_, imageMemory = imageMemory_]() mutable
+			{
+				vkDestroySampler(logicalDevice, sampler, nullptr);
+				vkDestroyImageView(logicalDevice, imageView, nullptr);
+				vkDestroyImage(logicalDevice, image, nullptr);
+				memoryAllocator.Free(imageMemory);
+			};
+
+		sampler_ = VK_NULL_HANDLE;
+		imageView_ = VK_NULL_HANDLE;
+		image_ = VK_NULL_HANDLE;
+		imageMemory_ = {};
+		return release;
 	}
 
-	void VulkanTexture::CreateImage(VkPhysicalDevice _physicalDevice)
+	void VulkanTexture::CreateImage()
 	{
 		VkImageCreateInfo imageCreateInfo{};
 		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -154,7 +559,7 @@ namespace graphics
 		imageCreateInfo.extent.width = width_;
 		imageCreateInfo.extent.height = height_;
 		imageCreateInfo.extent.depth = 1;
-		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.mipLevels = numMips_;
 		imageCreateInfo.arrayLayers = 1;
 		imageCreateInfo.format = format_;
 		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -165,16 +570,9 @@ namespace graphics
 		imageCreateInfo.flags = 0;
 		vkCreateImage(logicalDevice_, &imageCreateInfo, nullptr, &image_) >> VulkanResultChecker::Get();
 
-		VkMemoryRequirements memoryRequirements;
-		vkGetImageMemoryRequirements(logicalDevice_, image_, &memoryRequirements);
-
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memoryRequirements.size;
-		allocInfo.memoryTypeIndex = FindMemoryTypeIndex(_physicalDevice, memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-		vkAllocateMemory(logicalDevice_, &allocInfo, nullptr, &imageMemory_) >> VulkanResultChecker::Get();
-		vkBindImageMemory(logicalDevice_, image_, imageMemory_, 0);
+		imageMemory_ = memoryAllocator_.AllocateForImage(image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		memorySize_ = imageMemory_.size_;
+		residentMemory_ += memorySize_;
 	}
 
 	void VulkanTexture::CreateImageView()
@@ -184,9 +582,10 @@ namespace graphics
 		imageViewCreateInfo.image = image_;
 		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 		imageViewCreateInfo.format = format_;
+		imageViewCreateInfo.components = GetComponentMapping(format_);
 		imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.levelCount = numMips_;
 		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
 		imageViewCreateInfo.subresourceRange.layerCount = 1;
 		vkCreateImageView(logicalDevice_, &imageViewCreateInfo, nullptr, &imageView_) >> VulkanResultChecker::Get();
@@ -213,106 +612,31 @@ namespace graphics
 		samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		samplerCreateInfo.mipLodBias = 0.0f;
 		samplerCreateInfo.minLod = 0.0f;
-		samplerCreateInfo.maxLod = 0.0f;
+		samplerCreateInfo.maxLod = (float)numMips_;
 		vkCreateSampler(logicalDevice_, &samplerCreateInfo, nullptr, &sampler_) >> VulkanResultChecker::Get();
 	}
 
-	VkCommandBuffer BeginDisposableCommandBuffer(VkDevice _logicalDevice, VkCommandPool _commandPool)
+	void VulkanTexture::Upload(const file::Image& _image, std::span<const uint8_t> _bytes)
 	{
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = _commandPool;
-		allocInfo.commandBufferCount = 1;
-
-		VkCommandBuffer commandBuffer;
-		vkAllocateCommandBuffers(_logicalDevice, &allocInfo, &commandBuffer);
-
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-		vkBeginCommandBuffer(commandBuffer, &beginInfo);
-		return commandBuffer;
-	}
-
-	void EndDisposableCommandBuffer(VkDevice _logicalDevice, VkCommandBuffer _commandBuffer, VkQueue _graphicsQueue, VkCommandPool _commandPool)
-	{
-		vkEndCommandBuffer(_commandBuffer);
-
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &_commandBuffer;
-
-		vkQueueSubmit(_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(_graphicsQueue);
-
-		vkFreeCommandBuffers(_logicalDevice, _commandPool, 1, &_commandBuffer);
-	}
-
-	void VulkanTexture::TransitImageLayout(VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout, VkQueue _graphicsQueue, VkCommandPool _commandPool)
-	{
-		VkCommandBuffer commandBuffer = BeginDisposableCommandBuffer(logicalDevice_, _commandPool);
-
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = _oldLayout;
-		barrier.newLayout = _newLayout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image_;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		
-		VkPipelineStageFlags srcStageFlags = 0;
-		VkPipelineStageFlags dstStageFlags = 0;
-
-		if (_oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && _newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			srcStageFlags = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			dstStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}
-		else if (_oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && _newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-		{
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			srcStageFlags = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			dstStageFlags = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		}
-		else
+		// one region per mip level, levels are packed back to back in _bytes
+		std::vector<VkBufferImageCopy> imageCopies(numMips_);
+		for (uint32_t i = 0; i < numMips_; i++)
 		{
-			throw std::runtime_error("unsupported transition layouts");
+			const file::Image::MipLevel mip = _image.GetMip(i);
+
+			VkBufferImageCopy& imageCopy = imageCopies[i];
+			imageCopy.bufferOffset = mip.offset_;
+			imageCopy.bufferRowLength = 0;
+			imageCopy.bufferImageHeight = 0;
+			imageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			imageCopy.imageSubresource.mipLevel = i;
+			imageCopy.imageSubresource.baseArrayLayer = 0;
+			imageCopy.imageSubresource.layerCount = 1;
+			imageCopy.imageOffset = { 0, 0, 0 };
+			imageCopy.imageExtent = { mip.width_, mip.height_, 1 };
 		}
 
-		vkCmdPipelineBarrier(commandBuffer, srcStageFlags, dstStageFlags, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-		EndDisposableCommandBuffer(logicalDevice_, commandBuffer, _graphicsQueue, _commandPool);
-	}
-
-	void VulkanTexture::CopyBufferToImage(VkBuffer _buffer, VkQueue _graphicsQueue, VkCommandPool _commandPool)
-	{
-		VkCommandBuffer commandBuffer = BeginDisposableCommandBuffer(logicalDevice_, _commandPool);
-
-		VkBufferImageCopy imageCopy{};
-		imageCopy.bufferOffset = 0;
-		imageCopy.bufferRowLength = 0;
-		imageCopy.bufferImageHeight = 0;
-		imageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		imageCopy.imageSubresource.mipLevel = 0;
-		imageCopy.imageSubresource.baseArrayLayer = 0;
-		imageCopy.imageSubresource.layerCount = 1;
-		imageCopy.imageOffset = { 0, 0, 0 };
-		imageCopy.imageExtent = { width_, height_, 1 };
-		vkCmdCopyBufferToImage(commandBuffer, _buffer, image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageCopy);
-
-		EndDisposableCommandBuffer(logicalDevice_, commandBuffer, _graphicsQueue, _commandPool);
+		// recorded with every other upload of the frame, the frame's submission makes the image shader readable
+		uploadSerial_ = stagingRing_.CopyToImage(image_, numMips_, _bytes, imageCopies);
 	}
 }
\ No newline at end of file
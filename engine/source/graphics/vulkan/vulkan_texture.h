@@ -1,8 +1,14 @@
 #pragma once
 #include "vulkan/vulkan.h"
+#include "vulkan_memory_allocator.h"
+#include "vulkan_staging_ring.h"
 #include "graphics/texture.h"
 #include "file/image.h"
+#include "file/texture_container.h"
+#include <atomic>
+#include <functional>
 #include <mutex>
+#include <span>
 
 namespace graphics
 {
@@ -13,28 +19,54 @@ namespace graphics
 		{
 			VkDevice logicalDevice_;
 			VkPhysicalDevice physicalDevice_;
-			VkQueue graphicsQueue_;
-			VkCommandPool commandPool_;
+			VulkanMemoryAllocator* memoryAllocator_ = nullptr;
+			VulkanStagingRing* stagingRing_ = nullptr;
+			uint32_t maxSize_ = 0;
+			size_t memoryBudget_ = 0;
 		};
 
+	private:
+		struct StreamState;
+
 	private:
 		inline static std::once_flag placeholderInitialized_;
 		inline static file::Image placeholder_;
+		inline static std::atomic<size_t> residentMemory_ = 0; // device memory held by every texture, weighed against the budget
 
 		VkDevice logicalDevice_;
 		VkPhysicalDevice physicalDevice_;
-		VkQueue graphicsQueue_;
-		VkCommandPool commandPool_;
+		VulkanMemoryAllocator& memoryAllocator_;
+		VulkanStagingRing& stagingRing_;
 
 		VkImage image_ = VK_NULL_HANDLE;
 		VkImageView imageView_ = VK_NULL_HANDLE;
-		VkDeviceMemory imageMemory_ = VK_NULL_HANDLE;
+		VulkanMemoryAllocator::Allocation imageMemory_;
 		VkSampler sampler_ = VK_NULL_HANDLE;
 		VkFormat format_;
 		uint32_t width_ = 0;
 		uint32_t height_ = 0;
+		uint32_t numMips_ = 1;
+		std::atomic<size_t> memorySize_ = 0;
+		uint32_t maxSize_ = 0;
+		size_t memoryBudget_ = 0;
+		ImageFormat layoutFormat_ = ImageFormat::R8G8B8A8_UNORM;
+		bool generateMips_ = true;
+		bool srgb_ = false;
+		file::BlockCompressor::Quality compressionQuality_ = file::BlockCompressor::Quality::NORMAL;
 		VkDescriptorImageInfo imageInfo_{};
 		std::shared_ptr<class VulkanTextureBinding> bindingImpl_;
+		std::atomic<uint32_t> generation_ = 0;
+		std::atomic<uint64_t> uploadSerial_ = 0; // staging ring serial of the current image's copy
+
+		// file textures stream on the thread pool, eviction reloads them without their top levels
+		std::filesystem::path imagePath_;
+		bool useCache_ = false;
+		std::atomic<bool> evicted_ = false;
+		std::optional<uint32_t> streamedSize_; // cap of the last finished load, guarded by the stream state
+		std::unique_ptr<file::Image> evictedImage_; // levels up to the evicted size of the last load without a cache, guarded by the stream state
+		bool keepsEvictedImage_ = true; // guarded by the stream state
+		std::atomic<size_t> hostMemory_ = 0;
+		std::shared_ptr<StreamState> streamState_;
 
 		std::unique_ptr<file::Image> deferredImage_; // declared as pointer to free unnecessary memory
 
@@ -45,16 +77,36 @@ namespace graphics
 	public:
 		virtual std::shared_ptr<BindingImpl> GetBindingImpl() const override;
 
+		virtual uint32_t GetGeneration() const override;
+
 		virtual uint32_t GetWidth() const override;
 		virtual uint32_t GetHeight() const override;
 
+		virtual size_t GetDeviceMemory() const override;
+		virtual bool IsEvicted() const override;
+		virtual bool IsUploaded() override;
+		virtual bool IsInSparseMemory() override;
+		virtual bool Evict() override;
+		virtual void Restore() override;
+		virtual size_t GetHostMemory() const override;
+		virtual void ReleaseHostMemory() override;
+
 	private:
-		void Initialize(VkPhysicalDevice _physicalDevice, VkQueue _graphicsQueue, VkCommandPool _commandPool, file::Image& _image);
-		void CreateStagingBuffer(VkPhysicalDevice _physicalDevice, const file::Image& _image, VkBuffer& _outStagingBuffer, VkDeviceMemory& _outBufferMemory);
-		void CreateImage(VkPhysicalDevice _physicalDevice);
+		void Stream();
+		void Load();
+		uint32_t GetMaxSize() const;
+		bool MapCooked(const std::filesystem::path& _path, const std::filesystem::path& _sourcePath, uint32_t _maxSize, file::TextureContainer::Mapping& _outMapping) const;
+		file::Image::Format GetTargetFormat(const file::Image& _image) const;
+		bool IsPrepared(const file::Image& _image) const;
+		void Prepare(file::Image& _image) const;
+		ImageFormat ResolveFormat(const file::Image& _image) const;
+		void Replace(const file::Image& _image, std::span<const uint8_t> _bytes);
+		void Initialize(VkPhysicalDevice _physicalDevice, const file::Image& _image, std::span<const uint8_t> _bytes);
+		// hands the current image over to the returned function that destroys it
+		std::function<void()> DetachImage();
+		void CreateImage();
 		void CreateImageView();
 		void CreateSampler(VkPhysicalDevice _physicalDevice);
-		void TransitImageLayout(VkFormat _format, VkImageLayout _oldLayout, VkImageLayout _newLayout, VkQueue _graphicsQueue, VkCommandPool _commandPool);
-		void CopyBufferToImage(VkBuffer _buffer, VkQueue _graphicsQueue, VkCommandPool _commandPool);
+		void Upload(const file::Image& _image, std::span<const uint8_t> _bytes);
 	};
 }
\ No newline at end of file
@@ -18,19 +18,14 @@ namespace graphics
 		}
 	};
 
-	VulkanUniformBuffer::VulkanUniformBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const UniformBuffer::Layout& _layout)
+	VulkanUniformBuffer::VulkanUniformBuffer(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, const UniformBuffer::Layout& _layout)
 		: logicalDevice_(_logicalDevice)
+		, memoryAllocator_(_memoryAllocator)
 		, bufferSize_(_layout.size_)
-		, persistentMapping_(_layout.persistentMapping_)
 	{
 		VkBufferUsageFlags memoryFlag = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
 		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-		CreateBuffer(_logicalDevice, _physicalDevice, memoryFlag, properties, bufferSize_, buffer_, bufferMemory_);
-
-		if (persistentMapping_)
-		{
-			vkMapMemory(logicalDevice_, bufferMemory_, 0, bufferSize_, 0, &mapped_) >> VulkanResultChecker::Get();
-		}
+		CreateBuffer(_logicalDevice, memoryAllocator_, memoryFlag, properties, bufferSize_, buffer_, bufferMemory_);
 
 		bufferInfo_.buffer = buffer_;
 		bufferInfo_.offset = 0;
@@ -42,13 +37,7 @@ namespace graphics
 
 	VulkanUniformBuffer::~VulkanUniformBuffer()
 	{
-		if (persistentMapping_)
-		{
-			vkUnmapMemory(logicalDevice_, bufferMemory_);
-		}
-
-		vkFreeMemory(logicalDevice_, bufferMemory_, nullptr);
-		vkDestroyBuffer(logicalDevice_, buffer_, nullptr);
+		DestroyBuffer(logicalDevice_, memoryAllocator_, buffer_, bufferMemory_);
 	}
 
 	VkBuffer VulkanUniformBuffer::GetBuffer() const
@@ -68,15 +57,6 @@ namespace graphics
 
     void VulkanUniformBuffer::Update(const void* _data)
 	{
-		if (persistentMapping_)
-		{
-			memcpy(mapped_, _data, bufferSize_);
-		}
-		else
-		{
-			vkMapMemory(logicalDevice_, bufferMemory_, 0, bufferSize_, 0, &mapped_) >> VulkanResultChecker::Get();
-			memcpy(mapped_, _data, bufferSize_);
-			vkUnmapMemory(logicalDevice_, bufferMemory_);
-		}
+		memcpy(bufferMemory_.mapped_, _data, bufferSize_);
 	}
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "vulkan/vulkan.h"
 #include "graphics/uniform_buffer.h"
+#include "vulkan_memory_allocator.h"
 
 namespace graphics
 {
@@ -8,16 +9,15 @@ namespace graphics
 	{
 	private:
 		VkDevice logicalDevice_ = VK_NULL_HANDLE;
+		VulkanMemoryAllocator& memoryAllocator_;
 		VkBuffer buffer_ = VK_NULL_HANDLE;
-		VkDeviceMemory bufferMemory_ = VK_NULL_HANDLE;
+		VulkanMemoryAllocator::Allocation bufferMemory_; // host visible blocks stay mapped, so every buffer is written through its mapping
 		VkDeviceSize bufferSize_{};
-		void* mapped_ = nullptr;
-		const bool persistentMapping_ = false;
 		VkDescriptorBufferInfo bufferInfo_{};
 		std::shared_ptr<class VulkanUniformBufferBinding> bindingImpl_;
 
 	public:
-		VulkanUniformBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, const UniformBuffer::Layout& _layout);
+		VulkanUniformBuffer(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, const UniformBuffer::Layout& _layout);
 		~VulkanUniformBuffer();
 
 	public:
@@ -3,23 +3,7 @@
 
 namespace graphics
 {
-	uint32_t FindMemoryTypeIndex(VkPhysicalDevice _physicalDevice, VkMemoryRequirements _memoryRequirements, VkMemoryPropertyFlags _requiredProperties)
-	{
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
-
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-		{
-			if ((_memoryRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & _requiredProperties) == _requiredProperties)
-			{
-				return i;
-			}
-		}
-
-		return std::numeric_limits<uint32_t>::max();
-	}
-
-	void CreateBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkDeviceSize _bufferSize, VkBuffer& _outBuffer, VkDeviceMemory& _outBufferMemory)
+	void CreateBuffer(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkDeviceSize _bufferSize, VkBuffer& _outBuffer, VulkanMemoryAllocator::Allocation& _outAllocation)
 	{
 		VkBufferCreateInfo bufferCreateInfo{};
 		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -28,57 +12,14 @@ namespace graphics
 		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		vkCreateBuffer(_logicalDevice, &bufferCreateInfo, nullptr, &_outBuffer) >> VulkanResultChecker::Get();
 
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(_logicalDevice, _outBuffer, &memRequirements);
-
-		uint32_t memoryTypeIndex = FindMemoryTypeIndex(_physicalDevice, memRequirements, _properties);
-		if (memoryTypeIndex == std::numeric_limits<uint32_t>::max())
-		{
-			throw std::exception("CreateBuffer() : failed to find required memory type");
-		}
-
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = memoryTypeIndex;
-
-		vkAllocateMemory(_logicalDevice, &allocInfo, nullptr, &_outBufferMemory) >> VulkanResultChecker::Get();
-		vkBindBufferMemory(_logicalDevice, _outBuffer, _outBufferMemory, 0) >> VulkanResultChecker::Get();
+		_outAllocation = _memoryAllocator.AllocateForBuffer(_outBuffer, _properties);
 	}
 
-	void CopyBuffer(VkDevice _logicalDevice, VkQueue _transferQueue, VkCommandPool _commandPool, VkBuffer _srcBuffer, VkBuffer _dstBuffer, VkDeviceSize _bufferSize)
+	void DestroyBuffer(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VkBuffer& _buffer, VulkanMemoryAllocator::Allocation& _allocation)
 	{
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = _commandPool;
-		allocInfo.commandBufferCount = 1;
-
-		VkCommandBuffer commandBuffer;
-		vkAllocateCommandBuffers(_logicalDevice, &allocInfo, &commandBuffer) >> VulkanResultChecker::Get();
-
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-		vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0;
-		copyRegion.dstOffset = 0;
-		copyRegion.size = _bufferSize;
-		vkCmdCopyBuffer(commandBuffer, _srcBuffer, _dstBuffer, 1, &copyRegion);
-		vkEndCommandBuffer(commandBuffer);
-
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-
-		vkQueueSubmit(_transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(_transferQueue);
-
-		vkFreeCommandBuffers(_logicalDevice, _commandPool, 1, &commandBuffer);
+		vkDestroyBuffer(_logicalDevice, _buffer, nullptr);
+		_memoryAllocator.Free(_allocation);
+		_buffer = VK_NULL_HANDLE;
 	}
 
 	VkPrimitiveTopology VulkanTypeConverter::Convert(PrimitiveTopology _topology)
@@ -97,6 +38,22 @@ namespace graphics
 		return VkPrimitiveTopology{};
 	}
 
+	VkIndexType VulkanTypeConverter::Convert(IndexFormat _format)
+	{
+		switch (_format)
+		{
+		case IndexFormat::NONE:
+			throw std::runtime_error("index format is not resolved");
+			break;
+		case IndexFormat::UINT16:
+			return VK_INDEX_TYPE_UINT16;
+		case IndexFormat::UINT32:
+			return VK_INDEX_TYPE_UINT32;
+		}
+
+		return VkIndexType{};
+	}
+
 	VkFormat VulkanTypeConverter::Convert(ImageFormat _format)
 	{
 		switch (_format)
@@ -117,10 +74,36 @@ namespace graphics
 			return VK_FORMAT_B8G8R8A8_UNORM;
 		case ImageFormat::B8G8R8A8_NORM:
 			return VK_FORMAT_B8G8R8A8_SNORM;
+		case ImageFormat::R8_UNORM:
+			return VK_FORMAT_R8_UNORM;
+		case ImageFormat::R8G8_UNORM:
+			return VK_FORMAT_R8G8_UNORM;
+		case ImageFormat::R16_UNORM:
+			return VK_FORMAT_R16_UNORM;
+		case ImageFormat::R16G16B16A16_SFLOAT:
+			return VK_FORMAT_R16G16B16A16_SFLOAT;
+		case ImageFormat::R32G32B32_SFLOAT:
+			return VK_FORMAT_R32G32B32_SFLOAT;
 			case ImageFormat::D32_SFLOAT:
 			return VK_FORMAT_D32_SFLOAT;
 		case ImageFormat::D32_SFLOAT_U8_UINT:
 			return VK_FORMAT_D32_SFLOAT_S8_UINT;
+		case ImageFormat::BC1_RGBA_UNORM:
+			return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case ImageFormat::BC1_RGBA_SRGB:
+			return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case ImageFormat::BC3_UNORM:
+			return VK_FORMAT_BC3_UNORM_BLOCK;
+		case ImageFormat::BC3_SRGB:
+			return VK_FORMAT_BC3_SRGB_BLOCK;
+		case ImageFormat::BC4_UNORM:
+			return VK_FORMAT_BC4_UNORM_BLOCK;
+		case ImageFormat::BC5_UNORM:
+			return VK_FORMAT_BC5_UNORM_BLOCK;
+		case ImageFormat::BC7_UNORM:
+			return VK_FORMAT_BC7_UNORM_BLOCK;
+		case ImageFormat::BC7_SRGB:
+			return VK_FORMAT_BC7_SRGB_BLOCK;
 		}
 
 		return VK_FORMAT_UNDEFINED;
@@ -192,4 +175,28 @@ namespace graphics
 
 		return flags;
 	}
+
+	VkFormat VulkanTypeConverter::Convert(ShaderReflection::ComponentType _type, uint32_t _numComponents)
+	{
+		static constexpr VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static constexpr VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static constexpr VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (_numComponents == 0 || _numComponents > 4)
+		{
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		switch (_type)
+		{
+		case ShaderReflection::ComponentType::FLOAT:
+			return floatFormats[_numComponents - 1];
+		case ShaderReflection::ComponentType::INT:
+			return intFormats[_numComponents - 1];
+		case ShaderReflection::ComponentType::UINT:
+			return uintFormats[_numComponents - 1];
+		}
+
+		return VK_FORMAT_UNDEFINED;
+	}
 }
\ No newline at end of file
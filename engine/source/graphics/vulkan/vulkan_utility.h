@@ -1,22 +1,24 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include "graphics/pipeline.h"
+#include "vulkan_memory_allocator.h"
 
 namespace graphics
 {
-	uint32_t FindMemoryTypeIndex(VkPhysicalDevice _physicalDevice, VkMemoryRequirements _memoryRequirements, VkMemoryPropertyFlags _requiredProperties);
-	void CreateBuffer(VkDevice _logicalDevice, VkPhysicalDevice _physicalDevice, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkDeviceSize _bufferSize, VkBuffer& _outBuffer, VkDeviceMemory& _outBufferMemory);
-	void CopyBuffer(VkDevice _logicalDevice, VkQueue _transferQueue, VkCommandPool _commandPool, VkBuffer _srcBuffer, VkBuffer _dstBuffer, VkDeviceSize _bufferSize);
+	void CreateBuffer(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VkBufferUsageFlags _usage, VkMemoryPropertyFlags _properties, VkDeviceSize _bufferSize, VkBuffer& _outBuffer, VulkanMemoryAllocator::Allocation& _outAllocation);
+	void DestroyBuffer(VkDevice _logicalDevice, VulkanMemoryAllocator& _memoryAllocator, VkBuffer& _buffer, VulkanMemoryAllocator::Allocation& _allocation);
 
 	class VulkanTypeConverter
 	{
 	public:
 		static VkPrimitiveTopology Convert(PrimitiveTopology _topology);
+		static VkIndexType Convert(IndexFormat _format);
 		static VkFormat Convert(ImageFormat _format);
 		static VkImageUsageFlags Convert(ImageUsage _usage);
 		static VkAttachmentLoadOp ConvertLoadOp(ImageOperation _operation);
 		static VkAttachmentStoreOp ConvertStoreOp(ImageOperation _operation);
 		static VkDescriptorType Convert(ShaderBinding::Type _type);
 		static VkShaderStageFlags Convert(ShaderStage _stage);
+		static VkFormat Convert(ShaderReflection::ComponentType _type, uint32_t _numComponents);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "half.h"
+#include <cstring>
+
+namespace math
+{
+	uint16_t FloatToHalf(float _value)
+	{
+		uint32_t bits = 0;
+		memcpy(&bits, &_value, sizeof(bits));
+
+		const uint32_t sign = (bits >> 16) & 0x8000;
+		const int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		if (((bits >> 23) & 0xff) == 0xff)
+		{
+			return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+		}
+
+		if (exponent >= 31)
+		{
+			return (uint16_t)(sign | 0x7c00);
+		}
+
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+			{
+				return (uint16_t)sign;
+			}
+
+			// subnormal, the implicit leading bit becomes explicit before shifting
+			mantissa |= 0x800000;
+			const uint32_t shift = (uint32_t)(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1);
+			const uint32_t halfway = 1u << (shift - 1);
+			if (remainder > halfway || (remainder == halfway && (half & 1)))
+			{
+				half++;
+			}
+			return (uint16_t)(sign | half);
+		}
+
+		uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+		const uint32_t remainder = mantissa & 0x1fff;
+		if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		{
+			half++; // may carry into the exponent, which still rounds correctly up to infinity
+		}
+		return (uint16_t)(sign | half);
+	}
+
+	float HalfToFloat(uint16_t _value)
+	{
+		const uint32_t sign = (uint32_t)(_value & 0x8000) << 16;
+		uint32_t exponent = (_value >> 10) & 0x1f;
+		uint32_t mantissa = _value & 0x3ff;
+
+		uint32_t bits = 0;
+		if (exponent == 0x1f)
+		{
+			bits = sign | 0x7f800000 | (mantissa << 13);
+		}
+		else if (exponent != 0)
+		{
+			bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+		}
+		else if (mantissa != 0)
+		{
+			// normalize the subnormal
+			exponent = 127 - 15 + 1;
+			while (!(mantissa & 0x400))
+			{
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+		}
+		else
+		{
+			bits = sign;
+		}
+
+		float value = 0.0f;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+}
\ No newline at end of file
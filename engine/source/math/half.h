@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+
+namespace math
+{
+	// ieee 754 binary16 conversions, rounding to nearest even and keeping infinities and nan
+	uint16_t FloatToHalf(float _value);
+	float HalfToFloat(uint16_t _value);
+}
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "thread_pool.h"
+#include <atomic>
+#include <memory>
+#include <algorithm>
 
 namespace thread
 {
@@ -34,6 +37,56 @@ namespace thread
 		condition_.notify_one();
 	}
 
+	void ThreadPool::ParallelFor(size_t _count, const std::function<void(size_t)>& _task)
+	{
+		if (_count == 0)
+		{
+			return;
+		}
+
+		struct State
+		{
+			std::atomic<size_t> next_ = 0;
+			std::atomic<size_t> numFinished_ = 0;
+			std::mutex mutex_;
+			std::condition_variable condition_;
+			const std::function<void(size_t)>* task_ = nullptr;
+		};
+
+		// helpers that start late find nothing left to claim and never touch the task
+		auto state = std::make_shared<State>();
+		state->task_ = &_task;
+
+		auto run = [state, _count]()
+			{
+				for (size_t i = state->next_++; i < _count; i = state->next_++)
+				{
+					(*state->task_)(i);
+
+					if (++state->numFinished_ == _count)
+					{
+						std::lock_guard<std::mutex> lock(state->mutex_);
+						state->condition_.notify_all();
+					}
+				}
+			};
+
+		size_t numHelpers = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			numHelpers = std::min(workers_.size(), _count - 1);
+		}
+
+		for (size_t i = 0; i < numHelpers; i++)
+		{
+			EnqueueTask(run);
+		}
+		run();
+
+		std::unique_lock<std::mutex> lock(state->mutex_);
+		state->condition_.wait(lock, [&state, _count] { return state->numFinished_ == _count; });
+	}
+
 	void ThreadPool::WorkerThread()
 	{
 		while (true)
@@ -2,6 +2,7 @@
 #include <queue>
 #include <condition_variable>
 #include <functional>
+#include <thread>
 #include "utility/forward_declaration.h"
 
 namespace thread
@@ -20,6 +21,10 @@ namespace thread
 	public:
 		static void EnqueueTask(std::function<void()> _task);
 
+		// runs _task for every index in [0, _count) and returns once all of them finished,
+		// the calling thread takes part so this is safe to call from a worker or before initialization
+		static void ParallelFor(size_t _count, const std::function<void(size_t)>& _task);
+
 	private:
 		static void Initialize(size_t _numThreads = 4);
 		static void Deinitialize();
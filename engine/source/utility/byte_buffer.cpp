@@ -3,6 +3,24 @@
 
 namespace utility
 {
+	void ByteBuffer::Layout::AddAttribute(size_t _size)
+	{
+		Attribute attribute;
+		attribute.offset_ = attributes_.empty() ? 0 : (attributes_.back().offset_ + attributes_.back().size_);
+		attribute.size_ = _size;
+		attributes_.push_back(attribute);
+	}
+
+	void ByteBuffer::Layout::AddAttribute(size_t _size, size_t _offset)
+	{
+		assert(attributes_.empty() || _offset >= attributes_.back().offset_ + attributes_.back().size_);
+
+		Attribute attribute;
+		attribute.offset_ = _offset;
+		attribute.size_ = _size;
+		attributes_.push_back(attribute);
+	}
+
 	const ByteBuffer::Layout::Attribute& ByteBuffer::Layout::GetAttribute(size_t _index) const
 	{
 		return attributes_[_index];
@@ -25,12 +43,7 @@ namespace utility
 
 	size_t ByteBuffer::Layout::GetSizeInBytes() const
 	{
-		size_t totalSize = 0;
-		for (const auto& attribute : attributes_)
-		{
-			totalSize += attribute.size_;
-		}
-		return totalSize;
+		return attributes_.empty() ? 0 : (attributes_.back().offset_ + attributes_.back().size_);
 	}
 
 	ByteBuffer::Element::Element(const Layout& _layout, const uint8_t* _rawData)
@@ -80,6 +93,18 @@ namespace utility
 		return Element(*layout_, rawBytes_.data() + (layout_->GetSizeInBytes() * _index));
 	}
 
+	void ByteBuffer::Resize(size_t _numElements)
+	{
+		assert(layout_.has_value());
+
+		rawBytes_.resize(_numElements * layout_->GetSizeInBytes());
+	}
+
+	uint8_t* ByteBuffer::GetRawBufferAddress()
+	{
+		return rawBytes_.data();
+	}
+
 	const uint8_t* ByteBuffer::GetRawBufferAddress() const
 	{
 		return rawBytes_.data();
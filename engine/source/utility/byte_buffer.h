@@ -27,6 +27,9 @@ namespace utility
 		public:
 			template<typename T>
 			void AddAttribute();
+			void AddAttribute(size_t _size);
+			// for layouts with padding like uniform blocks, offsets may not go backwards
+			void AddAttribute(size_t _size, size_t _offset);
 			const Attribute& GetAttribute(size_t _index) const;
 
 			size_t GetAttributeOffset(size_t _index) const;
@@ -64,7 +67,9 @@ namespace utility
 
 		Element Add();
 		Element At(size_t _index) const;
+		void Resize(size_t _numElements);
 
+		uint8_t* GetRawBufferAddress();
 		const uint8_t* GetRawBufferAddress() const;
 	};
 }
@@ -80,9 +85,6 @@ namespace utility
 	template<typename T>
 	inline void ByteBuffer::Layout::AddAttribute()
 	{
-		Attribute attribute;
-		attribute.offset_ = attributes_.empty() ? 0 : (attributes_.back().offset_ + attributes_.back().size_);
-		attribute.size_ = sizeof(T);
-		attributes_.push_back(attribute);
+		AddAttribute(sizeof(T));
 	}
 }
\ No newline at end of file
@@ -19,12 +19,18 @@ namespace graphics
 
 	class RenderPass;
 	class Renderer;
+	class AssetRegistry;
+	class Streamable;
+	class ResidencyManager;
 
 	class ShaderBinding;
 	struct ShaderDescriptor;
+	class ShaderReflection;
 
 	struct Viewport;
+	struct Drawable;
 	enum class PrimitiveTopology;
+	enum class IndexFormat;
 	enum class ComparisonFunc;
 	enum class RasterizerState;
 	enum class BlendState;
@@ -33,6 +39,10 @@ namespace graphics
 
 	class VulkanAPI;
 	class VulkanPipeline;
+	class VulkanPipelineCache;
+	class VulkanMemoryAllocator;
+	class VulkanStagingRing;
+	class VulkanDescriptorAllocator;
 	class VulkanRenderTarget;
 	class VulkanMesh;
 	class VulkanMaterial;
@@ -44,6 +54,19 @@ namespace graphics
 namespace file
 {
 	class Explorer;
+	class MappedFile;
+	class Archive;
+	class VirtualFileSystem;
+	class BlockCompressor;
+	class MeshCache;
+	class MeshOptimizer;
+	class MeshSimplifier;
+	class MeshletBuilder;
+	class MipGenerator;
+	class TextureContainer;
 	struct Image;
 	struct Model;
+	struct Mesh;
+	struct MeshLod;
+	struct Meshlet;
 }
\ No newline at end of file
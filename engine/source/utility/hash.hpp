@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace utility
+{
+	// 64 bit murmurhash (64a), fast enough to fingerprint whole files and vertex buffers
+	inline uint64_t HashBytes(const void* _data, size_t _size, uint64_t _seed = 0)
+	{
+		constexpr uint64_t multiplier = 0xc6a4a7935bd1e995ull;
+		constexpr int shift = 47;
+
+		const uint8_t* bytes = (const uint8_t*)_data;
+		uint64_t hash = _seed ^ (_size * multiplier);
+
+		const size_t numWords = _size / sizeof(uint64_t);
+		for (size_t i = 0; i < numWords; i++)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+
+			word *= multiplier;
+			word ^= word >> shift;
+			word *= multiplier;
+
+			hash ^= word;
+			hash *= multiplier;
+		}
+
+		const uint8_t* tail = bytes + numWords * sizeof(uint64_t);
+		const size_t numTailBytes = _size % sizeof(uint64_t);
+		if (numTailBytes > 0)
+		{
+			for (size_t i = 0; i < numTailBytes; i++)
+			{
+				hash ^= (uint64_t)tail[i] << (i * 8);
+			}
+			hash *= multiplier;
+		}
+
+		hash ^= hash >> shift;
+		hash *= multiplier;
+		hash ^= hash >> shift;
+		return hash;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,371 @@
+#include "shader_compiler.h"
+#include "hash.hpp"
+#include "log.h"
+#include "file/binary_file.h"
+#include "thread/thread_pool.h"
+#include <shaderc/shaderc.hpp>
+#include <glslang/build_info.h>
+#include <vulkan/vulkan_core.h>
+#include <array>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
+
+namespace utility
+{
+	namespace
+	{
+		struct Stage
+		{
+			const char* extension_;
+			shaderc_shader_kind kind_;
+		};
+
+		constexpr std::array<Stage, 6> stages =
+		{{
+			{ ".vert", shaderc_vertex_shader },
+			{ ".frag", shaderc_fragment_shader },
+			{ ".comp", shaderc_compute_shader },
+			{ ".geom", shaderc_geometry_shader },
+			{ ".tesc", shaderc_tess_control_shader },
+			{ ".tese", shaderc_tess_evaluation_shader },
+		}};
+
+		struct Shader
+		{
+			std::filesystem::path sourcePath_;
+			std::string name_; // binary path relative to the output directory, the source path relative to the input directory with .spv appended
+			shaderc_shader_kind kind_ = shaderc_vertex_shader;
+		};
+
+		// a shader and everything it includes by normalized path, read once for both the hash and the compiler
+		using Sources = std::map<std::string, std::string>;
+
+		std::string Normalize(const std::filesystem::path& _path)
+		{
+			std::error_code error;
+			const std::filesystem::path absolute = std::filesystem::absolute(_path, error);
+			return (error ? _path : absolute).lexically_normal().generic_string();
+		}
+
+		bool ReadFile(const std::filesystem::path& _path, std::string& _outText)
+		{
+			std::ifstream stream(_path, std::ios::binary);
+			if (!stream)
+			{
+				return false;
+			}
+
+			std::ostringstream text;
+			text << stream.rdbuf();
+			_outText = text.str();
+			return true;
+		}
+
+		// quoted includes look next to the including file first, both forms then fall back to the input directory
+		std::optional<std::filesystem::path> ResolveInclude(const std::string& _requested, const std::filesystem::path& _requestingPath, bool _relative, const std::filesystem::path& _inputDirectory)
+		{
+			std::error_code error;
+			if (_relative)
+			{
+				const std::filesystem::path candidate = _requestingPath.parent_path() / _requested;
+				if (std::filesystem::is_regular_file(candidate, error))
+				{
+					return candidate;
+				}
+			}
+
+			const std::filesystem::path candidate = _inputDirectory / _requested;
+			if (std::filesystem::is_regular_file(candidate, error))
+			{
+				return candidate;
+			}
+
+			return std::nullopt;
+		}
+
+		// includes inside disabled branches are gathered as well, which at worst compiles a shader once too often
+		void GatherSources(const std::filesystem::path& _path, const std::filesystem::path& _inputDirectory, Sources& _outSources)
+		{
+			const std::string key = Normalize(_path);
+			if (_outSources.contains(key))
+			{
+				return;
+			}
+
+			std::string text;
+			if (!ReadFile(_path, text))
+			{
+				return;
+			}
+
+			_outSources[key] = text;
+
+			std::istringstream lines(text);
+			std::string line;
+			while (std::getline(lines, line))
+			{
+				const size_t hash = line.find_first_not_of(" \t");
+				if (hash == std::string::npos || line[hash] != '#')
+				{
+					continue;
+				}
+
+				const size_t directive = line.find_first_not_of(" \t", hash + 1);
+				if (directive == std::string::npos || line.compare(directive, 7, "include") != 0)
+				{
+					continue;
+				}
+
+				const size_t open = line.find_first_of("\"<", directive + 7);
+				if (open == std::string::npos)
+				{
+					continue;
+				}
+
+				const size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+				if (close == std::string::npos)
+				{
+					continue;
+				}
+
+				const std::optional<std::filesystem::path> include = ResolveInclude(line.substr(open + 1, close - open - 1), key, line[open] == '"', _inputDirectory);
+				if (include)
+				{
+					GatherSources(*include, _inputDirectory, _outSources);
+				}
+			}
+		}
+
+		// serves includes from the gathered sources so the compiler sees exactly what was hashed
+		class Includer final : public shaderc::CompileOptions::IncluderInterface
+		{
+		private:
+			struct Include
+			{
+				shaderc_include_result result_{};
+				std::string name_;
+				std::string message_;
+			};
+
+		private:
+			const Sources& sources_;
+			const std::filesystem::path inputDirectory_;
+
+		public:
+			Includer(const Sources& _sources, const std::filesystem::path& _inputDirectory)
+				: sources_(_sources)
+				, inputDirectory_(_inputDirectory)
+			{}
+
+		public:
+			shaderc_include_result* GetInclude(const char* _requestedSource, shaderc_include_type _type, const char* _requestingSource, size_t) override
+			{
+				Include* include = new Include();
+				include->result_.user_data = include;
+
+				const std::optional<std::filesystem::path> path = ResolveInclude(_requestedSource, _requestingSource, _type == shaderc_include_type_relative, inputDirectory_);
+				const auto source = path ? sources_.find(Normalize(*path)) : sources_.end();
+				if (source == sources_.end())
+				{
+					include->message_ = std::string("cannot find include ") + _requestedSource;
+					include->result_.content = include->message_.data();
+					include->result_.content_length = include->message_.size();
+					return &include->result_;
+				}
+
+				include->name_ = source->first;
+				include->result_.source_name = include->name_.data();
+				include->result_.source_name_length = include->name_.size();
+				include->result_.content = source->second.data();
+				include->result_.content_length = source->second.size();
+				return &include->result_;
+			}
+
+			void ReleaseInclude(shaderc_include_result* _result) override
+			{
+				delete (Include*)_result->user_data;
+			}
+		};
+
+		// anything besides the sources that changes the binary
+		uint64_t GetCompilerHash(const ShaderCompiler::Defines& _defines)
+		{
+			// shaderc comes with the sdk, its header version stands for shaderc and spirv-tools next to glslang's own
+			std::string compiler = std::to_string(ShaderCompiler::version) + "|" + std::to_string(VK_HEADER_VERSION_COMPLETE) + "|" +
+				std::to_string(GLSLANG_VERSION_MAJOR) + "." + std::to_string(GLSLANG_VERSION_MINOR) + "." + std::to_string(GLSLANG_VERSION_PATCH) + GLSLANG_VERSION_FLAVOR;
+			for (const auto& [name, value] : _defines)
+			{
+				compiler += "|" + name + "=" + value;
+			}
+
+			return HashBytes(compiler.data(), compiler.size());
+		}
+
+		uint64_t GetShaderHash(const Shader& _shader, const Sources& _sources, uint64_t _compilerHash)
+		{
+			uint64_t hash = HashBytes(&_shader.kind_, sizeof(_shader.kind_), _compilerHash);
+			// contents only, moving the tree around does not compile anything
+			for (const auto& [path, text] : _sources)
+			{
+				hash = HashBytes(text.data(), text.size(), hash);
+			}
+			return hash;
+		}
+
+		// one line per binary : name and key, tab separated
+		std::unordered_map<std::string, uint64_t> ReadCache(const std::filesystem::path& _path)
+		{
+			std::unordered_map<std::string, uint64_t> cache;
+
+			std::ifstream stream(_path);
+			std::string line;
+			while (std::getline(stream, line))
+			{
+				const size_t tab = line.find('\t');
+				if (tab != std::string::npos)
+				{
+					cache[line.substr(0, tab)] = std::strtoull(line.c_str() + tab + 1, nullptr, 16);
+				}
+			}
+
+			return cache;
+		}
+
+		bool WriteCache(const std::filesystem::path& _path, const std::map<std::string, uint64_t>& _cache)
+		{
+			return file::WriteAtomically(_path, [&_cache](std::ostream& _stream)
+				{
+					for (const auto& [name, key] : _cache)
+					{
+						_stream << name << "\t" << std::hex << key << std::dec << "\n";
+					}
+					return true;
+				});
+		}
+
+		bool WriteBinary(const std::filesystem::path& _path, const shaderc::SpvCompilationResult& _result)
+		{
+			const std::vector<uint32_t> words(_result.cbegin(), _result.cend());
+
+			std::ofstream stream(_path, std::ios::binary | std::ios::trunc);
+			stream.write((const char*)words.data(), words.size() * sizeof(uint32_t));
+			return (bool)stream;
+		}
+	}
+
+	bool ShaderCompiler::CompileShaders(std::string_view _inputDirectory, std::string_view _outputDirectory, const Defines& _defines)
+	{
+		const std::filesystem::path inputDirectory(_inputDirectory);
+		const std::filesystem::path outputDirectory(_outputDirectory);
+
+		std::vector<Shader> shaders;
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(inputDirectory, error), end; !error && it != end; it.increment(error))
+		{
+			if (!it->is_regular_file())
+			{
+				continue;
+			}
+
+			const std::string extension = it->path().extension().string();
+			for (const Stage& stage : stages)
+			{
+				if (extension == stage.extension_)
+				{
+					shaders.push_back({ it->path(), it->path().lexically_relative(inputDirectory).generic_string() + ".spv", stage.kind_ });
+				}
+			}
+		}
+
+		if (error)
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::error, "failed to list shaders in " + inputDirectory.string()) << std::endl;
+			return false;
+		}
+
+		std::filesystem::create_directories(outputDirectory, error);
+
+		const std::unordered_map<std::string, uint64_t> previousCache = ReadCache(outputDirectory / cacheName);
+		const uint64_t compilerHash = GetCompilerHash(_defines);
+		const shaderc::Compiler compiler;
+
+		// a failed shader keeps its previous key, that still matches the binary it left in place
+		std::vector<std::optional<uint64_t>> keys(shaders.size());
+		std::atomic<size_t> numCompiled = 0;
+		std::atomic<size_t> numFailed = 0;
+
+		thread::ThreadPool::ParallelFor(shaders.size(), [&](size_t _index)
+			{
+				const Shader& shader = shaders[_index];
+				const std::filesystem::path outputPath = outputDirectory / shader.name_;
+				const auto previous = previousCache.find(shader.name_);
+
+				Sources sources;
+				GatherSources(shader.sourcePath_, inputDirectory, sources);
+
+				const std::string sourceName = Normalize(shader.sourcePath_);
+				const auto source = sources.find(sourceName);
+				if (source == sources.end())
+				{
+					std::cout << Log::Format(Log::Category::graphics, Log::Level::error, "failed to read shader " + shader.sourcePath_.string()) << std::endl;
+					keys[_index] = (previous != previousCache.end()) ? std::optional<uint64_t>(previous->second) : std::nullopt;
+					numFailed++;
+					return;
+				}
+
+				const uint64_t key = GetShaderHash(shader, sources, compilerHash);
+				std::error_code existsError;
+				if (previous != previousCache.end() && previous->second == key && std::filesystem::exists(outputPath, existsError))
+				{
+					keys[_index] = key;
+					return;
+				}
+
+				std::error_code directoryError;
+				std::filesystem::create_directories(outputPath.parent_path(), directoryError);
+
+				shaderc::CompileOptions options;
+				options.SetIncluder(std::make_unique<Includer>(sources, inputDirectory));
+				for (const auto& [name, value] : _defines)
+				{
+					options.AddMacroDefinition(name, value);
+				}
+
+				const shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source->second.data(), source->second.size(), shader.kind_, sourceName.c_str(), "main", options);
+				if (result.GetCompilationStatus() != shaderc_compilation_status_success || !WriteBinary(outputPath, result))
+				{
+					std::cout << Log::Format(Log::Category::graphics, Log::Level::error, "failed to compile " + shader.sourcePath_.string() + "\n" + result.GetErrorMessage()) << std::endl;
+					keys[_index] = (previous != previousCache.end()) ? std::optional<uint64_t>(previous->second) : std::nullopt;
+					numFailed++;
+					return;
+				}
+
+				keys[_index] = key;
+				numCompiled++;
+			});
+
+		std::map<std::string, uint64_t> cache;
+		for (size_t i = 0; i < shaders.size(); i++)
+		{
+			if (keys[i])
+			{
+				cache[shaders[i].name_] = *keys[i];
+			}
+		}
+
+		if (!WriteCache(outputDirectory / cacheName, cache))
+		{
+			std::cout << Log::Format(Log::Category::graphics, Log::Level::warning, "failed to write shader cache in " + outputDirectory.string()) << std::endl;
+		}
+
+		std::cout << Log::Format(Log::Category::graphics, Log::Level::message, "compiled " + std::to_string(numCompiled) + " shaders, " +
+			std::to_string(shaders.size() - numCompiled - numFailed) + " up to date, " + std::to_string(numFailed) + " failed") << std::endl;
+
+		return numFailed == 0;
+	}
+}
\ No newline at end of file
@@ -1,15 +1,24 @@
 #pragma once
+#include <cstdint>
+#include <string>
 #include <string_view>
-#include "file/path.generated.h"
+#include <utility>
+#include <vector>
 
 namespace utility
 {
+	// compiles glsl in process, every shader below the input directory becomes <relative path>.spv in the output directory,
+	// a cache next to the binaries is keyed by the hash of source, includes, defines and compiler so unchanged shaders only cost a hash
 	class ShaderCompiler final
 	{
 	public:
-		static void CompileShaders(std::string_view _inputDirectory, std::string_view _outputDirectory)
-		{
-			system((std::string(PATH_SHADER_COMPILER) + " " + std::string(_inputDirectory) + " " + std::string(_outputDirectory)).c_str());
-		}
+		using Defines = std::vector<std::pair<std::string, std::string>>;
+
+		static constexpr uint32_t version = 1; // bump when compile options change, every shader is compiled again
+		static constexpr const char* cacheName = "shader_cache.txt";
+
+	public:
+		// shaders compile in parallel on the thread pool, false when any of them failed, failed shaders keep their previous binary
+		static bool CompileShaders(std::string_view _inputDirectory, std::string_view _outputDirectory, const Defines& _defines = {});
 	};
 }
\ No newline at end of file
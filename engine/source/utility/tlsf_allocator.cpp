@@ -0,0 +1,281 @@
+#include "tlsf_allocator.h"
+#include <bit>
+#include <stdexcept>
+
+namespace utility
+{
+	TlsfAllocator::TlsfAllocator(uint64_t _size)
+		: size_(_size)
+	{
+		freeLists_.fill(invalidNode);
+
+		if (size_ > 0)
+		{
+			const uint32_t node = CreateNode();
+			nodes_[node].size_ = size_;
+			nodes_[node].free_ = true;
+			InsertFree(node);
+		}
+	}
+
+	std::optional<TlsfAllocator::Allocation> TlsfAllocator::Allocate(uint64_t _size, uint64_t _alignment)
+	{
+		const uint64_t size = (_size > 0) ? _size : 1;
+		const uint64_t alignment = (_alignment > 0) ? _alignment : 1;
+		if (size > size_ || alignment - 1 > size_ - size)
+		{
+			return std::nullopt;
+		}
+
+		// worst case padding is taken into the search so any node found fits once aligned
+		const uint64_t searchSize = size + alignment - 1;
+		uint32_t node = FindFree(searchSize);
+		if (node == invalidNode)
+		{
+			return std::nullopt;
+		}
+		RemoveFree(node);
+
+		const uint64_t offset = nodes_[node].offset_;
+		const uint64_t padding = ((offset + alignment - 1) & ~(alignment - 1)) - offset;
+		if (padding > 0)
+		{
+			// the front padding stays free, its physical predecessor is never free so nothing merges
+			Split(node, padding);
+			const uint32_t tail = nodes_[node].nextPhysical_;
+			RemoveFree(tail);
+			InsertFree(node);
+			node = tail;
+		}
+
+		if (nodes_[node].size_ > size)
+		{
+			Split(node, size);
+		}
+
+		nodes_[node].free_ = false;
+		usedSize_ += size;
+		numAllocations_++;
+
+		Allocation allocation;
+		allocation.offset_ = nodes_[node].offset_;
+		allocation.size_ = size;
+		allocation.node_ = node;
+		return allocation;
+	}
+
+	void TlsfAllocator::Free(const Allocation& _allocation)
+	{
+		uint32_t node = _allocation.node_;
+		if (node >= nodes_.size() || nodes_[node].free_)
+		{
+			throw std::runtime_error("TlsfAllocator::Free() : allocation is not live");
+		}
+
+		usedSize_ -= nodes_[node].size_;
+		numAllocations_--;
+		nodes_[node].free_ = true;
+
+		const uint32_t prev = nodes_[node].prevPhysical_;
+		if (prev != invalidNode && nodes_[prev].free_)
+		{
+			RemoveFree(prev);
+			nodes_[prev].size_ += nodes_[node].size_;
+			nodes_[prev].nextPhysical_ = nodes_[node].nextPhysical_;
+			if (nodes_[node].nextPhysical_ != invalidNode)
+			{
+				nodes_[nodes_[node].nextPhysical_].prevPhysical_ = prev;
+			}
+			DestroyNode(node);
+			node = prev;
+		}
+
+		const uint32_t next = nodes_[node].nextPhysical_;
+		if (next != invalidNode && nodes_[next].free_)
+		{
+			RemoveFree(next);
+			nodes_[node].size_ += nodes_[next].size_;
+			nodes_[node].nextPhysical_ = nodes_[next].nextPhysical_;
+			if (nodes_[next].nextPhysical_ != invalidNode)
+			{
+				nodes_[nodes_[next].nextPhysical_].prevPhysical_ = node;
+			}
+			DestroyNode(next);
+		}
+
+		InsertFree(node);
+	}
+
+	uint64_t TlsfAllocator::GetSize() const
+	{
+		return size_;
+	}
+
+	uint64_t TlsfAllocator::GetUsedSize() const
+	{
+		return usedSize_;
+	}
+
+	uint32_t TlsfAllocator::GetNumAllocations() const
+	{
+		return numAllocations_;
+	}
+
+	bool TlsfAllocator::IsEmpty() const
+	{
+		return numAllocations_ == 0;
+	}
+
+	void TlsfAllocator::Map(uint64_t _size, uint32_t& _outFirstLevel, uint32_t& _outSecondLevel)
+	{
+		// sizes below numSecondLevels get one list each, above that every power of two is cut into numSecondLevels lists
+		if (_size < numSecondLevels)
+		{
+			_outFirstLevel = 0;
+			_outSecondLevel = (uint32_t)_size;
+			return;
+		}
+
+		const uint32_t mostSignificantBit = (uint32_t)std::bit_width(_size) - 1;
+		_outFirstLevel = mostSignificantBit - numSecondLevelBits + 1;
+		_outSecondLevel = (uint32_t)(_size >> (mostSignificantBit - numSecondLevelBits)) - numSecondLevels;
+	}
+
+	uint32_t TlsfAllocator::FindFree(uint64_t _size) const
+	{
+		// rounded up to the next list so its head always fits without walking the list
+		uint64_t roundedSize = _size;
+		if (_size >= numSecondLevels)
+		{
+			const uint64_t rounding = (1ull << (std::bit_width(_size) - 1 - numSecondLevelBits)) - 1;
+			roundedSize = (_size <= UINT64_MAX - rounding) ? _size + rounding : _size;
+		}
+
+		uint32_t firstLevel = 0;
+		uint32_t secondLevel = 0;
+		Map(roundedSize, firstLevel, secondLevel);
+
+		uint32_t secondLevelBitmap = (firstLevel < numFirstLevels) ? secondLevelBitmaps_[firstLevel] & (~0u << secondLevel) : 0;
+		if (secondLevelBitmap == 0)
+		{
+			const uint64_t firstLevelBitmap = (firstLevel + 1 < 64) ? firstLevelBitmap_ & (~0ull << (firstLevel + 1)) : 0;
+			if (firstLevelBitmap != 0)
+			{
+				firstLevel = (uint32_t)std::countr_zero(firstLevelBitmap);
+				secondLevelBitmap = secondLevelBitmaps_[firstLevel];
+			}
+		}
+
+		if (secondLevelBitmap != 0)
+		{
+			return freeLists_[firstLevel * numSecondLevels + std::countr_zero(secondLevelBitmap)];
+		}
+
+		// rounding skips the list _size itself maps to, one that only holds an exact fit like a block's very first allocation is walked here
+		Map(_size, firstLevel, secondLevel);
+		for (uint32_t node = freeLists_[firstLevel * numSecondLevels + secondLevel]; node != invalidNode; node = nodes_[node].nextFree_)
+		{
+			if (nodes_[node].size_ >= _size)
+			{
+				return node;
+			}
+		}
+
+		return invalidNode;
+	}
+
+	void TlsfAllocator::InsertFree(uint32_t _node)
+	{
+		uint32_t firstLevel = 0;
+		uint32_t secondLevel = 0;
+		Map(nodes_[_node].size_, firstLevel, secondLevel);
+
+		uint32_t& head = freeLists_[firstLevel * numSecondLevels + secondLevel];
+		nodes_[_node].prevFree_ = invalidNode;
+		nodes_[_node].nextFree_ = head;
+		if (head != invalidNode)
+		{
+			nodes_[head].prevFree_ = _node;
+		}
+		head = _node;
+
+		firstLevelBitmap_ |= 1ull << firstLevel;
+		secondLevelBitmaps_[firstLevel] |= 1u << secondLevel;
+	}
+
+	void TlsfAllocator::RemoveFree(uint32_t _node)
+	{
+		uint32_t firstLevel = 0;
+		uint32_t secondLevel = 0;
+		Map(nodes_[_node].size_, firstLevel, secondLevel);
+
+		const uint32_t prev = nodes_[_node].prevFree_;
+		const uint32_t next = nodes_[_node].nextFree_;
+		if (prev != invalidNode)
+		{
+			nodes_[prev].nextFree_ = next;
+		}
+		if (next != invalidNode)
+		{
+			nodes_[next].prevFree_ = prev;
+		}
+
+		uint32_t& head = freeLists_[firstLevel * numSecondLevels + secondLevel];
+		if (head == _node)
+		{
+			head = next;
+			if (head == invalidNode)
+			{
+				secondLevelBitmaps_[firstLevel] &= ~(1u << secondLevel);
+				if (secondLevelBitmaps_[firstLevel] == 0)
+				{
+					firstLevelBitmap_ &= ~(1ull << firstLevel);
+				}
+			}
+		}
+
+		nodes_[_node].prevFree_ = invalidNode;
+		nodes_[_node].nextFree_ = invalidNode;
+	}
+
+	uint32_t TlsfAllocator::CreateNode()
+	{
+		if (!unusedNodes_.empty())
+		{
+			const uint32_t node = unusedNodes_.back();
+			unusedNodes_.pop_back();
+			nodes_[node] = Node{};
+			return node;
+		}
+
+		nodes_.emplace_back();
+		return (uint32_t)nodes_.size() - 1;
+	}
+
+	void TlsfAllocator::DestroyNode(uint32_t _node)
+	{
+		nodes_[_node] = Node{};
+		unusedNodes_.push_back(_node);
+	}
+
+	void TlsfAllocator::Split(uint32_t _node, uint64_t _size)
+	{
+		const uint32_t tail = CreateNode();
+
+		Node& node = nodes_[_node];
+		Node& tailNode = nodes_[tail];
+		tailNode.offset_ = node.offset_ + _size;
+		tailNode.size_ = node.size_ - _size;
+		tailNode.prevPhysical_ = _node;
+		tailNode.nextPhysical_ = node.nextPhysical_;
+		tailNode.free_ = true;
+		if (node.nextPhysical_ != invalidNode)
+		{
+			nodes_[node.nextPhysical_].prevPhysical_ = tail;
+		}
+		node.size_ = _size;
+		node.nextPhysical_ = tail;
+
+		InsertFree(tail);
+	}
+}
\ No newline at end of file
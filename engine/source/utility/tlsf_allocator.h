@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace utility
+{
+	// two level segregated fit over an offset range, allocating and freeing take constant time and free neighbours merge at once,
+	// only offsets are handed out so any kind of memory can sit behind it
+	class TlsfAllocator
+	{
+	public:
+		static constexpr uint32_t invalidNode = UINT32_MAX;
+
+		struct Allocation
+		{
+			uint64_t offset_ = 0;
+			uint64_t size_ = 0;
+			uint32_t node_ = invalidNode;
+		};
+
+	private:
+		static constexpr uint32_t numSecondLevelBits = 4;
+		static constexpr uint32_t numSecondLevels = 1 << numSecondLevelBits;
+		static constexpr uint32_t numFirstLevels = 64 - numSecondLevelBits + 1;
+
+		struct Node
+		{
+			uint64_t offset_ = 0;
+			uint64_t size_ = 0;
+			uint32_t prevPhysical_ = invalidNode;
+			uint32_t nextPhysical_ = invalidNode;
+			uint32_t prevFree_ = invalidNode;
+			uint32_t nextFree_ = invalidNode;
+			bool free_ = false;
+		};
+
+	private:
+		uint64_t size_ = 0;
+		uint64_t usedSize_ = 0;
+		uint32_t numAllocations_ = 0;
+		std::vector<Node> nodes_;
+		std::vector<uint32_t> unusedNodes_;
+		uint64_t firstLevelBitmap_ = 0;
+		std::array<uint32_t, numFirstLevels> secondLevelBitmaps_{};
+		std::array<uint32_t, numFirstLevels * numSecondLevels> freeLists_;
+
+	public:
+		TlsfAllocator(uint64_t _size);
+
+	public:
+		// nullopt when no free region can hold _size bytes at _alignment, which must be a power of two
+		std::optional<Allocation> Allocate(uint64_t _size, uint64_t _alignment = 1);
+		void Free(const Allocation& _allocation);
+
+		uint64_t GetSize() const;
+		uint64_t GetUsedSize() const;
+		uint32_t GetNumAllocations() const;
+		bool IsEmpty() const;
+
+	private:
+		static void Map(uint64_t _size, uint32_t& _outFirstLevel, uint32_t& _outSecondLevel);
+		uint32_t FindFree(uint64_t _size) const;
+		void InsertFree(uint32_t _node);
+		void RemoveFree(uint32_t _node);
+		uint32_t CreateNode();
+		void DestroyNode(uint32_t _node);
+		// cuts _node at _size, the tail becomes a free node of its own
+		void Split(uint32_t _node, uint64_t _size);
+	};
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "application.h"
+#include "file/path.generated.h"
+#include "file/virtual_file_system.h"
 #include "graphics/vulkan/vulkan_api.h"
 #include "thread/thread_pool.h"
 
@@ -9,6 +11,10 @@ namespace window
 	{
 		thread::ThreadPool::Initialize();
 
+		// packed asset roots shadow their loose files, nothing is mounted while developing against loose assets
+		file::VirtualFileSystem::MountPacked(PATH_ENGINE_ASSET);
+		file::VirtualFileSystem::MountPacked(std::filesystem::current_path());
+
 		if (_apiType == graphics::GraphicsAPI::Type::VULKAN)
 		{
 			graphicsAPI_ = std::make_unique<graphics::VulkanAPI>(wnd_);
@@ -18,6 +24,7 @@ namespace window
 			throw std::exception("invalid graphics api type");
 		}
 
+		assetRegistry_ = std::make_unique<graphics::AssetRegistry>(*graphicsAPI_);
 		renderer_ = std::make_unique<graphics::Renderer>();
 	}
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "window/window.h"
 #include "graphics/renderer.h"
+#include "graphics/asset_registry.h"
 
 namespace window
 {
@@ -12,6 +13,7 @@ namespace window
 
 	protected:
 		std::unique_ptr<graphics::GraphicsAPI> graphicsAPI_;
+		std::unique_ptr<graphics::AssetRegistry> assetRegistry_;
 		std::unique_ptr<graphics::Renderer> renderer_;
 
 	public:
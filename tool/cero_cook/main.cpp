@@ -0,0 +1,99 @@
+#include "file/asset_cooker.h"
+#include <iostream>
+#include <string_view>
+
+namespace
+{
+	constexpr std::pair<std::string_view, file::Image::Format> formats[] =
+	{
+		{ "bc1", file::Image::Format::BC1 },
+		{ "bc3", file::Image::Format::BC3 },
+		{ "bc4", file::Image::Format::BC4 },
+		{ "bc5", file::Image::Format::BC5 },
+		{ "bc7", file::Image::Format::BC7 },
+	};
+
+	// "none" leaves textures uncompressed
+	std::optional<file::Image::Format> ParseFormat(std::string_view _name, bool& _outValid)
+	{
+		for (const auto& [name, format] : formats)
+		{
+			if (name == _name)
+			{
+				_outValid = true;
+				return format;
+			}
+		}
+
+		_outValid = (_name == "none");
+		return std::nullopt;
+	}
+}
+
+// cooks every model and texture below a directory, runs again only cook what changed since
+int main(int _argc, char** _argv)
+{
+	if (_argc < 3)
+	{
+		std::cout << "usage : cero_cook <source directory> <output directory> [--color bc1|bc3|bc7|none] [--normal bc5|bc7|none] [--linear] [--quality fast|normal|high] [--deflate] [--threads n] [--force]" << std::endl;
+		return 1;
+	}
+
+	file::AssetCooker::Settings settings;
+	settings.sourceRoot_ = std::filesystem::path(_argv[1]).lexically_normal();
+	settings.outputRoot_ = std::filesystem::path(_argv[2]).lexically_normal();
+
+	for (int i = 3; i < _argc; i++)
+	{
+		const std::string_view argument = _argv[i];
+		const std::string_view value = (i + 1 < _argc) ? _argv[i + 1] : "";
+		bool valid = true;
+
+		if (argument == "--color")
+		{
+			settings.colorFormat_ = ParseFormat(value, valid);
+			i++;
+		}
+		else if (argument == "--normal")
+		{
+			settings.normalFormat_ = ParseFormat(value, valid);
+			i++;
+		}
+		else if (argument == "--quality")
+		{
+			valid = (value == "fast" || value == "normal" || value == "high");
+			settings.quality_ = (value == "fast") ? file::BlockCompressor::Quality::FAST : (value == "high") ? file::BlockCompressor::Quality::HIGH : file::BlockCompressor::Quality::NORMAL;
+			i++;
+		}
+		else if (argument == "--threads")
+		{
+			settings.numThreads_ = (uint32_t)std::strtoul(value.data(), nullptr, 10);
+			i++;
+		}
+		else if (argument == "--linear")
+		{
+			settings.srgb_ = false;
+		}
+		else if (argument == "--deflate")
+		{
+			settings.supercompression_ = file::TextureContainer::Supercompression::ZLIB;
+		}
+		else if (argument == "--force")
+		{
+			settings.force_ = true;
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if (!valid)
+		{
+			std::cout << "invalid argument : " << argument << std::endl;
+			return 1;
+		}
+	}
+
+	file::AssetCooker::Report report;
+	return (file::AssetCooker::Cook(settings, report) && report.numFailed_ == 0) ? 0 : 1;
+}
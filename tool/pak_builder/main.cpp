@@ -0,0 +1,33 @@
+#include "file/archive.h"
+#include <iostream>
+#include <string_view>
+
+// packs a directory into a .pak, mounting it at the same directory makes every loader read from it instead
+int main(int _argc, char** _argv)
+{
+	if (_argc < 2)
+	{
+		std::cout << "usage : pak_builder <directory> [output.pak] [--deflate]" << std::endl;
+		return 1;
+	}
+
+	const std::filesystem::path root = std::filesystem::path(_argv[1]).lexically_normal();
+	std::filesystem::path outPath = root.has_filename() ? root : root.parent_path();
+	outPath += file::Archive::extension;
+
+	// stored entries are served straight from the mapping, deflated ones are inflated into a copy on every open
+	file::Archive::Compression compression = file::Archive::Compression::NONE;
+	for (int i = 2; i < _argc; i++)
+	{
+		if (std::string_view(_argv[i]) == "--deflate")
+		{
+			compression = file::Archive::Compression::ZLIB;
+		}
+		else
+		{
+			outPath = _argv[i];
+		}
+	}
+
+	return file::Archive::Build(root, outPath, compression) ? 0 : 1;
+}